@@ -75,6 +75,13 @@
         default = hyprgrd;
       };
 
+      # `nix flake check`: the daemon built with the GTK visualizer and the
+      # plugin, each running its own tests.
+      checks.${system} = {
+        daemon = hyprgrd;
+        plugin = hyprgrd-plugin;
+      };
+
       devShells.${system}.default = pkgs.mkShell {
         name = "hyprgrd";
 
@@ -0,0 +1,169 @@
+// acks.hpp — Matching the daemon's acknowledgements to sent commands.
+//
+// Mirrors src/ipc/ack.rs; keep the two in sync.
+//
+// With `plugin:hyprgrd:acks = 1` the writer thread negotiates
+// acknowledgements on every connection (protocol.hpp) and sends dispatcher
+// commands with a sequence id:
+//
+//     {"seq":7,"cmd":{"Go":"Right"}}\n          JSON
+//     [0x15][len][seq:u32][command frame]       binary
+//
+// The daemon answers each one on the same connection once it has been
+// handled, with its handling time in nanoseconds:
+//
+//     ACK 7 ok 153200\n
+//     ACK 7 err 4100 no active monitor\n
+//
+// The writer reads those lines while the connection is idle and matches
+// them here against what it sent, so nothing on Hyprland's main thread
+// ever waits for the daemon.  Failures are handed back to the main thread,
+// which shows them with addNotification.
+
+#pragma once
+
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+/// One parsed `ACK` line.  `error` points into the parsed line.
+struct AckReply {
+    uint32_t         seq      = 0;
+    bool             ok       = false;
+    uint64_t         handleNs = 0;
+    std::string_view error;
+};
+
+/// Parse an `ACK <seq> ok|err <handle_ns> [error]` line (without newline).
+inline std::optional<AckReply> parseAckReply(std::string_view line) {
+    line = trimView(line);
+    if (!line.starts_with("ACK "))
+        return std::nullopt;
+    line.remove_prefix(4);
+    auto word = [&line]() {
+        const size_t     end = std::min(line.find(' '), line.size());
+        std::string_view w   = line.substr(0, end);
+        line.remove_prefix(std::min(end + 1, line.size()));
+        return w;
+    };
+    auto number = [](std::string_view w, auto& out) {
+        const auto [end, ec] = std::from_chars(w.data(), w.data() + w.size(), out);
+        return ec == std::errc{} && end == w.data() + w.size() && !w.empty();
+    };
+
+    AckReply reply;
+    const std::string_view seq = word(), status = word(), handle = word();
+    if (!number(seq, reply.seq) || reply.seq == 0 || !number(handle, reply.handleNs))
+        return std::nullopt;
+    if (status == "ok" && line.empty())
+        reply.ok = true;
+    else if (status == "err")
+        reply.error = line;
+    else
+        return std::nullopt;
+    return reply;
+}
+
+/// Longest daemon error kept with a failure.
+inline constexpr size_t MAX_ACK_ERROR = 95;
+
+/// The outcome of one acknowledged command, trivially copyable so failures
+/// can travel to the main thread through an SpscRing.
+template <typename Message>
+struct AckResult {
+    Message  msg;             ///< The command as it was sent
+    bool     ok          = false;
+    uint64_t roundTripNs = 0; ///< Send → reply, as seen by the writer
+    uint64_t handleNs    = 0; ///< Handling time reported by the daemon
+    char     error[MAX_ACK_ERROR + 1] = {};
+
+    std::string_view errorText() const { return error; }
+};
+
+/// Acknowledgement counters; readable from any thread.
+struct AckStats {
+    std::atomic<uint64_t> acked{0};  ///< Answered "ok"
+    std::atomic<uint64_t> failed{0}; ///< Answered "err"
+    std::atomic<uint64_t> lost{0};   ///< Never answered
+};
+
+/// Commands sent with a sequence id and still waiting for their reply.
+///
+/// Keyed by `seq % WINDOW`; a command still unanswered when its slot is
+/// reused, or when the connection is replaced (`reset()`), counts as lost.
+/// Only the writer thread touches the tracker, except `stats()`.
+/// `Message` is any trivially copyable type with a `uint32_t seq` field.
+template <typename Message>
+class AckTracker {
+  public:
+    static constexpr size_t WINDOW = 64;
+
+    using Result = AckResult<Message>;
+
+    /// Remember `msg` (whose `seq` is non-zero), sent at `nowNs`.
+    void sent(const Message& msg, uint64_t nowNs) {
+        Pending& slot = m_pending[msg.seq % WINDOW];
+        if (slot.seq)
+            bump(m_stats.lost);
+        slot = Pending{.seq = msg.seq, .sentNs = nowNs, .msg = msg};
+    }
+
+    /// Match a reply line received at `nowNs`.  Returns nothing for lines
+    /// that aren't acknowledgements or answer nothing pending.
+    std::optional<Result> received(std::string_view line, uint64_t nowNs) {
+        const auto reply = parseAckReply(line);
+        if (!reply)
+            return std::nullopt;
+        Pending& slot = m_pending[reply->seq % WINDOW];
+        if (slot.seq != reply->seq)
+            return std::nullopt;
+        Result result{.msg = slot.msg};
+        result.ok          = reply->ok;
+        result.roundTripNs = nowNs - slot.sentNs;
+        result.handleNs    = reply->handleNs;
+        const size_t n     = std::min(reply->error.size(), MAX_ACK_ERROR);
+        std::memcpy(result.error, reply->error.data(), n);
+        slot.seq = 0;
+        bump(result.ok ? m_stats.acked : m_stats.failed);
+        return result;
+    }
+
+    /// Forget everything pending (the connection was replaced), counting it
+    /// as lost.  Returns how many commands were lost.
+    size_t reset() {
+        size_t lost = 0;
+        for (auto& slot : m_pending) {
+            lost += slot.seq != 0;
+            slot.seq = 0;
+        }
+        m_stats.lost.fetch_add(lost, std::memory_order_relaxed);
+        return lost;
+    }
+
+    /// Commands waiting for their reply.
+    size_t pending() const {
+        return static_cast<size_t>(std::count_if(m_pending.begin(), m_pending.end(), [](const Pending& p) { return p.seq != 0; }));
+    }
+
+    const AckStats& stats() const { return m_stats; }
+
+  private:
+    struct Pending {
+        uint32_t seq    = 0; ///< 0: free
+        uint64_t sentNs = 0;
+        Message  msg{};
+    };
+
+    static void bump(std::atomic<uint64_t>& counter) { counter.fetch_add(1, std::memory_order_relaxed); }
+
+    std::array<Pending, WINDOW> m_pending{};
+    AckStats                    m_stats;
+};
@@ -0,0 +1,492 @@
+// Microbenchmarks for the hyprgrd plugin helpers and IPC path.
+//
+// Covers the JSON builders, message encoding, the daemon connection and
+// send queue against a mock daemon socket, a real-time replay of a swipe
+// gesture at 240 Hz through the same coalescer + queue path the swipe
+// hooks use, and the in-compositor overlay's per-move cost as the grid
+// grows.  Like the tests, this needs no Hyprland SDK.
+//
+// Build & run:
+//   cd plugin && cmake -B build-bench -DHYPRGRD_BUILD_BENCH=ON && cmake --build build-bench
+//   ./build-bench/bench_plugin [--swipe FILE] [FILTER]
+//
+// Output is one JSON object per benchmark and line on stdout, e.g.
+//
+//   {"name":"build_swipe_update_json","iterations":200000,"ns_per_op":98.1,
+//    "allocs_per_op":1.00,"ops_per_sec":10193679}
+//
+// Some benchmarks add extra fields (documented where they are emitted).
+// FILTER runs only the benchmarks whose name contains it.  `--swipe FILE`
+// replays a recorded gesture instead of the built-in one; the file holds
+// one event per line, `<time_ms> <dx> <dy>`.
+
+#include "coalescer.hpp"
+#include "connection.hpp"
+#include "helpers.hpp"
+#include "overlay.hpp"
+#include "protocol.hpp"
+#include "queue.hpp"
+#include "stats.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Harness
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Count heap allocations on the current thread (the mock daemon and the
+// send queue's writer run on their own threads and are not counted).
+static thread_local uint64_t g_allocations = 0;
+
+void* operator new(size_t n) {
+    ++g_allocations;
+    if (void* p = std::malloc(n ? n : 1))
+        return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+/// Keep the compiler from optimising a result away.
+template <typename T>
+static inline void keep(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static std::string_view g_filter;
+
+static bool selected(std::string_view name) {
+    return g_filter.empty() || name.find(g_filter) != std::string_view::npos;
+}
+
+/// Print one output record.  `extra` is appended verbatim (`,"key":value…`).
+static void emit(std::string_view name, uint64_t iterations, double nsPerOp, double allocsPerOp, double opsPerSec,
+                 const std::string& extra = {}) {
+    printf(R"({"name":"%.*s","iterations":%llu,"ns_per_op":%.1f,"allocs_per_op":%.2f,"ops_per_sec":%.0f%s})"
+           "\n",
+           static_cast<int>(name.size()), name.data(), static_cast<unsigned long long>(iterations), nsPerOp,
+           allocsPerOp, opsPerSec, extra.c_str());
+    fflush(stdout);
+}
+
+/// Print the record of `iterations` ops that took `elapsedNs` in total.
+static void report(std::string_view name, uint64_t iterations, uint64_t elapsedNs, uint64_t allocations,
+                   const std::string& extra = {}) {
+    const double ops = static_cast<double>(iterations);
+    emit(name, iterations, static_cast<double>(elapsedNs) / ops, static_cast<double>(allocations) / ops,
+         elapsedNs ? ops * 1e9 / static_cast<double>(elapsedNs) : 0.0, extra);
+}
+
+/// Run `fn(i)` `iterations` times (after a short warm-up) and report it.
+template <typename Fn>
+static void bench(std::string_view name, uint64_t iterations, Fn&& fn) {
+    if (!selected(name))
+        return;
+    for (uint64_t i = 0; i < iterations / 10; ++i)
+        fn(i);
+    const uint64_t allocs = g_allocations;
+    const uint64_t start  = nowNs();
+    for (uint64_t i = 0; i < iterations; ++i)
+        fn(i);
+    const uint64_t elapsed = nowNs() - start;
+    report(name, iterations, elapsed, g_allocations - allocs);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Mock daemon
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Unix-socket server standing in for the daemon: accepts one client at a
+/// time, answers the binary handshake and counts the messages it receives
+/// (JSON lines or binary frames).
+class MockDaemon {
+  public:
+    explicit MockDaemon(const char* name) {
+        m_path = "/tmp/hyprgrd-plugin-bench-" + std::to_string(getpid()) + "-" + name + ".sock";
+        unlink(m_path.c_str());
+        m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un addr {};
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, m_path.c_str(), sizeof(addr.sun_path) - 1);
+        if (bind(m_listen, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 || listen(m_listen, 4) < 0) {
+            perror("bench: mock daemon");
+            std::exit(1);
+        }
+        m_thread = std::thread([this] { run(); });
+    }
+
+    MockDaemon(const MockDaemon&)            = delete;
+    MockDaemon& operator=(const MockDaemon&) = delete;
+
+    ~MockDaemon() {
+        m_stop.store(true);
+        shutdown(m_listen, SHUT_RDWR);
+        if (int fd = m_client.load(); fd >= 0)
+            shutdown(fd, SHUT_RDWR);
+        m_thread.join();
+        close(m_listen);
+        unlink(m_path.c_str());
+    }
+
+    const std::string& path() const { return m_path; }
+
+    /// Messages received so far.
+    uint64_t received() const { return m_received.load(std::memory_order_acquire); }
+
+    /// Wait until `n` messages have arrived.  Returns false after 5 s.
+    bool waitFor(uint64_t n) const {
+        const uint64_t deadline = nowNs() + 5'000'000'000ull;
+        while (received() < n) {
+            if (nowNs() > deadline)
+                return false;
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+  private:
+    void run() {
+        while (!m_stop.load()) {
+            int fd = accept(m_listen, nullptr, nullptr);
+            if (fd < 0)
+                return;
+            m_client.store(fd);
+            serve(fd);
+            m_client.store(-1);
+            close(fd);
+        }
+    }
+
+    void serve(int fd) {
+        std::string pending;
+        bool        binary = false;
+        char        buf[64 * 1024];
+        ssize_t     n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0) {
+            pending.append(buf, static_cast<size_t>(n));
+            size_t at = 0;
+            while (at < pending.size()) {
+                const char first = pending[at];
+                if (!binary || first == '{' || first == '"') {
+                    const size_t nl = pending.find('\n', at);
+                    if (nl == std::string::npos)
+                        break;
+                    std::string_view line(pending.data() + at, nl - at);
+                    at = nl + 1;
+                    if (line == PROTOCOL_HELLO) {
+                        std::string reply = std::string(PROTOCOL_ACCEPT_BINARY) + "\n";
+                        (void)!write(fd, reply.data(), reply.size());
+                        binary = true;
+                        continue;
+                    }
+                } else {
+                    if (pending.size() - at < 2)
+                        break;
+                    const size_t len = static_cast<uint8_t>(pending[at + 1]);
+                    if (pending.size() - at < 2 + len)
+                        break;
+                    at += 2 + len;
+                }
+                m_received.fetch_add(1, std::memory_order_release);
+            }
+            pending.erase(0, at);
+        }
+    }
+
+    std::string           m_path;
+    int                   m_listen = -1;
+    std::atomic<int>      m_client{-1};
+    std::atomic<bool>     m_stop{false};
+    std::atomic<uint64_t> m_received{0};
+    std::thread           m_thread;
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// JSON builders and message encoding
+// ═══════════════════════════════════════════════════════════════════════════
+
+static void benchBuilders() {
+    bench("build_swipe_update_json", 200'000, [](uint64_t i) {
+        keep(buildSwipeUpdateJson(3, static_cast<double>(i & 63) * 0.5, -1.25).data());
+    });
+
+    char swipeBuf[SWIPE_JSON_CAPACITY];
+    bench("format_swipe_update_json", 200'000, [&](uint64_t i) {
+        keep(formatSwipeUpdateJson(swipeBuf, 3, static_cast<double>(i & 63) * 0.5, -1.25).data());
+    });
+
+    const std::string switchArg = " 2 1 ";
+    bench("build_switch_json", 500'000, [&](uint64_t) { keep(buildSwitchJson(switchArg).value.data()); });
+
+    char argBuf[argJsonCapacity("SwitchTo", 16)];
+    bench("format_switch_json", 500'000, [&](uint64_t) { keep(formatSwitchJson(argBuf, switchArg).data()); });
+
+    const std::string quoted = R"(workspace "main" \ C:\path\to\"thing" padded out to sixty-four b)";
+    bench("escape_json_string", 500'000, [&](uint64_t) { keep(escapeJsonString(quoted).data()); });
+
+    std::string out;
+    const auto  update = PluginMessage::swipeUpdate(3, 12.5, -3.25, 123456);
+    bench("encode_message_json", 500'000, [&](uint64_t) {
+        encodeMessage(update, WireFormat::Json, out);
+        keep(out.data());
+    });
+    bench("encode_message_binary", 500'000, [&](uint64_t) {
+        encodeMessage(update, WireFormat::Binary, out);
+        keep(out.data());
+    });
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// IPC round trips against the mock daemon
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Synchronous writes on a DaemonConnection, as the writer thread does,
+/// until the mock daemon has read them all.  Extra field: `busy_writes`
+/// (writes that hit a full socket buffer and were retried).
+static void benchConnection() {
+    constexpr std::string_view name = "connection_send_line_json";
+    if (!selected(name))
+        return;
+    MockDaemon       daemon("conn");
+    DaemonConnection conn;
+    conn.setPath(daemon.path());
+    if (!conn.connect()) {
+        fprintf(stderr, "bench: cannot connect to mock daemon\n");
+        return;
+    }
+    const std::string line       = buildSwipeUpdateJson(3, 12.5, -3.25);
+    constexpr uint64_t iterations = 100'000;
+
+    const uint64_t allocs = g_allocations;
+    const uint64_t start  = nowNs();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        // A full socket buffer drops the write; retry so every op is a
+        // delivered message and the result is sustained throughput.
+        while (!conn.sendLine(line))
+            std::this_thread::yield();
+    }
+    const uint64_t used = g_allocations - allocs;
+    if (!daemon.waitFor(iterations)) {
+        fprintf(stderr, "bench: %.*s: mock daemon received %llu of %llu\n", static_cast<int>(name.size()),
+                name.data(), static_cast<unsigned long long>(daemon.received()),
+                static_cast<unsigned long long>(iterations));
+        return;
+    }
+    const uint64_t elapsed = nowNs() - start;
+
+    char extra[64];
+    snprintf(extra, sizeof(extra), R"(,"busy_writes":%llu)",
+             static_cast<unsigned long long>(conn.stats().busyWrites.load()));
+    report(name, iterations, elapsed, used, extra);
+}
+
+/// `sendCommand()`-style round trip: enqueue on the calling ("main")
+/// thread, then wait until the mock daemon has read the message.
+/// allocs_per_op counts the enqueuing thread only.
+static void benchQueueRoundTrip(std::string_view name, WireFormat format) {
+    if (!selected(name))
+        return;
+    MockDaemon daemon(format == WireFormat::Binary ? "rt-binary" : "rt-json");
+    SendQueue  queue;
+    queue.configure({.format = format});
+    queue.start(daemon.path());
+    // Wait for the connection (and handshake) before timing anything.
+    queue.enqueue(PluginMessage::simple(MessageKind::SwipeEnd), FullPolicy::Drop);
+    if (!daemon.waitFor(1)) {
+        fprintf(stderr, "bench: %.*s: mock daemon received nothing\n", static_cast<int>(name.size()), name.data());
+        return;
+    }
+
+    constexpr uint64_t iterations = 20'000;
+    const uint64_t     allocs     = g_allocations;
+    const uint64_t     start      = nowNs();
+    for (uint64_t i = 0; i < iterations; ++i) {
+        queue.enqueue(PluginMessage::swipeUpdate(3, 1.0, 0.5), FullPolicy::Drop);
+        if (!daemon.waitFor(i + 2)) {
+            fprintf(stderr, "bench: %.*s: message %llu lost\n", static_cast<int>(name.size()), name.data(),
+                    static_cast<unsigned long long>(i));
+            return;
+        }
+    }
+    const uint64_t elapsed = nowNs() - start;
+    report(name, iterations, elapsed, g_allocations - allocs);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Swipe replay at 240 Hz
+// ═══════════════════════════════════════════════════════════════════════════
+
+struct SwipeEvent {
+    uint32_t timeMs;
+    double   dx;
+    double   dy;
+};
+
+/// Built-in gesture: a 500 ms three-finger swipe to the right, sampled at
+/// 240 Hz, whose speed rises and falls like a real flick (~600 px total).
+static std::vector<SwipeEvent> builtinSwipe() {
+    constexpr int           events = 120;
+    std::vector<SwipeEvent> swipe;
+    swipe.reserve(events);
+    for (int i = 0; i < events; ++i) {
+        const double t     = (i + 0.5) / events;
+        const double speed = std::sin(M_PI * t); // px per event, peak ~7.9
+        swipe.push_back({static_cast<uint32_t>(1000 + i * 1000 / 240), 7.9 * speed, 0.4 * std::sin(6 * M_PI * t)});
+    }
+    return swipe;
+}
+
+/// Load `<time_ms> <dx> <dy>` lines.  Exits on a malformed file.
+static std::vector<SwipeEvent> loadSwipe(const char* path) {
+    std::ifstream           in(path);
+    std::vector<SwipeEvent> swipe;
+    SwipeEvent              ev{};
+    while (in >> ev.timeMs >> ev.dx >> ev.dy)
+        swipe.push_back(ev);
+    if (!in.eof() || swipe.empty()) {
+        fprintf(stderr, "bench: %s: expected lines of \"<time_ms> <dx> <dy>\"\n", path);
+        std::exit(1);
+    }
+    return swipe;
+}
+
+/// Replay `swipe` in real time at 240 Hz through the swipe hook path
+/// (SwipeCoalescer at the default 8 ms + SendQueue) `repeats` times.
+///
+/// ns_per_op / allocs_per_op are per input event on the "main" thread;
+/// ops_per_sec is the achieved event rate.  Extra fields: `hook_p99_ns`,
+/// `hook_max_ns`, `messages` (delivered to the daemon) and
+/// `end_to_delivery_us` (SwipeEnd enqueue until the daemon read it, mean).
+static void benchSwipeReplay(const std::vector<SwipeEvent>& swipe, WireFormat format) {
+    const std::string_view name = format == WireFormat::Binary ? "swipe_replay_240hz_binary" : "swipe_replay_240hz_json";
+    if (!selected(name))
+        return;
+    MockDaemon daemon(format == WireFormat::Binary ? "replay-binary" : "replay-json");
+    SendQueue  queue;
+    queue.configure({.format = format});
+    queue.start(daemon.path());
+    queue.enqueue(PluginMessage::simple(MessageKind::SwipeEnd), FullPolicy::Drop);
+    if (!daemon.waitFor(1)) {
+        fprintf(stderr, "bench: %.*s: mock daemon received nothing\n", static_cast<int>(name.size()), name.data());
+        return;
+    }
+
+    constexpr int      repeats  = 4;
+    constexpr uint64_t periodNs = 1'000'000'000ull / 240;
+    LatencyHistogram   hook;
+    SwipeCoalescer     coalescer;
+    coalescer.setInterval(8);
+    uint64_t enqueued = 1, hookNs = 0, allocs = 0, deliveryNs = 0;
+
+    auto send = [&](const PluginMessage& msg) {
+        if (queue.enqueue(msg, FullPolicy::Coalesce))
+            ++enqueued;
+    };
+
+    const uint64_t start = nowNs();
+    uint64_t       tick  = start;
+    for (int r = 0; r < repeats; ++r) {
+        send(PluginMessage::swipeBegin(3));
+        coalescer.reset();
+        for (const auto& ev : swipe) {
+            tick += periodNs;
+            std::this_thread::sleep_for(std::chrono::nanoseconds(tick - std::min(tick, nowNs())));
+
+            const uint64_t a  = g_allocations;
+            const uint64_t t0 = nowNs();
+            if (auto d = coalescer.add(ev.timeMs, 3, ev.dx, ev.dy))
+                send(PluginMessage::swipeUpdate(d->fingers, d->dx, d->dy, d->timeMs));
+            const uint64_t spent = nowNs() - t0;
+            allocs += g_allocations - a;
+            hookNs += spent;
+            hook.record(spent);
+        }
+        if (auto d = coalescer.flush())
+            send(PluginMessage::swipeUpdate(d->fingers, d->dx, d->dy, d->timeMs));
+        const uint64_t endAt = nowNs();
+        send(PluginMessage::simple(MessageKind::SwipeEnd));
+        // At 240 Hz the ring never fills, but count merged updates anyway.
+        if (!daemon.waitFor(enqueued - queue.coalesced())) {
+            fprintf(stderr, "bench: %.*s: daemon received %llu of %llu messages\n", static_cast<int>(name.size()),
+                    name.data(), static_cast<unsigned long long>(daemon.received()),
+                    static_cast<unsigned long long>(enqueued));
+            return;
+        }
+        deliveryNs += nowNs() - endAt;
+    }
+    const uint64_t wallNs = nowNs() - start;
+    const uint64_t events = static_cast<uint64_t>(swipe.size()) * repeats;
+
+    // The histogram reports bucket upper bounds; don't exceed the max.
+    const uint64_t p99 = std::min(hook.quantileNs(0.99), hook.maxNs());
+    char           extra[160];
+    snprintf(extra, sizeof(extra), R"(,"hook_p99_ns":%llu,"hook_max_ns":%llu,"messages":%llu,"end_to_delivery_us":%.1f)",
+             static_cast<unsigned long long>(p99),
+             static_cast<unsigned long long>(hook.maxNs()),
+             static_cast<unsigned long long>(daemon.received() - 1), deliveryNs / 1e3 / repeats);
+    emit(name, events, static_cast<double>(hookNs) / events, static_cast<double>(allocs) / events,
+         events * 1e9 / wallNs, extra);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Overlay moves on growing grids
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// One move on an `n` × `n` grid: the daemon's syncgrid to the next cell,
+/// and the frame's layout.  With the viewport the cost should not depend on
+/// `n`.
+static void benchOverlayMoves() {
+    for (size_t n : {4, 64, 1024, 16384}) {
+        OverlayModel m;
+        m.sync(GridState{.cols = n, .rows = n, .col = n / 2, .row = n / 2}, 0.0);
+        std::vector<OverlayRect> rects;
+        m.layout(rects);
+        const std::string name = "overlay_move_" + std::to_string(n) + "x" + std::to_string(n);
+        bench(name, 200'000, [&](uint64_t i) {
+            const size_t col = n / 2 + (i & 1);
+            m.sync(GridState{.cols = n, .rows = n, .col = col, .row = n / 2}, static_cast<double>(i));
+            m.layout(rects);
+            keep(rects.data());
+        });
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<SwipeEvent> swipe;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--swipe" && i + 1 < argc)
+            swipe = loadSwipe(argv[++i]);
+        else if (arg == "-h" || arg == "--help") {
+            fprintf(stderr, "usage: %s [--swipe FILE] [FILTER]\n", argv[0]);
+            return 0;
+        } else
+            g_filter = arg;
+    }
+    if (swipe.empty())
+        swipe = builtinSwipe();
+
+    benchBuilders();
+    benchConnection();
+    benchQueueRoundTrip("queue_round_trip_json", WireFormat::Json);
+    benchQueueRoundTrip("queue_round_trip_binary", WireFormat::Binary);
+    benchSwipeReplay(swipe, WireFormat::Json);
+    benchSwipeReplay(swipe, WireFormat::Binary);
+    benchOverlayMoves();
+    return 0;
+}
@@ -0,0 +1,111 @@
+// coalescer.hpp — Merge high-rate swipe updates before they reach the daemon.
+//
+// Touchpads report swipe motion at 120–250 Hz, and every update the daemon
+// receives turns into a PrepareMove and an overlay redraw.  The daemon only
+// ever sums the deltas, so the plugin can sum them first and forward at
+// most one update per flush interval without losing any motion.
+//
+// A timer interval still beats against the display: some frames see two
+// updates and some none, which shows as uneven overlay motion on high
+// refresh panels.  Paced by frame (`swipe_pacing = frame`), the coalescer
+// holds every update and the plugin's preRender hook flushes it once per
+// frame of the gesture's monitor, so the daemon gets exactly one update per
+// displayed frame, sent as the frame starts.  A gesture with no monitor to
+// pace it falls back to the timer.
+
+#pragma once
+
+#include "helpers.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/// When SwipeCoalescer releases held motion.
+enum class SwipePacing : uint8_t {
+    /// On the first update after the flush interval has passed.
+    Timer,
+    /// Only on `flush()`, which the preRender hook calls once per frame.
+    Frame,
+};
+
+/// Parse the `swipe_pacing` config value ("timer" / "frame").  Unknown
+/// values fall back to `Frame`.
+inline SwipePacing parseSwipePacing(std::string_view s) {
+    return trimView(s) == "timer" ? SwipePacing::Timer : SwipePacing::Frame;
+}
+
+/// Paced by frame, a frame asked for that hasn't started after this long
+/// (the monitor skipped it) is asked for again.
+inline constexpr uint64_t SWIPE_FRAME_WAIT_MS = 50;
+
+/// An accumulated swipe delta ready to be sent as one SwipeUpdate.
+struct SwipeDelta {
+    uint32_t fingers = 0;
+    uint32_t timeMs  = 0; ///< Timestamp of the latest merged event
+    double   dx      = 0.0;
+    double   dy      = 0.0;
+};
+
+/// Sums swipe deltas and releases them at most once per interval.
+///
+/// Times are the event timestamps in milliseconds (libinput's `timeMs`).
+/// The first update of a gesture is released immediately so the overlay
+/// reacts without delay; later ones are held until `intervalMs` has passed
+/// since the last release.  An interval of 0 disables coalescing.
+///
+/// Paced by frame, `add()` releases nothing and the interval is unused.
+///
+/// Call `flush()` before forwarding SwipeEnd so no motion is lost.
+class SwipeCoalescer {
+  public:
+    void setInterval(uint32_t intervalMs) { m_intervalMs = intervalMs; }
+    void setPacing(SwipePacing pacing) { m_pacing = pacing; }
+
+    /// Forget any pending motion; call at swipeBegin.
+    void reset() {
+        m_pending     = {};
+        m_hasPending  = false;
+        m_hasReleased = false;
+    }
+
+    /// Add one update.  Returns the delta to send now, if any.
+    std::optional<SwipeDelta> add(uint32_t timeMs, uint32_t fingers, double dx, double dy) {
+        m_pending.fingers = fingers;
+        m_pending.timeMs  = timeMs;
+        m_pending.dx += dx;
+        m_pending.dy += dy;
+        m_hasPending = true;
+        if (m_pacing == SwipePacing::Frame)
+            return std::nullopt;
+
+        // uint32 subtraction handles the timestamp wrapping around.
+        if (m_intervalMs == 0 || !m_hasReleased || timeMs - m_lastReleaseMs >= m_intervalMs) {
+            m_lastReleaseMs = timeMs;
+            m_hasReleased   = true;
+            return flush();
+        }
+        return std::nullopt;
+    }
+
+    /// True while motion is held back.
+    bool pending() const { return m_hasPending; }
+
+    /// Release whatever motion is pending (nothing if there is none).
+    std::optional<SwipeDelta> flush() {
+        if (!m_hasPending)
+            return std::nullopt;
+        SwipeDelta out = m_pending;
+        m_pending      = {.fingers = out.fingers};
+        m_hasPending   = false;
+        return out;
+    }
+
+  private:
+    SwipeDelta  m_pending;
+    bool        m_hasPending    = false;
+    bool        m_hasReleased   = false;
+    uint32_t    m_lastReleaseMs = 0;
+    uint32_t    m_intervalMs    = 0;
+    SwipePacing m_pacing        = SwipePacing::Timer;
+};
@@ -0,0 +1,293 @@
+// commands.hpp — The dispatcher commands the plugin forwards to the daemon.
+//
+// One row of DISPATCHER_COMMANDS per `hyprgrd:<name>` keybind dispatcher:
+// its name, the daemon's `Command` variant (src/command.rs), the binary
+// opcode (protocol.hpp) and what the argument is.  The table drives
+// dispatcher registration in main.cpp and the encoders below, which the
+// send queue uses for these commands; each row gets its own instantiation
+// of the encoders, with the key and opcode folded in at compile time.
+//
+// On connections that take them (protocol version 2) the writer sends the
+// arguments pre-parsed instead of as strings.  Keybind arguments are
+// static, so ParsedFrameCache parses each distinct one once and every later
+// press just copies its frame.
+//
+// `plugin_command_table_matches_daemon` in src/ipc/protocol.rs reads this
+// file and checks every row against the daemon: the JSON form and the
+// binary frame must both decode, to the same command.  Keep each row on
+// one line so that test can find it.
+
+#pragma once
+
+#include "grid.hpp"
+#include "helpers.hpp"
+#include "protocol.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/// What a queued message asks the daemon to do.
+enum class MessageKind : uint8_t {
+    Go,
+    MoveGo,
+    Switch,
+    MoveToMonitor,
+    MoveToMonitorIndex,
+    ToggleVisualizer,
+    SyncGrid,
+    AttachOverlay,
+    AttachGestures,
+    SwipeBegin,
+    SwipeUpdate,
+    SwipeVelocity,
+    SwipeEnd,
+};
+
+/// What a dispatcher's argument holds.  JSON and version-1 frames forward
+/// it untouched (trimmed) for the daemon to parse; parseCommandFrame()
+/// encodes it for version 2.
+enum class ArgKind : uint8_t {
+    None,      ///< No argument; the command is a bare JSON string.
+    Direction, ///< `left`, `right`, `up`, `down`, …
+    Cell,      ///< `<col> <row>`
+    Index,     ///< A monitor index
+};
+
+/// One dispatcher command.
+struct CommandSpec {
+    std::string_view dispatcher; ///< Without the `hyprgrd:` prefix
+    std::string_view json;       ///< Variant name of the daemon's `Command`
+    uint8_t          opcode;
+    MessageKind      kind;
+    ArgKind          arg;
+};
+
+// clang-format off
+inline constexpr std::array DISPATCHER_COMMANDS = {
+    CommandSpec{"go",                 "Go",                       Op::Go,                       MessageKind::Go,                 ArgKind::Direction},
+    CommandSpec{"movego",             "MoveWindowAndGo",          Op::MoveWindowAndGo,          MessageKind::MoveGo,             ArgKind::Direction},
+    CommandSpec{"switch",             "SwitchTo",                 Op::SwitchTo,                 MessageKind::Switch,             ArgKind::Cell},
+    CommandSpec{"movetomonitor",      "MoveWindowToMonitor",      Op::MoveWindowToMonitor,      MessageKind::MoveToMonitor,      ArgKind::Direction},
+    CommandSpec{"movetomonitorindex", "MoveWindowToMonitorIndex", Op::MoveWindowToMonitorIndex, MessageKind::MoveToMonitorIndex, ArgKind::Index},
+    CommandSpec{"togglevis",          "ToggleVisualizer",         Op::ToggleVisualizer,         MessageKind::ToggleVisualizer,   ArgKind::None},
+};
+// clang-format on
+
+/// Index of `kind`'s row, or `DISPATCHER_COMMANDS.size()` if it has none.
+constexpr size_t commandIndex(MessageKind kind) {
+    for (size_t i = 0; i < DISPATCHER_COMMANDS.size(); ++i)
+        if (DISPATCHER_COMMANDS[i].kind == kind)
+            return i;
+    return DISPATCHER_COMMANDS.size();
+}
+
+/// The row of `kind`, or nullptr for messages that aren't dispatcher
+/// commands (swipes, SyncGrid, …).
+constexpr const CommandSpec* commandFor(MessageKind kind) {
+    const size_t i = commandIndex(kind);
+    return i < DISPATCHER_COMMANDS.size() ? &DISPATCHER_COMMANDS[i] : nullptr;
+}
+
+/// The row of dispatcher `name` (without `hyprgrd:`), or nullptr.
+constexpr const CommandSpec* commandNamed(std::string_view name) {
+    for (const auto& spec : DISPATCHER_COMMANDS)
+        if (spec.dispatcher == name)
+            return &spec;
+    return nullptr;
+}
+
+namespace detail {
+    constexpr bool commandTableIsConsistent() {
+        for (size_t i = 0; i < DISPATCHER_COMMANDS.size(); ++i)
+            for (size_t j = i + 1; j < DISPATCHER_COMMANDS.size(); ++j) {
+                const auto &a = DISPATCHER_COMMANDS[i], &b = DISPATCHER_COMMANDS[j];
+                if (a.dispatcher == b.dispatcher || a.json == b.json || a.opcode == b.opcode || a.kind == b.kind)
+                    return false;
+            }
+        return true;
+    }
+}
+static_assert(detail::commandTableIsConsistent(), "DISPATCHER_COMMANDS rows must not share a name, opcode or kind");
+
+/// Buffer size that fits the JSON of any dispatcher command with an
+/// `argLen`-byte argument.
+constexpr size_t commandJsonCapacity(size_t argLen) {
+    size_t longest = 0;
+    for (const auto& spec : DISPATCHER_COMMANDS)
+        longest = std::max(longest, argJsonCapacity(spec.json, argLen));
+    return longest;
+}
+
+/// Write the JSON of row `I` with argument `arg` (ignored for ArgKind::None):
+/// `{"Go":"right"}`, or `"ToggleVisualizer"`.
+template <size_t I>
+std::string_view formatCommandJson(std::span<char> out, std::string_view arg) {
+    constexpr CommandSpec spec = DISPATCHER_COMMANDS[I];
+    if constexpr (spec.arg == ArgKind::None) {
+        SpanWriter w(out);
+        w.put("\"");
+        w.put(spec.json);
+        w.put("\"");
+        return w.view();
+    } else {
+        return formatArgJson(out, spec.json, arg);
+    }
+}
+
+/// Append the binary frame of row `I` with argument `arg`.
+template <size_t I>
+void putCommandFrame(std::string& out, std::string_view arg) {
+    constexpr CommandSpec spec = DISPATCHER_COMMANDS[I];
+    if constexpr (spec.arg == ArgKind::None)
+        putFrameHeader(out, spec.opcode, 0);
+    else
+        putArgFrame(out, spec.opcode, arg);
+}
+
+/// Call `fn(std::integral_constant<size_t, I>{})` with the row index of
+/// `kind`.  Returns false (without calling) if `kind` has no row.
+template <typename Fn>
+bool visitCommand(MessageKind kind, Fn&& fn) {
+    return [&]<size_t... I>(std::index_sequence<I...>) {
+        return ((DISPATCHER_COMMANDS[I].kind == kind && (fn(std::integral_constant<size_t, I>{}), true)) || ...);
+    }(std::make_index_sequence<DISPATCHER_COMMANDS.size()>{});
+}
+
+//  Pre-parsed frames
+
+/// Longest pre-parsed frame: header, col and row.
+inline constexpr size_t MAX_PARSED_FRAME = 2 + 8;
+
+/// One dispatcher frame with its argument already parsed (`Op::Parsed`).
+struct ParsedFrame {
+    uint8_t len = 0; ///< 0: no parsed form; send the argument as a string
+    char    bytes[MAX_PARSED_FRAME] = {};
+
+    std::string_view view() const { return {bytes, len}; }
+};
+
+// Direction codes are GridDirection's order, which is the daemon's
+// `Direction::ALL`.
+static_assert(static_cast<int>(GridDirection::DownRight) == 7, "GridDirection must keep the daemon's order");
+
+/// Parse `arg` the way the daemon would for `spec` and encode the
+/// pre-parsed frame.  Arguments that don't parse here (or whose numbers
+/// don't fit a u32) get no frame, so they go out as strings and the daemon
+/// reports the error as for any other client.
+inline ParsedFrame parseCommandFrame(const CommandSpec& spec, std::string_view arg) {
+    ParsedFrame frame;
+    size_t      len = 2;
+    auto        put = [&](uint32_t v, size_t bytes) {
+        for (size_t i = 0; i < bytes; ++i)
+            frame.bytes[len++] = static_cast<char>((v >> (8 * i)) & 0xff);
+    };
+    auto fits = [](size_t v) { return v <= std::numeric_limits<uint32_t>::max(); };
+    switch (spec.arg) {
+        case ArgKind::None: return frame;
+        case ArgKind::Direction: {
+            const auto dir = parseGridDirection(arg);
+            if (!dir)
+                return frame;
+            put(static_cast<uint32_t>(*dir), 1);
+            break;
+        }
+        case ArgKind::Cell: {
+            const auto cell = parseGridCell(arg);
+            if (!cell || !fits(cell->col) || !fits(cell->row))
+                return frame;
+            put(static_cast<uint32_t>(cell->col), 4);
+            put(static_cast<uint32_t>(cell->row), 4);
+            break;
+        }
+        case ArgKind::Index: {
+            size_t index;
+            if (!parseUnsignedWords(arg, std::span<size_t>(&index, 1)) || !fits(index))
+                return frame;
+            put(static_cast<uint32_t>(index), 4);
+            break;
+        }
+    }
+    frame.bytes[0] = static_cast<char>(spec.opcode | Op::Parsed);
+    frame.bytes[1] = static_cast<char>(len - 2);
+    frame.len      = static_cast<uint8_t>(len);
+    return frame;
+}
+
+/// Pre-parsed frames of the dispatcher arguments seen so far, keyed by
+/// command and argument string.
+///
+/// A small open-addressed table: Hyprland configs bind a handful of
+/// distinct arguments, so it fills once and then only answers lookups.
+/// Arguments longer than `MAX_KEY`, or new ones once it is full, are parsed
+/// on every use instead.  Negative results are cached too.  Not
+/// thread-safe; the writer thread owns it.
+class ParsedFrameCache {
+  public:
+    static constexpr size_t SLOTS   = 64;
+    static constexpr size_t MAX_KEY = 31;
+
+    /// The pre-parsed frame of dispatcher command `kind` with `arg`
+    /// (`len` 0 if it has none).
+    const ParsedFrame& lookup(MessageKind kind, std::string_view arg) {
+        const CommandSpec* spec = commandFor(kind);
+        if (!spec) {
+            m_scratch = {};
+            return m_scratch;
+        }
+        if (arg.size() > MAX_KEY) {
+            m_scratch = parseCommandFrame(*spec, arg);
+            return m_scratch;
+        }
+        for (size_t probe = 0, at = hash(kind, arg); probe < SLOTS; ++probe, at = (at + 1) % SLOTS) {
+            Slot& slot = m_slots[at];
+            if (slot.used && slot.kind == kind && slot.keyView() == arg)
+                return slot.frame;
+            if (!slot.used) {
+                slot.used   = true;
+                slot.kind   = kind;
+                slot.keyLen = static_cast<uint8_t>(arg.size());
+                std::memcpy(slot.key, arg.data(), arg.size());
+                slot.frame = parseCommandFrame(*spec, arg);
+                ++m_size;
+                return slot.frame;
+            }
+        }
+        m_scratch = parseCommandFrame(*spec, arg);
+        return m_scratch;
+    }
+
+    /// Distinct arguments cached.
+    size_t size() const { return m_size; }
+
+  private:
+    struct Slot {
+        bool        used   = false;
+        MessageKind kind   = MessageKind::Go;
+        uint8_t     keyLen = 0;
+        char        key[MAX_KEY] = {};
+        ParsedFrame frame;
+
+        std::string_view keyView() const { return {key, keyLen}; }
+    };
+
+    /// FNV-1a over the kind and the argument.
+    static size_t hash(MessageKind kind, std::string_view arg) {
+        uint32_t h = (2166136261u ^ static_cast<uint8_t>(kind)) * 16777619u;
+        for (char c : arg)
+            h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+        return h % SLOTS;
+    }
+
+    std::array<Slot, SLOTS> m_slots{};
+    size_t                  m_size = 0;
+    ParsedFrame             m_scratch;
+};
@@ -0,0 +1,496 @@
+// connection.hpp — Persistent connection from the plugin to the hyprgrd daemon.
+//
+// Also home to SocketWatch, which tells the writer thread when the daemon
+// (re)creates its socket.
+//
+// Like helpers.hpp this does not depend on the Hyprland SDK, so the test
+// suite can exercise it against a plain Unix socket server.
+
+#pragma once
+
+#include "protocol.hpp"
+#include "swipe_channel.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/// Connection health counters; readable from any thread.
+struct ConnectionStats {
+    std::atomic<uint64_t> connects{0};        ///< Successful connects
+    std::atomic<uint64_t> connectFailures{0}; ///< Failed socket()/connect()/handshake
+    std::atomic<uint64_t> shortWrites{0};     ///< Partial writes (connection reset)
+    std::atomic<uint64_t> busyWrites{0};      ///< EAGAIN: daemon not draining its socket
+    std::atomic<uint64_t> hangups{0};         ///< Daemon closed an idle connection
+};
+
+/// Outcome of DaemonConnection::sendEncoded().
+enum class SendResult {
+    Sent,   ///< The whole message was written.
+    Busy,   ///< Daemon not draining its socket; message dropped, connection kept.
+    Failed, ///< No connection, or it broke and re-opening it didn't help.
+};
+
+/// One long-lived, non-blocking stream connection to the daemon socket.
+///
+/// The socket address is resolved once via `setPath()` (at `PLUGIN_INIT`)
+/// and cached, so the hot path never touches the environment.  The
+/// connection is opened lazily on the first send and transparently
+/// re-opened once when a write fails because the daemon went away
+/// (`EPIPE`, `ECONNRESET`, `ENOTCONN`), e.g. after a daemon restart.
+///
+/// With `setPreferredFormat(WireFormat::Binary)` every (re)connect performs
+/// the protocol.hpp handshake, which waits up to
+/// `PROTOCOL_HELLO_TIMEOUT_MS` for the reply — only do that off the
+/// compositor's main thread.
+///
+/// With a swipe channel set (`setSwipeChannel()`), a binary connection
+/// also offers it to the daemon and marks it attached while connected.
+/// A greeting (`setGreeting()`) goes out on every connection before
+/// anything else, so a restarted daemon hears it again.
+///
+/// With `setAcks(true)` every connect first asks for acknowledgements
+/// (acks.hpp); `acks()` tells whether the daemon agreed, and the reply
+/// lines are handed to `checkIdle()`'s callback.
+///
+/// Writes never block: if the daemon is not draining its socket the
+/// message is dropped and the send returns false.
+class DaemonConnection {
+  public:
+    DaemonConnection() = default;
+    DaemonConnection(const DaemonConnection&)            = delete;
+    DaemonConnection& operator=(const DaemonConnection&) = delete;
+    ~DaemonConnection() { disconnect(); }
+
+    /// Resolve and cache the socket address.  Closes any open connection.
+    void setPath(const std::string& path) {
+        disconnect();
+        m_addr            = {};
+        m_addr.sun_family = AF_UNIX;
+        strncpy(m_addr.sun_path, path.c_str(), sizeof(m_addr.sun_path) - 1);
+    }
+
+    /// Format to negotiate on the next connect (default: JSON, no handshake).
+    void setPreferredFormat(WireFormat format) { m_preferred = format; }
+
+    /// Shared-memory swipe channel to offer on binary connections (nullptr:
+    /// none).  Must outlive the connection.
+    void setSwipeChannel(SwipeChannel* channel) { m_channel = channel; }
+
+    /// Bytes to send first on every new connection, for each wire format
+    /// (both empty: none).  Takes effect on the next connect.
+    void setGreeting(std::string json, std::string frame) {
+        m_greetingJson  = std::move(json);
+        m_greetingFrame = std::move(frame);
+    }
+
+    /// Ask for acknowledgements on the next connect (default: off).
+    void setAcks(bool on) { m_wantAcks = on; }
+
+    /// True if acknowledgements are asked for.
+    bool acksWanted() const { return m_wantAcks; }
+
+    /// Format negotiated for the current connection.
+    WireFormat format() const { return m_format; }
+
+    /// True if the current binary connection takes pre-parsed dispatcher
+    /// arguments (protocol version 2).
+    bool parsedArgs() const { return m_parsedArgs; }
+
+    /// True if the daemon acknowledges sequenced commands on the current
+    /// connection.
+    bool acks() const { return m_acks; }
+
+    const ConnectionStats& stats() const { return m_stats; }
+
+    /// True while a connection is open (it may still turn out to be dead
+    /// on the next write).
+    bool connected() const { return m_fd >= 0; }
+
+    /// The open socket (-1 if none), for polling it while idle.
+    int fd() const { return m_fd; }
+
+    /// Call when poll() reports the idle connection readable or hung up.
+    /// Hands every complete line the daemon sent (without newline) to
+    /// `onLine`; if it closed the connection, disconnects and returns false.
+    template <typename OnLine>
+    bool checkIdle(OnLine&& onLine) {
+        if (m_fd < 0)
+            return false;
+        char buf[256];
+        for (;;) {
+            const ssize_t n = recv(m_fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n > 0) {
+                takeLines(std::string_view(buf, static_cast<size_t>(n)), onLine);
+                continue;
+            }
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+                return true;
+            break;
+        }
+        bump(m_stats.hangups);
+        disconnect();
+        return false;
+    }
+
+    /// `checkIdle()` discarding anything the daemon sent.
+    bool checkIdle() {
+        return checkIdle([](std::string_view) {});
+    }
+
+    /// Open the connection if it is not already open.  Returns true when a
+    /// connection is available afterwards.
+    bool connect() {
+        if (m_fd >= 0)
+            return true;
+        if (m_addr.sun_family != AF_UNIX)
+            return false;
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            bump(m_stats.connectFailures);
+            return false;
+        }
+        // Unix stream connects complete immediately; EAGAIN only happens
+        // when the daemon's backlog is full, which we treat as "not up".
+        if (::connect(fd, reinterpret_cast<const struct sockaddr*>(&m_addr), sizeof(m_addr)) < 0) {
+            close(fd);
+            bump(m_stats.connectFailures);
+            return false;
+        }
+        m_fd         = fd;
+        m_format     = WireFormat::Json;
+        m_parsedArgs = false;
+        m_answered   = false;
+        m_silent     = false;
+        if (m_wantAcks && !negotiateAcks()) {
+            bump(m_stats.connectFailures);
+            return false;
+        }
+        if (m_preferred == WireFormat::Binary && !negotiate()) {
+            bump(m_stats.connectFailures);
+            return false;
+        }
+        if (m_format == WireFormat::Binary && m_channel && m_channel->ready() && !attachSwipeChannel()) {
+            bump(m_stats.connectFailures);
+            return false;
+        }
+        const std::string& greeting = m_format == WireFormat::Binary ? m_greetingFrame : m_greetingJson;
+        if (!greeting.empty() && writeBytes(greeting) != WriteResult::Ok) {
+            disconnect();
+            bump(m_stats.connectFailures);
+            return false;
+        }
+        bump(m_stats.connects);
+        return true;
+    }
+
+    /// Close the connection (no-op if not connected).
+    void disconnect() {
+        if (m_channel)
+            m_channel->setAttached(false);
+        if (m_fd >= 0) {
+            close(m_fd);
+            m_fd = -1;
+        }
+        m_acks = false;
+        m_rx.clear();
+    }
+
+    /// Send `line` followed by a newline, connecting first if needed.
+    ///
+    /// JSON lines are accepted in either wire format.  If the daemon has
+    /// gone away the connection is re-opened once and the write retried.
+    /// Returns true only if the whole line was written.
+    bool sendLine(std::string_view line) {
+        return sendEncoded([line](WireFormat, std::string& out) {
+                   out.assign(line);
+                   out += '\n';
+               }) == SendResult::Sent;
+    }
+
+    /// Send one message encoded for the negotiated format.
+    ///
+    /// `encode(format, out)` must fill `out` with the complete bytes to
+    /// write.  It is called again if the connection has to be re-opened,
+    /// since the new connection may negotiate a different format.  The
+    /// buffer is reused across calls, so steady-state sends don't allocate.
+    template <typename Encode>
+    SendResult sendEncoded(Encode&& encode) {
+        if (!connect())
+            return SendResult::Failed;
+        encode(m_format, m_buf);
+        switch (writeBytes(m_buf)) {
+            case WriteResult::Ok: return SendResult::Sent;
+            case WriteResult::Dropped: return dropped();
+            case WriteResult::Broken: break;
+        }
+        disconnect();
+        if (!connect())
+            return SendResult::Failed;
+        encode(m_format, m_buf);
+        switch (writeBytes(m_buf)) {
+            case WriteResult::Ok: return SendResult::Sent;
+            case WriteResult::Dropped: return dropped();
+            case WriteResult::Broken: break;
+        }
+        return SendResult::Failed;
+    }
+
+  private:
+    enum class WriteResult {
+        Ok,
+        Dropped, ///< Daemon not keeping up; message discarded, connection kept.
+        Broken,  ///< Peer is gone; caller should reconnect.
+    };
+
+    /// A dropped write left the connection open only if the daemon was busy.
+    SendResult dropped() const { return m_fd >= 0 ? SendResult::Busy : SendResult::Failed; }
+
+    WriteResult writeBytes(std::string_view bytes) {
+        // MSG_NOSIGNAL: a dead daemon must not SIGPIPE the compositor.
+        ssize_t n = send(m_fd, bytes.data(), bytes.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n == static_cast<ssize_t>(bytes.size()))
+            return WriteResult::Ok;
+        if (n >= 0) {
+            // A partial message would corrupt the framing of everything
+            // that follows, so drop the connection and start afresh next time.
+            bump(m_stats.shortWrites);
+            disconnect();
+            return WriteResult::Dropped;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            bump(m_stats.busyWrites);
+            return WriteResult::Dropped;
+        }
+        if (errno == EPIPE || errno == ECONNRESET || errno == ENOTCONN || errno == ECONNREFUSED)
+            return WriteResult::Broken;
+        disconnect();
+        return WriteResult::Dropped;
+    }
+
+    /// Request binary framing on the fresh connection.  Stays on JSON if
+    /// the daemon declines or doesn't answer in time; returns false only
+    /// if the connection itself failed.
+    bool negotiate() {
+        std::string reply;
+        if (!hello(PROTOCOL_HELLO, reply))
+            return false;
+        if (reply == PROTOCOL_ACCEPT_JSON) {
+            // A daemon that predates version 2.
+            reply.clear();
+            if (!hello(PROTOCOL_HELLO_V1, reply))
+                return false;
+        }
+        m_parsedArgs = reply == PROTOCOL_ACCEPT_BINARY;
+        if (m_parsedArgs || reply == PROTOCOL_ACCEPT_BINARY_V1)
+            m_format = WireFormat::Binary;
+        return true;
+    }
+
+    /// Request acknowledgements on the fresh connection, like negotiate().
+    bool negotiateAcks() {
+        std::string reply;
+        if (!hello(PROTOCOL_HELLO_ACKS, reply))
+            return false;
+        m_acks = reply == PROTOCOL_ACCEPT_ACKS;
+        return true;
+    }
+
+    /// Send the handshake line `line` and read the reply into `reply`.
+    /// Skipped (leaving `reply` empty) once the daemon left a handshake
+    /// unanswered: a late answer to it must not pass for this one's.
+    bool hello(std::string_view line, std::string& reply) {
+        if (m_silent)
+            return true;
+        m_buf.assign(line);
+        m_buf += '\n';
+        if (writeBytes(m_buf) != WriteResult::Ok) {
+            disconnect();
+            return false;
+        }
+        // A daemon that answered one HELLO answers them all, so silence
+        // from it now only means it is slow.
+        return readReply(reply, !m_answered);
+    }
+
+    /// Longest reply line kept; anything longer is discarded.
+    static constexpr size_t MAX_REPLY_LINE = 4096;
+
+    /// Split received bytes into lines, keeping a partial one for later.
+    template <typename OnLine>
+    void takeLines(std::string_view bytes, OnLine& onLine) {
+        for (size_t nl; (nl = bytes.find('\n')) != std::string_view::npos;) {
+            if (m_rx.empty()) {
+                onLine(bytes.substr(0, nl));
+            } else {
+                m_rx.append(bytes.substr(0, nl));
+                onLine(std::string_view(m_rx));
+                m_rx.clear();
+            }
+            bytes.remove_prefix(nl + 1);
+        }
+        m_rx.append(bytes);
+        if (m_rx.size() > MAX_REPLY_LINE)
+            m_rx.clear();
+    }
+
+    /// Hand the swipe channel's fds to the daemon.  The channel stays
+    /// detached (swipes go over the socket) unless the daemon accepts;
+    /// returns false only if the connection itself failed.
+    bool attachSwipeChannel() {
+        char frame[2] = {static_cast<char>(Op::AttachSwipeChannel), 0};
+        struct iovec iov = {.iov_base = frame, .iov_len = sizeof(frame)};
+        alignas(struct cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+        struct msghdr msg = {};
+        msg.msg_iov        = &iov;
+        msg.msg_iovlen     = 1;
+        msg.msg_control    = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level     = SOL_SOCKET;
+        cmsg->cmsg_type      = SCM_RIGHTS;
+        cmsg->cmsg_len       = CMSG_LEN(2 * sizeof(int));
+        const int fds[2]     = {m_channel->memFd(), m_channel->eventFd()};
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+        if (sendmsg(m_fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT) != static_cast<ssize_t>(sizeof(frame))) {
+            disconnect();
+            return false;
+        }
+        std::string reply;
+        if (!readReply(reply, true))
+            return false;
+        m_channel->setAttached(reply == PROTOCOL_ACCEPT_SHM);
+        return true;
+    }
+
+    /// Longest handshake reply; every one the daemon sends is far shorter.
+    static constexpr size_t MAX_HANDSHAKE_REPLY = 64;
+
+    /// Read one reply line (without newline), waiting up to
+    /// `PROTOCOL_HELLO_TIMEOUT_MS` per byte.  If `mayIgnore` and the daemon
+    /// sends nothing at all, it predates the request: `reply` stays empty
+    /// and no further handshake is read on this connection.  Any other
+    /// timeout, or an over-long line, would leave the rest of the reply to
+    /// be taken for the next handshake's, so the connection is dropped.
+    /// Returns false if the connection failed or was dropped.
+    bool readReply(std::string& reply, bool mayIgnore) {
+        char c = 0;
+        for (;;) {
+            struct pollfd pfd = {.fd = m_fd, .events = POLLIN, .revents = 0};
+            if (poll(&pfd, 1, PROTOCOL_HELLO_TIMEOUT_MS) <= 0) {
+                if (reply.empty() && mayIgnore) {
+                    m_silent = true;
+                    return true;
+                }
+                disconnect();
+                return false;
+            }
+            ssize_t n = read(m_fd, &c, 1);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR)) {
+                disconnect();
+                return false;
+            }
+            if (n < 0)
+                continue;
+            if (c == '\n') {
+                m_answered = true;
+                return true;
+            }
+            if (reply.size() == MAX_HANDSHAKE_REPLY) {
+                disconnect();
+                return false;
+            }
+            reply += c;
+        }
+    }
+
+    static void bump(std::atomic<uint64_t>& counter) { counter.fetch_add(1, std::memory_order_relaxed); }
+
+    int                m_fd         = -1;
+    struct sockaddr_un m_addr {};
+    WireFormat         m_preferred  = WireFormat::Json;
+    WireFormat         m_format     = WireFormat::Json;
+    bool               m_parsedArgs = false;
+    bool               m_wantAcks   = false;
+    bool               m_acks       = false;
+    bool               m_answered   = false; ///< A handshake was answered on this connection
+    bool               m_silent     = false; ///< A handshake went unanswered on this connection
+    SwipeChannel*      m_channel    = nullptr;
+    std::string        m_buf;
+    std::string        m_rx; ///< Partial reply line read while idle
+    std::string        m_greetingJson;
+    std::string        m_greetingFrame;
+    ConnectionStats    m_stats;
+};
+
+/// Watches the directory of the daemon socket with inotify, so a writer
+/// waiting for the daemon hears when it binds its socket instead of
+/// retrying connect() on a timer.
+class SocketWatch {
+  public:
+    SocketWatch() = default;
+    SocketWatch(const SocketWatch&)            = delete;
+    SocketWatch& operator=(const SocketWatch&) = delete;
+    ~SocketWatch() { close(); }
+
+    /// Start watching for `path` to be created.  Returns false if inotify
+    /// or the directory is unavailable.
+    bool open(std::string_view path) {
+        close();
+        const size_t     slash = path.rfind('/');
+        const std::string dir  = slash == std::string_view::npos ? "." : std::string(path.substr(0, slash ? slash : 1));
+        m_name                 = path.substr(slash == std::string_view::npos ? 0 : slash + 1);
+        m_fd                   = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_fd < 0)
+            return false;
+        if (inotify_add_watch(m_fd, dir.c_str(), IN_CREATE | IN_MOVED_TO) < 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (m_fd >= 0)
+            ::close(m_fd);
+        m_fd = -1;
+    }
+
+    /// The inotify fd (-1 if not watching), readable when events are pending.
+    int fd() const { return m_fd; }
+
+    /// Drain pending events.  Returns true if any was about the socket
+    /// (or events were lost, which might have been).
+    bool consume() {
+        alignas(struct inotify_event) char buf[4096];
+        bool                                hit = false;
+        for (;;) {
+            const ssize_t n = read(m_fd, buf, sizeof(buf));
+            if (n <= 0)
+                return hit;
+            for (ssize_t at = 0; at < n;) {
+                const auto* ev = reinterpret_cast<const struct inotify_event*>(buf + at);
+                if ((ev->mask & IN_Q_OVERFLOW) || (ev->len && std::string_view(ev->name) == m_name))
+                    hit = true;
+                at += static_cast<ssize_t>(sizeof(struct inotify_event) + ev->len);
+            }
+        }
+    }
+
+  private:
+    int         m_fd = -1;
+    std::string m_name;
+};
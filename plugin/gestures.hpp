@@ -0,0 +1,72 @@
+// gestures.hpp — Which swipes the plugin takes from Hyprland.
+//
+// Mirrors the finger-count check on `SwipeBegin` in src/switcher.rs; keep
+// the two in sync.
+//
+// The daemon only acts on its switch and move finger counts.  On every
+// (re)connect the plugin sends `AttachGestures` and the daemon answers with
+// `hyprgrd:syncgestures <fingers…>` (`syncgestures_args` in
+// src/hyprland/wm.rs).  From then on swipeBegin looks the finger count up
+// here and leaves every other swipe to Hyprland, so other gesture binds
+// keep working and nothing about it crosses the socket.  Until the daemon
+// answers (daemons that predate this never do) every swipe is taken, as
+// before.
+
+#pragma once
+
+#include "helpers.hpp"
+
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+/// Highest finger count the table knows; more fingers are never routed.
+inline constexpr uint32_t MAX_ROUTED_FINGERS = 10;
+
+/// The finger counts whose swipes go to the daemon.
+class GestureRoutes {
+  public:
+    /// True if a swipe with `fingers` fingers should go to the daemon.
+    bool owns(uint32_t fingers) const { return !m_synced || (fingers < m_owned.size() && m_owned[fingers]); }
+
+    /// Route `fingers` to the daemon.
+    void add(uint32_t fingers) {
+        m_synced = true;
+        if (fingers < m_owned.size())
+            m_owned[fingers] = true;
+    }
+
+    /// True once the daemon has said which counts it uses.
+    bool synced() const { return m_synced; }
+
+    bool operator==(const GestureRoutes&) const = default;
+
+  private:
+    std::array<bool, MAX_ROUTED_FINGERS + 1> m_owned{};
+    bool                                     m_synced = false;
+};
+
+/// Parse `hyprgrd:syncgestures <fingers> [<fingers>…]` (sent by the daemon):
+/// one or more finger counts, 1 to `MAX_ROUTED_FINGERS`.
+inline std::optional<GestureRoutes> parseSyncGestures(std::string_view arg) {
+    GestureRoutes    routes;
+    std::string_view rest = trimView(arg);
+    if (rest.empty())
+        return std::nullopt;
+    while (!rest.empty()) {
+        uint32_t fingers = 0;
+        auto [end, ec]   = std::from_chars(rest.data(), rest.data() + rest.size(), fingers);
+        if (ec != std::errc{} || fingers == 0 || fingers > MAX_ROUTED_FINGERS)
+            return std::nullopt;
+        rest = rest.substr(static_cast<size_t>(end - rest.data()));
+        if (!rest.empty() && !std::isspace(static_cast<unsigned char>(rest.front())))
+            return std::nullopt;
+        rest = trimView(rest);
+        routes.add(fingers);
+    }
+    return routes;
+}
@@ -0,0 +1,316 @@
+// grid.hpp — In-compositor grid engine for `plugin:hyprgrd:grid_mode = plugin`.
+//
+// Mirrors the daemon's grid model (src/grid.rs and the workspace id mapping
+// in src/switcher.rs); keep the two in sync.  With the plugin owning the
+// grid, a keybind is resolved to workspace ids right here and applied on
+// Hyprland's main thread, and the daemon only hears about the new cell
+// afterwards (to update the visualizer).
+
+#pragma once
+
+#include "helpers.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// Grid navigation direction (cardinal and diagonal).
+enum class GridDirection {
+    Left,
+    Right,
+    Up,
+    Down,
+    UpLeft,
+    UpRight,
+    DownLeft,
+    DownRight,
+};
+
+/// Parse a direction the way the daemon does: case-insensitive, ignoring
+/// whitespace and underscores ("right", "up-left", "UpLeft", "down_right").
+inline std::optional<GridDirection> parseGridDirection(std::string_view s) {
+    char   buf[16];
+    size_t n = 0;
+    for (char c : s) {
+        if (std::isspace(static_cast<unsigned char>(c)) || c == '_')
+            continue;
+        if (n == sizeof(buf))
+            return std::nullopt;
+        buf[n++] = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    const std::string_view word(buf, n);
+    if (word == "left")
+        return GridDirection::Left;
+    if (word == "right")
+        return GridDirection::Right;
+    if (word == "up")
+        return GridDirection::Up;
+    if (word == "down")
+        return GridDirection::Down;
+    if (word == "upleft" || word == "up-left")
+        return GridDirection::UpLeft;
+    if (word == "upright" || word == "up-right")
+        return GridDirection::UpRight;
+    if (word == "downleft" || word == "down-left")
+        return GridDirection::DownLeft;
+    if (word == "downright" || word == "down-right")
+        return GridDirection::DownRight;
+    return std::nullopt;
+}
+
+/// A grid cell.
+struct GridCell {
+    size_t col = 0;
+    size_t row = 0;
+
+    bool operator==(const GridCell&) const = default;
+};
+
+/// One step from `from` in `dir`.  Left/up at an edge stay in place;
+/// right/down always extend (`Grid::get_abs_from`).
+inline GridCell stepFrom(GridDirection dir, GridCell from) {
+    const bool left  = dir == GridDirection::Left || dir == GridDirection::UpLeft || dir == GridDirection::DownLeft;
+    const bool right = dir == GridDirection::Right || dir == GridDirection::UpRight || dir == GridDirection::DownRight;
+    const bool up    = dir == GridDirection::Up || dir == GridDirection::UpLeft || dir == GridDirection::UpRight;
+    const bool down  = dir == GridDirection::Down || dir == GridDirection::DownLeft || dir == GridDirection::DownRight;
+    GridCell   to    = from;
+    if (left && to.col > 0)
+        --to.col;
+    if (right)
+        ++to.col;
+    if (up && to.row > 0)
+        --to.row;
+    if (down)
+        ++to.row;
+    return to;
+}
+
+/// Workspace id of `cell` on the monitor at `monitorIndex` of
+/// `monitorCount` (`GridSwitcher::compute_workspace_id`): Cantor pairing of
+/// the cell, one contiguous block of ids per cell, starting at 1.
+inline int32_t computeWorkspaceId(GridCell cell, size_t monitorIndex, size_t monitorCount) {
+    const auto s    = static_cast<__int128>(cell.col) + static_cast<__int128>(cell.row);
+    const auto pair = s * (s + 1) / 2 + static_cast<__int128>(cell.row);
+    const auto id   = pair * static_cast<__int128>(monitorCount) + static_cast<__int128>(monitorIndex) + 1;
+    return static_cast<int32_t>(std::clamp<__int128>(id, std::numeric_limits<int32_t>::min(),
+                                                      std::numeric_limits<int32_t>::max()));
+}
+
+/// Grid dimensions and position; the payload of SyncGrid in both
+/// directions.
+struct GridState {
+    size_t cols = 1;
+    size_t rows = 1;
+    size_t col  = 0;
+    size_t row  = 0;
+
+    bool operator==(const GridState&) const = default;
+};
+
+/// Parse exactly `out.size()` whitespace-separated non-negative integers.
+inline bool parseUnsignedWords(std::string_view arg, std::span<size_t> out) {
+    std::string_view rest = trimView(arg);
+    for (size_t i = 0; i < out.size(); ++i) {
+        auto [end, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), out[i]);
+        if (ec != std::errc{})
+            return false;
+        rest = rest.substr(static_cast<size_t>(end - rest.data()));
+        if (i + 1 < out.size() && (rest.empty() || !std::isspace(static_cast<unsigned char>(rest.front()))))
+            return false;
+        rest = trimView(rest);
+    }
+    return rest.empty();
+}
+
+/// Parse `hyprgrd:switch <col> <row>` like the daemon's SwitchTo.
+inline std::optional<GridCell> parseGridCell(std::string_view arg) {
+    size_t v[2];
+    if (!parseUnsignedWords(arg, v))
+        return std::nullopt;
+    return GridCell{.col = v[0], .row = v[1]};
+}
+
+/// Parse `hyprgrd:syncgrid <cols> <rows> <col> <row>` (sent by the daemon).
+inline std::optional<GridState> parseSyncGrid(std::string_view arg) {
+    size_t v[4];
+    if (!parseUnsignedWords(arg, v))
+        return std::nullopt;
+    return GridState{.cols = v[0], .rows = v[1], .col = v[2], .row = v[3]};
+}
+
+/// Names of the monitors in a `monitors` JSON reply (`hyprctl -j monitors`),
+/// in order — the order the daemon also assigns monitor indices in.
+///
+/// Only `"name"` keys of the top-level array's objects count; nested
+/// objects such as `activeWorkspace` have names too.
+inline std::vector<std::string> monitorNamesFromJson(std::string_view json) {
+    // End of the string starting at the quote `at` (npos if unterminated).
+    const auto stringEnd = [json](size_t at) {
+        for (size_t i = at + 1; i < json.size(); i += json[i] == '\\' ? 2 : 1)
+            if (json[i] == '"')
+                return i;
+        return std::string_view::npos;
+    };
+    const auto skipSpace = [json](size_t i) {
+        while (i < json.size() && std::isspace(static_cast<unsigned char>(json[i])))
+            ++i;
+        return i;
+    };
+
+    std::vector<std::string> names;
+    int                      depth = 0;
+    for (size_t i = 0; i < json.size(); ++i) {
+        const char c = json[i];
+        if (c == '[' || c == '{')
+            ++depth;
+        else if (c == ']' || c == '}')
+            --depth;
+        if (c != '"')
+            continue;
+        const size_t end = stringEnd(i);
+        if (end == std::string_view::npos)
+            break;
+        const std::string_view str = json.substr(i + 1, end - i - 1);
+        i                          = end;
+        const size_t colon         = skipSpace(end + 1);
+        if (colon >= json.size() || json[colon] != ':')
+            continue; // a value, not a key
+        const size_t value = skipSpace(colon + 1);
+        if (depth != 2 || str != "name" || value >= json.size() || json[value] != '"')
+            continue;
+        const size_t valueEnd = stringEnd(value);
+        if (valueEnd == std::string_view::npos)
+            break;
+        names.emplace_back(json.substr(value + 1, valueEnd - value - 1));
+        i = valueEnd;
+    }
+    return names;
+}
+
+/// Cells that changed state after a `WarmCells::visit`.
+struct WarmChange {
+    std::vector<GridCell> warm; ///< Newly warm: create and keep
+    std::vector<GridCell> cool; ///< Evicted: release
+};
+
+/// Least-recently-visited set of cells whose workspaces are kept warm
+/// (`plugin:hyprgrd:prefetch_cells`).  Mirrors `WarmCells` in
+/// src/prefetch.rs; keep the two in sync.
+class WarmCells {
+  public:
+    /// Hold at most `maxCells` cells (at least one); clears the set.
+    void setCapacity(size_t maxCells) {
+        m_max = std::max(maxCells, size_t{1});
+        m_cells.clear();
+    }
+
+    size_t capacity() const { return m_max; }
+
+    /// Least recently visited first.
+    const std::vector<GridCell>& cells() const { return m_cells; }
+
+    /// Record a move to `cell`: it and as many of its neighbours as the
+    /// cap allows (cardinal directions first) become the most recent
+    /// cells, evicting the least recently visited ones.
+    WarmChange visit(GridCell cell) {
+        static constexpr GridDirection ORDER[] = {
+            GridDirection::Right,     GridDirection::Left,     GridDirection::Down,    GridDirection::Up,
+            GridDirection::DownRight, GridDirection::DownLeft, GridDirection::UpRight, GridDirection::UpLeft,
+        };
+        std::vector<GridCell> wanted{cell};
+        for (GridDirection dir : ORDER) {
+            const GridCell next = stepFrom(dir, cell);
+            if (wanted.size() < m_max && std::find(wanted.begin(), wanted.end(), next) == wanted.end())
+                wanted.push_back(next);
+        }
+
+        WarmChange change;
+        // Neighbours before the cell itself, so it ends up most recent.
+        for (auto it = wanted.rbegin(); it != wanted.rend(); ++it) {
+            const auto at = std::find(m_cells.begin(), m_cells.end(), *it);
+            if (at != m_cells.end())
+                m_cells.erase(at);
+            else
+                change.warm.push_back(*it);
+            m_cells.push_back(*it);
+        }
+        std::reverse(change.warm.begin(), change.warm.end());
+        const size_t excess = m_cells.size() > m_max ? m_cells.size() - m_max : 0;
+        change.cool.assign(m_cells.begin(), m_cells.begin() + static_cast<ptrdiff_t>(excess));
+        m_cells.erase(m_cells.begin(), m_cells.begin() + static_cast<ptrdiff_t>(excess));
+        return change;
+    }
+
+  private:
+    std::vector<GridCell> m_cells;
+    size_t                m_max = 16;
+};
+
+/// The plugin-side grid: dimensions, the shared position and the monitor
+/// list that determines workspace ids.  Main-thread only.
+class GridEngine {
+  public:
+    /// Monitors in the daemon's order.  Until set the engine is not ready
+    /// and dispatchers fall back to the daemon.
+    void setMonitors(std::vector<std::string> monitors) { m_monitors = std::move(monitors); }
+
+    /// A monitor was added or removed: drop the list so the next dispatcher
+    /// reads it again.  The grid and the position in it are kept.
+    void forgetMonitors() { m_monitors.clear(); }
+
+    bool ready() const { return !m_monitors.empty(); }
+
+    const std::vector<std::string>& monitors() const { return m_monitors; }
+
+    const GridState& state() const { return m_state; }
+
+    GridCell cell() const { return {m_state.col, m_state.row}; }
+
+    /// Move to `cell`, growing the grid to contain it.
+    void moveTo(GridCell cell) {
+        m_state.col  = cell.col;
+        m_state.row  = cell.row;
+        m_state.cols = std::max(m_state.cols, cell.col + 1);
+        m_state.rows = std::max(m_state.rows, cell.row + 1);
+    }
+
+    /// Adopt the daemon's state (after it moved on its own, e.g. a swipe).
+    void sync(const GridState& state) {
+        m_state.cols = std::max(state.cols, size_t{1});
+        m_state.rows = std::max(state.rows, size_t{1});
+        moveTo({state.col, state.row});
+    }
+
+    /// Workspace id of `cell` on `monitor`, or nullopt for an unknown monitor.
+    std::optional<int32_t> workspaceFor(GridCell cell, std::string_view monitor) const {
+        const auto it = std::find(m_monitors.begin(), m_monitors.end(), monitor);
+        if (it == m_monitors.end())
+            return std::nullopt;
+        return computeWorkspaceId(cell, static_cast<size_t>(it - m_monitors.begin()), m_monitors.size());
+    }
+
+    /// The per-monitor switches that show the current cell.  Views point
+    /// into the engine's monitor list.
+    std::vector<WorkspaceSwitch> switches() const { return workspacesOf(cell()); }
+
+    /// Each monitor's workspace for `cell`, in monitor order.
+    std::vector<WorkspaceSwitch> workspacesOf(GridCell cell) const {
+        std::vector<WorkspaceSwitch> out;
+        out.reserve(m_monitors.size());
+        for (size_t i = 0; i < m_monitors.size(); ++i)
+            out.push_back({m_monitors[i], computeWorkspaceId(cell, i, m_monitors.size())});
+        return out;
+    }
+
+  private:
+    std::vector<std::string> m_monitors;
+    GridState                m_state;
+};
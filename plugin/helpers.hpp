@@ -2,25 +2,54 @@
 //
 // These are split out so the test suite can exercise them without pulling in
 // the Hyprland SDK headers.
+//
+// Every builder comes in two flavours: `format*()` writes into a
+// caller-provided buffer and returns a view of the bytes written (no heap
+// allocation; used on the dispatcher and swipe paths), and `build*()`
+// returns a `std::string` and is a thin wrapper around the former.
 
 #pragma once
 
+#include <algorithm>
 #include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 //  String helpers 
 
-/// Trim leading and trailing whitespace from a string.
-inline std::string trim(const std::string& s) {
+/// Trim leading and trailing whitespace from a view (no copy).
+inline std::string_view trimView(std::string_view s) {
     auto start = s.find_first_not_of(" \t\r\n");
-    if (start == std::string::npos)
-        return "";
+    if (start == std::string_view::npos)
+        return {};
     auto end = s.find_last_not_of(" \t\r\n");
     return s.substr(start, end - start + 1);
 }
 
+/// Trim leading and trailing whitespace from a string.
+inline std::string trim(const std::string& s) {
+    return std::string(trimView(s));
+}
+
+/// Write `s` into `out` with its first letter capitalized ("right" →
+/// "Right").  Returns an empty view if `out` is too small.
+inline std::string_view capitalizeInto(std::span<char> out, std::string_view s) {
+    if (s.size() > out.size())
+        return {};
+    s.copy(out.data(), s.size());
+    if (!s.empty())
+        out[0] = static_cast<char>(toupper(static_cast<unsigned char>(out[0])));
+    return {out.data(), s.size()};
+}
+
 /// Capitalize the first letter of a string ("right" → "Right").
 inline std::string capitalize(std::string s) {
     if (!s.empty())
@@ -36,6 +65,65 @@ inline std::string socketPath() {
     return "/tmp/hyprgrd.sock";
 }
 
+/// Appends to a fixed caller-provided buffer; never allocates.
+///
+/// Once something doesn't fit the writer is marked as overflowed and
+/// `view()` returns an empty view, so a truncated message can never be
+/// mistaken for a complete one.
+class SpanWriter {
+  public:
+    explicit SpanWriter(std::span<char> buf) : m_buf(buf) {}
+
+    void put(char c) {
+        if (m_len < m_buf.size())
+            m_buf[m_len++] = c;
+        else
+            m_overflow = true;
+    }
+
+    void put(std::string_view s) {
+        if (s.size() > m_buf.size() - m_len) {
+            m_overflow = true;
+            return;
+        }
+        s.copy(m_buf.data() + m_len, s.size());
+        m_len += s.size();
+    }
+
+    /// Append `printf`-formatted text.
+    template <typename... Args>
+    void putf(const char* fmt, Args... args) {
+        const size_t room = m_buf.size() - m_len;
+        int          n    = snprintf(m_buf.data() + m_len, room, fmt, args...);
+        // snprintf needs room for its terminator: n == room is truncated.
+        if (n < 0 || static_cast<size_t>(n) >= room)
+            m_overflow = true;
+        else
+            m_len += static_cast<size_t>(n);
+    }
+
+    bool overflowed() const { return m_overflow; }
+
+    /// The bytes written, or an empty view after an overflow.
+    std::string_view view() const {
+        return m_overflow ? std::string_view{} : std::string_view{m_buf.data(), m_len};
+    }
+
+  private:
+    std::span<char> m_buf;
+    size_t          m_len      = 0;
+    bool            m_overflow = false;
+};
+
+/// Run `format(span)` into a string sized for `capacity` bytes — the glue
+/// between the `format*()` and `build*()` flavours.
+template <typename Format>
+inline std::string formatToString(size_t capacity, Format&& format) {
+    std::string out(capacity, '\0');
+    out.resize(format(std::span<char>(out)).size());
+    return out;
+}
+
 //  Command builders 
 //
 // Each builder validates its input and returns either a JSON payload string
@@ -48,76 +136,358 @@ struct CommandResult {
     std::string value; ///< JSON payload if `ok`, error message otherwise.
 };
 
+/// Append `s` escaped for use as a JSON string value (backslash and quote).
+inline void putJsonEscaped(SpanWriter& w, std::string_view s) {
+    for (char c : s) {
+        if (c == '\\') w.put("\\\\");
+        else if (c == '"') w.put("\\\"");
+        else w.put(c);
+    }
+}
+
 /// Escape a string for use as a JSON string value (backslash and quote).
 inline std::string escapeJsonString(const std::string& s) {
-    std::string out;
-    out.reserve(s.size() + 8);
-    for (unsigned char c : s) {
-        if (c == '\\') out += "\\\\";
-        else if (c == '"') out += "\\\"";
-        else out += static_cast<char>(c);
-    }
-    return out;
+    return formatToString(2 * s.size(), [&](std::span<char> out) {
+        SpanWriter w(out);
+        putJsonEscaped(w, s);
+        return w.view();
+    });
+}
+
+/// Bytes needed by `formatArgJson(…, key, arg)` for an `argLen`-byte
+/// argument in the worst case (every character escaped).
+constexpr size_t argJsonCapacity(std::string_view key, size_t argLen) {
+    return key.size() + 2 * argLen + 8;
+}
+
+/// Write `{"<key>":"<trimmed, escaped arg>"}` — the shape shared by every
+/// dispatcher that forwards its raw argument.
+inline std::string_view formatArgJson(std::span<char> out, std::string_view key, std::string_view arg) {
+    SpanWriter w(out);
+    w.put("{\"");
+    w.put(key);
+    w.put("\":\"");
+    putJsonEscaped(w, trimView(arg));
+    w.put("\"}");
+    return w.view();
+}
+
+/// `build*Json()` wrapper around `formatArgJson`.
+inline CommandResult buildArgJson(std::string_view key, std::string_view arg) {
+    return {true, formatToString(argJsonCapacity(key, arg.size()), [&](std::span<char> out) {
+                return formatArgJson(out, key, arg);
+            })};
+}
+
+/// Write the JSON for `hyprgrd:go <direction>`. Forwards the raw argument;
+/// daemon parses and validates.
+inline std::string_view formatGoJson(std::span<char> out, std::string_view arg) {
+    return formatArgJson(out, "Go", arg);
 }
 
 /// Build the JSON for `hyprgrd:go <direction>`. Forwards the raw argument;
 /// daemon parses and validates.
 inline CommandResult buildGoJson(const std::string& arg) {
-    std::string s = escapeJsonString(trim(arg));
-    return {true, "{\"Go\":\"" + s + "\"}"};
+    return buildArgJson("Go", arg);
+}
+
+/// Write the JSON for `hyprgrd:movego <direction>`. Forwards the raw argument.
+inline std::string_view formatMoveGoJson(std::span<char> out, std::string_view arg) {
+    return formatArgJson(out, "MoveWindowAndGo", arg);
 }
 
 /// Build the JSON for `hyprgrd:movego <direction>`. Forwards the raw argument.
 inline CommandResult buildMoveGoJson(const std::string& arg) {
-    std::string s = escapeJsonString(trim(arg));
-    return {true, "{\"MoveWindowAndGo\":\"" + s + "\"}"};
+    return buildArgJson("MoveWindowAndGo", arg);
+}
+
+/// Write the JSON for `hyprgrd:switch <col> <row>`. Forwards the raw argument
+/// (e.g. "0 0"); daemon parses.
+inline std::string_view formatSwitchJson(std::span<char> out, std::string_view arg) {
+    return formatArgJson(out, "SwitchTo", arg);
 }
 
 /// Build the JSON for `hyprgrd:switch <col> <row>`. Forwards the raw argument
 /// (e.g. "0 0"); daemon parses.
 inline CommandResult buildSwitchJson(const std::string& arg) {
-    std::string s = escapeJsonString(trim(arg));
-    return {true, "{\"SwitchTo\":\"" + s + "\"}"};
+    return buildArgJson("SwitchTo", arg);
+}
+
+/// Write the JSON for `hyprgrd:movetomonitor <direction>`. Forwards the raw argument.
+inline std::string_view formatMoveToMonitorJson(std::span<char> out, std::string_view arg) {
+    return formatArgJson(out, "MoveWindowToMonitor", arg);
 }
 
 /// Build the JSON for `hyprgrd:movetomonitor <direction>`. Forwards the raw argument.
 inline CommandResult buildMoveToMonitorJson(const std::string& arg) {
-    std::string s = escapeJsonString(trim(arg));
-    return {true, "{\"MoveWindowToMonitor\":\"" + s + "\"}"};
+    return buildArgJson("MoveWindowToMonitor", arg);
+}
+
+/// Write the JSON for `hyprgrd:movetomonitorindex <n>`. Forwards the raw argument;
+/// daemon parses.
+inline std::string_view formatMoveToMonitorIndexJson(std::span<char> out, std::string_view arg) {
+    return formatArgJson(out, "MoveWindowToMonitorIndex", arg);
 }
 
 /// Build the JSON for `hyprgrd:movetomonitorindex <n>`. Forwards the raw argument;
 /// daemon parses.
 inline CommandResult buildMoveToMonitorIndexJson(const std::string& arg) {
-    std::string s = escapeJsonString(trim(arg));
-    return {true, "{\"MoveWindowToMonitorIndex\":\"" + s + "\"}"};
+    return buildArgJson("MoveWindowToMonitorIndex", arg);
+}
+
+/// Write the JSON for `hyprgrd:togglevis` (takes no argument).
+///
+/// Produces: `"ToggleVisualizer"`
+inline std::string_view formatToggleVisualizerJson(std::span<char> out) {
+    SpanWriter w(out);
+    w.put("\"ToggleVisualizer\"");
+    return w.view();
+}
+
+/// Build the JSON for `hyprgrd:togglevis` (takes no argument).
+///
+/// Produces: `"ToggleVisualizer"`
+inline std::string buildToggleVisualizerJson() {
+    return formatToString(32, [](std::span<char> out) { return formatToggleVisualizerJson(out); });
+}
+
+/// Write the JSON telling the daemon the plugin draws the overlay itself
+/// (`overlay = plugin`; sent on every connect).
+///
+/// Produces: `"AttachOverlay"`
+inline std::string_view formatAttachOverlayJson(std::span<char> out) {
+    SpanWriter w(out);
+    w.put("\"AttachOverlay\"");
+    return w.view();
+}
+
+/// Build the JSON for AttachOverlay.
+///
+/// Produces: `"AttachOverlay"`
+inline std::string buildAttachOverlayJson() {
+    return formatToString(32, [](std::span<char> out) { return formatAttachOverlayJson(out); });
+}
+
+/// Write the JSON asking the daemon which finger counts it uses, so the
+/// plugin can leave other swipes to Hyprland (sent on every connect).
+///
+/// Produces: `"AttachGestures"`
+inline std::string_view formatAttachGesturesJson(std::span<char> out) {
+    SpanWriter w(out);
+    w.put("\"AttachGestures\"");
+    return w.view();
+}
+
+/// Write the JSON telling the daemon where the plugin's grid engine moved
+/// (`grid_mode = plugin`).  Fits in `SWIPE_JSON_CAPACITY`.
+///
+/// Produces: `{"SyncGrid":{"cols":3,"rows":2,"col":2,"row":1}}`
+inline std::string_view formatSyncGridJson(std::span<char> out, uint32_t cols, uint32_t rows, uint32_t col,
+                                           uint32_t row) {
+    SpanWriter w(out);
+    w.putf(R"({"SyncGrid":{"cols":%u,"rows":%u,"col":%u,"row":%u}})", cols, rows, col, row);
+    return w.view();
+}
+
+/// Build the JSON telling the daemon where the plugin's grid engine moved.
+///
+/// Produces: `{"SyncGrid":{"cols":3,"rows":2,"col":2,"row":1}}`
+inline std::string buildSyncGridJson(uint32_t cols, uint32_t rows, uint32_t col, uint32_t row) {
+    return formatToString(128, [&](std::span<char> out) { return formatSyncGridJson(out, cols, rows, col, row); });
 }
 
 //  Swipe event builders (sent by the swipe hooks) 
 
+/// Largest swipe delta or velocity written, either sign.  No gesture comes
+/// near it; it bounds the `%f` output so the events below always fit.
+inline constexpr double SWIPE_VALUE_LIMIT = 1e9;
+
+/// `v` clamped to ±SWIPE_VALUE_LIMIT, and 0 for NaN (which JSON can't
+/// carry anyway).
+inline double swipeValue(double v) {
+    return std::isnan(v) ? 0.0 : std::clamp(v, -SWIPE_VALUE_LIMIT, SWIPE_VALUE_LIMIT);
+}
+
+/// Buffer size that fits any swipe event JSON: the longest, a traced
+/// update with every field at its widest, takes 149 bytes.
+inline constexpr size_t SWIPE_JSON_CAPACITY = 256;
+
+/// Write JSON for a swipe-begin event.
+///
+/// Produces: `{"SwipeBegin":{"fingers":3}}`
+inline std::string_view formatSwipeBeginJson(std::span<char> out, uint32_t fingers) {
+    SpanWriter w(out);
+    w.putf(R"({"SwipeBegin":{"fingers":%u}})", fingers);
+    return w.view();
+}
+
 /// Build JSON for a swipe-begin event.
 ///
 /// Produces: `{"SwipeBegin":{"fingers":3}}`
 inline std::string buildSwipeBeginJson(uint32_t fingers) {
-    return "{\"SwipeBegin\":{\"fingers\":" + std::to_string(fingers) + "}}";
+    return formatToString(SWIPE_JSON_CAPACITY, [&](std::span<char> out) {
+        return formatSwipeBeginJson(out, fingers);
+    });
+}
+
+/// Write JSON for a swipe-update event.
+///
+/// Produces: `{"SwipeUpdate":{"fingers":3,"dx":10.5,"dy":-2.3}}`
+inline std::string_view formatSwipeUpdateJson(std::span<char> out, uint32_t fingers, double dx, double dy) {
+    SpanWriter w(out);
+    // Use enough precision for sub-pixel deltas.
+    w.putf(R"({"SwipeUpdate":{"fingers":%u,"dx":%.6f,"dy":%.6f}})", fingers, swipeValue(dx), swipeValue(dy));
+    return w.view();
 }
 
 /// Build JSON for a swipe-update event.
 ///
 /// Produces: `{"SwipeUpdate":{"fingers":3,"dx":10.5,"dy":-2.3}}`
 inline std::string buildSwipeUpdateJson(uint32_t fingers, double dx, double dy) {
-    // Use enough precision for sub-pixel deltas.
-    char buf[256];
-    snprintf(buf, sizeof(buf),
-             R"({"SwipeUpdate":{"fingers":%u,"dx":%.6f,"dy":%.6f}})",
-             fingers, dx, dy);
-    return buf;
+    return formatToString(SWIPE_JSON_CAPACITY, [&](std::span<char> out) {
+        return formatSwipeUpdateJson(out, fingers, dx, dy);
+    });
+}
+
+/// Write JSON for a swipe-update event that carries a latency trace:
+/// `timeMs` is the input event timestamp and `sentNs` the CLOCK_MONOTONIC
+/// time the plugin sent the update.
+///
+/// Produces: `{"SwipeUpdate":{"fingers":3,"dx":10.5,"dy":-2.3,"trace":{"input_ms":1234,"sent_ns":5678}}}`
+inline std::string_view formatTracedSwipeUpdateJson(std::span<char> out, uint32_t fingers, double dx, double dy,
+                                                    uint32_t timeMs, uint64_t sentNs) {
+    SpanWriter w(out);
+    w.putf(R"({"SwipeUpdate":{"fingers":%u,"dx":%.6f,"dy":%.6f,"trace":{"input_ms":%u,"sent_ns":%llu}}})", fingers,
+           swipeValue(dx), swipeValue(dy), timeMs, static_cast<unsigned long long>(sentNs));
+    return w.view();
+}
+
+/// Build JSON for a swipe-update event that carries a latency trace.
+///
+/// Produces: `{"SwipeUpdate":{"fingers":3,"dx":10.5,"dy":-2.3,"trace":{"input_ms":1234,"sent_ns":5678}}}`
+inline std::string buildTracedSwipeUpdateJson(uint32_t fingers, double dx, double dy, uint32_t timeMs,
+                                              uint64_t sentNs) {
+    return formatToString(SWIPE_JSON_CAPACITY, [&](std::span<char> out) {
+        return formatTracedSwipeUpdateJson(out, fingers, dx, dy, timeMs, sentNs);
+    });
+}
+
+/// Write JSON for a swipe's release velocity (pixels per second).
+///
+/// Produces: `{"SwipeVelocity":{"vx":850.0,"vy":-12.5}}`
+inline std::string_view formatSwipeVelocityJson(std::span<char> out, double vx, double vy) {
+    SpanWriter w(out);
+    w.putf(R"({"SwipeVelocity":{"vx":%.3f,"vy":%.3f}})", swipeValue(vx), swipeValue(vy));
+    return w.view();
+}
+
+/// Build JSON for a swipe's release velocity.
+///
+/// Produces: `{"SwipeVelocity":{"vx":850.0,"vy":-12.5}}`
+inline std::string buildSwipeVelocityJson(double vx, double vy) {
+    return formatToString(SWIPE_JSON_CAPACITY, [&](std::span<char> out) {
+        return formatSwipeVelocityJson(out, vx, vy);
+    });
+}
+
+/// Write JSON for a swipe-end event.
+///
+/// Produces: `"SwipeEnd"`
+inline std::string_view formatSwipeEndJson(std::span<char> out) {
+    SpanWriter w(out);
+    w.put("\"SwipeEnd\"");
+    return w.view();
 }
 
 /// Build JSON for a swipe-end event.
 ///
 /// Produces: `"SwipeEnd"`
 inline std::string buildSwipeEndJson() {
-    return "\"SwipeEnd\"";
+    return formatToString(SWIPE_JSON_CAPACITY, [](std::span<char> out) { return formatSwipeEndJson(out); });
 }
 
+//  Grid application (hyprgrd:applygrid) 
+
+/// One `<monitor> <workspace>` pair of a `hyprgrd:applygrid` argument.
+struct WorkspaceSwitch {
+    std::string_view monitor; ///< Points into the parsed argument
+    int              workspace = 0;
+};
+
+/// Parse `<monitor> <workspace> [<monitor> <workspace> …]` into `out`.
+///
+/// Returns false (leaving `out` unspecified) when the argument is empty,
+/// has an odd number of words or a workspace isn't an integer.
+inline bool parseApplyGrid(std::string_view arg, std::vector<WorkspaceSwitch>& out) {
+    out.clear();
+    const auto isSpace = [](char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; };
+    const auto nextWord = [&](std::string_view& rest) {
+        while (!rest.empty() && isSpace(rest.front()))
+            rest.remove_prefix(1);
+        size_t n = 0;
+        while (n < rest.size() && !isSpace(rest[n]))
+            ++n;
+        std::string_view word = rest.substr(0, n);
+        rest.remove_prefix(n);
+        return word;
+    };
+
+    std::string_view rest = arg;
+    for (std::string_view monitor = nextWord(rest); !monitor.empty(); monitor = nextWord(rest)) {
+        std::string_view ws = nextWord(rest);
+        int              id = 0;
+        auto [end, ec]      = std::from_chars(ws.data(), ws.data() + ws.size(), id);
+        if (ws.empty() || ec != std::errc{} || end != ws.data() + ws.size())
+            return false;
+        out.push_back({monitor, id});
+    }
+    return !out.empty();
+}
+
+/// Parse `<workspace> [<workspace> …]` (`hyprgrd:cool`) into `out`.
+///
+/// Returns false when the argument is empty or a word isn't an integer.
+inline bool parseWorkspaceIds(std::string_view arg, std::vector<int>& out) {
+    out.clear();
+    std::string_view rest = trimView(arg);
+    while (!rest.empty()) {
+        int id         = 0;
+        auto [end, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), id);
+        if (ec != std::errc{})
+            return false;
+        rest = rest.substr(static_cast<size_t>(end - rest.data()));
+        if (!rest.empty() && !std::isspace(static_cast<unsigned char>(rest.front())))
+            return false;
+        out.push_back(id);
+        rest = trimView(rest);
+    }
+    return !out.empty();
+}
+
+/// Value of the first string field `key` in a JSON object, without
+/// unescaping; empty if absent.  Enough for the fixed field order of
+/// Hyprland's own replies (e.g. `"monitor"` in `activeworkspace`), not a
+/// general JSON parser.
+inline std::string_view jsonStringField(std::string_view json, std::string_view key) {
+    for (size_t at = json.find(key); at != std::string_view::npos; at = json.find(key, at + 1)) {
+        if (at == 0 || json[at - 1] != '"' || json.substr(at + key.size(), 1) != "\"")
+            continue;
+        std::string_view rest = trimView(json.substr(at + key.size() + 1));
+        if (rest.empty() || rest.front() != ':')
+            continue;
+        rest = trimView(rest.substr(1));
+        if (rest.empty() || rest.front() != '"')
+            return {};
+        rest.remove_prefix(1);
+        return rest.substr(0, rest.find('"'));
+    }
+    return {};
+}
+
+/// Move the switch for monitor `focused` (if any) to the end.  Each switch
+/// focuses its monitor, so applying the focused one last leaves focus —
+/// and the cursor — where it was.
+inline void focusedLast(std::vector<WorkspaceSwitch>& switches, std::string_view focused) {
+    std::stable_partition(switches.begin(), switches.end(),
+                          [focused](const WorkspaceSwitch& s) { return s.monitor != focused; });
+}
@@ -0,0 +1,460 @@
+// Load generator for the hyprgrd daemon.
+//
+// Starts the daemon against its mock window manager (`hyprgrd --mock-wm`,
+// see src/main.rs), opens N concurrent clients to its socket through the
+// plugin's own DaemonConnection and plays a recorded command sequence on
+// every client at a fixed rate.  The mock daemon acknowledges each handled
+// command on stdout, which gives the command-to-handled latency of every
+// traced swipe update and the daemon's backlog at any moment; its CPU time
+// comes from /proc.  Running a list of rates shows where the socket
+// listener or the command channel stops keeping up: handled_per_sec stops
+// following offered_per_sec, backlog_max grows, and the latency split
+// (socket_p99_us: send → decoded by the listener; channel_p99_us: decoded
+// → handled by the switcher) tells which side is saturated.
+//
+// Build & run:
+//   cd plugin && cmake -B build-bench -DHYPRGRD_BUILD_BENCH=ON && cmake --build build-bench
+//   cargo build --release
+//   ./build-bench/loadgen --daemon ../target/release/hyprgrd --clients 1,8 --rate 240,2000,20000
+//
+// Output is one JSON object per (clients, rate) step and line on stdout,
+// e.g.
+//
+//   {"name":"loadgen","clients":8,"rate_hz":2000,"wire":"binary","offered_per_sec":16000,
+//    "sent":80000,"dropped":0,"handled":80000,"handled_per_sec":15998,"merged":3120,"backlog_max":41,
+//    "ack_p50_us":32.8,"ack_p99_us":131.1,"ack_max_us":802.3,"socket_p99_us":65.5,
+//    "channel_p99_us":65.5,"lag_max_us":210.4,"daemon_cpu_pct":38.0}
+//
+// Latencies are log2 histogram bucket bounds (stats.hpp), within a factor
+// of two.  `dropped` counts sends the plugin would have dropped because
+// the daemon wasn't draining its socket; `lag_max_us` is how far behind
+// schedule a client fell.  The daemon reads its command channel the way
+// its real event loops do, folding `go` bursts, merging swipe updates and
+// dropping stale visual offsets; `handled` counts every command sent that
+// was taken care of that way, `merged` those the switcher never saw
+// separately.
+//
+// Options:
+//   --daemon PATH        hyprgrd binary to start with --mock-wm (required)
+//   --clients N[,N…]     concurrent connections per step (default 4)
+//   --rate HZ[,HZ…]      messages per second and client (default 240)
+//   --duration S         seconds per step (default 3)
+//   --wire json|binary   wire format to negotiate (default binary)
+//   --mock-delay-us N    time the mock window manager takes per call
+//   --sequence FILE      commands to play instead of the built-in mix
+//
+// A sequence file holds one command per line, played in order and from
+// the start again; blank lines and lines starting with `#` are skipped:
+//
+//   go <direction>              switch <col> <row>
+//   begin <fingers>             update <fingers> <dx> <dy>
+//   end
+//
+// plus any other dispatcher of commands.hpp with its argument, such as
+// `movetomonitor left` or `togglevis`.
+
+#include "commands.hpp"
+#include "connection.hpp"
+#include "helpers.hpp"
+#include "protocol.hpp"
+#include "queue.hpp"
+#include "stats.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Command sequences
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Built-in mix: a short three-finger swipe that comes back to where it
+/// started (so it doesn't commit and the grid stays small), then keybind
+/// moves away and back and an absolute switch home.
+static std::vector<PluginMessage> builtinSequence() {
+    std::vector<PluginMessage> seq;
+    seq.push_back(PluginMessage::swipeBegin(3));
+    for (int i = 0; i < 24; ++i)
+        seq.push_back(PluginMessage::swipeUpdate(3, i < 12 ? 4.0 : -4.0, 0.5, static_cast<uint32_t>(i * 4)));
+    seq.push_back(PluginMessage::simple(MessageKind::SwipeEnd));
+    PluginMessage m;
+    for (std::string_view arg : {"right", "down", "left", "up"}) {
+        PluginMessage::withArg(MessageKind::Go, arg, m);
+        seq.push_back(m);
+    }
+    PluginMessage::withArg(MessageKind::Switch, "0 0", m);
+    seq.push_back(m);
+    return seq;
+}
+
+/// Load a sequence file (see the header).  Exits on a malformed line.
+static std::vector<PluginMessage> loadSequence(const char* path) {
+    std::ifstream              in(path);
+    std::vector<PluginMessage> seq;
+    std::string                line;
+    for (size_t lineNo = 1; std::getline(in, line); ++lineNo) {
+        std::istringstream words(line);
+        std::string        op;
+        if (!(words >> op) || op[0] == '#')
+            continue;
+        PluginMessage m;
+        std::string   rest;
+        uint32_t      fingers = 0;
+        double        dx = 0.0, dy = 0.0;
+        bool          ok = true;
+        if (const CommandSpec* spec = commandNamed(op)) {
+            std::getline(words, rest);
+            ok = PluginMessage::withArg(spec->kind, trim(rest), m);
+        } else if (op == "begin") {
+            ok = static_cast<bool>(words >> fingers);
+            m  = PluginMessage::swipeBegin(fingers);
+        } else if (op == "update") {
+            ok = static_cast<bool>(words >> fingers >> dx >> dy);
+            m  = PluginMessage::swipeUpdate(fingers, dx, dy);
+        } else if (op == "end") {
+            m = PluginMessage::simple(MessageKind::SwipeEnd);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            fprintf(stderr, "loadgen: %s:%zu: cannot parse \"%s\"\n", path, lineNo, line.c_str());
+            std::exit(1);
+        }
+        seq.push_back(m);
+    }
+    if (seq.empty()) {
+        fprintf(stderr, "loadgen: %s: no commands\n", path);
+        std::exit(1);
+    }
+    return seq;
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Mock daemon process
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// `hyprgrd --mock-wm` in a private runtime and config directory, with its
+/// stdout (the acks) on a pipe read by a background thread.
+class MockWmDaemon {
+  public:
+    MockWmDaemon(const char* binary, uint64_t delayUs) {
+        char dir[] = "/tmp/hyprgrd-loadgen-XXXXXX";
+        if (!mkdtemp(dir)) {
+            perror("loadgen: mkdtemp");
+            std::exit(1);
+        }
+        m_dir  = dir;
+        m_path = m_dir + "/hyprgrd.sock";
+
+        int out[2];
+        if (pipe(out) < 0) {
+            perror("loadgen: pipe");
+            std::exit(1);
+        }
+        const std::string delay = "--mock-wm-delay-us=" + std::to_string(delayUs);
+        m_pid                   = fork();
+        if (m_pid == 0) {
+            dup2(out[1], STDOUT_FILENO);
+            close(out[0]);
+            close(out[1]);
+            // No user config (prefetching, custom gestures) and no clash
+            // with a daemon that is already running.
+            setenv("XDG_RUNTIME_DIR", m_dir.c_str(), 1);
+            setenv("XDG_CONFIG_HOME", m_dir.c_str(), 1);
+            execl(binary, binary, "--mock-wm", delay.c_str(), static_cast<char*>(nullptr));
+            perror("loadgen: exec");
+            _exit(127);
+        }
+        close(out[1]);
+        if (m_pid < 0) {
+            perror("loadgen: fork");
+            std::exit(1);
+        }
+        m_acks   = fdopen(out[0], "r");
+        m_reader = std::thread([this] { readAcks(); });
+
+        struct stat st {};
+        for (int i = 0; i < 500 && stat(m_path.c_str(), &st) < 0; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (stat(m_path.c_str(), &st) < 0) {
+            fprintf(stderr, "loadgen: %s did not create %s\n", binary, m_path.c_str());
+            std::exit(1);
+        }
+    }
+
+    MockWmDaemon(const MockWmDaemon&)            = delete;
+    MockWmDaemon& operator=(const MockWmDaemon&) = delete;
+
+    ~MockWmDaemon() {
+        kill(m_pid, SIGTERM);
+        waitpid(m_pid, nullptr, 0);
+        m_reader.join();
+        fclose(m_acks);
+        unlink(m_path.c_str());
+        rmdir(m_dir.c_str());
+    }
+
+    const std::string& path() const { return m_path; }
+
+    /// Commands handled so far, including those folded or merged into
+    /// another one.
+    uint64_t handled() const { return m_handled.load(std::memory_order_acquire); }
+
+    /// Commands the switcher was handed so far.
+    uint64_t calls() const { return m_calls.load(std::memory_order_acquire); }
+
+    /// Wait until `n` commands have been handled.  Returns false after 5 s.
+    bool waitFor(uint64_t n) const {
+        const uint64_t deadline = nowNs() + 5'000'000'000ull;
+        while (handled() < n) {
+            if (nowNs() > deadline)
+                return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    /// Daemon CPU time (user + system) so far, in seconds.
+    double cpuSeconds() const {
+        std::ifstream in("/proc/" + std::to_string(m_pid) + "/stat");
+        std::string   stat((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        // Fields after the parenthesised command name start at `state`;
+        // utime and stime are the 12th and 13th of those.
+        const size_t paren = stat.rfind(')');
+        if (paren == std::string::npos)
+            return 0.0;
+        std::istringstream fields(stat.substr(paren + 2));
+        std::string        skip;
+        unsigned long long utime = 0, stime = 0;
+        for (int i = 0; i < 11; ++i)
+            fields >> skip;
+        fields >> utime >> stime;
+        return static_cast<double>(utime + stime) / static_cast<double>(sysconf(_SC_CLK_TCK));
+    }
+
+    /// Latencies of traced commands sent at or after `since` (nowNs()).
+    void resetLatency(uint64_t since) {
+        m_since.store(since, std::memory_order_release);
+        total.reset();
+        socket.reset();
+        channel.reset();
+    }
+
+    LatencyHistogram total;   ///< Send → handled
+    LatencyHistogram socket;  ///< Send → decoded by the listener
+    LatencyHistogram channel; ///< Decoded → handled
+
+  private:
+    void readAcks() {
+        unsigned long long sent = 0, received = 0, done = 0, taken = 0;
+        while (fscanf(m_acks, " ack %llu %llu %llu %llu", &sent, &received, &done, &taken) == 4) {
+            if (sent != 0 && sent >= m_since.load(std::memory_order_acquire) && received >= sent && done >= received) {
+                total.record(done - sent);
+                socket.record(received - sent);
+                channel.record(done - received);
+            }
+            m_calls.fetch_add(1, std::memory_order_release);
+            m_handled.fetch_add(taken, std::memory_order_release);
+        }
+    }
+
+    std::string           m_dir;
+    std::string           m_path;
+    pid_t                 m_pid  = -1;
+    FILE*                 m_acks = nullptr;
+    std::thread           m_reader;
+    std::atomic<uint64_t> m_handled{0};
+    std::atomic<uint64_t> m_calls{0};
+    std::atomic<uint64_t> m_since{0};
+};
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Clients
+// ═══════════════════════════════════════════════════════════════════════════
+
+struct StepCounters {
+    std::atomic<uint64_t> sent{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> lagMaxNs{0};
+};
+
+/// One client: play `seq` from a per-client offset at `rateHz` from
+/// `startNs` until `endNs`, on a fixed schedule (a client that falls
+/// behind sends immediately rather than skipping).
+static void runClient(const std::string& path, WireFormat format, const std::vector<PluginMessage>& seq,
+                      size_t offset, uint64_t rateHz, uint64_t startNs, uint64_t endNs, StepCounters& counters) {
+    DaemonConnection conn;
+    ParsedFrameCache parsed;
+    conn.setPath(path);
+    conn.setPreferredFormat(format);
+    if (!conn.connect()) {
+        fprintf(stderr, "loadgen: cannot connect to %s\n", path.c_str());
+        return;
+    }
+    const uint64_t periodNs = 1'000'000'000ull / std::max<uint64_t>(rateHz, 1);
+    uint64_t       lagMax   = 0;
+    size_t         i        = offset;
+    for (uint64_t due = startNs; due < endNs; due += periodNs, ++i) {
+        const uint64_t now = nowNs();
+        if (now < due)
+            std::this_thread::sleep_for(std::chrono::nanoseconds(due - now));
+        else
+            lagMax = std::max(lagMax, now - due);
+        PluginMessage msg = seq[i % seq.size()];
+        const bool    ok  = conn.sendEncoded([&](WireFormat f, std::string& out) {
+            if (msg.kind == MessageKind::SwipeUpdate)
+                msg.sentNs = nowNs();
+            encodeMessage(msg, f, out, conn.parsedArgs() ? &parsed : nullptr);
+        }) == SendResult::Sent;
+        counters.sent.fetch_add(1, std::memory_order_relaxed);
+        if (!ok)
+            counters.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+    uint64_t prev = counters.lagMaxNs.load(std::memory_order_relaxed);
+    while (lagMax > prev && !counters.lagMaxNs.compare_exchange_weak(prev, lagMax, std::memory_order_relaxed)) {}
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Steps
+// ═══════════════════════════════════════════════════════════════════════════
+
+struct Options {
+    const char*                daemon   = nullptr;
+    std::vector<uint64_t>      clients  = {4};
+    std::vector<uint64_t>      rates    = {240};
+    double                     duration = 3.0;
+    WireFormat                 format   = WireFormat::Binary;
+    uint64_t                   delayUs  = 0;
+    std::vector<PluginMessage> sequence;
+};
+
+/// Run `clients` clients at `rateHz` each for the configured duration and
+/// print the step's record.
+static void runStep(MockWmDaemon& daemon, const Options& opt, uint64_t clients, uint64_t rateHz) {
+    StepCounters   counters;
+    const uint64_t handledBefore = daemon.handled();
+    const uint64_t callsBefore   = daemon.calls();
+    // Let every client connect (and negotiate) before the clock starts.
+    const uint64_t startNs = nowNs() + 100'000'000ull;
+    const uint64_t endNs   = startNs + static_cast<uint64_t>(opt.duration * 1e9);
+    daemon.resetLatency(startNs);
+
+    std::vector<std::thread> threads;
+    for (uint64_t c = 0; c < clients; ++c)
+        threads.emplace_back(runClient, std::cref(daemon.path()), opt.format, std::cref(opt.sequence),
+                             static_cast<size_t>(c * 7), rateHz, startNs, endNs, std::ref(counters));
+
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::nanoseconds(startNs)));
+    const double cpuBefore  = daemon.cpuSeconds();
+    uint64_t     backlogMax = 0;
+    while (nowNs() < endNs) {
+        const uint64_t delivered = counters.sent.load() - counters.dropped.load();
+        const uint64_t handled   = daemon.handled() - handledBefore;
+        backlogMax               = std::max(backlogMax, delivered > handled ? delivered - handled : 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    for (auto& t : threads)
+        t.join();
+    const double   cpu       = daemon.cpuSeconds() - cpuBefore;
+    const double   wallS     = static_cast<double>(nowNs() - startNs) / 1e9;
+    const uint64_t sent      = counters.sent.load();
+    const uint64_t dropped   = counters.dropped.load();
+    const uint64_t handledIn = daemon.handled() - handledBefore;
+    // The rest of the backlog drains before the next step starts.
+    if (!daemon.waitFor(handledBefore + sent - dropped))
+        fprintf(stderr, "loadgen: daemon handled %llu of %llu commands\n",
+                static_cast<unsigned long long>(daemon.handled() - handledBefore),
+                static_cast<unsigned long long>(sent - dropped));
+    const uint64_t handledAll = daemon.handled() - handledBefore;
+    const uint64_t calls      = daemon.calls() - callsBefore;
+
+    auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1e3; };
+    printf(R"({"name":"loadgen","clients":%llu,"rate_hz":%llu,"wire":"%s","offered_per_sec":%llu,)"
+           R"("sent":%llu,"dropped":%llu,"handled":%llu,"handled_per_sec":%.0f,"merged":%llu,"backlog_max":%llu,)"
+           R"("ack_p50_us":%.1f,"ack_p99_us":%.1f,"ack_max_us":%.1f,"socket_p99_us":%.1f,"channel_p99_us":%.1f,)"
+           R"("lag_max_us":%.1f,"daemon_cpu_pct":%.1f})"
+           "\n",
+           static_cast<unsigned long long>(clients), static_cast<unsigned long long>(rateHz),
+           opt.format == WireFormat::Binary ? "binary" : "json", static_cast<unsigned long long>(clients * rateHz),
+           static_cast<unsigned long long>(sent), static_cast<unsigned long long>(dropped),
+           static_cast<unsigned long long>(handledIn), static_cast<double>(handledIn) / wallS,
+           static_cast<unsigned long long>(handledAll > calls ? handledAll - calls : 0),
+           static_cast<unsigned long long>(backlogMax), us(std::min(daemon.total.quantileNs(0.5), daemon.total.maxNs())),
+           us(std::min(daemon.total.quantileNs(0.99), daemon.total.maxNs())), us(daemon.total.maxNs()),
+           us(std::min(daemon.socket.quantileNs(0.99), daemon.socket.maxNs())),
+           us(std::min(daemon.channel.quantileNs(0.99), daemon.channel.maxNs())), us(counters.lagMaxNs.load()),
+           100.0 * cpu / wallS);
+    fflush(stdout);
+}
+
+/// Parse `N[,N…]`.  Exits on anything else.
+static std::vector<uint64_t> parseList(std::string_view what, std::string_view arg) {
+    std::vector<uint64_t> out;
+    while (!arg.empty()) {
+        const size_t     comma = arg.find(',');
+        const std::string item(arg.substr(0, comma));
+        char*            end = nullptr;
+        const uint64_t   v   = std::strtoull(item.c_str(), &end, 10);
+        if (item.empty() || *end != '\0' || v == 0) {
+            fprintf(stderr, "loadgen: bad %.*s: %s\n", static_cast<int>(what.size()), what.data(), item.c_str());
+            std::exit(2);
+        }
+        out.push_back(v);
+        arg = comma == std::string_view::npos ? std::string_view() : arg.substr(comma + 1);
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg   = argv[i];
+        const char*      value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (arg == "--daemon" && value)
+            opt.daemon = argv[++i];
+        else if (arg == "--clients" && value)
+            opt.clients = parseList("client count", argv[++i]);
+        else if (arg == "--rate" && value)
+            opt.rates = parseList("rate", argv[++i]);
+        else if (arg == "--duration" && value)
+            opt.duration = std::max(std::atof(argv[++i]), 0.1);
+        else if (arg == "--wire" && value)
+            opt.format = std::string_view(argv[++i]) == "json" ? WireFormat::Json : WireFormat::Binary;
+        else if (arg == "--mock-delay-us" && value)
+            opt.delayUs = std::strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--sequence" && value)
+            opt.sequence = loadSequence(argv[++i]);
+        else {
+            fprintf(stderr,
+                    "usage: %s --daemon PATH [--clients N[,N...]] [--rate HZ[,HZ...]] [--duration S]\n"
+                    "       [--wire json|binary] [--mock-delay-us N] [--sequence FILE]\n",
+                    argv[0]);
+            return arg == "-h" || arg == "--help" ? 0 : 2;
+        }
+    }
+    if (!opt.daemon) {
+        fprintf(stderr, "loadgen: --daemon PATH is required\n");
+        return 2;
+    }
+    if (opt.sequence.empty())
+        opt.sequence = builtinSequence();
+
+    MockWmDaemon daemon(opt.daemon, opt.delayUs);
+    for (uint64_t clients : opt.clients)
+        for (uint64_t rate : opt.rates)
+            runStep(daemon, opt, clients, rate);
+    return 0;
+}
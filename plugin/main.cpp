@@ -9,17 +9,116 @@
 //   hyprgrd:movetomonitor       <direction>      — move focused window to monitor in direction
 //   hyprgrd:movetomonitorindex  <n>              — move focused window to monitor n (0-based)
 //   hyprgrd:togglevis                            — toggle persistent visualizer overlay
+//   hyprgrd:stats               [reset]          — show (or reset) plugin latency stats
+//   hyprgrd:applygrid           <mon> <ws> …     — switch several monitors at once (used by the daemon)
+//   hyprgrd:syncgrid            <cols> <rows> <col> <row> — adopt the daemon's grid (used by the daemon)
+//   hyprgrd:syncoverlay         <settings …>     — gesture and timing settings for the overlay (used by the daemon)
+//   hyprgrd:syncgestures        <fingers> …      — finger counts whose swipes to forward (used by the daemon)
+//   hyprgrd:warm                <mon> <ws> …     — create workspaces ahead of time and keep them (used by the daemon)
+//   hyprgrd:cool                <ws> …           — let prefetched workspaces go again (used by the daemon)
+//
+// ## hyprctl commands
+//
+//   hyprctl hyprgrd-stats       — send-queue, connection and latency stats
+//
+// ## Config
+//
+//   plugin:hyprgrd:queue_full_policy = coalesce   # or: drop
+//   plugin:hyprgrd:swipe_pacing      = frame      # or: timer
+//   plugin:hyprgrd:swipe_coalesce_ms = 8          # timer pacing only; 0 = forward every update
+//   plugin:hyprgrd:wire_format       = binary     # or: json
+//   plugin:hyprgrd:instrument        = 0          # 1 = record latency histograms
+//   plugin:hyprgrd:grid_mode         = daemon     # or: plugin
+//   plugin:hyprgrd:swipe_channel     = shm        # or: socket
+//   plugin:hyprgrd:overlay           = daemon     # or: plugin
+//   plugin:hyprgrd:prefetch_cells    = 0          # >0: keep this many cells warm (grid_mode = plugin)
+//   plugin:hyprgrd:acks              = 0          # 1 = have the daemon acknowledge dispatcher commands
+//
+// Dispatchers and swipe hooks never touch the socket themselves: they push
+// a message onto a bounded lock-free ring (queue.hpp) that a writer thread
+// drains into the daemon connection.  When the daemon stalls and the ring
+// fills up, `drop` discards new messages while `coalesce` (the default)
+// merges swipe updates into one pending update before they reach the last
+// slots, which stay free for SwipeEnd and everything else.
+//
+// Independently of the queue, swipe updates are summed in the plugin and
+// paced (see below): once per frame by default, or at most once per
+// `swipe_coalesce_ms` (default 8 ms, about one frame at 120 Hz) with
+// `swipe_pacing = timer`.  Either way they are flushed before SwipeEnd.
+//
+// With `instrument = 1` the plugin records, into lock-free histograms
+// (stats.hpp), the time spent in each swipe hook and in the dispatchers'
+// sendCommand, plus how long messages wait in the queue and in the socket
+// write — enough to tell whether latency comes from the plugin, the socket
+// or the daemon.
+//
+// With `grid_mode = plugin` the plugin owns the grid (grid.hpp): go,
+// movego and switch are resolved to workspace ids and applied right here on
+// the main thread, and the daemon is only told the new cell (SyncGrid) for
+// the visualizer.  The daemon mirrors moves it makes itself, such as swipe
+// commits, back through `hyprgrd:syncgrid`.  With the default
+// `grid_mode = daemon` every command goes to the daemon as before.
+//
+// The writer connects as soon as the plugin loads and keeps the connection
+// ready: it notices the daemon hanging up and watches for its socket with
+// inotify, so swipeBegin decides ownership from a cached "daemon alive"
+// flag without touching the socket.
+//
+// On connect the writer negotiates the compact binary framing from
+// protocol.hpp (unless `wire_format = json`); daemons that don't know the
+// handshake keep receiving JSON.
+//
+// On a binary connection the writer also offers the shared-memory swipe
+// channel (swipe_channel.hpp, unless `swipe_channel = socket`).  While the
+// daemon has it attached, swipe updates bypass the queue and the
+// coalescer: the hook adds them to totals in shared memory and rings an
+// eventfd only when the daemon has caught up.  SwipeBegin / SwipeEnd still
+// go through the queue.
+//
+// Every raw update also feeds a velocity tracker (velocity.hpp); just
+// before SwipeEnd the plugin sends SwipeVelocity, the release velocity as
+// of the swipeEnd event, so the daemon can commit a quick flick that
+// hasn't covered the whole commit threshold.
+//
+// Workspaces of the cells around the current one can be created ahead of
+// the first visit and kept alive while empty, so landing on a new cell
+// doesn't pay for creating them: the daemon asks with `hyprgrd:warm` /
+// `hyprgrd:cool` after its own moves, and with `grid_mode = plugin` and
+// `prefetch_cells > 0` the plugin does the same after its moves, keeping
+// at most that many cells (least recently visited go first).
+//
+// With `acks = 1` the writer has the daemon acknowledge every dispatcher
+// command (acks.hpp) and matches the replies on its own thread.  A
+// dispatcher still returns as soon as its command is queued; a command the
+// daemon rejects or fails to carry out shows up as a notification, with
+// the daemon's handling time and the round trip.
+//
+// With `overlay = plugin` the grid overlay is drawn by the compositor
+// (overlay.hpp) instead of the daemon's GTK window: the plugin announces
+// it with AttachOverlay on every connect, follows swipes from its own
+// hooks and adds the overlay to the render pass of the focused monitor,
+// so it moves on the same frame as the fingers.  togglevis is handled
+// locally; the daemon only pushes settings and cells.
 //
 // ## Swipe gesture forwarding
 //
-// The plugin hooks Hyprland's swipeBegin / swipeUpdate / swipeEnd events,
-// forwards them to the hyprgrd daemon over its Unix socket as
-// SwipeBegin / SwipeUpdate / SwipeEnd JSON commands, and **cancels** the
-// default Hyprland workspace-swipe handling.  This lets hyprgrd own the
-// gesture without Hyprland fighting over it.
+// The plugin hooks Hyprland's swipeBegin / swipeUpdate / swipeEnd events
+// and forwards them to the hyprgrd daemon over its Unix socket as
+// SwipeBegin / SwipeUpdate / SwipeEnd commands, in binary frames by default
+// (`wire_format = binary`, protocol.hpp) or as JSON lines.  Only swipes the
+// daemon acts on are taken: it answers the AttachGestures greeting with its
+// finger counts (gestures.hpp).  For those the plugin **cancels** Hyprland's
+// own workspace swipe, so hyprgrd owns the gesture without Hyprland
+// fighting over it; swipes with any other count stay with Hyprland and its
+// gesture binds.
+//
+// Updates are forwarded once per frame of the monitor the gesture started
+// on (`swipe_pacing = frame`, the default): motion is summed between frames
+// and the preRender hook sends it as the frame starts (coalescer.hpp).
+// `swipe_pacing = timer` sends at most one per `swipe_coalesce_ms` instead.
 //
 // Requires Hyprland 0.51+ gesture config so the compositor emits swipe
-// events (the plugin then eats them before Hyprland acts). Example:
+// events (the plugin then eats the ones hyprgrd takes). Example:
 //
 //   gestures {
 //       gesture = 3, horizontal, workspace
@@ -37,183 +136,668 @@
 //   bind = SUPER, 1, hyprgrd:switch, 0 0
 //   bind = SUPER, 2, hyprgrd:switch, 1 0
 
+#include "coalescer.hpp"
+#include "commands.hpp"
+#include "gestures.hpp"
+#include "grid.hpp"
 #include "helpers.hpp"
+#include "overlay.hpp"
+#include "queue.hpp"
+#include "swipe_channel.hpp"
+#include "velocity.hpp"
 
 #include <hyprland/src/plugins/PluginAPI.hpp>
+#include <hyprland/src/Compositor.hpp>
 #include <hyprland/src/devices/IPointer.hpp>
-
-#include <sys/socket.h>
-#include <sys/un.h>
-#include <unistd.h>
+#include <hyprland/src/render/OpenGL.hpp>
+#include <hyprland/src/render/Renderer.hpp>
+#include <hyprland/src/render/pass/RectPassElement.hpp>
 
 #include <any>
-#include <cstring>
+#include <optional>
+#include <utility>
+#include <vector>
 
 inline HANDLE PHANDLE = nullptr;
 
 /// Finger count of the current swipe (set on swipeBegin, used through swipeEnd).
 static uint32_t g_swipeFingers = 0;
 
-/// Connect to the hyprgrd Unix socket, send `json` + newline, and close.
-/// Returns true on success.
-static bool sendCommand(const std::string& json) {
-    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (fd < 0)
-        return false;
+/// Finger counts the daemon uses, pushed with hyprgrd:syncgestures.
+static GestureRoutes g_gestureRoutes;
+
+/// Swipes left to Hyprland because the daemon doesn't use their finger count.
+static uint64_t g_swipesPassed = 0;
+
+/// Queue + writer thread owning the one connection to the daemon, shared by
+/// the dispatchers and the swipe hooks.  Started in PLUGIN_INIT.
+static SendQueue g_queue;
 
-    struct sockaddr_un addr {};
-    addr.sun_family = AF_UNIX;
-    std::string path = socketPath();
-    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+/// Shared-memory swipe channel, offered to the daemon by the writer thread.
+static SwipeChannel g_swipeChannel;
 
-    if (connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
-        close(fd);
+/// Latency histograms, recorded while `plugin:hyprgrd:instrument` is set.
+static PluginStats g_stats;
+
+/// The plugin-owned grid, used while `plugin:hyprgrd:grid_mode = plugin`.
+static GridEngine g_grid;
+
+/// Cells kept warm after plugin-grid moves (`plugin:hyprgrd:prefetch_cells`).
+static WarmCells g_warmCells;
+
+/// The in-compositor overlay, used while `plugin:hyprgrd:overlay = plugin`.
+static OverlayModel g_overlay;
+
+/// Handle returned by registerHyprCtlCommand for `hyprctl hyprgrd-stats`.
+static SP<SHyprCtlCommand> g_statsCmd;
+
+/// Event source watching the writer's ack-failure eventfd; registered
+/// even with `acks = 0`, since a reload may turn them on.
+static wl_event_source* g_ackSource = nullptr;
+
+/// Current `plugin:hyprgrd:queue_full_policy`.
+static FullPolicy fullPolicy() {
+    static auto* const* PPOLICY = (Hyprlang::STRING const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:queue_full_policy")->getDataStaticPtr();
+    return parseFullPolicy(*PPOLICY ? *PPOLICY : "");
+}
+
+/// Current `plugin:hyprgrd:wire_format` ("binary" unless set to "json").
+static WireFormat wireFormat() {
+    static auto* const* PFORMAT = (Hyprlang::STRING const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:wire_format")->getDataStaticPtr();
+    return (*PFORMAT && trimView(*PFORMAT) == "json") ? WireFormat::Json : WireFormat::Binary;
+}
+
+/// Current `plugin:hyprgrd:swipe_channel` is not `socket`.
+static bool swipeChannelEnabled() {
+    static auto* const* PCHANNEL = (Hyprlang::STRING const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:swipe_channel")->getDataStaticPtr();
+    return !(*PCHANNEL && trimView(*PCHANNEL) == "socket");
+}
+
+/// Current `plugin:hyprgrd:swipe_coalesce_ms` (negative values count as 0).
+static uint32_t swipeCoalesceMs() {
+    static auto* const* PINTERVAL = (Hyprlang::INT* const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:swipe_coalesce_ms")->getDataStaticPtr();
+    return **PINTERVAL > 0 ? static_cast<uint32_t>(**PINTERVAL) : 0;
+}
+
+/// Current `plugin:hyprgrd:swipe_pacing`.
+static SwipePacing swipePacing() {
+    static auto* const* PPACING = (Hyprlang::STRING const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:swipe_pacing")->getDataStaticPtr();
+    return parseSwipePacing(*PPACING ? *PPACING : "");
+}
+
+/// Current `plugin:hyprgrd:instrument`.
+static bool instrumented() {
+    static auto* const* PINSTRUMENT = (Hyprlang::INT* const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:instrument")->getDataStaticPtr();
+    return **PINSTRUMENT != 0;
+}
+
+/// Current `plugin:hyprgrd:grid_mode` is `plugin`.
+static bool pluginGridMode() {
+    static auto* const* PMODE = (Hyprlang::STRING const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:grid_mode")->getDataStaticPtr();
+    return *PMODE && trimView(*PMODE) == "plugin";
+}
+
+/// Current `plugin:hyprgrd:prefetch_cells` (0: no prefetching).
+static size_t prefetchCells() {
+    static auto* const* PCELLS = (Hyprlang::INT* const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:prefetch_cells")->getDataStaticPtr();
+    return **PCELLS > 0 ? static_cast<size_t>(**PCELLS) : 0;
+}
+
+/// Current `plugin:hyprgrd:acks`.
+static bool acksEnabled() {
+    static auto* const* PACKS = (Hyprlang::INT* const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:acks")->getDataStaticPtr();
+    return **PACKS != 0;
+}
+
+/// Current `plugin:hyprgrd:overlay` is `plugin`.
+static bool pluginOverlay() {
+    static auto* const* POVERLAY = (Hyprlang::STRING const*)HyprlandAPI::getConfigValue(
+        PHANDLE, "plugin:hyprgrd:overlay")->getDataStaticPtr();
+    return *POVERLAY && trimView(*POVERLAY) == "plugin";
+}
+
+/// The writer's connection setup for the current config.
+static QueueSettings queueSettings() {
+    QueueSettings settings;
+    settings.greeting = {PluginMessage::simple(MessageKind::AttachGestures)};
+    if (pluginOverlay())
+        settings.greeting.push_back(PluginMessage::simple(MessageKind::AttachOverlay));
+    settings.format       = wireFormat();
+    settings.acks         = acksEnabled();
+    settings.swipeChannel = swipeChannelEnabled();
+    return settings;
+}
+
+/// `hist` while instrumentation is on, else nullptr (for ScopedTimer).
+static LatencyHistogram* timed(LatencyHistogram& hist) {
+    return instrumented() ? &hist : nullptr;
+}
+
+/// Queue `msg` for the daemon.  Never blocks; returns false if the message
+/// was dropped because the queue is full.
+static bool sendCommand(PluginMessage msg) {
+    if (instrumented())
+        msg.enqueuedNs = nowNs();
+    return g_queue.enqueue(msg, fullPolicy());
+}
+
+//  In-compositor grid (grid_mode = plugin) 
+
+/// Run a Hyprland dispatch in-process; fails unless Hyprland answers "ok".
+static SDispatchResult hyprDispatch(const std::string& cmd) {
+    const std::string reply = HyprlandAPI::invokeHyprctlCommand("dispatch", cmd);
+    if (trimView(reply) != "ok")
+        return SDispatchResult{.success = false, .error = cmd + ": " + reply};
+    return SDispatchResult{};
+}
+
+/// Name of the focused monitor (empty if Hyprland doesn't say).
+static std::string focusedMonitor() {
+    return std::string(jsonStringField(HyprlandAPI::invokeHyprctlCommand("activeworkspace", "", "j"), "monitor"));
+}
+
+/// Switch each monitor to its workspace, the focused monitor last so focus
+/// stays where it was.
+static SDispatchResult applySwitches(std::vector<WorkspaceSwitch> switches) {
+    const std::string focused = focusedMonitor();
+    focusedLast(switches, focused);
+    for (const auto& s : switches) {
+        for (const std::string& cmd :
+             {"focusmonitor " + std::string(s.monitor), "workspace " + std::to_string(s.workspace)}) {
+            if (auto result = hyprDispatch(cmd); !result.success)
+                return result;
+        }
+    }
+    return SDispatchResult{};
+}
+
+/// True when the dispatchers should use `g_grid`: grid_mode is `plugin` and
+/// the monitor list is known (queried on first use, and again after a
+/// monitor was added or removed).
+static bool gridEngineActive() {
+    if (!pluginGridMode())
         return false;
+    if (!g_grid.ready())
+        g_grid.setMonitors(monitorNamesFromJson(HyprlandAPI::invokeHyprctlCommand("monitors", "", "j")));
+    return g_grid.ready();
+}
+
+//  In-compositor overlay (overlay = plugin) 
+
+/// Layout-coordinate box last handed to the damage tracker, so the next
+/// change also repaints where the overlay was.
+static CBox g_overlayBox;
+
+/// Scratch list of the overlay's rectangles, reused every frame.
+static std::vector<OverlayRect> g_overlayRects;
+
+/// Overlay timeline clock, in milliseconds.
+static double overlayNowMs() {
+    return static_cast<double>(nowNs()) / 1e6;
+}
+
+/// The overlay's box centred on `mon`, in layout coordinates.
+static CBox overlayBoxOn(const PHLMONITOR& mon) {
+    return CBox{mon->m_position.x + (mon->m_size.x - g_overlay.width()) / 2,
+                mon->m_position.y + (mon->m_size.y - g_overlay.height()) / 2, g_overlay.width(), g_overlay.height()};
+}
+
+/// Schedule a repaint of the overlay's previous and current area on the
+/// focused monitor.
+static void damageOverlay() {
+    if (!g_pHyprRenderer || !g_pCompositor)
+        return;
+    if (g_overlayBox.w > 0)
+        g_pHyprRenderer->damageBox(g_overlayBox);
+    const PHLMONITOR mon = g_pCompositor->m_lastMonitor.lock();
+    if (!mon)
+        return;
+    g_overlayBox = overlayBoxOn(mon);
+    g_pHyprRenderer->damageBox(g_overlayBox);
+}
+
+/// Show `st` on the overlay (no-op unless overlay = plugin).
+static void overlaySync(const GridState& st) {
+    if (!pluginOverlay())
+        return;
+    g_overlay.sync(st, overlayNowMs());
+    damageOverlay();
+}
+
+/// "render" hook: at RENDER_LAST_MOMENT on the focused monitor, step the
+/// overlay's animations and add its rectangles to the render pass, on top
+/// of everything else.  Keeps damaging its area while a slide, linger or
+/// fade still needs frames.
+static void renderOverlay(eRenderStage stage) {
+    if (stage != RENDER_LAST_MOMENT || !pluginOverlay() || !g_pCompositor || !g_pHyprOpenGL)
+        return;
+    const PHLMONITOR mon = g_pHyprOpenGL->m_renderData.pMonitor.lock();
+    if (!mon || mon != g_pCompositor->m_lastMonitor.lock())
+        return;
+    const bool more = g_overlay.advance(overlayNowMs());
+    if (g_overlay.visible()) {
+        const CBox   box     = overlayBoxOn(mon);
+        const double scale   = mon->m_scale;
+        const float  opacity = static_cast<float>(g_overlay.opacity());
+        g_overlay.layout(g_overlayRects);
+        for (const OverlayRect& r : g_overlayRects) {
+            CRectPassElement::SRectData data;
+            data.box   = CBox{box.x - mon->m_position.x + r.x, box.y - mon->m_position.y + r.y, r.w, r.h}.scale(scale).round();
+            data.color = CHyprColor{r.color.r, r.color.g, r.color.b, r.color.a * opacity};
+            data.round = static_cast<int>(std::lround(r.radius * scale));
+            g_pHyprRenderer->m_renderPass.add(makeUnique<CRectPassElement>(data));
+        }
     }
+    if (more)
+        damageOverlay();
+}
+
+//  Workspace prefetching 
+
+/// Create `monitor`'s workspace `id` without showing it, if it doesn't
+/// exist yet, and keep it even while empty.
+static void warmWorkspace(std::string_view monitor, int id) {
+    if (!g_pCompositor)
+        return;
+    const PHLMONITOR mon = g_pCompositor->getMonitorFromName(std::string(monitor));
+    if (!mon)
+        return;
+    PHLWORKSPACE ws = g_pCompositor->getWorkspaceByID(id);
+    if (!ws)
+        ws = g_pCompositor->createNewWorkspace(id, mon->m_id);
+    if (ws)
+        ws->setPersistent(true);
+}
+
+/// Let workspace `id` go again: Hyprland drops it once it is empty and
+/// not shown.
+static void coolWorkspace(int id) {
+    if (!g_pCompositor)
+        return;
+    if (const PHLWORKSPACE ws = g_pCompositor->getWorkspaceByID(id))
+        ws->setPersistent(false);
+}
 
-    std::string msg = json + "\n";
-    ssize_t written = write(fd, msg.c_str(), msg.size());
-    close(fd);
-    return written == static_cast<ssize_t>(msg.size());
+/// After a plugin-grid move to `cell`: warm its neighbourhood and release
+/// the cells that fell out of `g_warmCells` (prefetch_cells > 0 only).
+static void prefetchAround(GridCell cell) {
+    const size_t cap = prefetchCells();
+    if (cap == 0)
+        return;
+    if (cap != g_warmCells.capacity())
+        g_warmCells.setCapacity(cap);
+    const WarmChange change = g_warmCells.visit(cell);
+    for (GridCell c : change.warm)
+        for (const WorkspaceSwitch& s : g_grid.workspacesOf(c))
+            warmWorkspace(s.monitor, s.workspace);
+    for (GridCell c : change.cool)
+        for (const WorkspaceSwitch& s : g_grid.workspacesOf(c))
+            coolWorkspace(s.workspace);
+}
+
+/// Move the plugin grid to `cell`, switch every monitor there and tell the
+/// daemon, which only has to update the visualizer.
+static SDispatchResult gridMoveTo(GridCell cell) {
+    g_grid.moveTo(cell);
+    const SDispatchResult result = applySwitches(g_grid.switches());
+    const GridState&      st     = g_grid.state();
+    overlaySync(st);
+    // Best-effort: the move has happened whether or not the daemon hears of it.
+    sendCommand(PluginMessage::syncGrid(st.cols, st.rows, st.col, st.row));
+    prefetchAround(g_grid.cell());
+    return result;
 }
 
 //  Dispatchers 
 
-/// hyprgrd:go <direction>
-///
-/// Move one grid cell in the given direction.
-/// <direction> is one of: left, right, up, down (case-insensitive).
-///
-/// Sends: {"Go":"Right"}  (etc.)
-static SDispatchResult dispatchGo(std::string arg) {
-    auto result = buildGoJson(arg);
-    if (!result.ok)
-        return SDispatchResult{.success = false, .error = result.value};
-    bool ok = sendCommand(result.value);
-    return ok ? SDispatchResult{} : SDispatchResult{.success = false, .error = "failed to send command"};
+// The keybind dispatchers (go, movego, switch, movetomonitor,
+// movetomonitorindex, togglevis) come from DISPATCHER_COMMANDS in
+// commands.hpp, one dispatchCommand<I> each: they forward the trimmed
+// argument to the daemon, {"Go":"right"} or its binary frame, and leave
+// parsing it to the daemon.  The functions below take over a command when
+// the plugin owns it (grid_mode / overlay = plugin).
+
+/// hyprgrd:go <direction> with grid_mode = plugin: switch in-process and
+/// send {"SyncGrid":{…}}.
+static SDispatchResult localGo(const std::string& arg) {
+    const auto dir = parseGridDirection(arg);
+    if (!dir)
+        return SDispatchResult{.success = false, .error = "invalid direction: " + arg};
+    return gridMoveTo(stepFrom(*dir, g_grid.cell()));
 }
 
-/// hyprgrd:movego <direction>
+/// hyprgrd:movego <direction> with grid_mode = plugin: move the window
+/// in-process and send {"SyncGrid":{…}}.
+static SDispatchResult localMoveGo(const std::string& arg) {
+    const auto dir = parseGridDirection(arg);
+    if (!dir)
+        return SDispatchResult{.success = false, .error = "invalid direction: " + arg};
+    // The window goes to the target cell's workspace on the monitor it is on.
+    const GridCell    target = stepFrom(*dir, g_grid.cell());
+    const std::string mon    = focusedMonitor();
+    const auto        ws     = g_grid.workspaceFor(target, mon);
+    if (!ws)
+        return SDispatchResult{.success = false, .error = "active monitor " + mon + " has no grid mapping"};
+    if (auto result = hyprDispatch("movetoworkspace " + std::to_string(*ws)); !result.success)
+        return result;
+    return gridMoveTo(target);
+}
+
+/// hyprgrd:switch <col> <row> with grid_mode = plugin: switch in-process
+/// and send {"SyncGrid":{…}}.
+static SDispatchResult localSwitch(const std::string& arg) {
+    const auto cell = parseGridCell(arg);
+    if (!cell)
+        return SDispatchResult{.success = false, .error = "expected \"col row\", got: " + arg};
+    return gridMoveTo(*cell);
+}
+
+/// hyprgrd:togglevis with overlay = plugin: toggle the in-compositor
+/// overlay; nothing is sent.
+static SDispatchResult localToggleVis() {
+    g_overlay.toggleManual(overlayNowMs());
+    damageOverlay();
+    return SDispatchResult{};
+}
+
+/// The plugin's own handling of a dispatcher command, or nothing when it
+/// goes to the daemon.
+static std::optional<SDispatchResult> handleLocally(MessageKind kind, const std::string& arg) {
+    switch (kind) {
+        case MessageKind::Go: return gridEngineActive() ? std::optional(localGo(arg)) : std::nullopt;
+        case MessageKind::MoveGo: return gridEngineActive() ? std::optional(localMoveGo(arg)) : std::nullopt;
+        case MessageKind::Switch: return gridEngineActive() ? std::optional(localSwitch(arg)) : std::nullopt;
+        case MessageKind::ToggleVisualizer: return pluginOverlay() ? std::optional(localToggleVis()) : std::nullopt;
+        default: return std::nullopt;
+    }
+}
+
+/// hyprgrd:<DISPATCHER_COMMANDS[I].dispatcher> [argument]
 ///
-/// Move the focused window one grid cell and follow it.
-/// <direction> is one of: left, right, up, down (case-insensitive).
+/// Queue the command for the daemon (unless the plugin handles it) and
+/// translate the outcome.  Commands without an argument ignore whatever
+/// Hyprland passes (an empty string from a keybind).
+template <size_t I>
+static SDispatchResult dispatchCommand(std::string arg) {
+    constexpr CommandSpec spec = DISPATCHER_COMMANDS[I];
+    if (auto local = handleLocally(spec.kind, arg))
+        return *local;
+    PluginMessage msg = PluginMessage::simple(spec.kind);
+    if constexpr (spec.arg != ArgKind::None) {
+        if (!PluginMessage::withArg(spec.kind, trimView(arg), msg))
+            return SDispatchResult{.success = false, .error = "argument too long"};
+    }
+    ScopedTimer timer(timed(g_stats.dispatch));
+    bool        ok = sendCommand(msg);
+    return ok ? SDispatchResult{} : SDispatchResult{.success = false, .error = "send queue full"};
+}
+
+/// Register dispatchCommand<I> for every row of DISPATCHER_COMMANDS.
+static void addCommandDispatchers() {
+    [&]<size_t... I>(std::index_sequence<I...>) {
+        (HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:" + std::string(DISPATCHER_COMMANDS[I].dispatcher),
+                                      dispatchCommand<I>),
+         ...);
+    }(std::make_index_sequence<DISPATCHER_COMMANDS.size()>{});
+}
+
+/// hyprgrd:syncgrid <cols> <rows> <col> <row>
 ///
-/// Sends: {"MoveWindowAndGo":"Right"}  (etc.)
-static SDispatchResult dispatchMoveGo(std::string arg) {
-    auto result = buildMoveGoJson(arg);
-    if (!result.ok)
-        return SDispatchResult{.success = false, .error = result.value};
-    bool ok = sendCommand(result.value);
-    return ok ? SDispatchResult{} : SDispatchResult{.success = false, .error = "failed to send command"};
+/// Sent by the daemon after it moved on its own (swipe commits, commands
+/// from other clients) while grid_mode = plugin, so both agree on the cell.
+/// Only updates `g_grid`; the daemon has already switched the workspaces.
+static SDispatchResult dispatchSyncGrid(std::string arg) {
+    const auto state = parseSyncGrid(arg);
+    if (!state)
+        return SDispatchResult{.success = false, .error = "usage: hyprgrd:syncgrid <cols> <rows> <col> <row>"};
+    g_grid.sync(*state);
+    overlaySync(*state);
+    return SDispatchResult{};
 }
 
-/// hyprgrd:switch <col> <row>
+/// hyprgrd:syncoverlay <sensitivity> <threshold> <natural> <switch fingers>
+///                     <move fingers> <fling ms> <cursor ms> <linger ms> <fade ms>
 ///
-/// Jump to an absolute grid position.
-/// Arguments are space-separated integers (0-indexed).
+/// Sent by the daemon in answer to AttachOverlay (overlay = plugin): the
+/// gesture settings the overlay needs to predict the daemon's decisions,
+/// and the visualizer's timings.
+static SDispatchResult dispatchSyncOverlay(std::string arg) {
+    const auto cfg = parseSyncOverlay(arg);
+    if (!cfg)
+        return SDispatchResult{.success = false, .error = "usage: hyprgrd:syncoverlay <sensitivity> <threshold> <natural> "
+                                                          "<switch fingers> <move fingers> <fling ms> <cursor ms> "
+                                                          "<linger ms> <fade ms>"};
+    g_overlay.configure(*cfg);
+    return SDispatchResult{};
+}
+
+/// hyprgrd:syncgestures <fingers> [<fingers> …]
 ///
-/// Sends: {"SwitchTo":{"x":2,"y":1}}
-static SDispatchResult dispatchSwitch(std::string arg) {
-    auto result = buildSwitchJson(arg);
-    if (!result.ok)
-        return SDispatchResult{.success = false, .error = result.value};
-    bool ok = sendCommand(result.value);
-    return ok ? SDispatchResult{} : SDispatchResult{.success = false, .error = "failed to send command"};
+/// Sent by the daemon in answer to AttachGestures: the finger counts it
+/// acts on.  Swipes with other counts are left to Hyprland from now on.
+static SDispatchResult dispatchSyncGestures(std::string arg) {
+    const auto routes = parseSyncGestures(arg);
+    if (!routes)
+        return SDispatchResult{.success = false, .error = "usage: hyprgrd:syncgestures <fingers> [<fingers> …]"};
+    g_gestureRoutes = *routes;
+    return SDispatchResult{};
 }
 
 //  Swipe hook callbacks 
 
-// Persistent socket FD kept alive for the duration of a single swipe gesture.
-// Opened on swipeBegin, closed on swipeEnd.  This avoids connect+close
-// overhead on every swipeUpdate (~60 Hz).
-static int g_swipeFd = -1;
+// Swipe events go through the same send queue as the dispatchers, so a
+// gesture costs the compositor one ring push per event.  `g_swipeActive`
+// records whether we took ownership of the current gesture at swipeBegin.
+static bool g_swipeActive = false;
+
+/// The current gesture's updates go through `g_swipeChannel` (decided at
+/// swipeBegin, so a reconnect mid-gesture doesn't split it).
+static bool g_swipeShm = false;
+
+/// Sums the current gesture's updates between flushes.
+static SwipeCoalescer g_swipeCoalescer;
+
+/// Monitor whose frames pace the current gesture (swipe_pacing = frame):
+/// the focused one at swipeBegin.
+static PHLMONITORREF g_swipeMonitor;
+
+/// The current gesture is paced by `g_swipeMonitor`'s frames; off with
+/// swipe_pacing = timer or once that monitor is gone.
+static bool g_swipeFramePaced = false;
 
-/// Send a line of JSON over the persistent swipe socket.
-static void swipeSend(const std::string& json) {
-    if (g_swipeFd < 0)
+/// When a frame was last asked for and none has started since (0: none).
+static uint64_t g_swipeFrameAskedNs = 0;
+
+/// The current gesture's recent motion, for its release velocity.
+static VelocityTracker g_swipeVelocity;
+
+/// Queue a message for the swipe we currently own.
+static void swipeSend(const PluginMessage& msg) {
+    if (!g_swipeActive)
         return;
-    std::string msg = json + "\n";
-    // Best-effort write; if the daemon is gone we'll notice on the next event.
-    [[maybe_unused]] auto _ = write(g_swipeFd, msg.c_str(), msg.size());
+    // Best-effort; under the coalesce policy updates merge when full.
+    sendCommand(msg);
 }
 
-/// Open a persistent connection to the hyprgrd socket.
-static bool swipeConnect() {
-    g_swipeFd = socket(AF_UNIX, SOCK_STREAM, 0);
-    if (g_swipeFd < 0)
-        return false;
-
-    struct sockaddr_un addr {};
-    addr.sun_family = AF_UNIX;
-    std::string path = socketPath();
-    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+/// Forward an accumulated delta released by `g_swipeCoalescer`, if any,
+/// through the gesture's channel or the queue.
+static void swipeSendDelta(const std::optional<SwipeDelta>& delta) {
+    if (!delta)
+        return;
+    if (g_swipeShm)
+        g_swipeChannel.add(delta->fingers, delta->dx, delta->dy, delta->timeMs);
+    else
+        swipeSend(PluginMessage::swipeUpdate(delta->fingers, delta->dx, delta->dy, delta->timeMs));
+}
 
-    if (connect(g_swipeFd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
-        close(g_swipeFd);
-        g_swipeFd = -1;
-        return false;
+/// Ask for a frame of the gesture's monitor to flush held motion in, once
+/// per frame.  Hyprland renders nothing new while it isn't animating
+/// itself, so without this the motion would wait for swipeEnd.  Asks again
+/// if the frame hasn't started within SWIPE_FRAME_WAIT_MS, and falls back
+/// to timer pacing once the monitor is gone.
+static void swipeScheduleFrame() {
+    const uint64_t now = nowNs();
+    if (g_swipeFrameAskedNs && now - g_swipeFrameAskedNs < SWIPE_FRAME_WAIT_MS * 1'000'000)
+        return;
+    const PHLMONITOR mon = g_swipeMonitor.lock();
+    if (!mon || !g_pCompositor) {
+        g_swipeFramePaced = false;
+        g_swipeCoalescer.setPacing(SwipePacing::Timer);
+        swipeSendDelta(g_swipeCoalescer.flush());
+        return;
     }
-    return true;
+    g_pCompositor->scheduleFrameForMonitor(mon);
+    g_swipeFrameAskedNs = now;
 }
 
-/// Close the persistent swipe socket.
-static void swipeDisconnect() {
-    if (g_swipeFd >= 0) {
-        close(g_swipeFd);
-        g_swipeFd = -1;
+/// "preRender" hook: at the start of each frame of the gesture's monitor,
+/// forward the motion held since the last one (swipe_pacing = frame).  Any
+/// monitor's frame lets the next update ask for one again.
+static void swipeFrame(const PHLMONITOR& mon) {
+    if (!g_swipeActive || !g_swipeFramePaced)
+        return;
+    g_swipeFrameAskedNs = 0;
+    if (mon == g_swipeMonitor.lock())
+        swipeSendDelta(g_swipeCoalescer.flush());
+}
+
+/// `hyprctl hyprgrd-stats` — send-queue, connection and latency stats.
+static std::string statsCommand(eHyprCtlOutputFormat format, std::string /*request*/) {
+    const auto& conn = g_queue.connectionStats();
+    const auto  n    = [](const std::atomic<uint64_t>& v) { return std::to_string(v.load(std::memory_order_relaxed)); };
+    const std::pair<const char*, const LatencyHistogram*> hists[] = {
+        {"swipe_begin", &g_stats.swipeBegin}, {"swipe_update", &g_stats.swipeUpdate},
+        {"swipe_end", &g_stats.swipeEnd},     {"dispatch", &g_stats.dispatch},
+        {"queue_wait", &g_stats.queueWait},   {"socket_write", &g_stats.socketWrite},
+        {"ack_round_trip", &g_stats.ackRoundTrip}, {"ack_handling", &g_stats.ackHandling},
+    };
+    const auto& acks  = g_queue.ackStats();
+    const char* alive = g_queue.daemonAlive() ? "true" : "false";
+
+    if (format == FORMAT_JSON) {
+        std::string out = "{\"queued\":" + std::to_string(g_queue.queued()) +
+            ",\"dropped\":" + std::to_string(g_queue.dropped()) +
+            ",\"coalesced\":" + std::to_string(g_queue.coalesced()) +
+            ",\"folded\":" + std::to_string(g_queue.folded()) +
+            ",\"send_failures\":" + std::to_string(g_queue.sendFailures()) +
+            ",\"replayed\":" + std::to_string(g_queue.replayed()) + ",\"daemon_alive\":" + alive +
+            ",\"connects\":" + n(conn.connects) + ",\"connect_failures\":" + n(conn.connectFailures) +
+            ",\"short_writes\":" + n(conn.shortWrites) + ",\"busy_writes\":" + n(conn.busyWrites) +
+            ",\"hangups\":" + n(conn.hangups) + ",\"acked\":" + n(acks.acked) +
+            ",\"ack_failures\":" + n(acks.failed) + ",\"acks_lost\":" + n(acks.lost) +
+            ",\"swipes_passed\":" + std::to_string(g_swipesPassed) +
+            ",\"instrumented\":" + (instrumented() ? "true" : "false") + ",\"latency\":{";
+        for (size_t i = 0; i < std::size(hists); ++i)
+            out += (i ? ",\"" : "\"") + std::string(hists[i].first) + "\":" + hists[i].second->json();
+        return out + "}}";
     }
+
+    std::string out = "queued: " + std::to_string(g_queue.queued()) +
+        "\ndropped: " + std::to_string(g_queue.dropped()) +
+        "\ncoalesced: " + std::to_string(g_queue.coalesced()) +
+        "\nfolded: " + std::to_string(g_queue.folded()) +
+        "\nsend failures: " + std::to_string(g_queue.sendFailures()) +
+        "\nreplayed: " + std::to_string(g_queue.replayed()) + "\ndaemon alive: " + alive +
+        "\nconnects: " + n(conn.connects) + "\nconnect failures: " + n(conn.connectFailures) +
+        "\nshort writes: " + n(conn.shortWrites) + "\nbusy writes: " + n(conn.busyWrites) +
+        "\nhangups: " + n(conn.hangups) + "\nacked: " + n(acks.acked) + "\nack failures: " + n(acks.failed) +
+        "\nacks lost: " + n(acks.lost) + "\nswipes passed: " + std::to_string(g_swipesPassed) + "\n";
+    if (!instrumented())
+        return out + "latency: off (set plugin:hyprgrd:instrument = 1)\n";
+    for (const auto& [name, hist] : hists)
+        out += std::string(name) + ": " + hist->summary() + "\n";
+    return out;
 }
 
-// Pointers returned by registerCallbackDynamic — prevent them from being
-// garbage-collected by the Hyprland allocator while the plugin is loaded.
-static SP<HOOK_CALLBACK_FN> g_swipeBeginCb;
-static SP<HOOK_CALLBACK_FN> g_swipeUpdateCb;
-static SP<HOOK_CALLBACK_FN> g_swipeEndCb;
+/// Show the failures the writer collected from the daemon's acknowledgements.
+/// Runs on the main thread, from Hyprland's event loop.
+static int onAckFailures(int fd, uint32_t /*mask*/, void* /*data*/) {
+    uint64_t drained;
+    while (read(fd, &drained, sizeof(drained)) > 0) {}
+    AckFailure failure;
+    while (g_queue.popAckFailure(failure))
+        HyprlandAPI::addNotification(PHANDLE, "[hyprgrd] " + describeAckFailure(failure),
+                                     CHyprColor{1.0, 0.2, 0.2, 1.0}, 5000);
+    return 0;
+}
 
-/// hyprgrd:movetomonitor <direction>
+/// hyprgrd:stats [reset]
 ///
-/// Move the focused window to the monitor in the given direction.
-/// <direction> is one of: left, right, up, down (case-insensitive).
-///
-/// Sends: {"MoveWindowToMonitor":"Right"}  (etc.)
-static SDispatchResult dispatchMoveToMonitor(std::string arg) {
-    auto result = buildMoveToMonitorJson(arg);
-    if (!result.ok)
-        return SDispatchResult{.success = false, .error = result.value};
-    bool ok = sendCommand(result.value);
-    return ok ? SDispatchResult{} : SDispatchResult{.success = false, .error = "failed to send command"};
+/// Show the `hyprctl hyprgrd-stats` report as a notification, or clear the
+/// latency histograms with `reset`.
+static SDispatchResult dispatchStats(std::string arg) {
+    if (trimView(arg) == "reset") {
+        g_stats.reset();
+        return SDispatchResult{};
+    }
+    HyprlandAPI::addNotification(PHANDLE, "[hyprgrd]\n" + statsCommand(FORMAT_NORMAL, ""),
+                                 CHyprColor{0.6, 0.8, 1.0, 1.0}, 8000);
+    return SDispatchResult{};
 }
 
-/// hyprgrd:movetomonitorindex <n>
+/// hyprgrd:applygrid <monitor> <workspace> [<monitor> <workspace> …]
 ///
-/// Move the focused window to the monitor at the given index (0-based).
+/// Switch every listed monitor to its workspace in one dispatch.  The
+/// daemon sends this instead of a focusmonitor + workspace round trip per
+/// monitor on Hyprland's socket; the switches run in-process and the
+/// focused monitor goes last, so focus stays where it was.
 ///
-/// Sends: {"MoveWindowToMonitorIndex":2}
-static SDispatchResult dispatchMoveToMonitorIndex(std::string arg) {
-    auto result = buildMoveToMonitorIndexJson(arg);
-    if (!result.ok)
-        return SDispatchResult{.success = false, .error = result.value};
-    bool ok = sendCommand(result.value);
-    return ok ? SDispatchResult{} : SDispatchResult{.success = false, .error = "failed to send command"};
+/// Runs entirely inside the compositor; nothing is sent to the daemon.
+static SDispatchResult dispatchApplyGrid(std::string arg) {
+    std::vector<WorkspaceSwitch> switches;
+    if (!parseApplyGrid(arg, switches))
+        return SDispatchResult{.success = false, .error = "usage: hyprgrd:applygrid <monitor> <workspace> ..."};
+    return applySwitches(std::move(switches));
 }
 
-/// hyprgrd:togglevis
+/// hyprgrd:warm <monitor> <workspace> [<monitor> <workspace> …]
 ///
-/// Toggle a persistent overlay that shows the current grid state without
-/// moving workspaces.  This sends the JSON string `"ToggleVisualizer"` to
-/// the daemon; the first call shows the overlay and pins it, the second
-/// call hides it again.
+/// Sent by the daemon after a move with prefetching enabled: create each
+/// workspace on its monitor without switching to it and keep it alive
+/// while empty, so the first visit doesn't have to create it.
+static SDispatchResult dispatchWarm(std::string arg) {
+    std::vector<WorkspaceSwitch> workspaces;
+    if (!parseApplyGrid(arg, workspaces))
+        return SDispatchResult{.success = false, .error = "usage: hyprgrd:warm <monitor> <workspace> ..."};
+    for (const WorkspaceSwitch& w : workspaces)
+        warmWorkspace(w.monitor, w.workspace);
+    return SDispatchResult{};
+}
+
+/// hyprgrd:cool <workspace> [<workspace> …]
 ///
-/// Note: This dispatcher takes no arguments. Hyprland will pass an empty
-/// string when called without arguments, which we ignore.
-static SDispatchResult dispatchToggleVis(std::string arg) {
-    // Ignore any arguments (should be empty when called via keybind)
-    (void)arg;
-    const std::string json = "\"ToggleVisualizer\"";
-    bool ok = sendCommand(json);
-    return ok ? SDispatchResult{} : SDispatchResult{.success = false, .error = "failed to send command"};
+/// Sent by the daemon for cells that left its warm set: stop keeping
+/// their workspaces alive.
+static SDispatchResult dispatchCool(std::string arg) {
+    std::vector<int> ids;
+    if (!parseWorkspaceIds(arg, ids))
+        return SDispatchResult{.success = false, .error = "usage: hyprgrd:cool <workspace> ..."};
+    for (int id : ids)
+        coolWorkspace(id);
+    return SDispatchResult{};
 }
 
+// Pointers returned by registerCallbackDynamic — prevent them from being
+// garbage-collected by the Hyprland allocator while the plugin is loaded.
+static SP<HOOK_CALLBACK_FN> g_swipeBeginCb;
+static SP<HOOK_CALLBACK_FN> g_swipeUpdateCb;
+static SP<HOOK_CALLBACK_FN> g_swipeEndCb;
+static SP<HOOK_CALLBACK_FN> g_preRenderCb;
+static SP<HOOK_CALLBACK_FN> g_renderCb;
+static SP<HOOK_CALLBACK_FN> g_configReloadedCb;
+static SP<HOOK_CALLBACK_FN> g_monitorAddedCb;
+static SP<HOOK_CALLBACK_FN> g_monitorRemovedCb;
+
+
 //  Plugin entry points 
 
 APICALL EXPORT std::string PLUGIN_API_VERSION() {
@@ -239,33 +823,92 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
                                  " plugin=" + __hyprland_api_get_client_hash());
     }
 
+    //  Config 
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:queue_full_policy",
+                                Hyprlang::STRING{"coalesce"});
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:swipe_coalesce_ms", Hyprlang::INT{8});
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:swipe_pacing", Hyprlang::STRING{"frame"});
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:wire_format", Hyprlang::STRING{"binary"});
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:instrument", Hyprlang::INT{0});
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:grid_mode", Hyprlang::STRING{"daemon"});
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:swipe_channel", Hyprlang::STRING{"shm"});
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:overlay", Hyprlang::STRING{"daemon"});
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:prefetch_cells", Hyprlang::INT{0});
+    HyprlandAPI::addConfigValue(PHANDLE, "plugin:hyprgrd:acks", Hyprlang::INT{0});
+
+    // Resolve the daemon socket once and hand it to the writer thread,
+    // which owns the one lazily (re)connected socket.
+    g_queue.setStats(&g_stats);
+    // The channel is set up either way; each connection decides from the
+    // config of the moment whether to offer it.
+    if (g_swipeChannel.open())
+        g_queue.setSwipeChannel(&g_swipeChannel);
+    g_queue.configure(queueSettings());
+    g_queue.start(socketPath());
+    if (g_queue.ackFailureFd() >= 0)
+        g_ackSource = wl_event_loop_add_fd(g_pCompositor->m_wlEventLoop, g_queue.ackFailureFd(), WL_EVENT_READABLE,
+                                           onAckFailures, nullptr);
+
+    g_statsCmd = HyprlandAPI::registerHyprCtlCommand(
+        PHANDLE, SHyprCtlCommand{.name = "hyprgrd-stats", .exact = true, .fn = statsCommand});
+
     //  Dispatchers (keyboard binds) 
 
-    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:go",                 dispatchGo);
-    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:movego",             dispatchMoveGo);
-    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:switch",             dispatchSwitch);
-    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:movetomonitor",      dispatchMoveToMonitor);
-    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:movetomonitorindex", dispatchMoveToMonitorIndex);
-    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:togglevis",          dispatchToggleVis);
+    addCommandDispatchers();
+    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:stats",              dispatchStats);
+    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:applygrid",          dispatchApplyGrid);
+    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:syncgrid",           dispatchSyncGrid);
+    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:syncoverlay",        dispatchSyncOverlay);
+    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:syncgestures",       dispatchSyncGestures);
+    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:warm",               dispatchWarm);
+    HyprlandAPI::addDispatcherV2(PHANDLE, "hyprgrd:cool",               dispatchCool);
 
     //  Swipe gesture hooks 
     // Hook into Hyprland's swipe pipeline, forward events to the
     // daemon, and cancel the default workspace-swipe behaviour only
-    // when we successfully take ownership (connected to daemon).
+    // when we take ownership (the writer thread reports the daemon
+    // reachable).
     // Event payloads are IPointer::SSwipe*Event from Hyprland headers.
 
     g_swipeBeginCb = HyprlandAPI::registerCallbackDynamic(
         PHANDLE, "swipeBegin",
         [](void* /*thisptr*/, SCallbackInfo& info, std::any data) {
-            uint32_t fingers = 3;
+            ScopedTimer timer(timed(g_stats.swipeBegin));
+            uint32_t    fingers = 3;
             if (auto* ev = std::any_cast<IPointer::SSwipeBeginEvent>(&data))
                 fingers = ev->fingers;
+            if (!g_gestureRoutes.owns(fingers)) {
+                // Not a finger count the daemon uses: Hyprland's gesture.
+                ++g_swipesPassed;
+                info.cancelled = false;
+                return;
+            }
 
-            if (swipeConnect()) {
+            // Only a swipe the daemon can take starts a channel gesture, and
+            // the channel's new gesture must be visible before the daemon
+            // can see SwipeBegin.  Should the enqueue still fail, the daemon
+            // never follows the orphaned gesture: it waits for a SwipeBegin.
+            const bool owned = g_queue.daemonAlive();
+            const bool shm   = owned && g_swipeChannel.attached();
+            if (shm)
+                g_swipeChannel.begin(fingers);
+            if (owned && sendCommand(PluginMessage::swipeBegin(fingers))) {
                 g_swipeFingers = fingers;
-                swipeSend(buildSwipeBeginJson(g_swipeFingers));
+                g_swipeActive  = true;
+                g_swipeShm     = shm;
+                g_swipeCoalescer.reset();
+                g_swipeCoalescer.setInterval(swipeCoalesceMs());
+                g_swipeMonitor      = g_pCompositor ? g_pCompositor->m_lastMonitor : PHLMONITORREF{};
+                g_swipeFramePaced   = swipePacing() == SwipePacing::Frame && !g_swipeMonitor.expired();
+                g_swipeFrameAskedNs = 0;
+                g_swipeCoalescer.setPacing(g_swipeFramePaced ? SwipePacing::Frame : SwipePacing::Timer);
+                g_swipeVelocity.reset();
+                if (pluginOverlay())
+                    g_overlay.swipeBegin(fingers);
                 info.cancelled = true;
             } else {
+                // Let Hyprland have this one.  The writer reconnects on
+                // its own as soon as the daemon's socket appears.
                 info.cancelled = false;
             }
         });
@@ -273,36 +916,102 @@ APICALL EXPORT PLUGIN_DESCRIPTION_INFO PLUGIN_INIT(HANDLE handle) {
     g_swipeUpdateCb = HyprlandAPI::registerCallbackDynamic(
         PHANDLE, "swipeUpdate",
         [](void* /*thisptr*/, SCallbackInfo& info, std::any data) {
-            if (g_swipeFd < 0) {
+            ScopedTimer timer(timed(g_stats.swipeUpdate));
+            if (!g_swipeActive) {
                 info.cancelled = false;
                 return;
             }
             if (auto* ev = std::any_cast<IPointer::SSwipeUpdateEvent>(&data)) {
-                swipeSend(buildSwipeUpdateJson(ev->fingers, ev->delta.x, ev->delta.y));
+                g_swipeVelocity.add(ev->timeMs, ev->delta.x, ev->delta.y);
+                if (g_overlay.following()) {
+                    g_overlay.swipeUpdate(ev->delta.x, ev->delta.y, overlayNowMs());
+                    damageOverlay();
+                }
+                if (g_swipeShm && !g_swipeFramePaced) {
+                    g_swipeChannel.add(ev->fingers, ev->delta.x, ev->delta.y, ev->timeMs);
+                    info.cancelled = true;
+                    return;
+                }
+                swipeSendDelta(g_swipeCoalescer.add(ev->timeMs, ev->fingers, ev->delta.x, ev->delta.y));
+                if (g_swipeFramePaced && g_swipeCoalescer.pending())
+                    swipeScheduleFrame();
                 info.cancelled = true;
                 return;
             }
             // Layout mismatch: still cancel so we don't hand gesture back to Hyprland mid-swipe.
-            swipeSend(buildSwipeUpdateJson(g_swipeFingers, 0.0, 0.0));
+            swipeSend(PluginMessage::swipeUpdate(g_swipeFingers, 0.0, 0.0));
             info.cancelled = true;
         });
 
     g_swipeEndCb = HyprlandAPI::registerCallbackDynamic(
         PHANDLE, "swipeEnd",
-        [](void* /*thisptr*/, SCallbackInfo& info, std::any /*data*/) {
-            if (g_swipeFd >= 0) {
-                swipeSend(buildSwipeEndJson());
-                swipeDisconnect();
+        [](void* /*thisptr*/, SCallbackInfo& info, std::any data) {
+            ScopedTimer timer(timed(g_stats.swipeEnd));
+            if (g_swipeActive) {
+                uint32_t endMs = 0;
+                if (auto* ev = std::any_cast<IPointer::SSwipeEndEvent>(&data))
+                    endMs = ev->timeMs;
+                // Forced flush: held-back motion must reach the daemon
+                // before it decides whether to commit.
+                swipeSendDelta(g_swipeCoalescer.flush());
+                const SwipeVelocity v = g_swipeVelocity.velocity(endMs);
+                swipeSend(PluginMessage::swipeVelocity(v.vx, v.vy));
+                swipeSend(PluginMessage::simple(MessageKind::SwipeEnd));
+                if (g_overlay.following()) {
+                    g_overlay.swipeEnd(v, overlayNowMs());
+                    damageOverlay();
+                }
+                g_swipeActive  = false;
                 info.cancelled = true;
             } else {
                 info.cancelled = false;
             }
         });
 
+    // Frame-paced swipes flush once per frame of the gesture's monitor.
+    g_preRenderCb = HyprlandAPI::registerCallbackDynamic(
+        PHANDLE, "preRender", [](void* /*thisptr*/, SCallbackInfo& /*info*/, std::any data) {
+            if (auto* mon = std::any_cast<PHLMONITOR>(&data))
+                swipeFrame(*mon);
+        });
+
+    //  Overlay (overlay = plugin) 
+    // Drawn last in every frame of the focused monitor.
+    g_renderCb = HyprlandAPI::registerCallbackDynamic(
+        PHANDLE, "render", [](void* /*thisptr*/, SCallbackInfo& /*info*/, std::any data) {
+            if (auto* stage = std::any_cast<eRenderStage>(&data))
+                renderOverlay(*stage);
+        });
+
+    //  Config reloads 
+    // The config is parsed after PLUGIN_INIT and again on every reload;
+    // the writer reconnects when the connection's setup changed.  A reload
+    // may also have (re)configured monitors.
+    g_configReloadedCb = HyprlandAPI::registerCallbackDynamic(
+        PHANDLE, "configReloaded", [](void* /*thisptr*/, SCallbackInfo& /*info*/, std::any /*data*/) {
+            g_queue.configure(queueSettings());
+            g_grid.forgetMonitors();
+        });
+
+    //  Monitor hotplug 
+    // The plugin grid's workspace ids depend on the monitor set; it is read
+    // again on the next dispatcher.
+    g_monitorAddedCb = HyprlandAPI::registerCallbackDynamic(
+        PHANDLE, "monitorAdded",
+        [](void* /*thisptr*/, SCallbackInfo& /*info*/, std::any /*data*/) { g_grid.forgetMonitors(); });
+    g_monitorRemovedCb = HyprlandAPI::registerCallbackDynamic(
+        PHANDLE, "monitorRemoved",
+        [](void* /*thisptr*/, SCallbackInfo& /*info*/, std::any /*data*/) { g_grid.forgetMonitors(); });
+
     return {"hyprgrd", "Grid workspace switcher dispatchers + gesture forwarding", "hyprgrd", "0.2.0"};
 }
 
 APICALL EXPORT void PLUGIN_EXIT() {
-    swipeDisconnect();
+    if (g_statsCmd)
+        HyprlandAPI::unregisterHyprCtlCommand(PHANDLE, g_statsCmd);
+    if (g_ackSource)
+        wl_event_source_remove(g_ackSource);
+    g_ackSource = nullptr;
+    g_queue.stop();
 }
 
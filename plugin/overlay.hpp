@@ -0,0 +1,459 @@
+// overlay.hpp — Grid overlay drawn by the compositor itself, for
+// `plugin:hyprgrd:overlay = plugin`.
+//
+// Mirrors the GTK visualizer (layout, default CSS colours, easing and the
+// show → linger → fade lifecycle in src/visualizer/gtk.rs) and the swipe
+// maths in src/hyprland/gestures.rs; keep them in sync.
+//
+// The GTK overlay is a separate client: every visual step is an IPC hop
+// to the daemon, a GTK frame and a compositor commit, so it trails the
+// fingers by a frame or more.  Here the plugin follows the gesture from
+// its own swipe hooks and draws the overlay in Hyprland's render pass, on
+// the frame the input arrived for.  The daemon stays the source of truth:
+//
+// - On every (re)connect the plugin sends `AttachOverlay`; the daemon
+//   stops driving its own visualizer and answers with
+//   `hyprgrd:syncoverlay` (gesture and timing settings) and
+//   `hyprgrd:syncgrid` (the current cell).
+// - While swiping nothing crosses the socket for the overlay; on release
+//   the cursor slides to the cell the daemon will pick for the same
+//   release velocity, and the daemon's next `syncgrid` confirms (or
+//   corrects) it.
+
+#pragma once
+
+#include "grid.hpp"
+#include "helpers.hpp"
+#include "velocity.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/// Gesture and timing settings pushed by the daemon with
+/// `hyprgrd:syncoverlay`; the defaults match the daemon's.
+struct OverlayConfig {
+    double   sensitivity       = 200.0;
+    double   commitThreshold   = 0.3;
+    bool     naturalSwiping    = true;
+    uint32_t switchFingers     = 3;
+    uint32_t moveFingers       = 4;
+    uint32_t flingLookaheadMs  = 100;
+    uint32_t cursorAnimationMs = 80;
+    uint32_t lingerMs          = 300;
+    uint32_t fadeOutMs         = 200;
+
+    bool operator==(const OverlayConfig&) const = default;
+};
+
+/// Parse `hyprgrd:syncoverlay <sensitivity> <threshold> <natural 0|1>
+/// <switch fingers> <move fingers> <fling ms> <cursor ms> <linger ms>
+/// <fade ms>` (sent by the daemon, see `syncoverlay_args` in
+/// src/hyprland/wm.rs).
+inline std::optional<OverlayConfig> parseSyncOverlay(std::string_view arg) {
+    double           real[2];
+    uint32_t         whole[7];
+    std::string_view rest = trimView(arg);
+    for (size_t i = 0; i < 9; ++i) {
+        const char* first = rest.data();
+        const char* last  = rest.data() + rest.size();
+        auto [end, ec]    = i < 2 ? std::from_chars(first, last, real[i]) : std::from_chars(first, last, whole[i - 2]);
+        if (ec != std::errc{})
+            return std::nullopt;
+        rest = rest.substr(static_cast<size_t>(end - first));
+        if (i < 8 && (rest.empty() || !std::isspace(static_cast<unsigned char>(rest.front()))))
+            return std::nullopt;
+        rest = trimView(rest);
+    }
+    if (!rest.empty() || !(real[0] > 0.0) || whole[0] > 1)
+        return std::nullopt;
+    return OverlayConfig{
+        .sensitivity       = real[0],
+        .commitThreshold   = real[1],
+        .naturalSwiping    = whole[0] == 1,
+        .switchFingers     = whole[1],
+        .moveFingers       = whole[2],
+        .flingLookaheadMs  = whole[3],
+        .cursorAnimationMs = whole[4],
+        .lingerMs          = whole[5],
+        .fadeOutMs         = whole[6],
+    };
+}
+
+// ── Layout (the GTK visualizer's constants and default CSS) ─────────────
+
+inline constexpr double OVERLAY_CELL_SIZE   = 24.0;
+inline constexpr double OVERLAY_CELL_MARGIN = 3.0;
+inline constexpr double OVERLAY_CELL_PITCH  = OVERLAY_CELL_SIZE + 2 * OVERLAY_CELL_MARGIN; // 30
+/// Space between the overlay's edge and the grid.
+inline constexpr double OVERLAY_PADDING     = 12.0;
+inline constexpr double OVERLAY_RADIUS      = 16.0;
+inline constexpr double OVERLAY_CELL_RADIUS = 6.0;
+
+/// Straight (non-premultiplied) RGBA, 0–1.
+struct OverlayColor {
+    float r = 0.f;
+    float g = 0.f;
+    float b = 0.f;
+    float a = 0.f;
+
+    bool operator==(const OverlayColor&) const = default;
+};
+
+inline constexpr OverlayColor OVERLAY_BACKGROUND{0.f, 0.f, 0.f, 0.75f};
+inline constexpr OverlayColor OVERLAY_CELL{1.f, 1.f, 1.f, 0.08f};
+inline constexpr OverlayColor OVERLAY_TARGET{1.f, 1.f, 1.f, 0.22f};
+inline constexpr OverlayColor OVERLAY_CURSOR{1.f, 1.f, 1.f, 0.9f};
+
+/// One rounded rectangle of the overlay, in logical pixels relative to its
+/// top-left corner.
+struct OverlayRect {
+    double       x      = 0.0;
+    double       y      = 0.0;
+    double       w      = 0.0;
+    double       h      = 0.0;
+    double       radius = 0.0;
+    OverlayColor color;
+};
+
+// ── Swipe maths (src/hyprland/gestures.rs) ──────────────────────────────
+
+/// `normalised_swipe_offset`: clamp to [-1, 1] per axis, optionally invert.
+inline std::pair<double, double> normalisedSwipeOffset(double dx, double dy, const OverlayConfig& cfg) {
+    const double nx = std::clamp(dx / cfg.sensitivity, -1.0, 1.0);
+    const double ny = std::clamp(dy / cfg.sensitivity, -1.0, 1.0);
+    return cfg.naturalSwiping ? std::pair{-nx, -ny} : std::pair{nx, ny};
+}
+
+/// `dominant_direction`: diagonal when both axes pass the threshold,
+/// otherwise the larger axis if it does.
+inline std::optional<GridDirection> dominantDirection(double nx, double ny, double threshold) {
+    const double ax    = std::abs(nx);
+    const double ay    = std::abs(ny);
+    const bool   overX = ax >= threshold;
+    const bool   overY = ay >= threshold;
+    if (overX && overY) {
+        if (nx > 0.0)
+            return ny > 0.0 ? GridDirection::DownRight : GridDirection::UpRight;
+        return ny > 0.0 ? GridDirection::DownLeft : GridDirection::UpLeft;
+    }
+    if (ax >= ay && overX)
+        return nx > 0.0 ? GridDirection::Right : GridDirection::Left;
+    if (ay > ax && overY)
+        return ny > 0.0 ? GridDirection::Down : GridDirection::Up;
+    return std::nullopt;
+}
+
+// ── Easing (src/bezier.rs, src/visualizer/gtk.rs) ───────────────────────
+
+/// y of the CSS `ease` curve, cubic-bezier(0.25, 0.1, 0.25, 1), at x = `u`
+/// (`bezier::ease_scalar`: Newton–Raphson, bisection as the fallback).
+inline double cssEase(double u) {
+    constexpr double cx = 3.0 * 0.25, bx = 3.0 * (0.25 - 0.25) - cx, ax = 1.0 - cx - bx;
+    constexpr double cy = 3.0 * 0.1, by = 3.0 * (1.0 - 0.1) - cy, ay = 1.0 - cy - by;
+    const auto       x  = [&](double t) { return ((ax * t + bx) * t + cx) * t; };
+    const auto       y  = [&](double t) { return ((ay * t + by) * t + cy) * t; };
+
+    u        = std::clamp(u, 0.0, 1.0);
+    double t = u;
+    for (int i = 0; i < 8; ++i) {
+        const double err = x(t) - u;
+        if (std::abs(err) < 1e-6)
+            return y(t);
+        const double slope = (3.0 * ax * t + 2.0 * bx) * t + cx;
+        if (std::abs(slope) < 1e-6)
+            break;
+        t -= err / slope;
+        if (t < 0.0 || t > 1.0)
+            break;
+    }
+    double lo = 0.0, hi = 1.0;
+    t = u;
+    for (int i = 0; i < 24; ++i) {
+        const double at = x(t);
+        if (std::abs(at - u) < 1e-7)
+            break;
+        if (at < u)
+            lo = t;
+        else
+            hi = t;
+        t = 0.5 * (lo + hi);
+    }
+    return y(t);
+}
+
+/// `interpolated_offset`: blend the gesture offset towards its 45°-snapped
+/// direction as it approaches one whole cell.
+inline std::pair<double, double> interpolatedOffset(double ox, double oy) {
+    const double mag = std::hypot(ox, oy);
+    const double u   = std::min(std::max(std::abs(ox), std::abs(oy)), 1.0);
+    if (mag < 1e-10 || u < 1e-6)
+        return {ox, oy};
+    constexpr double quarter = std::numbers::pi / 4.0;
+    const double     angle   = std::round(std::atan2(oy, ox) / quarter) * quarter;
+    const double     alpha   = 1.0 - cssEase(u);
+    return {alpha * ox + (1.0 - alpha) * mag * std::cos(angle), alpha * oy + (1.0 - alpha) * mag * std::sin(angle)};
+}
+
+inline double easeOutCubic(double t) {
+    return 1.0 - std::pow(1.0 - t, 3);
+}
+
+/// Top-left of cell `index` along one axis, relative to the grid.
+inline double overlayCellPx(size_t index) {
+    return static_cast<double>(index) * OVERLAY_CELL_PITCH + OVERLAY_CELL_MARGIN;
+}
+
+// ── Viewport (src/visualizer/viewport.rs) ───────────────────────────────
+
+/// Most cells the overlay shows along each axis.  Bigger grids (scripts
+/// switch to cells hundreds away) show the part around the cursor, so the
+/// overlay's size and drawing cost stay the same however far the grid
+/// reaches.
+inline constexpr size_t OVERLAY_VIEWPORT_CELLS = 9;
+
+/// First shown cell and number of shown cells along one axis of an
+/// `n`-cell grid: `shown` as near the middle as the edges allow, with
+/// `reach` (at most one cell away) still in view.
+inline std::pair<size_t, size_t> overlayViewportAxis(size_t n, size_t shown, size_t reach) {
+    const size_t len   = std::min(n, OVERLAY_VIEWPORT_CELLS);
+    size_t       start = std::min(shown - std::min(shown, OVERLAY_VIEWPORT_CELLS / 2), n - len);
+    if (reach >= start + len)
+        start = reach + 1 - len;
+    else if (reach < start)
+        start = reach;
+    return {start, len};
+}
+
+// ── Model ───────────────────────────────────────────────────────────────
+
+/// What the overlay shows at a given time.  Fed from the dispatchers and
+/// swipe hooks, stepped from the render hook; main-thread only.  Times are
+/// milliseconds on any monotonic clock.
+class OverlayModel {
+  public:
+    void configure(const OverlayConfig& cfg) { m_cfg = cfg; }
+    const OverlayConfig& config() const { return m_cfg; }
+
+    /// Adopt the daemon's cell (`hyprgrd:syncgrid`, or a plugin-grid move).
+    /// A changed cell or grid flashes the overlay, as the daemon's
+    /// visualizer does after a switch; the first state is taken silently.
+    /// Arriving mid-gesture it ends the gesture display: the daemon
+    /// committed while the fingers were still down.
+    void sync(const GridState& st, double nowMs) {
+        const bool changed = m_synced && st != m_grid;
+        m_grid             = st;
+        m_synced           = true;
+        m_pending.reset();
+        if (m_gesture)
+            endGesture();
+        if (changed) {
+            showAuto();
+            hide(nowMs);
+        }
+        place(nowMs);
+    }
+
+    /// `hyprgrd:togglevis`: show until toggled again, or hide right away.
+    void toggleManual(double nowMs) {
+        if (m_kind == Kind::Manual) {
+            m_kind       = Kind::Hidden;
+            m_visibility = Visibility::Hidden;
+        } else {
+            m_kind       = Kind::Manual;
+            m_visibility = Visibility::Visible;
+        }
+        place(nowMs);
+    }
+
+    /// Start following a gesture with `fingers`; false (and ignored) unless
+    /// it is a switch or move swipe.
+    bool swipeBegin(uint32_t fingers) {
+        if (fingers != m_cfg.switchFingers && fingers != m_cfg.moveFingers)
+            return false;
+        m_gesture = true;
+        m_dx = m_dy = 0.0;
+        m_pending.reset();
+        return true;
+    }
+
+    bool following() const { return m_gesture; }
+
+    /// Add one update's motion; the cursor tracks the fingers directly.
+    void swipeUpdate(double dx, double dy, double nowMs) {
+        if (!m_gesture)
+            return;
+        m_dx += dx;
+        m_dy += dy;
+        const auto [ox, oy] = normalisedSwipeOffset(m_dx, m_dy, m_cfg);
+        m_offsetX           = ox;
+        m_offsetY           = oy;
+        m_target.reset();
+        if (const auto dir = dominantDirection(ox, oy, m_cfg.commitThreshold))
+            m_target = stepFrom(*dir, cell());
+        showAuto();
+        place(nowMs);
+    }
+
+    /// The fingers lifted with `velocity`: slide to the cell the daemon
+    /// will commit to for the same release (or back, if none) and linger.
+    void swipeEnd(const SwipeVelocity& velocity, double nowMs) {
+        if (!m_gesture)
+            return;
+        const double ahead = static_cast<double>(m_cfg.flingLookaheadMs) / 1000.0;
+        const auto [ox, oy] =
+            normalisedSwipeOffset(m_dx + velocity.vx * ahead, m_dy + velocity.vy * ahead, m_cfg);
+        endGesture();
+        if (const auto dir = dominantDirection(ox, oy, m_cfg.commitThreshold); dir && m_synced)
+            m_pending = stepFrom(*dir, cell());
+        hide(nowMs);
+        place(nowMs);
+    }
+
+    /// Step the cursor slide and the fade to `nowMs`.  Returns whether
+    /// later frames still change anything.
+    bool advance(double nowMs) {
+        if (m_anim) {
+            const double dur = m_cfg.cursorAnimationMs;
+            const double t   = dur > 0.0 ? std::clamp((nowMs - m_anim->startMs) / dur, 0.0, 1.0) : 1.0;
+            const double e   = easeOutCubic(t);
+            m_curX           = m_anim->fromX + (m_anim->toX - m_anim->fromX) * e;
+            m_curY           = m_anim->fromY + (m_anim->toY - m_anim->fromY) * e;
+            if (t >= 1.0)
+                m_anim.reset();
+        }
+        if (m_visibility == Visibility::Lingering && nowMs - m_since >= m_cfg.lingerMs) {
+            m_visibility = Visibility::Fading;
+            m_since += m_cfg.lingerMs;
+        }
+        m_opacity = 1.0;
+        if (m_visibility == Visibility::Fading) {
+            const double t = m_cfg.fadeOutMs > 0 ? (nowMs - m_since) / m_cfg.fadeOutMs : 1.0;
+            if (t >= 1.0) {
+                m_visibility = Visibility::Hidden;
+                m_kind       = Kind::Hidden;
+            } else {
+                m_opacity = 1.0 - t;
+            }
+        }
+        return visible() && (m_anim || m_visibility == Visibility::Lingering || m_visibility == Visibility::Fading);
+    }
+
+    bool   visible() const { return m_visibility != Visibility::Hidden; }
+    /// Of the whole overlay, as of the last `advance()`.
+    double opacity() const { return m_opacity; }
+    double width() const { return static_cast<double>(m_view.cols) * OVERLAY_CELL_PITCH + 2 * OVERLAY_PADDING; }
+    double height() const { return static_cast<double>(m_view.rows) * OVERLAY_CELL_PITCH + 2 * OVERLAY_PADDING; }
+
+    /// The rectangles to draw, back to front: background, the cells in
+    /// view, cursor.
+    void layout(std::vector<OverlayRect>& out) const {
+        out.clear();
+        out.push_back({0.0, 0.0, width(), height(), OVERLAY_RADIUS, OVERLAY_BACKGROUND});
+        for (size_t row = 0; row < m_view.rows; ++row)
+            for (size_t col = 0; col < m_view.cols; ++col) {
+                const bool target = m_target && m_target->col == m_view.col + col && m_target->row == m_view.row + row;
+                out.push_back({OVERLAY_PADDING + overlayCellPx(col), OVERLAY_PADDING + overlayCellPx(row), OVERLAY_CELL_SIZE,
+                               OVERLAY_CELL_SIZE, OVERLAY_CELL_RADIUS, target ? OVERLAY_TARGET : OVERLAY_CELL});
+            }
+        // A slide from a cell that just scrolled out starts at the edge.
+        const auto inView = [](double px, size_t first, size_t len) {
+            return std::clamp(px - static_cast<double>(first) * OVERLAY_CELL_PITCH, OVERLAY_CELL_MARGIN, overlayCellPx(len - 1));
+        };
+        out.push_back({OVERLAY_PADDING + std::round(inView(m_curX, m_view.col, m_view.cols)),
+                       OVERLAY_PADDING + std::round(inView(m_curY, m_view.row, m_view.rows)), OVERLAY_CELL_SIZE,
+                       OVERLAY_CELL_SIZE, OVERLAY_CELL_RADIUS, OVERLAY_CURSOR});
+    }
+
+  private:
+    enum class Visibility { Hidden, Visible, Lingering, Fading };
+    enum class Kind { Hidden, Manual, Auto };
+
+    struct CursorAnim {
+        double fromX, fromY, toX, toY, startMs;
+    };
+
+    /// The cells in view: first column and row, and how many of each.
+    struct View {
+        size_t col = 0, row = 0, cols = 1, rows = 1;
+    };
+
+    GridCell cell() const { return {m_grid.col, m_grid.row}; }
+
+    void endGesture() {
+        m_gesture = false;
+        m_offsetX = m_offsetY = 0.0;
+        m_target.reset();
+    }
+
+    void showAuto() {
+        if (m_kind != Kind::Manual)
+            m_kind = Kind::Auto;
+        m_visibility = Visibility::Visible;
+        m_opacity    = 1.0;
+    }
+
+    /// Start lingering, unless the overlay was shown by hand.
+    void hide(double nowMs) {
+        if (m_kind == Kind::Manual || m_visibility == Visibility::Hidden)
+            return;
+        m_visibility = Visibility::Lingering;
+        m_since      = nowMs;
+    }
+
+    /// Size the grid and move the cursor for the current state (the GTK
+    /// visualizer's `OverlayGrid::update`).
+    void place(double nowMs) {
+        const GridCell shown = m_pending ? *m_pending : cell();
+        const GridCell reach = m_target ? *m_target : shown;
+        // The grid as displayed, grown to reach the target.
+        const size_t cols = std::max({m_grid.cols, reach.col + 1, shown.col + 1});
+        const size_t rows = std::max({m_grid.rows, reach.row + 1, shown.row + 1});
+        std::tie(m_view.col, m_view.cols) = overlayViewportAxis(cols, shown.col, reach.col);
+        std::tie(m_view.row, m_view.rows) = overlayViewportAxis(rows, shown.row, reach.row);
+
+        const auto [ox, oy] = interpolatedOffset(m_offsetX, m_offsetY);
+        const double x      = std::max(overlayCellPx(shown.col) + ox * OVERLAY_CELL_PITCH, OVERLAY_CELL_MARGIN);
+        const double y      = std::max(overlayCellPx(shown.row) + oy * OVERLAY_CELL_PITCH, OVERLAY_CELL_MARGIN);
+        if (!m_placed || m_gesture || !visible()) {
+            m_curX   = x;
+            m_curY   = y;
+            m_anim.reset();
+            m_placed = true;
+            return;
+        }
+        const double toX = m_anim ? m_anim->toX : m_curX;
+        const double toY = m_anim ? m_anim->toY : m_curY;
+        if (std::abs(x - toX) > 0.5 || std::abs(y - toY) > 0.5)
+            m_anim = CursorAnim{m_curX, m_curY, x, y, nowMs};
+    }
+
+    OverlayConfig             m_cfg;
+    GridState                 m_grid;
+    bool                      m_synced  = false;
+    bool                      m_placed  = false;
+    bool                      m_gesture = false;
+    double                    m_dx      = 0.0; ///< Gesture totals since swipeBegin
+    double                    m_dy      = 0.0;
+    double                    m_offsetX = 0.0; ///< Normalised, as the daemon computes it
+    double                    m_offsetY = 0.0;
+    std::optional<GridCell>   m_target;  ///< Past the threshold while dragging
+    std::optional<GridCell>   m_pending; ///< Predicted on release, until the next sync
+    View                      m_view; ///< Of the displayed grid
+    double                    m_curX = OVERLAY_CELL_MARGIN; ///< Cursor, relative to the whole grid
+    double                    m_curY = OVERLAY_CELL_MARGIN;
+    std::optional<CursorAnim> m_anim;
+    Visibility                m_visibility = Visibility::Hidden;
+    Kind                      m_kind       = Kind::Hidden;
+    double                    m_since      = 0.0; ///< Start of the linger or fade
+    double                    m_opacity    = 1.0;
+};
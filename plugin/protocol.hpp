@@ -0,0 +1,127 @@
+// protocol.hpp — Binary wire protocol between the plugin and the daemon.
+//
+// Mirrors src/ipc/protocol.rs; keep the two in sync.
+//
+// A connection starts in JSON mode.  A client that wants binary framing
+// sends the handshake line
+//
+//     HELLO hyprgrd-binary/2\n
+//
+// and the daemon answers `OK hyprgrd-binary/2\n` (switch to binary) or
+// `OK json\n` (stay on JSON).  Daemons that predate version 2 answer
+// `OK json\n`, and the client retries with `HELLO hyprgrd-binary/1\n`.  A
+// daemon that predates the handshake does not answer at all; the client
+// then stays on JSON after a short timeout.
+//
+// Binary frames are `[opcode:u8][len:u8][payload:len bytes]`, integers and
+// floats little-endian.  Dispatcher frames carry the raw (trimmed) argument
+// as UTF-8; swipe updates carry a fixed 32-byte payload.  On version 2 a
+// dispatcher opcode with `Op::Parsed` set carries its argument already
+// parsed instead (commands.hpp): a direction code, col and row, or an
+// index.  In binary mode
+// the daemon still accepts JSON lines (they start with `{` or `"`, which
+// no opcode uses), so hand-written commands keep working on any connection.
+//
+// Once on binary framing the plugin may attach the shared-memory swipe
+// channel (swipe_channel.hpp): an empty `AttachSwipeChannel` frame carrying
+// the memfd and eventfd as SCM_RIGHTS, answered by `OK shm\n`.
+//
+// Before the binary handshake a client may send `HELLO hyprgrd-acks/1\n`
+// to have sequenced commands acknowledged (acks.hpp); the daemon answers
+// `OK hyprgrd-acks/1\n` and the framing stays as it was.  Older daemons
+// answer `OK json\n`, and the client then sends plain commands.
+
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/// Encoding used on a daemon connection.
+enum class WireFormat {
+    Json,
+    Binary,
+};
+
+/// Handshake line (without newline) requesting binary framing.
+inline constexpr std::string_view PROTOCOL_HELLO = "HELLO hyprgrd-binary/2";
+/// Daemon reply (without newline) accepting binary framing.
+inline constexpr std::string_view PROTOCOL_ACCEPT_BINARY = "OK hyprgrd-binary/2";
+
+/// The same for daemons without pre-parsed arguments.
+inline constexpr std::string_view PROTOCOL_HELLO_V1         = "HELLO hyprgrd-binary/1";
+inline constexpr std::string_view PROTOCOL_ACCEPT_BINARY_V1 = "OK hyprgrd-binary/1";
+
+/// Daemon reply (without newline) to a handshake it doesn't know.
+inline constexpr std::string_view PROTOCOL_ACCEPT_JSON = "OK json";
+
+/// Handshake line (without newline) requesting acknowledgements.
+inline constexpr std::string_view PROTOCOL_HELLO_ACKS = "HELLO hyprgrd-acks/1";
+/// Daemon reply (without newline) accepting acknowledgements.
+inline constexpr std::string_view PROTOCOL_ACCEPT_ACKS = "OK hyprgrd-acks/1";
+
+/// Daemon reply (without newline) accepting the shared-memory swipe channel.
+inline constexpr std::string_view PROTOCOL_ACCEPT_SHM = "OK shm";
+
+/// How long to wait for the handshake reply before falling back to JSON.
+inline constexpr int PROTOCOL_HELLO_TIMEOUT_MS = 250;
+
+/// Frame opcodes.
+namespace Op {
+    inline constexpr uint8_t Go                       = 0x01;
+    inline constexpr uint8_t MoveWindowAndGo          = 0x02;
+    inline constexpr uint8_t SwitchTo                 = 0x03;
+    inline constexpr uint8_t MoveWindowToMonitor      = 0x04;
+    inline constexpr uint8_t MoveWindowToMonitorIndex = 0x05;
+    inline constexpr uint8_t ToggleVisualizer         = 0x06;
+    inline constexpr uint8_t SyncGrid                 = 0x07; ///< payload: cols, rows, col, row (u32 each)
+    inline constexpr uint8_t AttachOverlay            = 0x08;
+    inline constexpr uint8_t SwipeBegin               = 0x10; ///< payload: fingers u32
+    inline constexpr uint8_t SwipeUpdate              = 0x11; ///< payload: fingers u32, dx f64, dy f64, time_ms u32, sent_ns u64
+    inline constexpr uint8_t SwipeEnd                 = 0x12;
+    inline constexpr uint8_t AttachSwipeChannel       = 0x13; ///< empty; memfd + eventfd as SCM_RIGHTS
+    inline constexpr uint8_t SwipeVelocity            = 0x14; ///< payload: vx f64, vy f64 (px/s)
+    inline constexpr uint8_t Sequenced                = 0x15; ///< payload: seq u32, then the command's frame
+    inline constexpr uint8_t AttachGestures           = 0x16;
+    inline constexpr uint8_t GoN                      = 0x17; ///< payload: direction code u8, count u32 (version 2)
+    inline constexpr uint8_t Parsed                   = 0x80; ///< flag on a dispatcher opcode: pre-parsed argument
+}
+
+/// Size of the fixed SwipeUpdate payload.  `time_ms` is the input event
+/// timestamp and `sent_ns` the plugin's CLOCK_MONOTONIC send time; both are
+/// 0 when the update carries no latency trace.
+inline constexpr size_t SWIPE_UPDATE_PAYLOAD = 4 + 8 + 8 + 4 + 8;
+
+/// Append `v` little-endian.
+inline void putU32(std::string& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i)
+        out += static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+/// Append `v` little-endian.
+inline void putU64(std::string& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i)
+        out += static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+/// Append the IEEE-754 bits of `v` little-endian.
+inline void putF64(std::string& out, double v) {
+    const auto bits = std::bit_cast<uint64_t>(v);
+    for (int i = 0; i < 8; ++i)
+        out += static_cast<char>((bits >> (8 * i)) & 0xff);
+}
+
+/// Append a frame header.  `len` must not exceed 255.
+inline void putFrameHeader(std::string& out, uint8_t op, size_t len) {
+    out += static_cast<char>(op);
+    out += static_cast<char>(static_cast<uint8_t>(len));
+}
+
+/// Append a frame carrying a string argument (truncated to 255 bytes).
+inline void putArgFrame(std::string& out, uint8_t op, std::string_view arg) {
+    if (arg.size() > 255)
+        arg = arg.substr(0, 255);
+    putFrameHeader(out, op, arg.size());
+    out.append(arg);
+}
@@ -0,0 +1,885 @@
+// queue.hpp — Off-main-thread send queue for the hyprgrd plugin.
+//
+// Hyprland calls our dispatchers and swipe hooks on its main thread, which
+// also renders frames.  Those callbacks only enqueue a small fixed-size
+// message into a lock-free single-producer/single-consumer ring; a
+// dedicated writer thread drains the ring into the daemon socket.  A
+// stalled daemon therefore costs the compositor nothing but a full ring.
+//
+// The writer also keeps the connection ready between messages: it connects
+// at start, notices an idle connection hanging up, and while the daemon is
+// away sleeps on an inotify watch of the socket's directory
+// (connection.hpp's SocketWatch), reconnecting the moment the socket
+// reappears.  The main thread only ever reads the cached `daemonAlive()`.
+// Dispatcher commands that find the daemon away, or its socket full, are
+// held by the writer and replayed, in order, once it reconnects or drains,
+// so neither a daemon restart nor a slow daemon loses a keybind pressed
+// meanwhile (see REPLAY_WINDOW_MS).
+//
+// Key repeat on a `hyprgrd:go` bind can outpace a busy daemon.  Presses of
+// the same `go` that pile up in the ring are folded into the one ahead of
+// them, and go out as one `GoN` move where the connection takes it
+// (version 2).
+//
+// With acknowledgements on (`QueueSettings::acks`), the writer numbers dispatcher
+// commands, matches the daemon's replies while idle (acks.hpp) and hands
+// failures back through a second ring whose eventfd the main thread
+// watches.
+
+#pragma once
+
+#include "acks.hpp"
+#include "commands.hpp"
+#include "connection.hpp"
+#include "helpers.hpp"
+#include "protocol.hpp"
+#include "stats.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+//  Lock-free ring
+
+/// Bounded single-producer/single-consumer ring buffer.
+///
+/// `push()` must only ever be called from one thread and `pop()` from one
+/// (other) thread.  `N` must be a power of two.
+template <typename T, size_t N>
+class SpscRing {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+  public:
+    /// Append `value`.  Returns false (leaving the ring untouched) if full.
+    bool push(const T& value) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == N)
+            return false;
+        m_slots[tail & (N - 1)] = value;
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// The oldest element, left in the ring, or nullptr if empty.  Consumer
+    /// side, like `pop()`; valid until the next `pop()`.
+    const T* front() const {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return nullptr;
+        return &m_slots[head & (N - 1)];
+    }
+
+    /// Remove the oldest element into `out`.  Returns false if empty.
+    bool pop(T& out) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire))
+            return false;
+        out = m_slots[head & (N - 1)];
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Number of queued elements (approximate while the other side is active).
+    size_t size() const {
+        return m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire);
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return N; }
+
+  private:
+    // Producer and consumer indices live on separate cache lines so the two
+    // threads don't false-share.
+    alignas(64) std::atomic<size_t> m_head{0};
+    alignas(64) std::atomic<size_t> m_tail{0};
+    std::array<T, N> m_slots{};
+};
+
+//  Messages
+
+/// Longest dispatcher argument that fits in a queued message.
+inline constexpr size_t MAX_MESSAGE_ARG = 119;
+
+/// A fixed-size, trivially copyable command for the daemon.
+///
+/// Messages are kept structured (rather than pre-encoded JSON) so the
+/// writer thread does the formatting and swipe updates can be merged.
+struct PluginMessage {
+    MessageKind kind    = MessageKind::SwipeEnd;
+    uint8_t     argLen  = 0;
+    uint32_t    fingers = 0;
+    uint32_t    timeMs  = 0; ///< Input event timestamp (swipe updates)
+    uint64_t    enqueuedNs = 0; ///< nowNs() at enqueue when instrumented, else 0
+    uint64_t    sentNs  = 0; ///< nowNs() when the writer sent a traced swipe update, else 0
+    uint32_t    seq     = 0; ///< Acknowledgement id (acks.hpp), 0 = none
+    uint32_t    repeat  = 0; ///< Go: further presses folded into this one (SendQueue)
+    double      dx      = 0.0;
+    double      dy      = 0.0;
+    uint32_t    grid[4] = {}; ///< SyncGrid: cols, rows, col, row
+    char        arg[MAX_MESSAGE_ARG + 1] = {};
+
+    /// Message carrying a raw dispatcher argument.  Returns false if `arg`
+    /// is too long to queue.
+    static bool withArg(MessageKind kind, std::string_view arg, PluginMessage& out) {
+        if (arg.size() > MAX_MESSAGE_ARG)
+            return false;
+        out        = PluginMessage{};
+        out.kind   = kind;
+        out.argLen = static_cast<uint8_t>(arg.size());
+        std::memcpy(out.arg, arg.data(), arg.size());
+        return true;
+    }
+
+    static PluginMessage simple(MessageKind kind) {
+        PluginMessage m;
+        m.kind = kind;
+        return m;
+    }
+
+    static PluginMessage syncGrid(uint32_t cols, uint32_t rows, uint32_t col, uint32_t row) {
+        PluginMessage m;
+        m.kind    = MessageKind::SyncGrid;
+        m.grid[0] = cols;
+        m.grid[1] = rows;
+        m.grid[2] = col;
+        m.grid[3] = row;
+        return m;
+    }
+
+    static PluginMessage swipeBegin(uint32_t fingers) {
+        PluginMessage m;
+        m.kind    = MessageKind::SwipeBegin;
+        m.fingers = fingers;
+        return m;
+    }
+
+    static PluginMessage swipeUpdate(uint32_t fingers, double dx, double dy, uint32_t timeMs = 0) {
+        PluginMessage m;
+        m.kind    = MessageKind::SwipeUpdate;
+        m.fingers = fingers;
+        m.timeMs  = timeMs;
+        m.dx      = dx;
+        m.dy      = dy;
+        return m;
+    }
+
+    /// Release velocity in pixels per second, carried in `dx` / `dy`.
+    static PluginMessage swipeVelocity(double vx, double vy) {
+        PluginMessage m;
+        m.kind = MessageKind::SwipeVelocity;
+        m.dx   = vx;
+        m.dy   = vy;
+        return m;
+    }
+
+    std::string_view argument() const { return {arg, argLen}; }
+};
+
+/// Commands the writer asks the daemon to acknowledge: the dispatchers'
+/// (commands.hpp).  Swipes are too frequent, and their outcome shows on
+/// screen anyway.
+inline bool wantsAck(MessageKind kind) {
+    return commandFor(kind) != nullptr;
+}
+
+/// Buffer size that fits the JSON of any queued message.
+inline constexpr size_t MESSAGE_JSON_CAPACITY = std::max(commandJsonCapacity(MAX_MESSAGE_ARG), SWIPE_JSON_CAPACITY);
+
+/// `{"seq":4294967295,"cmd":` plus the closing brace of a sequenced line.
+inline constexpr size_t SEQUENCED_JSON_OVERHEAD = 25 + 1;
+
+/// Buffer size `encodeMessage()` works in: any message, sequenced, with
+/// its newline.
+inline constexpr size_t ENCODED_MESSAGE_CAPACITY = SEQUENCED_JSON_OVERHEAD + MESSAGE_JSON_CAPACITY + 1;
+
+/// Write a queued message as the daemon's JSON wire format into `out`
+/// (at least `MESSAGE_JSON_CAPACITY` bytes).
+inline std::string_view formatMessageJson(std::span<char> out, const PluginMessage& m) {
+    std::string_view command;
+    const bool       isCommand = visitCommand(m.kind, [&](auto row) {
+        command = formatCommandJson<decltype(row)::value>(out, m.argument());
+    });
+    if (isCommand)
+        return command;
+    switch (m.kind) {
+        case MessageKind::SyncGrid: return formatSyncGridJson(out, m.grid[0], m.grid[1], m.grid[2], m.grid[3]);
+        case MessageKind::AttachOverlay: return formatAttachOverlayJson(out);
+        case MessageKind::AttachGestures: return formatAttachGesturesJson(out);
+        case MessageKind::SwipeBegin: return formatSwipeBeginJson(out, m.fingers);
+        case MessageKind::SwipeUpdate:
+            if (m.sentNs)
+                return formatTracedSwipeUpdateJson(out, m.fingers, m.dx, m.dy, m.timeMs, m.sentNs);
+            return formatSwipeUpdateJson(out, m.fingers, m.dx, m.dy);
+        case MessageKind::SwipeVelocity: return formatSwipeVelocityJson(out, m.dx, m.dy);
+        case MessageKind::SwipeEnd: return formatSwipeEndJson(out);
+        default: break; // dispatcher commands, above
+    }
+    return {};
+}
+
+/// Encode a queued message as the daemon's JSON wire format.
+inline std::string buildMessageJson(const PluginMessage& m) {
+    return formatToString(MESSAGE_JSON_CAPACITY, [&](std::span<char> out) { return formatMessageJson(out, m); });
+}
+
+/// Encode a queued message as one binary frame (see protocol.hpp).  With
+/// `parsed` (version-2 connections), dispatcher commands go out with their
+/// argument pre-parsed where it parses.
+/// A `go` with folded presses becomes one `GoN` frame there; callers
+/// check `goesAsOneFrame()` first.
+inline void buildMessageFrame(const PluginMessage& m, std::string& out, ParsedFrameCache* parsed = nullptr) {
+    out.clear();
+    if (parsed) {
+        if (const auto frame = parsed->lookup(m.kind, m.argument()).view(); !frame.empty()) {
+            if (m.repeat && m.kind == MessageKind::Go) {
+                putFrameHeader(out, Op::GoN, 5);
+                out += frame[2]; // the direction code
+                putU32(out, m.repeat + 1);
+            } else {
+                out.assign(frame);
+            }
+            return;
+        }
+    }
+    if (visitCommand(m.kind, [&](auto row) { putCommandFrame<decltype(row)::value>(out, m.argument()); }))
+        return;
+    switch (m.kind) {
+        case MessageKind::SyncGrid:
+            putFrameHeader(out, Op::SyncGrid, sizeof(m.grid));
+            for (uint32_t v : m.grid)
+                putU32(out, v);
+            break;
+        case MessageKind::AttachOverlay: putFrameHeader(out, Op::AttachOverlay, 0); break;
+        case MessageKind::AttachGestures: putFrameHeader(out, Op::AttachGestures, 0); break;
+        case MessageKind::SwipeBegin:
+            putFrameHeader(out, Op::SwipeBegin, 4);
+            putU32(out, m.fingers);
+            break;
+        case MessageKind::SwipeUpdate:
+            putFrameHeader(out, Op::SwipeUpdate, SWIPE_UPDATE_PAYLOAD);
+            putU32(out, m.fingers);
+            putF64(out, m.dx);
+            putF64(out, m.dy);
+            putU32(out, m.timeMs);
+            putU64(out, m.sentNs);
+            break;
+        case MessageKind::SwipeVelocity:
+            putFrameHeader(out, Op::SwipeVelocity, 16);
+            putF64(out, m.dx);
+            putF64(out, m.dy);
+            break;
+        case MessageKind::SwipeEnd: putFrameHeader(out, Op::SwipeEnd, 0); break;
+        default: break; // dispatcher commands, above
+    }
+}
+
+/// True if `m` encodes as one frame or line.  A `go` with folded presses
+/// only does as a `GoN` of a version-2 connection (`parsed`) whose
+/// direction parses; elsewhere every press goes out on its own.
+inline bool goesAsOneFrame(const PluginMessage& m, WireFormat format, ParsedFrameCache* parsed) {
+    return !m.repeat || (format == WireFormat::Binary && parsed && !parsed->lookup(m.kind, m.argument()).view().empty());
+}
+
+/// encodeMessage() of a message that goes as one frame or line (see
+/// goesAsOneFrame()).
+inline void encodeSingleMessage(const PluginMessage& m, WireFormat format, std::string& out, ParsedFrameCache* parsed) {
+    if (format == WireFormat::Binary) {
+        buildMessageFrame(m, out, parsed);
+        if (m.seq) {
+            const size_t inner = out.size();
+            out.insert(0, 6, '\0');
+            out[0] = static_cast<char>(Op::Sequenced);
+            out[1] = static_cast<char>(static_cast<uint8_t>(4 + inner));
+            for (int i = 0; i < 4; ++i)
+                out[2 + i] = static_cast<char>((m.seq >> (8 * i)) & 0xff);
+        }
+        return;
+    }
+    // `out` is reused by the caller, so after the first message these
+    // resizes stay within its capacity and never allocate.
+    out.resize(ENCODED_MESSAGE_CAPACITY);
+    size_t len = 0;
+    if (m.seq) {
+        constexpr std::string_view open = "{\"seq\":";
+        std::memcpy(out.data(), open.data(), open.size());
+        len = static_cast<size_t>(std::to_chars(out.data() + open.size(), out.data() + open.size() + 10, m.seq).ptr - out.data());
+        constexpr std::string_view cmd = ",\"cmd\":";
+        std::memcpy(out.data() + len, cmd.data(), cmd.size());
+        len += cmd.size();
+    }
+    const auto json = formatMessageJson(std::span<char>(out).subspan(len, MESSAGE_JSON_CAPACITY), m);
+    if (json.empty()) {
+        // Didn't fit: send nothing rather than a line cut short.
+        out.clear();
+        return;
+    }
+    len += json.size();
+    if (m.seq)
+        out[len++] = '}';
+    out[len] = '\n';
+    out.resize(len + 1);
+}
+
+/// Encode a queued message for `format`, including the JSON newline.
+/// Messages with a `seq` are wrapped as sequenced commands (acks.hpp).
+/// `parsed` is as for buildMessageFrame() and ignored for JSON.  Folded
+/// presses that can't go as one `GoN` are written out one after another,
+/// the `seq` (and so the acknowledgement) on the last.
+inline void encodeMessage(const PluginMessage& m, WireFormat format, std::string& out, ParsedFrameCache* parsed = nullptr) {
+    if (goesAsOneFrame(m, format, parsed)) {
+        encodeSingleMessage(m, format, out, parsed);
+        return;
+    }
+    PluginMessage press = m;
+    press.repeat        = 0;
+    press.seq           = 0;
+    std::string one;
+    out.clear();
+    for (uint32_t i = 0; i <= m.repeat; ++i) {
+        if (i == m.repeat)
+            press.seq = m.seq;
+        encodeSingleMessage(press, format, one, parsed);
+        out += one;
+    }
+}
+
+/// A command the daemon answered with an error, as handed to the main thread.
+using AckFailure = AckResult<PluginMessage>;
+
+/// Notification text for a failed command, e.g.
+/// `go right failed: no active monitor (daemon 0.1 ms, round trip 0.4 ms)`.
+inline std::string describeAckFailure(const AckFailure& f) {
+    const CommandSpec* spec = commandFor(f.msg.kind);
+    std::string        out(spec ? spec->dispatcher : "command");
+    if (f.msg.argLen)
+        out += " " + std::string(f.msg.argument());
+    out += " failed: " + std::string(f.errorText().empty() ? "unknown error" : f.errorText());
+    char times[64];
+    snprintf(times, sizeof(times), " (daemon %.1f ms, round trip %.1f ms)", f.handleNs / 1e6, f.roundTripNs / 1e6);
+    return out + times;
+}
+
+//  Send queue
+
+/// What `SendQueue::enqueue()` does when the ring is full.
+enum class FullPolicy {
+    /// Discard the new message.
+    Drop,
+    /// Swipe updates stop short of the last SEND_QUEUE_RESERVED slots and
+    /// are merged into one pending update (summing the deltas) instead.
+    /// The next other message queues it ahead of itself in the reserved
+    /// slots, so a gesture's SwipeEnd still goes out and flushes it.  Only
+    /// when even those are full is that message discarded, together with
+    /// the pending update, whose motion must not surface in a later gesture.
+    Coalesce,
+};
+
+/// Parse the `queue_full_policy` config value ("drop" / "coalesce").
+/// Unknown values fall back to `Coalesce`.
+inline FullPolicy parseFullPolicy(std::string_view s) {
+    return trimView(s) == "drop" ? FullPolicy::Drop : FullPolicy::Coalesce;
+}
+
+/// Messages the ring can hold before the full policy kicks in.
+inline constexpr size_t SEND_QUEUE_CAPACITY = 256;
+
+/// Slots swipe updates leave free under the coalesce policy, for what must
+/// not be merged: the pending update itself, SwipeBegin / SwipeEnd and
+/// dispatcher commands.
+inline constexpr size_t SEND_QUEUE_RESERVED = 32;
+
+/// After the socket appears the daemon may not be listening yet (bind
+/// comes before listen): retry the connect this often...
+inline constexpr int RECONNECT_RETRY_MS = 20;
+/// ...this many times.
+inline constexpr int RECONNECT_RETRIES = 25;
+/// Without inotify, retry the connect this often while disconnected.
+inline constexpr int RECONNECT_POLL_MS = 1000;
+
+/// Most presses folded into one `go`: a held key never fills the ring
+/// faster than that, and bounds the fallback of writing them out one by one.
+inline constexpr uint32_t MAX_FOLDED_REPEATS = SEND_QUEUE_CAPACITY;
+
+/// Dispatcher commands held for replay while the daemon is away or busy; beyond
+/// that the oldest is given up.
+inline constexpr size_t REPLAY_CAPACITY = 32;
+/// Held commands older than this when the daemon comes back are given up:
+/// a restart takes far less, and a keybind firing long after it was
+/// pressed is worse than one that didn't.
+inline constexpr uint64_t REPLAY_WINDOW_MS = 5000;
+
+/// Held for replay when the daemon is away or busy: the dispatchers'
+/// commands.
+/// Swipes only start while the daemon is alive, and replaying one's motion
+/// after the fingers lifted would be wrong.
+inline bool wantsReplay(MessageKind kind) {
+    return commandFor(kind) != nullptr;
+}
+
+/// How the writer sets up each connection, from the plugin's config.
+struct QueueSettings {
+    /// Sent first on every connection, ahead of anything queued.
+    std::vector<PluginMessage> greeting{};
+    /// Format to negotiate (falls back to JSON if the daemon declines).
+    WireFormat format = WireFormat::Json;
+    /// Ask the daemon to acknowledge dispatcher commands (see acks.hpp).
+    bool acks = false;
+    /// Offer the swipe channel (`setSwipeChannel()`) on binary connections.
+    bool swipeChannel = false;
+};
+
+/// Ring buffer plus writer thread that owns the daemon connection.
+///
+/// `enqueue()` is the producer side and must only be called from one
+/// thread (Hyprland's main thread).  It never blocks and never performs
+/// socket I/O.  Everything else is safe to call from any thread.
+class SendQueue {
+  public:
+    SendQueue() = default;
+    SendQueue(const SendQueue&)            = delete;
+    SendQueue& operator=(const SendQueue&) = delete;
+    ~SendQueue() { stop(); }
+
+    /// Record queue-wait and socket-write latencies of instrumented messages
+    /// (those with `enqueuedNs` set) into `stats`.  Call before `start()`.
+    void setStats(PluginStats* stats) { m_stats = stats; }
+
+    /// The channel to offer the daemon on binary connections while
+    /// `QueueSettings::swipeChannel` is on (see
+    /// DaemonConnection::setSwipeChannel).  Call before `start()`.
+    void setSwipeChannel(SwipeChannel* channel) { m_swipeChannel = channel; }
+
+    /// Set up connections as `settings` says.  Safe at any time and from
+    /// any thread: the writer takes it before its next connect, and drops a
+    /// connection set up differently, so the next one greets the daemon
+    /// anew (e.g. after a config reload).
+    void configure(const QueueSettings& settings) {
+        ConnectionSetup setup{.format = settings.format, .acks = settings.acks, .swipeChannel = settings.swipeChannel};
+        std::string     out;
+        for (const auto& msg : settings.greeting) {
+            encodeMessage(msg, WireFormat::Json, out);
+            setup.greetingJson += out;
+            encodeMessage(msg, WireFormat::Binary, out);
+            setup.greetingFrame += out;
+        }
+        {
+            std::lock_guard lock(m_setupMutex);
+            m_pendingSetup = std::move(setup);
+        }
+        m_reconfigured.store(true, std::memory_order_release);
+        wake();
+    }
+
+    /// Health counters of the writer's daemon connection.
+    const ConnectionStats& connectionStats() const { return m_conn.stats(); }
+
+    /// Acknowledgement counters.
+    const AckStats& ackStats() const { return m_acks.stats(); }
+
+    /// Readable (an eventfd) when failures are waiting in `popAckFailure()`;
+    /// -1 before `start()`.  The reader drains it.
+    int ackFailureFd() const { return m_failureFd; }
+
+    /// Take the oldest failure the daemon reported.  Only call from one
+    /// thread (Hyprland's main thread).
+    bool popAckFailure(AckFailure& out) { return m_failures.pop(out); }
+
+    /// Start the writer thread, connecting to the daemon socket at `path`
+    /// as `configure()` says.
+    void start(const std::string& path) {
+        stop();
+        m_stop.store(false, std::memory_order_relaxed);
+        m_wakeFd    = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        m_failureFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        m_writer    = std::thread([this, path] { run(path); });
+    }
+
+    /// Stop the writer thread.  Messages still queued are discarded.
+    void stop() {
+        if (!m_writer.joinable())
+            return;
+        m_stop.store(true, std::memory_order_relaxed);
+        wake();
+        m_writer.join();
+        for (int* fd : {&m_wakeFd, &m_failureFd}) {
+            if (*fd >= 0)
+                close(*fd);
+            *fd = -1;
+        }
+    }
+
+    /// Queue `msg` for the daemon.  Returns false if it had to be dropped.
+    bool enqueue(const PluginMessage& msg, FullPolicy policy) {
+        if (msg.kind == MessageKind::SwipeUpdate && policy == FullPolicy::Coalesce)
+            return enqueueUpdate(msg);
+        // A carried-over coalesced update must go out before anything newer.
+        if (m_hasCarry) {
+            m_hasCarry = false;
+            if (!m_ring.push(m_carry)) {
+                // Not even the reserved slots are free: give up both, so
+                // the update's motion can't surface in a later gesture.
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return drop();
+            }
+        }
+        if (m_ring.push(msg)) {
+            wake();
+            return true;
+        }
+        return drop();
+    }
+
+    /// Ask the writer to (re)connect now, without sending anything.
+    void poke() { wake(); }
+
+    /// True while the writer has a working connection to the daemon; false
+    /// after a connect or write failure or once the daemon hung up.  A
+    /// plain atomic load, cheap enough for every swipeBegin.
+    bool daemonAlive() const { return m_alive.load(std::memory_order_acquire); }
+
+    /// Messages discarded because the ring was full.
+    uint64_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    /// Swipe updates merged into a pending update because the ring was full.
+    uint64_t coalesced() const { return m_coalesced.load(std::memory_order_relaxed); }
+
+    /// Messages the writer failed to deliver to the daemon (held commands
+    /// count once they are given up).
+    uint64_t sendFailures() const { return m_sendFailures.load(std::memory_order_relaxed); }
+
+    /// Commands held while the daemon was away and delivered once it was back.
+    uint64_t replayed() const { return m_replayed.load(std::memory_order_relaxed); }
+
+    /// `go` presses folded into the one queued ahead of them.
+    uint64_t folded() const { return m_folded.load(std::memory_order_relaxed); }
+
+    /// Messages currently waiting in the ring.
+    size_t queued() const { return m_ring.size(); }
+
+  private:
+    bool drop() {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /// A swipe update under the coalesce policy: queued while it leaves the
+    /// reserved slots free, merged into the pending update otherwise.
+    bool enqueueUpdate(const PluginMessage& msg) {
+        const bool room = m_ring.size() < SEND_QUEUE_CAPACITY - SEND_QUEUE_RESERVED;
+        if (!m_hasCarry) {
+            if (room && m_ring.push(msg)) {
+                wake();
+                return true;
+            }
+            m_carry    = msg;
+            m_hasCarry = true;
+        } else {
+            m_carry.dx += msg.dx;
+            m_carry.dy += msg.dy;
+            m_carry.fingers = msg.fingers;
+            m_carry.timeMs  = msg.timeMs;
+            if (room && m_ring.push(m_carry)) {
+                m_hasCarry = false;
+                wake();
+            }
+        }
+        m_coalesced.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /// Ring the writer's eventfd if it is asleep (or about to be).  The
+    /// fences pair with the writer's: either it sees the new message
+    /// before sleeping, or we see it sleeping and ring.
+    void wake() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_relaxed) && m_sleeping.exchange(false, std::memory_order_acq_rel)) {
+            const uint64_t one = 1;
+            (void)!write(m_wakeFd, &one, sizeof(one));
+        }
+    }
+
+    /// Number the next acknowledged command (never 0).
+    uint32_t nextSeq() {
+        if (++m_seq == 0)
+            ++m_seq;
+        return m_seq;
+    }
+
+    /// Forget pending commands once their connection has been replaced;
+    /// the new one will never answer them.
+    void trackConnection() {
+        const uint64_t connects = m_conn.stats().connects.load(std::memory_order_relaxed);
+        if (connects != m_ackConnects) {
+            m_acks.reset();
+            m_ackConnects = connects;
+        }
+    }
+
+    /// Match one reply line from the daemon.
+    void onReply(std::string_view line) {
+        const auto result = m_acks.received(line, nowNs());
+        if (!result)
+            return;
+        if (m_stats && result->msg.enqueuedNs) {
+            m_stats->ackRoundTrip.record(result->roundTripNs);
+            m_stats->ackHandling.record(result->handleNs);
+        }
+        if (!result->ok && m_failures.push(*result)) {
+            const uint64_t one = 1;
+            (void)!write(m_failureFd, &one, sizeof(one));
+        }
+    }
+
+    /// Send `msg` on the writer's connection.  Returns false if it was not
+    /// delivered.
+    bool send(PluginMessage& msg) {
+        DaemonConnection& conn  = m_conn;
+        const bool        timed = m_stats && msg.enqueuedNs;
+        if (timed)
+            m_stats->queueWait.record(nowNs() - msg.enqueuedNs);
+        // Swipe updates from real input events carry that event's
+        // timestamp; stamping the send time next to it lets the
+        // daemon split end-to-end latency into stages.
+        if (msg.kind == MessageKind::SwipeUpdate && msg.timeMs)
+            msg.sentNs = nowNs();
+        // The connection may be re-opened mid-send without acks.
+        const uint32_t seq = conn.acksWanted() && wantsAck(msg.kind) ? nextSeq() : 0;
+        SendResult     result;
+        {
+            ScopedTimer timer(timed ? &m_stats->socketWrite : nullptr);
+            result = conn.sendEncoded([&](WireFormat f, std::string& out) {
+                msg.seq = conn.acks() ? seq : 0;
+                encodeMessage(msg, f, out, conn.parsedArgs() ? &m_parsedFrames : nullptr);
+            });
+        }
+        const bool ok = result == SendResult::Sent;
+        if (seq) {
+            trackConnection();
+            if (ok && msg.seq)
+                m_acks.sent(msg, nowNs());
+        }
+        // A busy daemon is still there: only a lost connection clears it.
+        m_alive.store(result != SendResult::Failed, std::memory_order_release);
+        return ok;
+    }
+
+    /// Fold the presses of the same `go` waiting right behind `msg` into it.
+    void foldRepeats(PluginMessage& msg) {
+        if (msg.kind != MessageKind::Go)
+            return;
+        while (const PluginMessage* next = m_ring.front()) {
+            if (next->kind != msg.kind || next->argument() != msg.argument() || msg.repeat >= MAX_FOLDED_REPEATS)
+                break;
+            PluginMessage press;
+            m_ring.pop(press);
+            ++msg.repeat;
+            m_folded.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /// Hold `msg` for replay, giving up the oldest held command if full.
+    void hold(const PluginMessage& msg) {
+        if (m_heldCount == REPLAY_CAPACITY) {
+            m_heldStart = (m_heldStart + 1) % REPLAY_CAPACITY;
+            --m_heldCount;
+            m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_held[(m_heldStart + m_heldCount++) % REPLAY_CAPACITY] = Held{.msg = msg, .heldNs = nowNs()};
+    }
+
+    /// Send the held commands, oldest first, dropping those past
+    /// REPLAY_WINDOW_MS.  Stops at the first one the daemon doesn't take;
+    /// returns false then.
+    bool replay() {
+        const uint64_t now = nowNs();
+        while (m_heldCount) {
+            Held& held = m_held[m_heldStart];
+            if (now - held.heldNs <= REPLAY_WINDOW_MS * 1'000'000) {
+                if (!send(held.msg))
+                    return false;
+                m_replayed.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_heldStart = (m_heldStart + 1) % REPLAY_CAPACITY;
+            --m_heldCount;
+        }
+        return true;
+    }
+
+    /// Take the latest `configure()` (writer only).  A connection set up
+    /// differently is dropped; the loop reconnects right away.
+    void applySetup() {
+        ConnectionSetup setup;
+        {
+            std::lock_guard lock(m_setupMutex);
+            setup = m_pendingSetup;
+        }
+        if (setup == m_setup)
+            return;
+        m_setup = std::move(setup);
+        m_conn.disconnect();
+        m_conn.setGreeting(m_setup.greetingJson, m_setup.greetingFrame);
+        m_conn.setPreferredFormat(m_setup.format);
+        m_conn.setAcks(m_setup.acks);
+        m_conn.setSwipeChannel(m_setup.swipeChannel ? m_swipeChannel : nullptr);
+        m_alive.store(false, std::memory_order_release);
+    }
+
+    void run(const std::string& path) {
+        DaemonConnection& conn = m_conn;
+        conn.setPath(path);
+        SocketWatch watch;
+        const bool  watching = watch.open(path);
+        int         retries  = 0; // connect retries left since the socket appeared
+
+        while (!m_stop.load(std::memory_order_relaxed)) {
+            if (m_reconfigured.exchange(false, std::memory_order_acq_rel))
+                applySetup();
+            // Held commands go first once the daemon is back.
+            const bool caughtUp = m_heldCount == 0 || (conn.connected() && replay());
+            PluginMessage msg;
+            if (m_ring.pop(msg)) {
+                foldRepeats(msg);
+                if (!caughtUp && wantsReplay(msg.kind)) {
+                    // Keep the order: behind what is already held.
+                    hold(msg);
+                } else if (!send(msg)) {
+                    // Away or just not draining its socket: either way a
+                    // command waits for the next writable turn.
+                    if (wantsReplay(msg.kind))
+                        hold(msg);
+                    else
+                        m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+                }
+                continue;
+            }
+            if (!conn.connected()) {
+                const bool ok = conn.connect();
+                m_alive.store(ok, std::memory_order_release);
+                if (ok) {
+                    retries = 0;
+                    if (m_heldCount)
+                        continue; // replay before sleeping
+                }
+            }
+
+            // Announce the sleep, then re-check for work that raced with it.
+            m_sleeping.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!m_ring.empty() || m_stop.load(std::memory_order_relaxed) ||
+                m_reconfigured.load(std::memory_order_relaxed)) {
+                m_sleeping.store(false, std::memory_order_relaxed);
+                continue;
+            }
+
+            struct pollfd fds[3];
+            nfds_t        n = 0;
+            fds[n++]        = {.fd = m_wakeFd, .events = POLLIN, .revents = 0};
+            const nfds_t watchAt = n;
+            if (watching && !conn.connected())
+                fds[n++] = {.fd = watch.fd(), .events = POLLIN, .revents = 0};
+            const nfds_t connAt = n;
+            if (conn.connected()) {
+                // Held commands on an open connection wait for room to write.
+                const short events = POLLIN | POLLRDHUP | (m_heldCount ? POLLOUT : 0);
+                fds[n++]           = {.fd = conn.fd(), .events = events, .revents = 0};
+            }
+            int timeout = -1;
+            if (retries > 0)
+                timeout = RECONNECT_RETRY_MS;
+            else if (!conn.connected() && !watching)
+                timeout = RECONNECT_POLL_MS;
+            else if (m_wakeFd < 0)
+                timeout = RECONNECT_RETRY_MS; // no doorbell: poll the ring
+
+            const int ready = poll(fds, n, timeout);
+            m_sleeping.store(false, std::memory_order_relaxed);
+            uint64_t drained;
+            while (m_wakeFd >= 0 && read(m_wakeFd, &drained, sizeof(drained)) > 0) {}
+            if (ready == 0 && retries > 0)
+                --retries;
+            if (ready <= 0)
+                continue;
+            if (watchAt < connAt && fds[watchAt].revents && watch.consume())
+                retries = RECONNECT_RETRIES;
+            if (connAt < n && fds[connAt].revents &&
+                !conn.checkIdle([this](std::string_view line) { onReply(line); })) {
+                // The daemon went away; try right away in case it already
+                // restarted, otherwise wait for its socket to reappear.
+                m_alive.store(false, std::memory_order_release);
+            }
+        }
+        conn.disconnect();
+        m_alive.store(false, std::memory_order_release);
+    }
+
+    SpscRing<PluginMessage, SEND_QUEUE_CAPACITY> m_ring;
+
+    // Producer-only state (coalesce policy).
+    PluginMessage m_carry;
+    bool          m_hasCarry = false;
+
+    int                   m_wakeFd = -1; ///< eventfd doorbell of the writer
+    std::atomic<bool>     m_sleeping{false};
+    std::atomic<bool>     m_stop{false};
+    std::atomic<bool>     m_alive{false};
+    std::atomic<uint64_t> m_dropped{0};
+    std::atomic<uint64_t> m_coalesced{0};
+    std::atomic<uint64_t> m_sendFailures{0};
+    std::atomic<uint64_t> m_replayed{0};
+    std::atomic<uint64_t> m_folded{0};
+    PluginStats*          m_stats        = nullptr;
+    SwipeChannel*         m_swipeChannel = nullptr;
+    ParsedFrameCache      m_parsedFrames; ///< Writer-only
+
+    // Commands held while the daemon is away (writer-only), a ring.
+    struct Held {
+        PluginMessage msg;
+        uint64_t      heldNs = 0;
+    };
+    std::array<Held, REPLAY_CAPACITY> m_held{};
+    size_t                            m_heldStart = 0;
+    size_t                            m_heldCount = 0;
+
+    // Acknowledgements (writer-only, except the failure ring's consumer).
+    AckTracker<PluginMessage>     m_acks;
+    SpscRing<AckFailure, 16>      m_failures;
+    int                           m_failureFd   = -1; ///< eventfd: failures waiting
+    uint32_t                      m_seq         = 0;
+    uint64_t                      m_ackConnects = 0; ///< connects count m_acks belongs to
+
+    // Connection setup: encoded from configure(), taken by the writer.
+    struct ConnectionSetup {
+        std::string greetingJson{};
+        std::string greetingFrame{};
+        WireFormat  format       = WireFormat::Json;
+        bool        acks         = false;
+        bool        swipeChannel = false;
+
+        bool operator==(const ConnectionSetup&) const = default;
+    };
+    std::mutex        m_setupMutex;
+    ConnectionSetup   m_pendingSetup; ///< Guarded by m_setupMutex
+    ConnectionSetup   m_setup;        ///< Writer-only: what the connection uses
+    std::atomic<bool> m_reconfigured{false};
+
+    DaemonConnection      m_conn; ///< Only touched by the writer thread (except stats()).
+    std::thread           m_writer;
+};
@@ -0,0 +1,141 @@
+// stats.hpp — Optional latency instrumentation for the hyprgrd plugin.
+//
+// Records how long the plugin spends inside Hyprland's callbacks (swipe
+// hooks, dispatchers) and how long messages then wait in the send queue and
+// in the socket write, into lock-free log2 histograms.  Comparing those
+// tells whether input latency comes from the plugin, the socket or the
+// daemon.
+//
+// Recording is a couple of relaxed atomic increments, safe from any thread.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+/// Monotonic timestamp in nanoseconds.  On Linux steady_clock is
+/// CLOCK_MONOTONIC — the clock libinput's event `timeMs` and the daemon's
+/// latency traces use — so these timestamps compare across processes.
+inline uint64_t nowNs() {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+}
+
+/// Lock-free histogram of durations with power-of-two buckets.
+///
+/// Bucket `b` counts durations whose bit width is `b`, i.e. values in
+/// `[2^(b-1), 2^b)` ns (bucket 0 holds exact zeros), so percentiles are
+/// reported as the bucket's upper bound — within a factor of two.
+class LatencyHistogram {
+  public:
+    static constexpr size_t BUCKETS = 40; ///< Up to ~9 minutes; longer saturates.
+
+    void record(uint64_t ns) {
+        size_t b = std::bit_width(ns);
+        if (b >= BUCKETS)
+            b = BUCKETS - 1;
+        m_buckets[b].fetch_add(1, std::memory_order_relaxed);
+        m_count.fetch_add(1, std::memory_order_relaxed);
+        m_sumNs.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t prev = m_maxNs.load(std::memory_order_relaxed);
+        while (ns > prev && !m_maxNs.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+    }
+
+    uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+    uint64_t maxNs() const { return m_maxNs.load(std::memory_order_relaxed); }
+
+    uint64_t meanNs() const {
+        const uint64_t n = count();
+        return n ? m_sumNs.load(std::memory_order_relaxed) / n : 0;
+    }
+
+    /// Upper bound (ns) of the bucket containing quantile `q` in `[0, 1]`;
+    /// 0 when nothing has been recorded.
+    uint64_t quantileNs(double q) const {
+        const uint64_t n = count();
+        if (n == 0)
+            return 0;
+        const auto rank = static_cast<uint64_t>(q * static_cast<double>(n - 1)) + 1;
+        uint64_t   seen = 0;
+        for (size_t b = 0; b < BUCKETS; ++b) {
+            seen += m_buckets[b].load(std::memory_order_relaxed);
+            if (seen >= rank)
+                return b == 0 ? 0 : (uint64_t{1} << b) - 1;
+        }
+        return maxNs();
+    }
+
+    void reset() {
+        for (auto& b : m_buckets)
+            b.store(0, std::memory_order_relaxed);
+        m_count.store(0, std::memory_order_relaxed);
+        m_sumNs.store(0, std::memory_order_relaxed);
+        m_maxNs.store(0, std::memory_order_relaxed);
+    }
+
+    /// One-line human-readable summary in microseconds.
+    std::string summary() const {
+        char buf[160];
+        snprintf(buf, sizeof(buf), "n=%llu mean=%.1fus p50<=%.1fus p99<=%.1fus max=%.1fus",
+                 static_cast<unsigned long long>(count()), meanNs() / 1e3, quantileNs(0.5) / 1e3,
+                 quantileNs(0.99) / 1e3, maxNs() / 1e3);
+        return buf;
+    }
+
+    /// JSON object with the same fields as `summary()` (nanoseconds).
+    std::string json() const {
+        char buf[192];
+        snprintf(buf, sizeof(buf), R"({"count":%llu,"mean_ns":%llu,"p50_ns":%llu,"p99_ns":%llu,"max_ns":%llu})",
+                 static_cast<unsigned long long>(count()), static_cast<unsigned long long>(meanNs()),
+                 static_cast<unsigned long long>(quantileNs(0.5)),
+                 static_cast<unsigned long long>(quantileNs(0.99)), static_cast<unsigned long long>(maxNs()));
+        return buf;
+    }
+
+  private:
+    std::array<std::atomic<uint64_t>, BUCKETS> m_buckets{};
+    std::atomic<uint64_t>                      m_count{0};
+    std::atomic<uint64_t>                      m_sumNs{0};
+    std::atomic<uint64_t>                      m_maxNs{0};
+};
+
+/// Every histogram the plugin records.
+struct PluginStats {
+    LatencyHistogram swipeBegin;   ///< Time inside the swipeBegin hook
+    LatencyHistogram swipeUpdate;  ///< Time inside the swipeUpdate hook
+    LatencyHistogram swipeEnd;     ///< Time inside the swipeEnd hook
+    LatencyHistogram dispatch;     ///< Time dispatchers spend in sendCommand
+    LatencyHistogram queueWait;    ///< Enqueue → writer picks the message up
+    LatencyHistogram socketWrite;  ///< Encoding + socket write on the writer thread
+    LatencyHistogram ackRoundTrip; ///< Send → acknowledgement (acks.hpp)
+    LatencyHistogram ackHandling;  ///< Handling time reported in acknowledgements
+
+    void reset() {
+        for (auto* h : {&swipeBegin, &swipeUpdate, &swipeEnd, &dispatch, &queueWait, &socketWrite, &ackRoundTrip,
+                        &ackHandling})
+            h->reset();
+    }
+};
+
+/// Records the lifetime of the scope into a histogram; no-op when given
+/// nullptr (instrumentation disabled), so the clock isn't even read.
+class ScopedTimer {
+  public:
+    explicit ScopedTimer(LatencyHistogram* hist) : m_hist(hist), m_start(hist ? nowNs() : 0) {}
+    ScopedTimer(const ScopedTimer&)            = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+    ~ScopedTimer() {
+        if (m_hist)
+            m_hist->record(nowNs() - m_start);
+    }
+
+  private:
+    LatencyHistogram* m_hist;
+    uint64_t          m_start;
+};
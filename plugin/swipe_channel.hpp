@@ -0,0 +1,202 @@
+// swipe_channel.hpp — Shared-memory swipe channel from the plugin to the daemon.
+//
+// Mirrors src/ipc/swipe_channel.rs; keep the two in sync.
+//
+// Swipe updates arrive at 60–250 Hz.  Instead of one socket write per
+// update, the swipeUpdate hook adds the motion to running totals published
+// in a seqlock slot inside a memfd, and rings an eventfd doorbell only
+// when the daemon has already consumed the previous value — while the
+// daemon is busy, further updates cost no syscall at all.  The daemon
+// reads the latest totals once per wakeup.
+//
+// SwipeBegin / SwipeEnd stay on the socket and order the channel: the
+// daemon starts following a gesture when it sees SwipeBegin and drains
+// the slot once more before acting on SwipeEnd.
+//
+// Both fds are handed to the daemon with SCM_RIGHTS on an
+// `Op::AttachSwipeChannel` frame right after the binary handshake
+// (connection.hpp); the daemon answers `OK shm`.
+
+#pragma once
+
+#include "stats.hpp"
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+inline constexpr uint32_t SWIPE_CHANNEL_MAGIC   = 0x57534748; ///< "HGSW"
+inline constexpr uint32_t SWIPE_CHANNEL_VERSION = 1;
+/// Size of the memfd (one page; the slot uses the first 64 bytes).
+inline constexpr size_t SWIPE_CHANNEL_SIZE = 4096;
+
+/// The shared slot.  Every field is written by the plugin only, except
+/// `readerSeq`, which only the daemon writes.
+///
+/// `seq` is odd while the plugin is writing; a reader copies the fields
+/// between two equal, even reads of it.  `dx` / `dy` are the gesture's
+/// totals since SwipeBegin, as f64 bits.
+struct SwipeSlot {
+    std::atomic<uint32_t> magic;
+    std::atomic<uint32_t> version;
+    std::atomic<uint32_t> seq;
+    std::atomic<uint32_t> readerSeq; ///< Last `seq` the daemon consumed
+    std::atomic<uint32_t> gesture;   ///< Bumped at every SwipeBegin
+    std::atomic<uint32_t> fingers;
+    std::atomic<uint64_t> dx;
+    std::atomic<uint64_t> dy;
+    std::atomic<uint64_t> sentNs;  ///< CLOCK_MONOTONIC publish time (0: untraced)
+    std::atomic<uint32_t> inputMs; ///< Latest input event time (0: untraced)
+    uint32_t              reserved[3];
+};
+
+static_assert(sizeof(SwipeSlot) == 64 && alignof(SwipeSlot) == 8, "layout shared with src/ipc/swipe_channel.rs");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "slot atomics must be address-free");
+
+/// A consistent copy of the slot.
+struct SwipeSnapshot {
+    uint32_t seq     = 0;
+    uint32_t gesture = 0;
+    uint32_t fingers = 0;
+    double   dx      = 0.0;
+    double   dy      = 0.0;
+    uint64_t sentNs  = 0;
+    uint32_t inputMs = 0;
+};
+
+/// Seqlock read of `slot`, as the daemon does it.
+inline SwipeSnapshot readSwipeSlot(const SwipeSlot& slot) {
+    for (;;) {
+        const uint32_t before = slot.seq.load(std::memory_order_acquire);
+        if (before & 1)
+            continue;
+        SwipeSnapshot s;
+        s.gesture = slot.gesture.load(std::memory_order_relaxed);
+        s.fingers = slot.fingers.load(std::memory_order_relaxed);
+        s.dx      = std::bit_cast<double>(slot.dx.load(std::memory_order_relaxed));
+        s.dy      = std::bit_cast<double>(slot.dy.load(std::memory_order_relaxed));
+        s.sentNs  = slot.sentNs.load(std::memory_order_relaxed);
+        s.inputMs = slot.inputMs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.seq.load(std::memory_order_relaxed) == before) {
+            s.seq = before;
+            return s;
+        }
+    }
+}
+
+/// The plugin's end of the channel: owns the memfd mapping and the
+/// doorbell.  Publishing is main-thread only; `attached()` may be read
+/// from anywhere.
+class SwipeChannel {
+  public:
+    SwipeChannel() = default;
+    SwipeChannel(const SwipeChannel&)            = delete;
+    SwipeChannel& operator=(const SwipeChannel&) = delete;
+    ~SwipeChannel() { close(); }
+
+    /// Create the memfd and eventfd.  Returns false (leaving the channel
+    /// unusable, so swipes stay on the socket) if either fails.
+    bool open() {
+        close();
+        m_memFd = memfd_create("hyprgrd-swipe", MFD_CLOEXEC);
+        if (m_memFd < 0 || ftruncate(m_memFd, SWIPE_CHANNEL_SIZE) < 0) {
+            close();
+            return false;
+        }
+        void* map = mmap(nullptr, SWIPE_CHANNEL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, m_memFd, 0);
+        m_eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (map == MAP_FAILED || m_eventFd < 0) {
+            if (map != MAP_FAILED)
+                munmap(map, SWIPE_CHANNEL_SIZE);
+            close();
+            return false;
+        }
+        // A fresh memfd is zero-filled, which is a valid initial slot.
+        m_slot = static_cast<SwipeSlot*>(map);
+        m_slot->version.store(SWIPE_CHANNEL_VERSION, std::memory_order_relaxed);
+        m_slot->magic.store(SWIPE_CHANNEL_MAGIC, std::memory_order_release);
+        return true;
+    }
+
+    void close() {
+        m_attached.store(false, std::memory_order_release);
+        if (m_slot)
+            munmap(m_slot, SWIPE_CHANNEL_SIZE);
+        if (m_memFd >= 0)
+            ::close(m_memFd);
+        if (m_eventFd >= 0)
+            ::close(m_eventFd);
+        m_slot    = nullptr;
+        m_memFd   = -1;
+        m_eventFd = -1;
+    }
+
+    bool ready() const { return m_slot != nullptr; }
+    int  memFd() const { return m_memFd; }
+    int  eventFd() const { return m_eventFd; }
+
+    /// Set by the connection once the daemon accepted the channel.
+    void setAttached(bool attached) { m_attached.store(attached && ready(), std::memory_order_release); }
+    bool attached() const { return m_attached.load(std::memory_order_acquire); }
+
+    /// Start a new gesture: bump `gesture` and zero the totals.  Must be
+    /// published before SwipeBegin is queued on the socket.
+    void begin(uint32_t fingers) {
+        m_gesture++;
+        m_dx = m_dy = 0.0;
+        publish(fingers, 0, false);
+    }
+
+    /// Add one update's motion and publish the new totals.  `timeMs` is
+    /// the input event time (0 for synthetic updates, which stay untraced).
+    void add(uint32_t fingers, double dx, double dy, uint32_t timeMs) {
+        m_dx += dx;
+        m_dy += dy;
+        publish(fingers, timeMs, true);
+    }
+
+    /// Doorbells rung so far (each one an eventfd write).
+    uint64_t doorbells() const { return m_doorbells; }
+
+    const SwipeSlot* slot() const { return m_slot; }
+    SwipeSlot*       slot() { return m_slot; }
+
+  private:
+    void publish(uint32_t fingers, uint32_t timeMs, bool ring) {
+        if (!m_slot)
+            return;
+        const uint32_t seq = m_slot->seq.load(std::memory_order_relaxed);
+        m_slot->seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_slot->gesture.store(m_gesture, std::memory_order_relaxed);
+        m_slot->fingers.store(fingers, std::memory_order_relaxed);
+        m_slot->dx.store(std::bit_cast<uint64_t>(m_dx), std::memory_order_relaxed);
+        m_slot->dy.store(std::bit_cast<uint64_t>(m_dy), std::memory_order_relaxed);
+        m_slot->sentNs.store(timeMs ? nowNs() : 0, std::memory_order_relaxed);
+        m_slot->inputMs.store(timeMs, std::memory_order_relaxed);
+        // seq_cst pairs with the daemon's store of readerSeq followed by
+        // its re-read of seq: either it sees this value, or we see that it
+        // caught up and ring.
+        m_slot->seq.store(seq + 2, std::memory_order_seq_cst);
+        if (ring && m_slot->readerSeq.load(std::memory_order_seq_cst) == seq) {
+            const uint64_t one = 1;
+            (void)!write(m_eventFd, &one, sizeof(one));
+            m_doorbells++;
+        }
+    }
+
+    SwipeSlot*        m_slot      = nullptr;
+    int               m_memFd     = -1;
+    int               m_eventFd   = -1;
+    std::atomic<bool> m_attached  = false;
+    uint32_t          m_gesture   = 0;
+    double            m_dx        = 0.0;
+    double            m_dy        = 0.0;
+    uint64_t          m_doorbells = 0;
+};
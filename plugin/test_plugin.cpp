@@ -7,12 +7,33 @@
 //   cd plugin && cmake -B build-test -DHYPRGRD_BUILD_TESTS=ON && cmake --build build-test
 //   ./build-test/test_plugin
 
+#include "acks.hpp"
+#include "coalescer.hpp"
+#include "commands.hpp"
+#include "connection.hpp"
+#include "gestures.hpp"
+#include "grid.hpp"
 #include "helpers.hpp"
+#include "overlay.hpp"
+#include "protocol.hpp"
+#include "queue.hpp"
+#include "stats.hpp"
+#include "swipe_channel.hpp"
+#include "velocity.hpp"
 
 #include <cassert>
+#include <chrono>
 #include <cstdlib>
 #include <iostream>
+#include <new>
 #include <string>
+#include <thread>
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
 
 static int tests_run    = 0;
 static int tests_passed = 0;
@@ -359,6 +380,2035 @@ TEST(dispatcher_movetomonitorindex_forwards_arg) {
     ASSERT_EQ(r.value, std::string(R"({"MoveWindowToMonitorIndex":"0"})"));
 }
 
+// ═══════════════════════════════════════════════════════════════════════════
+// hyprgrd:applygrid — argument parsing and focus ordering
+// ═══════════════════════════════════════════════════════════════════════════
+
+TEST(applygrid_parses_pairs) {
+    std::vector<WorkspaceSwitch> s;
+    ASSERT_TRUE(parseApplyGrid("  DP-1 7\tHDMI-A-1  -8 ", s));
+    ASSERT_EQ(s.size(), size_t(2));
+    ASSERT_EQ(s[0].monitor, std::string_view("DP-1"));
+    ASSERT_EQ(s[0].workspace, 7);
+    ASSERT_EQ(s[1].monitor, std::string_view("HDMI-A-1"));
+    ASSERT_EQ(s[1].workspace, -8);
+}
+
+TEST(applygrid_rejects_malformed) {
+    std::vector<WorkspaceSwitch> s;
+    ASSERT_FALSE(parseApplyGrid("", s));
+    ASSERT_FALSE(parseApplyGrid("DP-1", s));
+    ASSERT_FALSE(parseApplyGrid("DP-1 7 HDMI-A-1", s));
+    ASSERT_FALSE(parseApplyGrid("DP-1 seven", s));
+    ASSERT_FALSE(parseApplyGrid("DP-1 7x", s));
+}
+
+TEST(applygrid_focused_monitor_last) {
+    std::vector<WorkspaceSwitch> s;
+    ASSERT_TRUE(parseApplyGrid("DP-1 1 HDMI-A-1 2 DP-2 3", s));
+    focusedLast(s, "DP-1");
+    ASSERT_EQ(s[0].monitor, std::string_view("HDMI-A-1"));
+    ASSERT_EQ(s[1].monitor, std::string_view("DP-2"));
+    ASSERT_EQ(s[2].monitor, std::string_view("DP-1"));
+    focusedLast(s, "unknown");
+    ASSERT_EQ(s[2].monitor, std::string_view("DP-1"));
+}
+
+TEST(cool_parses_workspace_ids) {
+    std::vector<int> ids;
+    ASSERT_TRUE(parseWorkspaceIds(" 3\t-4  17 ", ids));
+    ASSERT_TRUE(ids == (std::vector<int>{3, -4, 17}));
+    ASSERT_FALSE(parseWorkspaceIds("", ids));
+    ASSERT_FALSE(parseWorkspaceIds("   ", ids));
+    ASSERT_FALSE(parseWorkspaceIds("3 four", ids));
+    ASSERT_FALSE(parseWorkspaceIds("3x", ids));
+}
+
+TEST(json_string_field_reads_active_workspace) {
+    // An escaped look-alike inside another value must not match.
+    const char* json = R"({"id": 3, "lastwindowtitle": "\"monitor\": \"fake\"",)"
+                       R"( "monitor": "HDMI-A-1", "monitorID": 1})";
+    ASSERT_EQ(jsonStringField(json, "monitor"), std::string_view("HDMI-A-1"));
+    ASSERT_EQ(jsonStringField(json, "missing"), std::string_view());
+    ASSERT_EQ(jsonStringField(json, "id"), std::string_view());
+    ASSERT_EQ(jsonStringField("", "monitor"), std::string_view());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// GridEngine — plugin-owned grid (mirrors src/grid.rs and src/switcher.rs)
+// ═══════════════════════════════════════════════════════════════════════════
+
+TEST(grid_direction_parsing_matches_daemon) {
+    ASSERT_TRUE(parseGridDirection("right") == GridDirection::Right);
+    ASSERT_TRUE(parseGridDirection(" Left ") == GridDirection::Left);
+    ASSERT_TRUE(parseGridDirection("up-left") == GridDirection::UpLeft);
+    ASSERT_TRUE(parseGridDirection("UpRight") == GridDirection::UpRight);
+    ASSERT_TRUE(parseGridDirection("down_right") == GridDirection::DownRight);
+    ASSERT_FALSE(parseGridDirection("sideways").has_value());
+    ASSERT_FALSE(parseGridDirection("").has_value());
+    ASSERT_FALSE(parseGridDirection("le-ft").has_value());
+}
+
+TEST(grid_step_extends_right_and_down_only) {
+    ASSERT_TRUE(stepFrom(GridDirection::Left, {0, 0}) == (GridCell{0, 0}));
+    ASSERT_TRUE(stepFrom(GridDirection::Up, {2, 0}) == (GridCell{2, 0}));
+    ASSERT_TRUE(stepFrom(GridDirection::Right, {0, 0}) == (GridCell{1, 0}));
+    ASSERT_TRUE(stepFrom(GridDirection::DownLeft, {0, 3}) == (GridCell{0, 4}));
+    ASSERT_TRUE(stepFrom(GridDirection::UpLeft, {2, 1}) == (GridCell{1, 0}));
+}
+
+// Same table as switcher.rs `workspace_ids_are_stable`.
+TEST(grid_workspace_ids_match_daemon) {
+    ASSERT_EQ(computeWorkspaceId({0, 0}, 0, 2), 1);
+    ASSERT_EQ(computeWorkspaceId({0, 0}, 1, 2), 2);
+    ASSERT_EQ(computeWorkspaceId({1, 0}, 0, 2), 3);
+    ASSERT_EQ(computeWorkspaceId({0, 1}, 0, 2), 5);
+    ASSERT_EQ(computeWorkspaceId({2, 1}, 1, 2), 16);
+    ASSERT_EQ(computeWorkspaceId({1, 1}, 2, 3), 15);
+    ASSERT_EQ(computeWorkspaceId({100000, 100000}, 0, 4), std::numeric_limits<int32_t>::max());
+}
+
+TEST(grid_engine_moves_grow_and_switch_every_monitor) {
+    GridEngine g;
+    ASSERT_FALSE(g.ready());
+    g.setMonitors({"DP-1", "HDMI-A-1"});
+    ASSERT_TRUE(g.ready());
+    g.moveTo(stepFrom(GridDirection::Right, g.cell()));
+    ASSERT_TRUE(g.state() == (GridState{.cols = 2, .rows = 1, .col = 1, .row = 0}));
+    auto s = g.switches();
+    ASSERT_EQ(s.size(), size_t(2));
+    ASSERT_EQ(s[0].monitor, std::string_view("DP-1"));
+    ASSERT_EQ(s[0].workspace, 3);
+    ASSERT_EQ(s[1].workspace, 4);
+    ASSERT_EQ(g.workspaceFor({0, 1}, "HDMI-A-1").value_or(0), 6);
+    ASSERT_FALSE(g.workspaceFor({0, 1}, "eDP-1").has_value());
+
+    // Moving back left keeps the grown dimensions; a daemon sync adopts its cell.
+    g.moveTo({0, 0});
+    ASSERT_EQ(g.state().cols, size_t(2));
+    g.sync({.cols = 3, .rows = 2, .col = 2, .row = 1});
+    ASSERT_TRUE(g.state() == (GridState{.cols = 3, .rows = 2, .col = 2, .row = 1}));
+}
+
+TEST(grid_engine_rereads_monitors_after_hotplug) {
+    GridEngine g;
+    g.setMonitors({"DP-1", "HDMI-A-1"});
+    g.moveTo({1, 1});
+    ASSERT_EQ(g.workspaceFor({1, 1}, "DP-1").value_or(0), 9);
+
+    // A monitor was plugged in: dispatchers go back to the daemon until
+    // the list is read again, then ids follow the new monitor count.
+    g.forgetMonitors();
+    ASSERT_FALSE(g.ready());
+    g.setMonitors({"DP-1", "HDMI-A-1", "eDP-1"});
+    ASSERT_TRUE(g.ready());
+    ASSERT_TRUE(g.cell() == (GridCell{1, 1}));
+    ASSERT_EQ(g.workspaceFor({1, 1}, "DP-1").value_or(0), 13);
+    ASSERT_EQ(g.switches().size(), size_t(3));
+}
+
+TEST(grid_argument_parsing) {
+    ASSERT_TRUE(parseGridCell(" 2 1 ") == (GridCell{2, 1}));
+    ASSERT_FALSE(parseGridCell("2").has_value());
+    ASSERT_FALSE(parseGridCell("2 -1").has_value());
+    ASSERT_FALSE(parseGridCell("21x 1").has_value());
+    ASSERT_TRUE(parseSyncGrid("3 2 2 1") == (GridState{.cols = 3, .rows = 2, .col = 2, .row = 1}));
+    ASSERT_FALSE(parseSyncGrid("3 2 2").has_value());
+    ASSERT_FALSE(parseSyncGrid("3 2 2 1 0").has_value());
+}
+
+TEST(grid_monitor_names_skip_nested_objects) {
+    const char* json = R"([{"id": 0, "name": "DP-1", "description": "say \"name\": x",)"
+                       R"( "activeWorkspace": {"id": 1, "name": "1"}},)"
+                       R"( {"id": 1, "name": "HDMI-A-1", "activeWorkspace": {"id": 2, "name": "2"}}])";
+    const auto names = monitorNamesFromJson(json);
+    ASSERT_EQ(names.size(), size_t(2));
+    ASSERT_EQ(names[0], std::string("DP-1"));
+    ASSERT_EQ(names[1], std::string("HDMI-A-1"));
+    ASSERT_TRUE(monitorNamesFromJson("").empty());
+}
+
+TEST(sync_grid_message_encodings) {
+    const auto m = PluginMessage::syncGrid(3, 2, 2, 1);
+    ASSERT_EQ(buildMessageJson(m), std::string(R"({"SyncGrid":{"cols":3,"rows":2,"col":2,"row":1}})"));
+    std::string frame;
+    buildMessageFrame(m, frame);
+    ASSERT_EQ(frame, std::string("\x07\x10\x03\0\0\0\x02\0\0\0\x02\0\0\0\x01\0\0\0", 18));
+}
+
+// Same cases as src/prefetch.rs.
+TEST(warm_cells_first_visit_warms_neighbours) {
+    WarmCells w;
+    const WarmChange change = w.visit({1, 1});
+    const std::vector<GridCell> expected{{1, 1}, {2, 1}, {0, 1}, {1, 2}, {1, 0}, {2, 2}, {0, 2}, {2, 0}, {0, 0}};
+    ASSERT_TRUE(change.warm == expected);
+    ASSERT_TRUE(change.cool.empty());
+    ASSERT_TRUE(w.cells().back() == (GridCell{1, 1}));
+    // Left and up stay in place at the origin.
+    WarmCells edge;
+    ASSERT_TRUE(edge.visit({0, 0}).warm == (std::vector<GridCell>{{0, 0}, {1, 0}, {0, 1}, {1, 1}}));
+}
+
+TEST(warm_cells_revisits_only_warm_what_is_new) {
+    WarmCells w;
+    w.visit({0, 0});
+    const WarmChange change = w.visit({1, 0});
+    ASSERT_TRUE(change.warm == (std::vector<GridCell>{{2, 0}, {2, 1}}));
+    ASSERT_TRUE(change.cool.empty());
+    const WarmChange back = w.visit({0, 0});
+    ASSERT_TRUE(back.warm.empty() && back.cool.empty());
+}
+
+TEST(warm_cells_cap_evicts_least_recently_visited) {
+    WarmCells w;
+    w.setCapacity(4);
+    w.visit({0, 0});
+    const WarmChange change = w.visit({3, 0});
+    ASSERT_TRUE(change.warm == (std::vector<GridCell>{{3, 0}, {4, 0}, {2, 0}, {3, 1}}));
+    ASSERT_EQ(change.cool.size(), size_t(4));
+    ASSERT_EQ(w.cells().size(), size_t(4));
+    ASSERT_TRUE(w.cells().back() == (GridCell{3, 0}));
+
+    w.setCapacity(0);
+    ASSERT_EQ(w.capacity(), size_t(1));
+    ASSERT_TRUE(w.visit({2, 2}).warm == (std::vector<GridCell>{{2, 2}}));
+    const WarmChange next = w.visit({3, 2});
+    ASSERT_TRUE(next.warm == (std::vector<GridCell>{{3, 2}}));
+    ASSERT_TRUE(next.cool == (std::vector<GridCell>{{2, 2}}));
+}
+
+TEST(grid_engine_workspaces_of_any_cell) {
+    GridEngine g;
+    g.setMonitors({"DP-1", "HDMI-A-1"});
+    const auto s = g.workspacesOf({1, 1});
+    ASSERT_EQ(s.size(), size_t(2));
+    ASSERT_EQ(s[0].monitor, std::string_view("DP-1"));
+    ASSERT_EQ(s[0].workspace, computeWorkspaceId({1, 1}, 0, 2));
+    ASSERT_EQ(s[1].workspace, computeWorkspaceId({1, 1}, 1, 2));
+    // The current cell is untouched.
+    ASSERT_TRUE(g.cell() == (GridCell{0, 0}));
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// DaemonConnection — persistent, lazily reconnecting daemon socket
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Unique socket path for a connection test.
+static std::string testSocketPath(const char* name) {
+    return "/tmp/hyprgrd-plugin-test-" + std::to_string(getpid()) + "-" + name + ".sock";
+}
+
+/// Bind and listen on `path`, standing in for the daemon.
+static int listenOn(const std::string& path) {
+    unlink(path.c_str());
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    listen(fd, 4);
+    return fd;
+}
+
+/// Read exactly `n` bytes from a client of the fake daemon.
+static std::string readN(int fd, size_t n) {
+    std::string out(n, '\0');
+    size_t      got = 0;
+    while (got < n) {
+        ssize_t r = read(fd, out.data() + got, n - got);
+        if (r <= 0)
+            break;
+        got += static_cast<size_t>(r);
+    }
+    out.resize(got);
+    return out;
+}
+
+TEST(connection_fails_without_daemon) {
+    DaemonConnection conn;
+    conn.setPath(testSocketPath("absent"));
+    ASSERT_FALSE(conn.sendLine("\"SwipeEnd\""));
+    ASSERT_FALSE(conn.connected());
+}
+
+TEST(connection_sends_newline_terminated_lines) {
+    auto path   = testSocketPath("lines");
+    int  server = listenOn(path);
+
+    DaemonConnection conn;
+    conn.setPath(path);
+    ASSERT_TRUE(conn.sendLine(R"({"Go":"right"})"));
+    ASSERT_TRUE(conn.sendLine(R"({"Go":"left"})"));
+
+    // Both lines arrive over the same, single connection.
+    int client = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readN(client, 29), std::string("{\"Go\":\"right\"}\n{\"Go\":\"left\"}\n"));
+
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(connection_reconnects_after_daemon_restart) {
+    auto path   = testSocketPath("restart");
+    int  server = listenOn(path);
+
+    DaemonConnection conn;
+    conn.setPath(path);
+    ASSERT_TRUE(conn.sendLine("\"SwipeEnd\""));
+    int client = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readN(client, 11), std::string("\"SwipeEnd\"\n"));
+
+    // Daemon goes away and comes back on the same path.
+    close(client);
+    close(server);
+    server = listenOn(path);
+
+    ASSERT_TRUE(conn.sendLine("\"CancelMove\""));
+    client = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readN(client, 13), std::string("\"CancelMove\"\n"));
+
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(connection_greets_every_new_connection) {
+    auto path   = testSocketPath("greeting");
+    int  server = listenOn(path);
+
+    DaemonConnection conn;
+    conn.setPath(path);
+    conn.setGreeting("\"AttachOverlay\"\n", std::string("\x08\0", 2));
+    ASSERT_TRUE(conn.sendLine("\"SwipeEnd\""));
+    int client = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readN(client, 27), std::string("\"AttachOverlay\"\n\"SwipeEnd\"\n"));
+
+    // A restarted daemon is greeted again before the next message.
+    close(client);
+    close(server);
+    server = listenOn(path);
+    ASSERT_TRUE(conn.sendLine("\"SwipeEnd\""));
+    client = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readN(client, 27), std::string("\"AttachOverlay\"\n\"SwipeEnd\"\n"));
+
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SpscRing / SendQueue — off-main-thread send queue
+// ═══════════════════════════════════════════════════════════════════════════
+
+TEST(ring_is_fifo) {
+    SpscRing<int, 4> ring;
+    ASSERT_TRUE(ring.push(1));
+    ASSERT_TRUE(ring.push(2));
+    int v = 0;
+    ASSERT_TRUE(ring.pop(v));
+    ASSERT_EQ(v, 1);
+    ASSERT_TRUE(ring.pop(v));
+    ASSERT_EQ(v, 2);
+    ASSERT_FALSE(ring.pop(v));
+}
+
+TEST(ring_rejects_push_when_full) {
+    SpscRing<int, 4> ring;
+    for (int i = 0; i < 4; ++i)
+        ASSERT_TRUE(ring.push(i));
+    ASSERT_FALSE(ring.push(99));
+    ASSERT_EQ(ring.size(), size_t{4});
+
+    // Indices keep wrapping correctly once space frees up.
+    int v = 0;
+    ASSERT_TRUE(ring.pop(v));
+    ASSERT_TRUE(ring.push(4));
+    for (int expected = 1; expected <= 4; ++expected) {
+        ASSERT_TRUE(ring.pop(v));
+        ASSERT_EQ(v, expected);
+    }
+}
+
+TEST(message_json_matches_builders) {
+    PluginMessage m;
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Go, "right", m));
+    ASSERT_EQ(buildMessageJson(m), buildGoJson("right").value);
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Switch, "1 2", m));
+    ASSERT_EQ(buildMessageJson(m), buildSwitchJson("1 2").value);
+    ASSERT_EQ(buildMessageJson(PluginMessage::simple(MessageKind::ToggleVisualizer)),
+              std::string("\"ToggleVisualizer\""));
+    ASSERT_EQ(buildMessageJson(PluginMessage::swipeBegin(4)), buildSwipeBeginJson(4));
+    ASSERT_EQ(buildMessageJson(PluginMessage::swipeUpdate(3, 1.5, -2.0)),
+              buildSwipeUpdateJson(3, 1.5, -2.0));
+}
+
+TEST(message_rejects_oversized_argument) {
+    PluginMessage m;
+    ASSERT_FALSE(PluginMessage::withArg(MessageKind::Go, std::string(MAX_MESSAGE_ARG + 1, 'x'), m));
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Go, std::string(MAX_MESSAGE_ARG, 'x'), m));
+}
+
+TEST(full_policy_parses_config_value) {
+    ASSERT_TRUE(parseFullPolicy("drop") == FullPolicy::Drop);
+    ASSERT_TRUE(parseFullPolicy(" drop ") == FullPolicy::Drop);
+    ASSERT_TRUE(parseFullPolicy("coalesce") == FullPolicy::Coalesce);
+    ASSERT_TRUE(parseFullPolicy("") == FullPolicy::Coalesce);
+}
+
+TEST(queue_drop_policy_counts_dropped) {
+    // Writer not started, so nothing drains the ring.
+    SendQueue queue;
+    for (size_t i = 0; i < SEND_QUEUE_CAPACITY; ++i)
+        ASSERT_TRUE(queue.enqueue(PluginMessage::swipeUpdate(3, 1.0, 0.0), FullPolicy::Drop));
+    ASSERT_FALSE(queue.enqueue(PluginMessage::swipeUpdate(3, 1.0, 0.0), FullPolicy::Drop));
+    ASSERT_FALSE(queue.enqueue(PluginMessage::simple(MessageKind::SwipeEnd), FullPolicy::Drop));
+    ASSERT_EQ(queue.dropped(), uint64_t{2});
+    ASSERT_EQ(queue.queued(), SEND_QUEUE_CAPACITY);
+}
+
+TEST(queue_coalesce_policy_merges_swipe_updates) {
+    auto path   = testSocketPath("coalesce");
+    int  server = listenOn(path);
+
+    SendQueue queue;
+    for (size_t i = 0; i < SEND_QUEUE_CAPACITY; ++i)
+        ASSERT_TRUE(queue.enqueue(PluginMessage::simple(MessageKind::SwipeEnd), FullPolicy::Coalesce));
+    ASSERT_TRUE(queue.enqueue(PluginMessage::swipeUpdate(3, 1.0, 2.0), FullPolicy::Coalesce));
+    ASSERT_TRUE(queue.enqueue(PluginMessage::swipeUpdate(3, 3.0, 4.0), FullPolicy::Coalesce));
+    ASSERT_EQ(queue.coalesced(), uint64_t{2});
+    ASSERT_EQ(queue.dropped(), uint64_t{0});
+
+    // Let the writer drain, then end the gesture: the merged update goes
+    // out ahead of the final SwipeEnd.
+    queue.start(path);
+    int client = accept(server, nullptr, nullptr);
+    std::string backlog;
+    for (size_t i = 0; i < SEND_QUEUE_CAPACITY; ++i)
+        backlog += "\"SwipeEnd\"\n";
+    ASSERT_EQ(readN(client, backlog.size()), backlog);
+    ASSERT_TRUE(queue.enqueue(PluginMessage::simple(MessageKind::SwipeEnd), FullPolicy::Coalesce));
+
+    const std::string tail = buildSwipeUpdateJson(3, 4.0, 6.0) + "\n\"SwipeEnd\"\n";
+    ASSERT_EQ(readN(client, tail.size()), tail);
+
+    queue.stop();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_coalesce_policy_keeps_room_to_end_a_gesture) {
+    auto path   = testSocketPath("coalesce-end");
+    int  server = listenOn(path);
+
+    // Nothing drains the ring: the gesture's updates stop short of the
+    // reserved slots, and the rest merge into one.
+    SendQueue queue;
+    ASSERT_TRUE(queue.enqueue(PluginMessage::swipeBegin(3), FullPolicy::Coalesce));
+    for (size_t i = 0; i < SEND_QUEUE_CAPACITY; ++i)
+        ASSERT_TRUE(queue.enqueue(PluginMessage::swipeUpdate(3, 1.0, 0.0), FullPolicy::Coalesce));
+    ASSERT_EQ(queue.queued(), SEND_QUEUE_CAPACITY - SEND_QUEUE_RESERVED);
+    ASSERT_TRUE(queue.enqueue(PluginMessage::simple(MessageKind::SwipeEnd), FullPolicy::Coalesce));
+    ASSERT_EQ(queue.dropped(), uint64_t{0});
+
+    queue.start(path);
+    int         client = accept(server, nullptr, nullptr);
+    const size_t queuedUpdates = SEND_QUEUE_CAPACITY - SEND_QUEUE_RESERVED - 1;
+    std::string expected       = buildSwipeBeginJson(3) + "\n";
+    for (size_t i = 0; i < queuedUpdates; ++i)
+        expected += buildSwipeUpdateJson(3, 1.0, 0.0) + "\n";
+    expected += buildSwipeUpdateJson(3, static_cast<double>(SEND_QUEUE_CAPACITY - queuedUpdates), 0.0) + "\n";
+    expected += "\"SwipeEnd\"\n";
+    ASSERT_EQ(readN(client, expected.size()), expected);
+
+    queue.stop();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_coalesce_policy_never_leaks_motion_into_the_next_gesture) {
+    auto path   = testSocketPath("coalesce-leak");
+    int  server = listenOn(path);
+
+    // The ring is full to the last reserved slot: the SwipeEnd has to go,
+    // and the merged update with it.
+    SendQueue queue;
+    for (size_t i = 0; i < SEND_QUEUE_CAPACITY; ++i)
+        ASSERT_TRUE(queue.enqueue(PluginMessage::syncGrid(1, 1, 0, 0), FullPolicy::Coalesce));
+    ASSERT_TRUE(queue.enqueue(PluginMessage::swipeUpdate(3, 5.0, 0.0), FullPolicy::Coalesce));
+    ASSERT_FALSE(queue.enqueue(PluginMessage::simple(MessageKind::SwipeEnd), FullPolicy::Coalesce));
+    ASSERT_EQ(queue.dropped(), uint64_t{2});
+
+    queue.start(path);
+    int         client = accept(server, nullptr, nullptr);
+    std::string backlog;
+    for (size_t i = 0; i < SEND_QUEUE_CAPACITY; ++i)
+        backlog += buildSyncGridJson(1, 1, 0, 0) + "\n";
+    ASSERT_EQ(readN(client, backlog.size()), backlog);
+    ASSERT_TRUE(queue.enqueue(PluginMessage::swipeBegin(4), FullPolicy::Coalesce));
+    const std::string begin = buildSwipeBeginJson(4) + "\n";
+    ASSERT_EQ(readN(client, begin.size()), begin);
+
+    queue.stop();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_writer_delivers_in_order) {
+    auto path   = testSocketPath("writer");
+    int  server = listenOn(path);
+
+    SendQueue queue;
+    queue.start(path);
+    PluginMessage go;
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Go, "right", go));
+    ASSERT_TRUE(queue.enqueue(go, FullPolicy::Drop));
+    ASSERT_TRUE(queue.enqueue(PluginMessage::swipeBegin(3), FullPolicy::Drop));
+
+    int client = accept(server, nullptr, nullptr);
+    const std::string expected = buildGoJson("right").value + "\n" + buildSwipeBeginJson(3) + "\n";
+    ASSERT_EQ(readN(client, expected.size()), expected);
+    ASSERT_TRUE(queue.daemonAlive());
+
+    queue.stop();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_greets_with_every_message_in_order) {
+    auto path   = testSocketPath("greet-queue");
+    int  server = listenOn(path);
+
+    SendQueue queue;
+    queue.configure({.greeting = {PluginMessage::simple(MessageKind::AttachGestures),
+                                  PluginMessage::simple(MessageKind::AttachOverlay)}});
+    queue.start(path);
+    ASSERT_TRUE(queue.enqueue(PluginMessage::swipeBegin(3), FullPolicy::Drop));
+
+    int client = accept(server, nullptr, nullptr);
+    const std::string expected = "\"AttachGestures\"\n\"AttachOverlay\"\n" + buildSwipeBeginJson(3) + "\n";
+    ASSERT_EQ(readN(client, expected.size()), expected);
+
+    queue.stop();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_reconnects_to_greet_with_a_new_config) {
+    auto path   = testSocketPath("greet-reload");
+    int  server = listenOn(path);
+
+    SendQueue queue;
+    queue.configure({.greeting = {PluginMessage::simple(MessageKind::AttachGestures)}});
+    queue.start(path);
+    int first = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readN(first, 17), std::string("\"AttachGestures\"\n"));
+
+    // Same setup: the connection stays.
+    queue.configure({.greeting = {PluginMessage::simple(MessageKind::AttachGestures)}});
+    // overlay = plugin after a reload: greet again, on a new connection.
+    queue.configure({.greeting = {PluginMessage::simple(MessageKind::AttachGestures),
+                                  PluginMessage::simple(MessageKind::AttachOverlay)}});
+    char eof = 0;
+    ASSERT_EQ(read(first, &eof, 1), ssize_t{0});
+    int second = accept(server, nullptr, nullptr);
+    const std::string expected = "\"AttachGestures\"\n\"AttachOverlay\"\n";
+    ASSERT_EQ(readN(second, expected.size()), expected);
+
+    queue.stop();
+    close(first);
+    close(second);
+    close(server);
+    unlink(path.c_str());
+}
+
+/// Spin until `cond()` holds, for at most two seconds.
+template <typename Cond>
+static bool eventually(Cond cond) {
+    for (int i = 0; i < 400 && !cond(); ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    return cond();
+}
+
+TEST(socket_watch_reports_only_the_socket) {
+    const auto path  = testSocketPath("watch");
+    const auto other = testSocketPath("watch-other");
+    unlink(path.c_str());
+    SocketWatch watch;
+    ASSERT_TRUE(watch.open(path));
+    ASSERT_FALSE(watch.consume());
+
+    int unrelated = listenOn(other);
+    ASSERT_FALSE(watch.consume());
+    int server = listenOn(path);
+    ASSERT_TRUE(watch.consume());
+    ASSERT_FALSE(watch.consume());
+
+    close(unrelated);
+    close(server);
+    unlink(other.c_str());
+    unlink(path.c_str());
+}
+
+TEST(queue_connects_when_daemon_socket_appears) {
+    const auto path = testSocketPath("appear");
+    unlink(path.c_str());
+    SendQueue queue;
+    queue.start(path);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    ASSERT_FALSE(queue.daemonAlive());
+
+    // No message and no poke: the writer hears about the socket itself.
+    int server = listenOn(path);
+    ASSERT_TRUE(eventually([&] { return queue.daemonAlive(); }));
+
+    queue.stop();
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_notices_idle_daemon_hangup_and_restart) {
+    const auto path   = testSocketPath("hangup");
+    int        server = listenOn(path);
+    SendQueue  queue;
+    queue.start(path);
+    ASSERT_TRUE(eventually([&] { return queue.daemonAlive(); }));
+
+    int client = accept(server, nullptr, nullptr);
+    close(client);
+    close(server);
+    unlink(path.c_str());
+    ASSERT_TRUE(eventually([&] { return !queue.daemonAlive(); }));
+    ASSERT_EQ(queue.connectionStats().hangups.load(), uint64_t{1});
+
+    server = listenOn(path);
+    ASSERT_TRUE(eventually([&] { return queue.daemonAlive(); }));
+
+    queue.stop();
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_keeps_a_busy_daemon_alive) {
+    const auto path   = testSocketPath("busy");
+    int        server = listenOn(path);
+    SendQueue  queue;
+    queue.start(path);
+    int client = accept(server, nullptr, nullptr);
+    ASSERT_TRUE(eventually([&] { return queue.daemonAlive(); }));
+
+    // The daemon never reads: fill the socket until writes come back busy.
+    const auto& conn = queue.connectionStats();
+    for (int i = 0; i < 200000 && conn.busyWrites.load() == 0; ++i) {
+        if (!queue.enqueue(PluginMessage::swipeUpdate(3, 1.0, 0.0), FullPolicy::Drop))
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    ASSERT_TRUE(conn.busyWrites.load() > 0);
+    ASSERT_TRUE(queue.daemonAlive());
+    ASSERT_EQ(conn.hangups.load(), uint64_t{0});
+
+    queue.stop();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_holds_commands_while_daemon_is_busy) {
+    const auto path   = testSocketPath("busyhold");
+    int        server = listenOn(path);
+    SendQueue  queue;
+    queue.start(path);
+    int client = accept(server, nullptr, nullptr);
+    ASSERT_TRUE(eventually([&] { return queue.daemonAlive(); }));
+
+    const auto& conn = queue.connectionStats();
+    for (int i = 0; i < 200000 && conn.busyWrites.load() == 0; ++i) {
+        if (!queue.enqueue(PluginMessage::swipeUpdate(3, 1.0, 0.0), FullPolicy::Drop))
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    ASSERT_TRUE(conn.busyWrites.load() > 0);
+
+    // Pressed while the socket is full: none of them may be lost.
+    std::string expected;
+    for (int i = 0; i < 3; ++i) {
+        PluginMessage msg;
+        ASSERT_TRUE(PluginMessage::withArg(MessageKind::MoveToMonitorIndex, std::to_string(i), msg));
+        while (!queue.enqueue(msg, FullPolicy::Drop))
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        expected += buildMessageJson(msg) + "\n";
+    }
+    ASSERT_TRUE(eventually([&] { return queue.queued() == 0; }));
+
+    // The daemon catches up: the held commands follow, in order.
+    std::string got;
+    ASSERT_TRUE(eventually([&] {
+        char    buf[65536];
+        ssize_t n;
+        while ((n = recv(client, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+            got.append(buf, static_cast<size_t>(n));
+        return got.find(expected) != std::string::npos;
+    }));
+
+    queue.stop();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_replays_commands_held_while_daemon_was_away) {
+    const auto path = testSocketPath("replay");
+    unlink(path.c_str());
+    SendQueue queue;
+    queue.start(path);
+
+    // Two more than fit: the oldest two are given up.
+    std::string expected;
+    for (size_t i = 0; i < REPLAY_CAPACITY + 2; ++i) {
+        PluginMessage msg;
+        ASSERT_TRUE(PluginMessage::withArg(MessageKind::MoveToMonitorIndex, std::to_string(i), msg));
+        ASSERT_TRUE(queue.enqueue(msg, FullPolicy::Drop));
+        if (i >= 2)
+            expected += buildMessageJson(msg) + "\n";
+    }
+    ASSERT_TRUE(eventually([&] { return queue.queued() == 0 && queue.sendFailures() == 2; }));
+    ASSERT_FALSE(queue.daemonAlive());
+
+    int server = listenOn(path);
+    int client = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readN(client, expected.size()), expected);
+    ASSERT_TRUE(eventually([&] { return queue.replayed() == REPLAY_CAPACITY; }));
+    ASSERT_TRUE(queue.daemonAlive());
+
+    queue.stop();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SwipeCoalescer — per-interval swipe update merging
+// ═══════════════════════════════════════════════════════════════════════════
+
+TEST(coalescer_releases_first_update_immediately) {
+    SwipeCoalescer c;
+    c.setInterval(8);
+    auto d = c.add(1000, 3, 1.5, -0.5);
+    ASSERT_TRUE(d.has_value());
+    ASSERT_EQ(d->fingers, uint32_t{3});
+    ASSERT_EQ(d->dx, 1.5);
+    ASSERT_EQ(d->dy, -0.5);
+}
+
+TEST(coalescer_sums_updates_within_interval) {
+    SwipeCoalescer c;
+    c.setInterval(8);
+    ASSERT_TRUE(c.add(1000, 3, 1.0, 0.0).has_value());
+    ASSERT_FALSE(c.add(1002, 3, 2.0, 1.0).has_value());
+    ASSERT_FALSE(c.add(1005, 3, 3.0, 1.0).has_value());
+    auto d = c.add(1008, 3, 4.0, 1.0);
+    ASSERT_TRUE(d.has_value());
+    ASSERT_EQ(d->dx, 9.0);
+    ASSERT_EQ(d->dy, 3.0);
+}
+
+TEST(coalescer_flush_releases_pending_motion_once) {
+    SwipeCoalescer c;
+    c.setInterval(8);
+    c.add(1000, 4, 1.0, 0.0);
+    c.add(1001, 4, 0.5, 0.25);
+    auto d = c.flush();
+    ASSERT_TRUE(d.has_value());
+    ASSERT_EQ(d->fingers, uint32_t{4});
+    ASSERT_EQ(d->dx, 0.5);
+    ASSERT_EQ(d->dy, 0.25);
+    ASSERT_FALSE(c.flush().has_value());
+}
+
+TEST(coalescer_zero_interval_forwards_every_update) {
+    SwipeCoalescer c;
+    c.setInterval(0);
+    ASSERT_TRUE(c.add(1000, 3, 1.0, 0.0).has_value());
+    ASSERT_TRUE(c.add(1000, 3, 1.0, 0.0).has_value());
+}
+
+TEST(coalescer_handles_timestamp_wraparound) {
+    SwipeCoalescer c;
+    c.setInterval(8);
+    ASSERT_TRUE(c.add(UINT32_MAX - 2, 3, 1.0, 0.0).has_value());
+    ASSERT_FALSE(c.add(UINT32_MAX, 3, 1.0, 0.0).has_value());
+    ASSERT_TRUE(c.add(6, 3, 1.0, 0.0).has_value());
+}
+
+TEST(coalescer_paced_by_frame_holds_motion_until_flushed) {
+    SwipeCoalescer c;
+    c.setInterval(8);
+    c.setPacing(SwipePacing::Frame);
+    ASSERT_FALSE(c.pending());
+    ASSERT_FALSE(c.add(1000, 3, 1.0, 0.5).has_value());
+    ASSERT_FALSE(c.add(1020, 3, 2.0, 0.5).has_value());
+    ASSERT_TRUE(c.pending());
+    auto d = c.flush();
+    ASSERT_TRUE(d.has_value());
+    ASSERT_EQ(d->dx, 3.0);
+    ASSERT_EQ(d->dy, 1.0);
+    ASSERT_EQ(d->timeMs, uint32_t{1020});
+    ASSERT_FALSE(c.pending());
+    ASSERT_FALSE(c.flush().has_value());
+}
+
+TEST(swipe_pacing_defaults_to_frame) {
+    ASSERT_TRUE(parseSwipePacing("timer") == SwipePacing::Timer);
+    ASSERT_TRUE(parseSwipePacing(" frame ") == SwipePacing::Frame);
+    ASSERT_TRUE(parseSwipePacing("") == SwipePacing::Frame);
+}
+
+TEST(coalescer_reset_drops_pending_and_releases_next_immediately) {
+    SwipeCoalescer c;
+    c.setInterval(8);
+    c.add(1000, 3, 1.0, 0.0);
+    c.add(1001, 3, 1.0, 0.0);
+    c.reset();
+    ASSERT_FALSE(c.flush().has_value());
+    ASSERT_TRUE(c.add(1002, 3, 1.0, 0.0).has_value());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// VelocityTracker — release velocity (mirrors VelocityWindow in gestures.rs)
+// ═══════════════════════════════════════════════════════════════════════════
+
+TEST(velocity_needs_two_distinct_times) {
+    VelocityTracker t;
+    ASSERT_EQ(t.velocity(0).vx, 0.0);
+    t.add(100, 5.0, 0.0);
+    t.add(100, 4.0, 0.0);
+    ASSERT_EQ(t.velocity(0).vx, 0.0);
+    t.add(110, 6.0, -2.0);
+    const auto v = t.velocity(110);
+    ASSERT_EQ(v.vx, 1000.0);
+    ASSERT_EQ(v.vy, -200.0);
+}
+
+TEST(velocity_only_looks_at_recent_motion) {
+    // Input times wrap around during the gesture.
+    VelocityTracker t;
+    const uint32_t  base = UINT32_MAX - 100;
+    for (uint32_t i = 0; i < 5; ++i)
+        t.add(base + i * 20, 1.0, 0.0);
+    // A flick: 40 px in the last 40 ms.
+    t.add(base + 100, 6.0, 0.0);
+    t.add(base + 120, 20.0, 0.0);
+    t.add(base + 140, 20.0, 0.0);
+    ASSERT_EQ(t.velocity(base + 140).vx, 1000.0);
+}
+
+TEST(velocity_is_zero_once_fingers_rest_before_lifting) {
+    VelocityTracker t;
+    for (uint32_t ms = 0; ms <= 40; ms += 10)
+        t.add(1000 + ms, -10.0, 0.0);
+    ASSERT_EQ(t.velocity(1040 + VELOCITY_WINDOW_MS).vx, -1000.0);
+    ASSERT_TRUE(t.velocity(1041 + VELOCITY_WINDOW_MS) == SwipeVelocity{});
+    t.reset();
+    ASSERT_TRUE(t.velocity(0) == SwipeVelocity{});
+}
+
+TEST(swipe_velocity_message_encodings) {
+    ASSERT_EQ(buildMessageJson(PluginMessage::swipeVelocity(850.0, -12.5)),
+              std::string(R"({"SwipeVelocity":{"vx":850.000,"vy":-12.500}})"));
+    std::string out;
+    buildMessageFrame(PluginMessage::swipeVelocity(1.5, -2.0), out);
+    ASSERT_EQ(out, std::string("\x14\x10\x00\x00\x00\x00\x00\x00\xf8\x3f"
+                               "\x00\x00\x00\x00\x00\x00\x00\xc0",
+                               18));
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Binary wire protocol — frames and handshake (mirrors src/ipc/protocol.rs)
+// ═══════════════════════════════════════════════════════════════════════════
+
+TEST(frame_go_carries_argument) {
+    PluginMessage m;
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Go, "right", m));
+    std::string out;
+    buildMessageFrame(m, out);
+    ASSERT_EQ(out, std::string("\x01\x05right", 7));
+}
+
+TEST(frame_toggle_and_swipe_end_are_empty) {
+    std::string out;
+    buildMessageFrame(PluginMessage::simple(MessageKind::ToggleVisualizer), out);
+    ASSERT_EQ(out, std::string("\x06\x00", 2));
+    buildMessageFrame(PluginMessage::simple(MessageKind::SwipeEnd), out);
+    ASSERT_EQ(out, std::string("\x12\x00", 2));
+}
+
+TEST(frame_swipe_begin_layout) {
+    std::string out;
+    buildMessageFrame(PluginMessage::swipeBegin(4), out);
+    ASSERT_EQ(out, std::string("\x10\x04\x04\x00\x00\x00", 6));
+}
+
+TEST(frame_swipe_update_layout) {
+    std::string out;
+    buildMessageFrame(PluginMessage::swipeUpdate(3, 1.5, -2.0, 0x01020304), out);
+    ASSERT_EQ(out.size(), size_t{2 + SWIPE_UPDATE_PAYLOAD});
+    ASSERT_EQ(out.substr(0, 6), std::string("\x11\x20\x03\x00\x00\x00", 6));
+    // 1.5 = 0x3FF8000000000000, -2.0 = 0xC000000000000000, little-endian.
+    ASSERT_EQ(out.substr(6, 8), std::string("\x00\x00\x00\x00\x00\x00\xf8\x3f", 8));
+    ASSERT_EQ(out.substr(14, 8), std::string("\x00\x00\x00\x00\x00\x00\x00\xc0", 8));
+    ASSERT_EQ(out.substr(22, 4), std::string("\x04\x03\x02\x01", 4));
+    // Untraced: sent_ns is zero.
+    ASSERT_EQ(out.substr(26, 8), std::string(8, '\0'));
+}
+
+TEST(frame_swipe_update_carries_send_time) {
+    auto m   = PluginMessage::swipeUpdate(3, 0.0, 0.0, 1000);
+    m.sentNs = 0x0102030405060708;
+    std::string out;
+    buildMessageFrame(m, out);
+    ASSERT_EQ(out.substr(26, 8), std::string("\x08\x07\x06\x05\x04\x03\x02\x01", 8));
+}
+
+TEST(traced_swipe_update_json) {
+    auto m   = PluginMessage::swipeUpdate(3, 1.5, -2.0, 4000000000u);
+    m.sentNs = 123456789012345;
+    ASSERT_EQ(buildMessageJson(m), buildTracedSwipeUpdateJson(3, 1.5, -2.0, 4000000000u, 123456789012345));
+    ASSERT_EQ(buildMessageJson(m),
+              std::string(R"({"SwipeUpdate":{"fingers":3,"dx":1.500000,"dy":-2.000000,)"
+                          R"("trace":{"input_ms":4000000000,"sent_ns":123456789012345}}})"));
+}
+
+/// Read one newline-terminated line (without the newline).
+static std::string readLine(int fd) {
+    std::string line;
+    char        c = 0;
+    while (read(fd, &c, 1) == 1 && c != '\n')
+        line += c;
+    return line;
+}
+
+TEST(writer_stamps_send_time_on_timed_updates) {
+    auto path   = testSocketPath("trace");
+    int  server = listenOn(path);
+
+    SendQueue queue;
+    queue.start(path);
+    int client = accept(server, nullptr, nullptr);
+
+    const uint64_t before = nowNs();
+    ASSERT_TRUE(queue.enqueue(PluginMessage::swipeUpdate(3, 1.0, 0.0, 77), FullPolicy::Drop));
+    const std::string line = readLine(client);
+    const auto        at   = line.find("\"sent_ns\":");
+    ASSERT_TRUE(line.find("\"input_ms\":77") != std::string::npos);
+    ASSERT_TRUE(at != std::string::npos);
+    const uint64_t sent = std::strtoull(line.c_str() + at + 10, nullptr, 10);
+    ASSERT_TRUE(sent >= before && sent <= nowNs());
+
+    // Updates without an input timestamp (synthetic ones) stay untraced.
+    ASSERT_TRUE(queue.enqueue(PluginMessage::swipeUpdate(3, 1.0, 0.0), FullPolicy::Drop));
+    ASSERT_EQ(readLine(client), buildSwipeUpdateJson(3, 1.0, 0.0));
+
+    queue.stop();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(encode_json_format_appends_newline) {
+    std::string out;
+    encodeMessage(PluginMessage::simple(MessageKind::SwipeEnd), WireFormat::Json, out);
+    ASSERT_EQ(out, std::string("\"SwipeEnd\"\n"));
+}
+
+TEST(connection_negotiates_binary_when_daemon_accepts) {
+    auto path   = testSocketPath("hello-ok");
+    int  server = listenOn(path);
+
+    // Answer the handshake from another thread, as the daemon would.
+    std::string hello;
+    std::thread daemon([&] {
+        int client = accept(server, nullptr, nullptr);
+        hello      = readLine(client);
+        std::string reply = std::string(PROTOCOL_ACCEPT_BINARY) + "\n";
+        (void)!write(client, reply.data(), reply.size());
+        ASSERT_EQ(readN(client, 2), std::string("\x12\x00", 2));
+        close(client);
+    });
+
+    DaemonConnection conn;
+    conn.setPath(path);
+    conn.setPreferredFormat(WireFormat::Binary);
+    ASSERT_TRUE(conn.connect());
+    ASSERT_TRUE(conn.format() == WireFormat::Binary);
+    ASSERT_TRUE(conn.sendEncoded([](WireFormat f, std::string& out) {
+        encodeMessage(PluginMessage::simple(MessageKind::SwipeEnd), f, out);
+    }) == SendResult::Sent);
+
+    daemon.join();
+    ASSERT_EQ(hello, std::string(PROTOCOL_HELLO));
+    ASSERT_TRUE(conn.parsedArgs());
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(connection_retries_version_1_with_older_daemon) {
+    auto path   = testSocketPath("hello-v1");
+    int  server = listenOn(path);
+
+    // A daemon without pre-parsed arguments: only knows version 1.
+    std::string first, second;
+    std::thread daemon([&] {
+        int client = accept(server, nullptr, nullptr);
+        first      = readLine(client);
+        std::string json = std::string(PROTOCOL_ACCEPT_JSON) + "\n";
+        (void)!write(client, json.data(), json.size());
+        second           = readLine(client);
+        std::string ok   = std::string(PROTOCOL_ACCEPT_BINARY_V1) + "\n";
+        (void)!write(client, ok.data(), ok.size());
+        ASSERT_EQ(readN(client, 3), std::string("\x01\x01x", 3));
+        close(client);
+    });
+
+    DaemonConnection conn;
+    ParsedFrameCache parsed;
+    conn.setPath(path);
+    conn.setPreferredFormat(WireFormat::Binary);
+    ASSERT_TRUE(conn.connect());
+    ASSERT_TRUE(conn.format() == WireFormat::Binary);
+    ASSERT_FALSE(conn.parsedArgs());
+    PluginMessage go;
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Go, "x", go));
+    ASSERT_TRUE(conn.sendEncoded([&](WireFormat f, std::string& out) {
+        encodeMessage(go, f, out, conn.parsedArgs() ? &parsed : nullptr);
+    }) == SendResult::Sent);
+
+    daemon.join();
+    ASSERT_EQ(first, std::string(PROTOCOL_HELLO));
+    ASSERT_EQ(second, std::string(PROTOCOL_HELLO_V1));
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(connection_stays_on_json_without_handshake_reply) {
+    auto path   = testSocketPath("hello-silent");
+    int  server = listenOn(path);
+
+    // A pre-handshake daemon: never answers.
+    DaemonConnection conn;
+    conn.setPath(path);
+    conn.setPreferredFormat(WireFormat::Binary);
+    ASSERT_TRUE(conn.connect());
+    ASSERT_TRUE(conn.format() == WireFormat::Json);
+    ASSERT_TRUE(conn.sendLine("\"SwipeEnd\""));
+
+    int client = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readLine(client), std::string(PROTOCOL_HELLO));
+    ASSERT_EQ(readN(client, 11), std::string("\"SwipeEnd\"\n"));
+
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(connection_skips_later_handshakes_after_an_unanswered_one) {
+    auto path   = testSocketPath("hello-silent-acks");
+    int  server = listenOn(path);
+
+    // A pre-handshake daemon ignores the acks request; the binary one is
+    // not sent, so a late answer can't pass for its reply.
+    DaemonConnection conn;
+    conn.setPath(path);
+    conn.setAcks(true);
+    conn.setPreferredFormat(WireFormat::Binary);
+    ASSERT_TRUE(conn.connect());
+    ASSERT_FALSE(conn.acks());
+    ASSERT_TRUE(conn.format() == WireFormat::Json);
+    ASSERT_TRUE(conn.sendLine("\"SwipeEnd\""));
+
+    int client = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readLine(client), std::string(PROTOCOL_HELLO_ACKS));
+    ASSERT_EQ(readN(client, 11), std::string("\"SwipeEnd\"\n"));
+
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+/// Connect to a daemon that answers the acks request with `reply` (sent
+/// as is) and then goes quiet; returns whether the connect succeeded.
+static bool connectsDespiteReply(const char* name, const std::string& reply) {
+    auto path   = testSocketPath(name);
+    int  server = listenOn(path);
+
+    int         client = -1;
+    std::thread daemon([&] {
+        client = accept(server, nullptr, nullptr);
+        readLine(client);
+        (void)!write(client, reply.data(), reply.size());
+    });
+
+    DaemonConnection conn;
+    conn.setPath(path);
+    conn.setAcks(true);
+    conn.setPreferredFormat(WireFormat::Binary);
+    const bool connected = conn.connect();
+    daemon.join();
+    close(client);
+    close(server);
+    unlink(path.c_str());
+    return connected && conn.connected();
+}
+
+TEST(connection_drops_a_daemon_whose_handshake_reply_goes_wrong) {
+    // Answered acks, then silence on the binary request: only slow.
+    ASSERT_FALSE(connectsDespiteReply("hello-late", std::string(PROTOCOL_ACCEPT_ACKS) + "\n"));
+    // A reply cut short by the timeout.
+    ASSERT_FALSE(connectsDespiteReply("hello-partial", "OK hyprgrd"));
+    // A reply too long to be one.
+    ASSERT_FALSE(connectsDespiteReply("hello-long", std::string(200, 'x') + "\n"));
+}
+
+TEST(queue_handshakes_again_when_the_format_changes) {
+    auto path   = testSocketPath("hello-reload");
+    int  server = listenOn(path);
+
+    // wire_format = json until the config is parsed, then binary.
+    SendQueue queue;
+    queue.start(path);
+    int first = accept(server, nullptr, nullptr);
+    ASSERT_TRUE(eventually([&] { return queue.daemonAlive(); }));
+
+    queue.configure({.format = WireFormat::Binary});
+    char eof = 0;
+    ASSERT_EQ(read(first, &eof, 1), ssize_t{0});
+    int second = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readLine(second), std::string(PROTOCOL_HELLO));
+
+    close(second);
+    queue.stop();
+    close(first);
+    close(server);
+    unlink(path.c_str());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Allocation-free builders — format*() must match build*() byte for byte
+// ═══════════════════════════════════════════════════════════════════════════
+
+// Count heap allocations on the current thread so tests can assert that a
+// code path performs none.  The whole replaceable family is backed by
+// malloc/free, so every new is released by a matching delete.  Both go
+// through out-of-line helpers: inlined, GCC would pair the caller's `new`
+// with the `free` inside delete and warn (-Wmismatched-new-delete).
+static thread_local size_t g_allocations = 0;
+
+[[gnu::noinline]] static void* countedAlloc(size_t n) noexcept {
+    ++g_allocations;
+    return std::malloc(n ? n : 1);
+}
+
+[[gnu::noinline]] static void countedFree(void* p) noexcept {
+    std::free(p);
+}
+
+void* operator new(size_t n) {
+    if (void* p = countedAlloc(n))
+        return p;
+    throw std::bad_alloc();
+}
+void* operator new[](size_t n) {
+    if (void* p = countedAlloc(n))
+        return p;
+    throw std::bad_alloc();
+}
+void* operator new(size_t n, const std::nothrow_t&) noexcept { return countedAlloc(n); }
+void* operator new[](size_t n, const std::nothrow_t&) noexcept { return countedAlloc(n); }
+void  operator delete(void* p) noexcept { countedFree(p); }
+void  operator delete[](void* p) noexcept { countedFree(p); }
+void  operator delete(void* p, size_t) noexcept { countedFree(p); }
+void  operator delete[](void* p, size_t) noexcept { countedFree(p); }
+void  operator delete(void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+void  operator delete[](void* p, const std::nothrow_t&) noexcept { countedFree(p); }
+
+TEST(trim_view_matches_trim) {
+    for (const char* s : {"", "   ", "right", "  right  ", "\tup left\n"})
+        ASSERT_EQ(std::string(trimView(s)), trim(s));
+}
+
+TEST(capitalize_into_matches_capitalize) {
+    char buf[16];
+    ASSERT_EQ(std::string(capitalizeInto(buf, "right")), capitalize("right"));
+    ASSERT_EQ(std::string(capitalizeInto(buf, "")), capitalize(""));
+    ASSERT_TRUE(capitalizeInto(std::span<char>(buf, 2), "right").empty());
+}
+
+TEST(format_arg_builders_match_build) {
+    char buf[256];
+    for (const char* arg : {"right", "  up-left ", "", "1 2", "a\"b\\c"}) {
+        ASSERT_EQ(std::string(formatGoJson(buf, arg)), buildGoJson(arg).value);
+        ASSERT_EQ(std::string(formatMoveGoJson(buf, arg)), buildMoveGoJson(arg).value);
+        ASSERT_EQ(std::string(formatSwitchJson(buf, arg)), buildSwitchJson(arg).value);
+        ASSERT_EQ(std::string(formatMoveToMonitorJson(buf, arg)), buildMoveToMonitorJson(arg).value);
+        ASSERT_EQ(std::string(formatMoveToMonitorIndexJson(buf, arg)), buildMoveToMonitorIndexJson(arg).value);
+    }
+    ASSERT_EQ(std::string(formatToggleVisualizerJson(buf)), buildToggleVisualizerJson());
+}
+
+TEST(format_swipe_builders_match_build) {
+    char buf[SWIPE_JSON_CAPACITY];
+    ASSERT_EQ(std::string(formatSwipeBeginJson(buf, 3)), buildSwipeBeginJson(3));
+    ASSERT_EQ(std::string(formatSwipeUpdateJson(buf, 4, 10.5, -2.25)), buildSwipeUpdateJson(4, 10.5, -2.25));
+    ASSERT_EQ(std::string(formatSwipeUpdateJson(buf, 3, -1e9, 1e-7)), buildSwipeUpdateJson(3, -1e9, 1e-7));
+    ASSERT_EQ(std::string(formatSwipeEndJson(buf)), buildSwipeEndJson());
+}
+
+TEST(format_escapes_like_escape_json_string) {
+    char buf[64];
+    const std::string arg = "x\"y\\z";
+    ASSERT_EQ(std::string(formatGoJson(buf, arg)), "{\"Go\":\"" + escapeJsonString(arg) + "\"}");
+}
+
+TEST(format_reports_overflow_as_empty) {
+    // Sized at run time, so the compiler doesn't flag the overflow itself.
+    volatile size_t   size = 8;
+    std::vector<char> buf(size);
+    ASSERT_TRUE(formatGoJson(buf, "right").empty());
+    ASSERT_TRUE(formatSwipeUpdateJson(buf, 3, 1.0, 1.0).empty());
+    // Exactly-fitting output is not an overflow.
+    char exact[10];
+    ASSERT_EQ(std::string(formatSwipeEndJson(exact)), std::string("\"SwipeEnd\""));
+}
+
+TEST(swipe_json_capacity_fits_any_value) {
+    constexpr double huge = std::numeric_limits<double>::max();
+    constexpr double inf  = std::numeric_limits<double>::infinity();
+    constexpr double nan  = std::numeric_limits<double>::quiet_NaN();
+    char             buf[SWIPE_JSON_CAPACITY];
+    ASSERT_EQ(std::string(formatTracedSwipeUpdateJson(buf, UINT32_MAX, -huge, inf, UINT32_MAX, UINT64_MAX)),
+              std::string(R"({"SwipeUpdate":{"fingers":4294967295,"dx":-1000000000.000000,"dy":1000000000.000000,)"
+                          R"("trace":{"input_ms":4294967295,"sent_ns":18446744073709551615}}})"));
+    ASSERT_EQ(std::string(formatSwipeUpdateJson(buf, 3, nan, -inf)),
+              std::string(R"({"SwipeUpdate":{"fingers":3,"dx":0.000000,"dy":-1000000000.000000}})"));
+    ASSERT_EQ(std::string(formatSwipeVelocityJson(buf, huge, nan)),
+              std::string(R"({"SwipeVelocity":{"vx":1000000000.000,"vy":0.000}})"));
+}
+
+TEST(message_json_capacity_fits_worst_case) {
+    PluginMessage m;
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::MoveToMonitorIndex,
+                                       std::string(MAX_MESSAGE_ARG, '"'), m));
+    char buf[MESSAGE_JSON_CAPACITY];
+    ASSERT_FALSE(formatMessageJson(buf, m).empty());
+}
+
+TEST(dispatcher_and_swipe_paths_do_not_allocate) {
+    std::string out;
+    out.reserve(ENCODED_MESSAGE_CAPACITY);
+    const std::string arg = "  right ";
+
+    const size_t  before = g_allocations;
+    PluginMessage msg;
+    bool          ok = PluginMessage::withArg(MessageKind::Go, trimView(arg), msg);
+    encodeMessage(msg, WireFormat::Json, out);
+    msg.seq = 4294967295u;
+    encodeMessage(msg, WireFormat::Json, out);
+    encodeMessage(msg, WireFormat::Binary, out);
+    encodeMessage(PluginMessage::swipeUpdate(3, 1.5, -2.0), WireFormat::Json, out);
+    encodeMessage(PluginMessage::swipeBegin(3), WireFormat::Binary, out);
+    encodeMessage(PluginMessage::swipeUpdate(3, 1.5, -2.0), WireFormat::Binary, out);
+    char buf[MESSAGE_JSON_CAPACITY];
+    formatMessageJson(buf, PluginMessage::simple(MessageKind::SwipeEnd));
+    const size_t after = g_allocations;
+
+    ASSERT_TRUE(ok);
+    ASSERT_EQ(after, before);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// LatencyHistogram / instrumentation counters
+// ═══════════════════════════════════════════════════════════════════════════
+
+TEST(histogram_empty_reports_zero) {
+    LatencyHistogram h;
+    ASSERT_EQ(h.count(), uint64_t{0});
+    ASSERT_EQ(h.quantileNs(0.5), uint64_t{0});
+    ASSERT_EQ(h.meanNs(), uint64_t{0});
+}
+
+TEST(histogram_quantiles_are_bucket_upper_bounds) {
+    LatencyHistogram h;
+    for (int i = 0; i < 99; ++i)
+        h.record(1000); // bucket [512, 1024)
+    h.record(1'000'000); // bucket [524288, 1048576)
+    ASSERT_EQ(h.count(), uint64_t{100});
+    ASSERT_EQ(h.quantileNs(0.5), uint64_t{1023});
+    ASSERT_EQ(h.quantileNs(1.0), uint64_t{1048575});
+    ASSERT_EQ(h.maxNs(), uint64_t{1'000'000});
+    ASSERT_EQ(h.meanNs(), uint64_t{(99 * 1000 + 1'000'000) / 100});
+}
+
+TEST(histogram_reset_clears_everything) {
+    LatencyHistogram h;
+    h.record(5);
+    h.reset();
+    ASSERT_EQ(h.count(), uint64_t{0});
+    ASSERT_EQ(h.maxNs(), uint64_t{0});
+}
+
+TEST(histogram_is_safe_under_concurrent_recording) {
+    LatencyHistogram h;
+    std::thread      a([&] { for (int i = 0; i < 10000; ++i) h.record(100); });
+    std::thread      b([&] { for (int i = 0; i < 10000; ++i) h.record(200); });
+    a.join();
+    b.join();
+    ASSERT_EQ(h.count(), uint64_t{20000});
+    ASSERT_EQ(h.maxNs(), uint64_t{200});
+}
+
+TEST(scoped_timer_records_once_and_null_is_noop) {
+    LatencyHistogram h;
+    { ScopedTimer t(&h); }
+    { ScopedTimer t(nullptr); }
+    ASSERT_EQ(h.count(), uint64_t{1});
+}
+
+TEST(connection_counts_connect_failures) {
+    DaemonConnection conn;
+    conn.setPath(testSocketPath("absent-stats"));
+    conn.sendLine("\"SwipeEnd\"");
+    conn.sendLine("\"SwipeEnd\"");
+    ASSERT_EQ(conn.stats().connectFailures.load(), uint64_t{2});
+    ASSERT_EQ(conn.stats().connects.load(), uint64_t{0});
+}
+
+TEST(queue_records_latency_for_instrumented_messages_only) {
+    auto path   = testSocketPath("stats");
+    int  server = listenOn(path);
+
+    PluginStats stats;
+    SendQueue   queue;
+    queue.setStats(&stats);
+    queue.start(path);
+
+    PluginMessage timedMsg = PluginMessage::simple(MessageKind::SwipeEnd);
+    timedMsg.enqueuedNs    = nowNs();
+    ASSERT_TRUE(queue.enqueue(timedMsg, FullPolicy::Drop));
+    ASSERT_TRUE(queue.enqueue(PluginMessage::simple(MessageKind::SwipeEnd), FullPolicy::Drop));
+
+    int client = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readN(client, 22), std::string("\"SwipeEnd\"\n\"SwipeEnd\"\n"));
+    queue.stop();
+
+    ASSERT_EQ(stats.queueWait.count(), uint64_t{1});
+    ASSERT_EQ(stats.socketWrite.count(), uint64_t{1});
+    ASSERT_EQ(queue.connectionStats().connects.load(), uint64_t{1});
+
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// SwipeChannel — shared-memory swipe updates (mirrors src/ipc/swipe_channel.rs)
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// Act as the daemon reading the slot: take the latest value and record it
+/// as consumed.
+static SwipeSnapshot consumeSlot(SwipeSlot& slot) {
+    const SwipeSnapshot s = readSwipeSlot(slot);
+    slot.readerSeq.store(s.seq, std::memory_order_seq_cst);
+    return s;
+}
+
+TEST(swipe_channel_publishes_gesture_totals) {
+    SwipeChannel channel;
+    ASSERT_TRUE(channel.open());
+    ASSERT_EQ(channel.slot()->magic.load(), SWIPE_CHANNEL_MAGIC);
+
+    channel.begin(3);
+    channel.add(3, 1.5, -1.0, 100);
+    channel.add(3, 0.5, 0.25, 104);
+    SwipeSnapshot s = readSwipeSlot(*channel.slot());
+    ASSERT_EQ(s.gesture, 1u);
+    ASSERT_EQ(s.dx, 2.0);
+    ASSERT_EQ(s.dy, -0.75);
+    ASSERT_EQ(s.inputMs, 104u);
+    ASSERT_TRUE(s.sentNs != 0);
+
+    // A new gesture starts from zero.
+    channel.begin(4);
+    s = readSwipeSlot(*channel.slot());
+    ASSERT_EQ(s.gesture, 2u);
+    ASSERT_EQ(s.fingers, 4u);
+    ASSERT_EQ(s.dx, 0.0);
+}
+
+TEST(swipe_channel_rings_only_when_daemon_caught_up) {
+    SwipeChannel channel;
+    ASSERT_TRUE(channel.open());
+    channel.begin(3);
+    consumeSlot(*channel.slot()); // the daemon's drain at SwipeBegin
+
+    channel.add(3, 1.0, 0.0, 1);
+    channel.add(3, 1.0, 0.0, 2); // daemon hasn't read yet: no syscall
+    ASSERT_EQ(channel.doorbells(), 1u);
+    ASSERT_EQ(consumeSlot(*channel.slot()).dx, 2.0);
+    channel.add(3, 1.0, 0.0, 3);
+    ASSERT_EQ(channel.doorbells(), 2u);
+
+    uint64_t rung = 0;
+    ASSERT_EQ(read(channel.eventFd(), &rung, sizeof(rung)), static_cast<ssize_t>(sizeof(rung)));
+    ASSERT_EQ(rung, 2u);
+}
+
+/// Receive one message and up to two SCM_RIGHTS fds, as the daemon does.
+static std::string recvWithFds(int fd, int (&fds)[2]) {
+    char         buf[16];
+    struct iovec iov = {.iov_base = buf, .iov_len = sizeof(buf)};
+    alignas(struct cmsghdr) char control[CMSG_SPACE(2 * sizeof(int))] = {};
+    struct msghdr msg = {};
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control;
+    msg.msg_controllen = sizeof(control);
+    const ssize_t n    = recvmsg(fd, &msg, 0);
+    fds[0] = fds[1]      = -1;
+    if (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg && cmsg->cmsg_type == SCM_RIGHTS)
+        memcpy(fds, CMSG_DATA(cmsg), sizeof(fds));
+    return std::string(buf, n > 0 ? static_cast<size_t>(n) : 0);
+}
+
+TEST(connection_attaches_swipe_channel_when_daemon_accepts) {
+    auto path   = testSocketPath("shm-ok");
+    int  server = listenOn(path);
+
+    SwipeChannel channel;
+    ASSERT_TRUE(channel.open());
+
+    int         client = -1;
+    std::string frame;
+    SwipeSlot*  daemonView = nullptr;
+    std::thread daemon([&] {
+        client = accept(server, nullptr, nullptr);
+        readLine(client);
+        const std::string binary = std::string(PROTOCOL_ACCEPT_BINARY) + "\n";
+        (void)!write(client, binary.data(), binary.size());
+        int fds[2];
+        frame      = recvWithFds(client, fds);
+        void* map  = mmap(nullptr, SWIPE_CHANNEL_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+        daemonView = map == MAP_FAILED ? nullptr : static_cast<SwipeSlot*>(map);
+        close(fds[0]);
+        close(fds[1]);
+        const std::string shm = std::string(PROTOCOL_ACCEPT_SHM) + "\n";
+        (void)!write(client, shm.data(), shm.size());
+    });
+
+    DaemonConnection conn;
+    conn.setPath(path);
+    conn.setPreferredFormat(WireFormat::Binary);
+    conn.setSwipeChannel(&channel);
+    ASSERT_TRUE(conn.connect());
+    daemon.join();
+    ASSERT_EQ(frame, std::string("\x13\x00", 2));
+    ASSERT_TRUE(channel.attached());
+
+    // The daemon's mapping sees what the plugin publishes.
+    ASSERT_TRUE(daemonView != nullptr);
+    channel.begin(3);
+    channel.add(3, 4.0, 0.0, 0);
+    ASSERT_EQ(readSwipeSlot(*daemonView).dx, 4.0);
+
+    conn.disconnect();
+    ASSERT_FALSE(channel.attached());
+    munmap(daemonView, SWIPE_CHANNEL_SIZE);
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_offers_swipe_channel_only_while_configured) {
+    auto path   = testSocketPath("shm-reload");
+    int  server = listenOn(path);
+
+    SwipeChannel channel;
+    ASSERT_TRUE(channel.open());
+
+    // swipe_channel = socket: a binary connection without the offer.
+    SendQueue queue;
+    queue.setSwipeChannel(&channel);
+    queue.configure({.format = WireFormat::Binary});
+    queue.start(path);
+    const std::string binary = std::string(PROTOCOL_ACCEPT_BINARY) + "\n";
+    int               first  = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readLine(first), std::string(PROTOCOL_HELLO));
+    (void)!write(first, binary.data(), binary.size());
+    ASSERT_TRUE(queue.enqueue(PluginMessage::simple(MessageKind::SwipeEnd), FullPolicy::Drop));
+    ASSERT_EQ(readN(first, 2), std::string("\x12\x00", 2));
+    ASSERT_FALSE(channel.attached());
+
+    // swipe_channel = shm after a reload: the next connection offers it.
+    queue.configure({.format = WireFormat::Binary, .swipeChannel = true});
+    char eof = 0;
+    ASSERT_EQ(read(first, &eof, 1), ssize_t{0});
+    int second = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readLine(second), std::string(PROTOCOL_HELLO));
+    (void)!write(second, binary.data(), binary.size());
+    int fds[2];
+    ASSERT_EQ(recvWithFds(second, fds), std::string("\x13\x00", 2));
+    close(fds[0]);
+    close(fds[1]);
+    const std::string shm = std::string(PROTOCOL_ACCEPT_SHM) + "\n";
+    (void)!write(second, shm.data(), shm.size());
+    ASSERT_TRUE(eventually([&] { return channel.attached(); }));
+
+    queue.stop();
+    ASSERT_FALSE(channel.attached());
+    close(first);
+    close(second);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(connection_keeps_swipes_on_socket_without_channel_reply) {
+    auto path   = testSocketPath("shm-silent");
+    int  server = listenOn(path);
+
+    SwipeChannel channel;
+    ASSERT_TRUE(channel.open());
+
+    // A binary daemon that predates the channel: skips the frame silently.
+    int         client = -1;
+    std::thread daemon([&] {
+        client = accept(server, nullptr, nullptr);
+        readLine(client);
+        const std::string binary = std::string(PROTOCOL_ACCEPT_BINARY) + "\n";
+        (void)!write(client, binary.data(), binary.size());
+    });
+
+    DaemonConnection conn;
+    conn.setPath(path);
+    conn.setPreferredFormat(WireFormat::Binary);
+    conn.setSwipeChannel(&channel);
+    ASSERT_TRUE(conn.connect());
+    daemon.join();
+    ASSERT_TRUE(conn.format() == WireFormat::Binary);
+    ASSERT_FALSE(channel.attached());
+
+    close(client);
+    close(server);
+    unlink(path.c_str());
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// OverlayModel — in-compositor grid overlay (overlay = plugin)
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// The model after the daemon's first sync of a 3×2 grid at the origin.
+static OverlayModel syncedOverlay() {
+    OverlayModel m;
+    m.sync(GridState{.cols = 3, .rows = 2, .col = 0, .row = 0}, 0.0);
+    return m;
+}
+
+/// The cursor (last rectangle) in overlay coordinates.
+static std::pair<double, double> overlayCursor(const OverlayModel& m) {
+    std::vector<OverlayRect> rects;
+    m.layout(rects);
+    return {rects.back().x, rects.back().y};
+}
+
+TEST(attach_overlay_message_encodings) {
+    const auto m = PluginMessage::simple(MessageKind::AttachOverlay);
+    ASSERT_EQ(buildMessageJson(m), buildAttachOverlayJson());
+    ASSERT_EQ(buildAttachOverlayJson(), std::string("\"AttachOverlay\""));
+    std::string frame;
+    buildMessageFrame(m, frame);
+    ASSERT_EQ(frame, std::string("\x08\0", 2));
+}
+
+TEST(attach_gestures_message_encodings) {
+    const auto m = PluginMessage::simple(MessageKind::AttachGestures);
+    ASSERT_EQ(buildMessageJson(m), std::string("\"AttachGestures\""));
+    std::string frame;
+    buildMessageFrame(m, frame);
+    ASSERT_EQ(frame, std::string("\x16\0", 2));
+}
+
+TEST(gesture_routes_take_every_swipe_until_synced) {
+    GestureRoutes routes;
+    ASSERT_FALSE(routes.synced());
+    ASSERT_TRUE(routes.owns(2) && routes.owns(3) && routes.owns(MAX_ROUTED_FINGERS + 1));
+
+    // `syncgestures_args` in src/hyprland/wm.rs.
+    const auto synced = parseSyncGestures(" 3 4 ");
+    ASSERT_TRUE(synced.has_value() && synced->synced());
+    ASSERT_TRUE(synced->owns(3) && synced->owns(4));
+    ASSERT_FALSE(synced->owns(2) || synced->owns(5) || synced->owns(0) || synced->owns(MAX_ROUTED_FINGERS + 1));
+    ASSERT_TRUE(parseSyncGestures("3")->owns(3));
+    ASSERT_FALSE(parseSyncGestures("3")->owns(4));
+}
+
+TEST(sync_gestures_rejects_bad_arguments) {
+    ASSERT_FALSE(parseSyncGestures("").has_value());
+    ASSERT_FALSE(parseSyncGestures("0").has_value());
+    ASSERT_FALSE(parseSyncGestures("3 11").has_value());
+    ASSERT_FALSE(parseSyncGestures("3,4").has_value());
+    ASSERT_FALSE(parseSyncGestures("-3").has_value());
+}
+
+TEST(sync_overlay_parses_daemon_arguments) {
+    // `syncoverlay_args` in src/hyprland/wm.rs for the default settings.
+    ASSERT_TRUE(parseSyncOverlay("200 0.3 1 3 4 100 80 300 200") == OverlayConfig{});
+    const auto cfg = parseSyncOverlay(" 150.5 0.25 0 2 3 0 0 0 50 ");
+    ASSERT_TRUE(cfg.has_value());
+    ASSERT_EQ(cfg->sensitivity, 150.5);
+    ASSERT_FALSE(cfg->naturalSwiping);
+    ASSERT_EQ(cfg->switchFingers, 2u);
+    ASSERT_EQ(cfg->fadeOutMs, 50u);
+    ASSERT_FALSE(parseSyncOverlay("200 0.3 1 3 4 100 80 300").has_value());
+    ASSERT_FALSE(parseSyncOverlay("200 0.3 1 3 4 100 80 300 200 1").has_value());
+    ASSERT_FALSE(parseSyncOverlay("200 0.3 2 3 4 100 80 300 200").has_value());
+    ASSERT_FALSE(parseSyncOverlay("0 0.3 1 3 4 100 80 300 200").has_value());
+    ASSERT_FALSE(parseSyncOverlay("200 0.3 1 3 4 -1 80 300 200").has_value());
+}
+
+TEST(overlay_swipe_maths_match_daemon) {
+    const OverlayConfig natural{};
+    ASSERT_TRUE(normalisedSwipeOffset(-100.0, 500.0, natural) == std::pair(0.5, -1.0));
+    ASSERT_TRUE(dominantDirection(0.5, 0.1, 0.3) == GridDirection::Right);
+    ASSERT_TRUE(dominantDirection(-0.5, -0.5, 0.3) == GridDirection::UpLeft);
+    ASSERT_TRUE(dominantDirection(0.3, 0.0, 0.3) == GridDirection::Right);
+    ASSERT_FALSE(dominantDirection(0.2, 0.2, 0.3).has_value());
+    ASSERT_EQ(cssEase(0.0), 0.0);
+    ASSERT_EQ(cssEase(1.0), 1.0);
+    ASSERT_TRUE(std::abs(cssEase(0.5) - 0.8024) < 1e-3);
+    // Straight swipes are already on a 45° line; a full cell snaps onto it.
+    ASSERT_TRUE(interpolatedOffset(0.5, 0.0) == std::pair(0.5, 0.0));
+    const auto [sx, sy] = interpolatedOffset(1.0, 0.1);
+    ASSERT_TRUE(std::abs(sy) < 1e-9 && std::abs(sx - std::hypot(1.0, 0.1)) < 1e-9);
+}
+
+TEST(overlay_geometry_follows_default_css) {
+    OverlayModel m = syncedOverlay();
+    ASSERT_EQ(m.width(), 3 * 30.0 + 2 * 12.0);
+    ASSERT_EQ(m.height(), 2 * 30.0 + 2 * 12.0);
+    std::vector<OverlayRect> rects;
+    m.layout(rects);
+    ASSERT_EQ(rects.size(), size_t{1 + 6 + 1});
+    ASSERT_TRUE(rects.front().color == OVERLAY_BACKGROUND);
+    ASSERT_EQ(rects.front().radius, 16.0);
+    // Second cell of the first row, and the cursor on the first.
+    ASSERT_EQ(rects[2].x, 12.0 + 30.0 + 3.0);
+    ASSERT_EQ(rects[2].w, 24.0);
+    ASSERT_TRUE(rects[2].color == OVERLAY_CELL);
+    ASSERT_TRUE(overlayCursor(m) == std::pair(15.0, 15.0));
+}
+
+TEST(overlay_viewport_axis_follows_the_cursor) {
+    ASSERT_TRUE(overlayViewportAxis(3, 2, 2) == std::pair(size_t{0}, size_t{3}));
+    ASSERT_TRUE(overlayViewportAxis(500, 0, 0) == std::pair(size_t{0}, size_t{9}));
+    ASSERT_TRUE(overlayViewportAxis(500, 200, 200) == std::pair(size_t{196}, size_t{9}));
+    ASSERT_TRUE(overlayViewportAxis(500, 499, 499) == std::pair(size_t{491}, size_t{9}));
+    // A target past the grid's edge scrolls it into view.
+    ASSERT_TRUE(overlayViewportAxis(501, 499, 500) == std::pair(size_t{492}, size_t{9}));
+}
+
+TEST(overlay_draws_only_the_cells_in_view) {
+    OverlayModel m;
+    m.sync(GridState{.cols = 400, .rows = 300, .col = 250, .row = 1}, 0.0);
+    ASSERT_EQ(m.width(), 9 * 30.0 + 2 * 12.0);
+    std::vector<OverlayRect> rects;
+    m.layout(rects);
+    ASSERT_EQ(rects.size(), size_t{1 + 81 + 1});
+    // Centred on the cursor's column; the top edge keeps row 1 second.
+    ASSERT_TRUE(overlayCursor(m) == std::pair(12.0 + 4 * 30.0 + 3.0, 12.0 + 30.0 + 3.0));
+}
+
+TEST(overlay_flashes_on_cell_change_then_fades) {
+    OverlayModel m = syncedOverlay();
+    ASSERT_FALSE(m.visible()); // the first sync is taken silently
+    m.sync(GridState{.cols = 3, .rows = 2, .col = 1, .row = 0}, 1000.0);
+    ASSERT_TRUE(m.visible());
+    ASSERT_TRUE(m.advance(1040.0)); // sliding to the new cell
+    ASSERT_TRUE(m.advance(1200.0)); // lingering
+    ASSERT_TRUE(overlayCursor(m) == std::pair(45.0, 15.0));
+    ASSERT_EQ(m.opacity(), 1.0);
+    ASSERT_TRUE(m.advance(1350.0)); // 50 of 200 ms into the fade
+    ASSERT_EQ(m.opacity(), 0.75);
+    ASSERT_FALSE(m.advance(1500.0));
+    ASSERT_FALSE(m.visible());
+    // The same cell again is no change.
+    m.sync(GridState{.cols = 3, .rows = 2, .col = 1, .row = 0}, 2000.0);
+    ASSERT_FALSE(m.visible());
+}
+
+TEST(overlay_manual_toggle_is_sticky) {
+    OverlayModel m = syncedOverlay();
+    m.toggleManual(0.0);
+    ASSERT_TRUE(m.visible());
+    m.sync(GridState{.cols = 3, .rows = 2, .col = 2, .row = 1}, 10.0);
+    m.advance(5000.0);
+    ASSERT_TRUE(m.visible());
+    ASSERT_EQ(m.opacity(), 1.0);
+    m.toggleManual(5000.0);
+    ASSERT_FALSE(m.visible());
+}
+
+TEST(overlay_follows_swipe_and_predicts_release) {
+    OverlayModel m = syncedOverlay();
+    ASSERT_FALSE(m.swipeBegin(2));
+    ASSERT_TRUE(m.swipeBegin(3));
+    // Natural swiping: fingers left move the cursor right, half a cell.
+    m.swipeUpdate(-60.0, 0.0, 10.0);
+    m.swipeUpdate(-40.0, 0.0, 20.0);
+    ASSERT_TRUE(m.visible());
+    ASSERT_TRUE(overlayCursor(m) == std::pair(30.0, 15.0));
+    std::vector<OverlayRect> rects;
+    m.layout(rects);
+    ASSERT_TRUE(rects[2].color == OVERLAY_TARGET);
+
+    // Released at rest: slide on to the cell the daemon commits to.
+    m.swipeEnd(SwipeVelocity{}, 30.0);
+    ASSERT_FALSE(m.following());
+    m.advance(200.0);
+    ASSERT_TRUE(overlayCursor(m) == std::pair(45.0, 15.0));
+    m.sync(GridState{.cols = 3, .rows = 2, .col = 1, .row = 0}, 210.0);
+    m.advance(400.0);
+    ASSERT_TRUE(overlayCursor(m) == std::pair(45.0, 15.0));
+}
+
+TEST(overlay_release_uses_fling_velocity) {
+    OverlayModel m = syncedOverlay();
+    m.swipeBegin(3);
+    m.swipeUpdate(-40.0, 0.0, 10.0); // 0.2: below the threshold
+    m.swipeEnd(SwipeVelocity{.vx = -1000.0, .vy = 0.0}, 20.0);
+    m.advance(200.0);
+    ASSERT_TRUE(overlayCursor(m) == std::pair(45.0, 15.0));
+
+    OverlayModel slow = syncedOverlay();
+    slow.swipeBegin(3);
+    slow.swipeUpdate(-40.0, 0.0, 10.0);
+    slow.swipeEnd(SwipeVelocity{}, 20.0);
+    slow.advance(200.0);
+    ASSERT_TRUE(overlayCursor(slow) == std::pair(15.0, 15.0));
+}
+
+TEST(overlay_grows_to_show_new_column) {
+    OverlayModel m;
+    m.sync(GridState{.cols = 3, .rows = 2, .col = 2, .row = 0}, 0.0);
+    m.swipeBegin(3);
+    m.swipeUpdate(-100.0, 0.0, 10.0);
+    ASSERT_EQ(m.width(), 4 * 30.0 + 2 * 12.0);
+    // The daemon committed while dragging: its sync ends the gesture display.
+    m.sync(GridState{.cols = 4, .rows = 2, .col = 3, .row = 0}, 20.0);
+    ASSERT_FALSE(m.following());
+    ASSERT_EQ(m.width(), 4 * 30.0 + 2 * 12.0);
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// DISPATCHER_COMMANDS — the command table
+// ═══════════════════════════════════════════════════════════════════════════
+
+TEST(command_table_lookups) {
+    ASSERT_EQ(DISPATCHER_COMMANDS.size(), size_t{6});
+    ASSERT_EQ(commandFor(MessageKind::MoveGo)->json, std::string_view("MoveWindowAndGo"));
+    ASSERT_TRUE(commandFor(MessageKind::SwipeUpdate) == nullptr);
+    ASSERT_TRUE(commandNamed("movetomonitorindex")->kind == MessageKind::MoveToMonitorIndex);
+    ASSERT_TRUE(commandNamed("stats") == nullptr);
+    static_assert(commandFor(MessageKind::Switch)->opcode == Op::SwitchTo);
+}
+
+TEST(command_table_encoders_match_legacy_builders) {
+    // The per-command builders in helpers.hpp predate the table; both
+    // must produce the same bytes.
+    const std::pair<MessageKind, CommandResult> rows[] = {
+        {MessageKind::Go, buildGoJson(" up ")},
+        {MessageKind::MoveGo, buildMoveGoJson(" up ")},
+        {MessageKind::Switch, buildSwitchJson(" up ")},
+        {MessageKind::MoveToMonitor, buildMoveToMonitorJson(" up ")},
+        {MessageKind::MoveToMonitorIndex, buildMoveToMonitorIndexJson(" up ")},
+        {MessageKind::ToggleVisualizer, {true, buildToggleVisualizerJson()}},
+    };
+    for (const auto& [kind, legacy] : rows) {
+        PluginMessage m;
+        ASSERT_TRUE(PluginMessage::withArg(kind, " up ", m));
+        ASSERT_EQ(buildMessageJson(m), legacy.value);
+    }
+}
+
+TEST(command_table_frames_use_row_opcode) {
+    for (const auto& spec : DISPATCHER_COMMANDS) {
+        PluginMessage m;
+        ASSERT_TRUE(PluginMessage::withArg(spec.kind, "1", m));
+        std::string out;
+        buildMessageFrame(m, out);
+        ASSERT_EQ(static_cast<int>(static_cast<uint8_t>(out[0])), static_cast<int>(spec.opcode));
+        ASSERT_EQ(out.size(), spec.arg == ArgKind::None ? size_t{2} : size_t{3});
+    }
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Pre-parsed frames — dispatcher arguments parsed once in the plugin
+// ═══════════════════════════════════════════════════════════════════════════
+
+static std::string parsedFrame(MessageKind kind, std::string_view arg) {
+    return std::string(parseCommandFrame(*commandFor(kind), arg).view());
+}
+
+TEST(parsed_frames_match_daemon_layout) {
+    // `decode_parsed` in src/ipc/protocol.rs.
+    ASSERT_EQ(parsedFrame(MessageKind::Go, "right"), std::string("\x81\x01\x01", 3));
+    ASSERT_EQ(parsedFrame(MessageKind::MoveGo, " UpLeft "), std::string("\x82\x01\x04", 3));
+    ASSERT_EQ(parsedFrame(MessageKind::MoveToMonitor, "down_right"), std::string("\x84\x01\x07", 3));
+    ASSERT_EQ(parsedFrame(MessageKind::Switch, " 2 1 "), std::string("\x83\x08\x02\0\0\0\x01\0\0\0", 10));
+    ASSERT_EQ(parsedFrame(MessageKind::MoveToMonitorIndex, "258"), std::string("\x85\x04\x02\x01\0\0", 6));
+    ASSERT_EQ(parsedFrame(MessageKind::ToggleVisualizer, ""), std::string());
+}
+
+TEST(folded_go_presses_go_out_as_one_gon_frame) {
+    PluginMessage m;
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Go, "right", m));
+    m.repeat = 2;
+    m.seq    = 7;
+    std::string      out;
+    ParsedFrameCache cache;
+    // `op::GO_N` in src/ipc/protocol.rs, sequenced as any other command.
+    encodeMessage(m, WireFormat::Binary, out, &cache);
+    ASSERT_EQ(out, std::string("\x15\x0b\x07\0\0\0\x17\x05\x01\x03\0\0\0", 13));
+
+    // Without version 2 every press goes out, the last one acknowledged.
+    encodeMessage(m, WireFormat::Json, out);
+    ASSERT_EQ(out, std::string("{\"Go\":\"right\"}\n{\"Go\":\"right\"}\n{\"seq\":7,\"cmd\":{\"Go\":\"right\"}}\n"));
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Go, "sideways", m));
+    m.repeat = 1;
+    encodeMessage(m, WireFormat::Binary, out, &cache);
+    ASSERT_EQ(out, std::string("\x01\x08sideways\x01\x08sideways", 20));
+}
+
+TEST(spsc_ring_front_peeks_without_popping) {
+    SpscRing<int, 4> ring;
+    ASSERT_TRUE(ring.front() == nullptr);
+    ring.push(1);
+    ring.push(2);
+    ASSERT_EQ(*ring.front(), 1);
+    int v = 0;
+    ring.pop(v);
+    ASSERT_EQ(*ring.front(), 2);
+    ASSERT_EQ(ring.size(), size_t{1});
+}
+
+TEST(unparsed_arguments_have_no_parsed_frame) {
+    // These go out as strings, for the daemon to accept or report.
+    ASSERT_EQ(parsedFrame(MessageKind::Go, "sideways"), std::string());
+    ASSERT_EQ(parsedFrame(MessageKind::Switch, "2"), std::string());
+    ASSERT_EQ(parsedFrame(MessageKind::Switch, "4294967296 0"), std::string());
+    ASSERT_EQ(parsedFrame(MessageKind::MoveToMonitorIndex, "+1"), std::string());
+
+    std::string      out;
+    ParsedFrameCache cache;
+    PluginMessage    m;
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Go, "sideways", m));
+    buildMessageFrame(m, out, &cache);
+    ASSERT_EQ(out, std::string("\x01\x08sideways", 10));
+}
+
+TEST(parsed_frame_cache_parses_each_argument_once) {
+    ParsedFrameCache   cache;
+    const ParsedFrame& first = cache.lookup(MessageKind::Go, "left");
+    ASSERT_TRUE(&cache.lookup(MessageKind::Go, "left") == &first);
+    ASSERT_EQ(cache.size(), size_t{1});
+    ASSERT_EQ(std::string(cache.lookup(MessageKind::MoveGo, "left").view()), std::string("\x82\x01\x00", 3));
+    ASSERT_EQ(cache.size(), size_t{2});
+    ASSERT_EQ(cache.lookup(MessageKind::SwipeEnd, "left").len, uint8_t{0});
+
+    // Past the key length, or once full, arguments are parsed every time.
+    const std::string longArg = std::string(ParsedFrameCache::MAX_KEY, ' ') + "up";
+    ASSERT_EQ(std::string(cache.lookup(MessageKind::Go, longArg).view()), std::string("\x81\x01\x02", 3));
+    for (uint32_t i = 0; i < 2 * ParsedFrameCache::SLOTS; ++i) {
+        const std::string arg = std::to_string(i) + " 0";
+        ASSERT_EQ(std::string(cache.lookup(MessageKind::Switch, arg).view()).substr(2, 1), std::string(1, static_cast<char>(i)));
+    }
+    ASSERT_EQ(cache.size(), ParsedFrameCache::SLOTS);
+    ASSERT_TRUE(&cache.lookup(MessageKind::Go, "left") == &first);
+
+    // A cached argument is copied out without allocating.
+    PluginMessage m;
+    ASSERT_TRUE(PluginMessage::withArg(MessageKind::Go, "left", m));
+    m.seq = 3;
+    std::string out;
+    out.reserve(ENCODED_MESSAGE_CAPACITY);
+    const size_t before = g_allocations;
+    encodeMessage(m, WireFormat::Binary, out, &cache);
+    ASSERT_EQ(g_allocations, before);
+    ASSERT_EQ(out, std::string("\x15\x07\x03\0\0\0\x81\x01\x00", 9));
+}
+
+// ═══════════════════════════════════════════════════════════════════════════
+// Acknowledgements — sequenced commands and the daemon's replies
+// ═══════════════════════════════════════════════════════════════════════════
+
+/// A Go command numbered `seq`, as the writer sends it.
+static PluginMessage sequencedGo(std::string_view dir, uint32_t seq) {
+    PluginMessage m;
+    PluginMessage::withArg(MessageKind::Go, dir, m);
+    m.seq = seq;
+    return m;
+}
+
+TEST(sequenced_message_encodings) {
+    std::string out;
+    encodeMessage(sequencedGo("right", 7), WireFormat::Json, out);
+    ASSERT_EQ(out, std::string(R"({"seq":7,"cmd":{"Go":"right"}})") + "\n");
+    encodeMessage(sequencedGo("right", 4294967295u), WireFormat::Json, out);
+    ASSERT_EQ(out, std::string(R"({"seq":4294967295,"cmd":{"Go":"right"}})") + "\n");
+
+    // `encode_sequenced` in src/ipc/protocol.rs.
+    encodeMessage(sequencedGo("up", 0x0102), WireFormat::Binary, out);
+    ASSERT_EQ(out, std::string("\x15\x08\x02\x01\0\0\x01\x02up", 10));
+    encodeMessage(sequencedGo("up", 0), WireFormat::Binary, out);
+    ASSERT_EQ(out, std::string("\x01\x02up", 4));
+    ASSERT_TRUE(wantsAck(MessageKind::ToggleVisualizer));
+    ASSERT_FALSE(wantsAck(MessageKind::SwipeUpdate));
+}
+
+TEST(ack_replies_parse_like_daemon_writes_them) {
+    // `format_ack` in src/ipc/ack.rs.
+    const auto ok = parseAckReply("ACK 7 ok 153200");
+    ASSERT_TRUE(ok && ok->seq == 7 && ok->ok && ok->handleNs == 153200);
+    const auto err = parseAckReply("ACK 8 err 41 no active monitor");
+    ASSERT_TRUE(err && !err->ok && err->handleNs == 41);
+    ASSERT_EQ(err->error, std::string_view("no active monitor"));
+    ASSERT_FALSE(parseAckReply("OK shm").has_value());
+    ASSERT_FALSE(parseAckReply("ACK 0 ok 1").has_value());
+    ASSERT_FALSE(parseAckReply("ACK 7 ok").has_value());
+    ASSERT_FALSE(parseAckReply("ACK 7 ok 1 trailing").has_value());
+    ASSERT_FALSE(parseAckReply("ACK x ok 1").has_value());
+}
+
+TEST(ack_tracker_matches_replies_to_sent_commands) {
+    AckTracker<PluginMessage> acks;
+    acks.sent(sequencedGo("right", 1), 1000);
+    acks.sent(sequencedGo("left", 2), 2000);
+    ASSERT_EQ(acks.pending(), size_t{2});
+
+    const auto failed = acks.received("ACK 2 err 300 no active monitor", 5000);
+    ASSERT_TRUE(failed.has_value() && !failed->ok);
+    ASSERT_EQ(failed->msg.argument(), std::string_view("left"));
+    ASSERT_EQ(failed->roundTripNs, uint64_t{3000});
+    ASSERT_EQ(failed->handleNs, uint64_t{300});
+    ASSERT_EQ(failed->errorText(), std::string_view("no active monitor"));
+    ASSERT_EQ(describeAckFailure(*failed),
+              std::string("go left failed: no active monitor (daemon 0.0 ms, round trip 0.0 ms)"));
+
+    ASSERT_TRUE(acks.received("ACK 1 ok 10", 6000)->ok);
+    ASSERT_FALSE(acks.received("ACK 1 ok 10", 6000).has_value()); // answered already
+    ASSERT_FALSE(acks.received("ACK 9 ok 10", 6000).has_value()); // never sent
+    ASSERT_EQ(acks.stats().acked.load(), uint64_t{1});
+    ASSERT_EQ(acks.stats().failed.load(), uint64_t{1});
+}
+
+TEST(ack_tracker_counts_unanswered_commands_as_lost) {
+    AckTracker<PluginMessage> acks;
+    acks.sent(sequencedGo("right", 3), 0);
+    // A full window later the slot is reused.
+    acks.sent(sequencedGo("right", 3 + AckTracker<PluginMessage>::WINDOW), 0);
+    ASSERT_EQ(acks.stats().lost.load(), uint64_t{1});
+    ASSERT_FALSE(acks.received("ACK 3 ok 1", 0).has_value());
+    acks.sent(sequencedGo("right", 4), 0);
+    ASSERT_EQ(acks.reset(), size_t{2});
+    ASSERT_EQ(acks.stats().lost.load(), uint64_t{3});
+    ASSERT_EQ(acks.pending(), size_t{0});
+}
+
+TEST(queue_reports_commands_the_daemon_rejects) {
+    auto path   = testSocketPath("acks");
+    int  server = listenOn(path);
+
+    // A daemon that agrees to acks and fails every command it is sent.
+    std::string hello, line;
+    std::thread daemon([&] {
+        int client = accept(server, nullptr, nullptr);
+        hello      = readLine(client);
+        std::string reply = std::string(PROTOCOL_ACCEPT_ACKS) + "\n";
+        (void)!write(client, reply.data(), reply.size());
+        line = readLine(client);
+        reply = "ACK 1 err 5 no active monitor\n";
+        (void)!write(client, reply.data(), reply.size());
+        readLine(client); // until the writer hangs up
+        close(client);
+    });
+
+    SendQueue queue;
+    queue.configure({.acks = true});
+    queue.start(path);
+    PluginMessage go;
+    PluginMessage::withArg(MessageKind::Go, "right", go);
+    ASSERT_TRUE(queue.enqueue(go, FullPolicy::Drop));
+
+    // The main thread hears about it through the eventfd.
+    struct pollfd pfd = {.fd = queue.ackFailureFd(), .events = POLLIN, .revents = 0};
+    ASSERT_EQ(poll(&pfd, 1, 2000), 1);
+    AckFailure failure;
+    ASSERT_TRUE(queue.popAckFailure(failure));
+    ASSERT_EQ(failure.msg.argument(), std::string_view("right"));
+    ASSERT_EQ(failure.errorText(), std::string_view("no active monitor"));
+    ASSERT_EQ(queue.ackStats().failed.load(), uint64_t{1});
+
+    queue.stop();
+    daemon.join();
+    ASSERT_EQ(hello, std::string(PROTOCOL_HELLO_ACKS));
+    ASSERT_EQ(line, std::string(R"({"seq":1,"cmd":{"Go":"right"}})"));
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(queue_asks_for_acks_after_a_reload) {
+    auto path   = testSocketPath("acks-reload");
+    int  server = listenOn(path);
+
+    SendQueue queue;
+    queue.start(path);
+    int first = accept(server, nullptr, nullptr);
+    ASSERT_TRUE(eventually([&] { return queue.daemonAlive(); }));
+
+    queue.configure({.acks = true});
+    char eof = 0;
+    ASSERT_EQ(read(first, &eof, 1), ssize_t{0});
+    int second = accept(server, nullptr, nullptr);
+    ASSERT_EQ(readLine(second), std::string(PROTOCOL_HELLO_ACKS));
+
+    close(second);
+    queue.stop();
+    close(first);
+    close(server);
+    unlink(path.c_str());
+}
+
+TEST(connection_sends_plain_commands_when_daemon_declines_acks) {
+    auto path   = testSocketPath("acks-declined");
+    int  server = listenOn(path);
+
+    std::thread daemon([&] {
+        int client = accept(server, nullptr, nullptr);
+        readLine(client);
+        (void)!write(client, "OK json\n", 8);
+        close(client);
+    });
+
+    DaemonConnection conn;
+    conn.setPath(path);
+    conn.setAcks(true);
+    ASSERT_TRUE(conn.connect());
+    ASSERT_FALSE(conn.acks());
+    daemon.join();
+    close(server);
+    unlink(path.c_str());
+}
+
 // ═══════════════════════════════════════════════════════════════════════════
 
 int main() {
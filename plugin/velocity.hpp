@@ -0,0 +1,90 @@
+// velocity.hpp — Release velocity of a swipe, from raw input timestamps.
+//
+// Mirrors `VelocityWindow` in src/hyprland/gestures.rs; keep the two in sync.
+//
+// The daemon decides on release whether a swipe commits.  With the release
+// velocity it can project where a quick flick was heading instead of
+// making it travel the whole commit threshold.  The plugin is the right
+// place to measure it: it sees every input event (the daemon only gets
+// coalesced updates) and the time the fingers lifted, so a swipe that came
+// to rest before lifting reports no velocity at all.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/// How much recent motion the velocity looks at.
+inline constexpr uint32_t VELOCITY_WINDOW_MS = 50;
+
+/// A velocity in pixels per second.
+struct SwipeVelocity {
+    double vx = 0.0;
+    double vy = 0.0;
+
+    bool operator==(const SwipeVelocity&) const = default;
+};
+
+/// Tracks a gesture's running totals over the last `VELOCITY_WINDOW_MS` of
+/// input.  Times are libinput event timestamps in milliseconds; they may
+/// wrap around.  Main-thread only.
+class VelocityTracker {
+  public:
+    /// Forget the previous gesture; call at swipeBegin.
+    void reset() {
+        m_len  = 0;
+        m_head = 0;
+        m_x = m_y = 0.0;
+    }
+
+    /// Add one update's motion at input time `timeMs`.
+    void add(uint32_t timeMs, double dx, double dy) {
+        m_x += dx;
+        m_y += dy;
+        m_samples[m_head] = {timeMs, m_x, m_y};
+        m_head            = (m_head + 1) % CAPACITY;
+        m_len             = std::min(m_len + 1, CAPACITY);
+    }
+
+    /// Velocity as of `nowMs` (the swipeEnd time; 0 if unknown): between
+    /// the oldest sample inside the window and the latest one, or zero if
+    /// the latest is older than the window or there are no two distinct
+    /// times to compare.
+    SwipeVelocity velocity(uint32_t nowMs) const {
+        if (m_len < 2)
+            return {};
+        const Sample& last = at(m_len - 1);
+        if (nowMs != 0 && nowMs - last.timeMs > VELOCITY_WINDOW_MS)
+            return {}; // at rest before the fingers lifted
+        const Sample* first = nullptr;
+        for (size_t i = m_len - 1; i-- > 0;) {
+            if (last.timeMs - at(i).timeMs > VELOCITY_WINDOW_MS)
+                break;
+            first = &at(i);
+        }
+        if (!first || first->timeMs == last.timeMs)
+            return {};
+        const double perSecond = 1000.0 / static_cast<double>(last.timeMs - first->timeMs);
+        return {(last.x - first->x) * perSecond, (last.y - first->y) * perSecond};
+    }
+
+  private:
+    struct Sample {
+        uint32_t timeMs = 0;
+        double   x      = 0.0; ///< Totals since reset()
+        double   y      = 0.0;
+    };
+
+    /// Enough for the window at 250 Hz.
+    static constexpr size_t CAPACITY = 16;
+
+    /// `i`-th sample, oldest first.
+    const Sample& at(size_t i) const { return m_samples[(m_head + CAPACITY - m_len + i) % CAPACITY]; }
+
+    Sample m_samples[CAPACITY];
+    size_t m_head = 0;
+    size_t m_len  = 0;
+    double m_x    = 0.0;
+    double m_y    = 0.0;
+};
@@ -5,10 +5,13 @@
 //! and [`Direction`] / [`MonitorInfo`] / [`WindowInfo`] provide
 //! the supporting data types.
 //!
-//! The plugin forwards raw arguments; the daemon parses direction strings
+//! Scripts send raw arguments; the daemon parses direction strings
 //! (e.g. "right", "up-left"), SwitchTo ("col row" or {"x", "y"}), and
-//! MoveWindowToMonitorIndex (number or string).
+//! MoveWindowToMonitorIndex (number or string).  The plugin sends them
+//! pre-parsed where the daemon allows it (see [`protocol`](crate::ipc::protocol)).
 
+use crate::ipc::ack::Ack;
+use crate::latency::InputTrace;
 use serde::de::Error as DeError;
 use serde::{Deserialize, Deserializer, Serialize};
 use std::fmt;
@@ -41,23 +44,58 @@ impl fmt::Display for Direction {
     }
 }
 
+impl Direction {
+    /// Every direction, in wire-code order.
+    pub const ALL: [Direction; 8] = [
+        Direction::Left,
+        Direction::Right,
+        Direction::Up,
+        Direction::Down,
+        Direction::UpLeft,
+        Direction::UpRight,
+        Direction::DownLeft,
+        Direction::DownRight,
+    ];
+
+    /// One-byte code of the direction in pre-parsed binary frames (see
+    /// [`protocol`](crate::ipc::protocol)).
+    pub fn code(self) -> u8 {
+        Self::ALL.iter().position(|&d| d == self).unwrap() as u8
+    }
+
+    /// The direction with wire code `code`.
+    pub fn from_code(code: u8) -> Option<Direction> {
+        Self::ALL.get(code as usize).copied()
+    }
+}
+
 /// Parse a direction string (case-insensitive; accepts "right", "up-left", "UpLeft", etc.).
+///
+/// Runs for every dispatcher command, so it squeezes the word into a stack
+/// buffer instead of allocating a normalized copy.
 fn parse_direction(s: &str) -> Option<Direction> {
-    let normalized: String = s
-        .trim()
-        .chars()
-        .filter(|c| !c.is_whitespace() && *c != '_')
-        .flat_map(|c| c.to_lowercase())
-        .collect();
-    match normalized.as_str() {
-        "left" => Some(Direction::Left),
-        "right" => Some(Direction::Right),
-        "up" => Some(Direction::Up),
-        "down" => Some(Direction::Down),
-        "upleft" | "up-left" => Some(Direction::UpLeft),
-        "upright" | "up-right" => Some(Direction::UpRight),
-        "downleft" | "down-left" => Some(Direction::DownLeft),
-        "downright" | "down-right" => Some(Direction::DownRight),
+    let mut word = [0u8; 16];
+    let mut len = 0;
+    for c in s.chars() {
+        if c.is_whitespace() || c == '_' {
+            continue;
+        }
+        // Every spelling is ASCII; anything else can't match.
+        if !c.is_ascii() || len == word.len() {
+            return None;
+        }
+        word[len] = (c as u8).to_ascii_lowercase();
+        len += 1;
+    }
+    match &word[..len] {
+        b"left" => Some(Direction::Left),
+        b"right" => Some(Direction::Right),
+        b"up" => Some(Direction::Up),
+        b"down" => Some(Direction::Down),
+        b"upleft" | b"up-left" => Some(Direction::UpLeft),
+        b"upright" | b"up-right" => Some(Direction::UpRight),
+        b"downleft" | b"down-left" => Some(Direction::DownLeft),
+        b"downright" | b"down-right" => Some(Direction::DownRight),
         _ => None,
     }
 }
@@ -67,8 +105,22 @@ impl<'de> Deserialize<'de> for Direction {
     where
         D: Deserializer<'de>,
     {
-        let s = String::deserialize(deserializer)?;
-        parse_direction(&s).ok_or_else(|| DeError::custom(format!("invalid direction: {:?}", s)))
+        use serde::de::Visitor;
+        struct V;
+        impl<'de> Visitor<'de> for V {
+            type Value = Direction;
+            fn expecting(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+                write!(f, "direction string")
+            }
+            // Borrowed from the input, so parsing doesn't allocate.
+            fn visit_str<E>(self, s: &str) -> Result<Direction, E>
+            where
+                E: DeError,
+            {
+                parse_direction(s).ok_or_else(|| DeError::custom(format!("invalid direction: {:?}", s)))
+            }
+        }
+        deserializer.deserialize_str(V)
     }
 }
 
@@ -113,12 +165,12 @@ impl<'de> Deserialize<'de> for SwitchToTarget {
             where
                 E: DeError,
             {
-                let parts: Vec<&str> = s.trim().split_whitespace().collect();
-                if parts.len() != 2 {
+                let mut parts = s.split_whitespace();
+                let (Some(col), Some(row), None) = (parts.next(), parts.next(), parts.next()) else {
                     return Err(DeError::custom(format!("SwitchTo: expected \"col row\", got {:?}", s)));
-                }
-                let x: usize = parts[0].parse().map_err(|_| DeError::custom("SwitchTo: col must be a non-negative integer"))?;
-                let y: usize = parts[1].parse().map_err(|_| DeError::custom("SwitchTo: row must be a non-negative integer"))?;
+                };
+                let x: usize = col.parse().map_err(|_| DeError::custom("SwitchTo: col must be a non-negative integer"))?;
+                let y: usize = row.parse().map_err(|_| DeError::custom("SwitchTo: row must be a non-negative integer"))?;
                 Ok(SwitchToTarget { x, y })
             }
         }
@@ -157,6 +209,41 @@ impl<'de> Deserialize<'de> for MonitorIndex {
     }
 }
 
+/// Grid dimensions and position, as reported by a plugin that owns the
+/// grid (see [`Command::SyncGrid`]).
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Serialize, Deserialize)]
+pub struct GridSync {
+    pub cols: usize,
+    pub rows: usize,
+    pub col: usize,
+    pub row: usize,
+}
+
+/// What a plugin-side overlay renderer needs to follow swipes on its own
+/// (see [`Command::AttachOverlay`]): the gesture normalisation of
+/// [`GestureConfig`](crate::hyprland::gestures::GestureConfig) and the
+/// timings of [`VisualizerConfig`](crate::config::VisualizerConfig).
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct OverlaySync {
+    pub sensitivity: f64,
+    pub commit_threshold: f64,
+    pub natural_swiping: bool,
+    pub switch_fingers: u32,
+    pub move_fingers: u32,
+    pub fling_lookahead_ms: u32,
+    pub cursor_animation_ms: u64,
+    pub linger_ms: u64,
+    pub fade_out_ms: u64,
+}
+
+/// The finger counts the daemon acts on, for a plugin that decides which
+/// swipes to forward (see [`Command::AttachGestures`]).
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct GestureRoutes {
+    pub switch_fingers: u32,
+    pub move_fingers: u32,
+}
+
 /// Every action the grid switcher can perform.
 ///
 /// Commands are produced by [`CommandSource`](crate::traits::CommandSource)
@@ -169,6 +256,14 @@ pub enum Command {
     /// Move one cell in the given direction, creating the column/row if needed.
     Go(Direction),
 
+    /// Move `count` cells in the given direction at once, straight to the
+    /// final cell: a burst of [`Go`](Command::Go)s folded together (see
+    /// [`CommandIntake`](crate::intake::CommandIntake)).  A count of 0 does
+    /// nothing.
+    ///
+    /// On the wire: `{"GoN":{"dir":"Right","count":3}}`.
+    GoN { dir: Direction, count: u32 },
+
     /// Move the currently active window one cell in the given direction and
     /// follow it.
     MoveWindowAndGo(Direction),
@@ -191,7 +286,15 @@ pub enum Command {
     /// `dx` and `dy` are in the range `[-1.0, 1.0]` and represent how far
     /// along each axis the gesture has traveled relative to one grid cell.
     /// The switcher should show a visualization that tracks this offset.
-    PrepareMove { dx: f64, dy: f64 },
+    ///
+    /// `trace` carries the latency timestamps of the input that produced
+    /// this offset, if the source provides them.
+    PrepareMove {
+        dx: f64,
+        dy: f64,
+        #[serde(default, skip_serializing_if = "Option::is_none")]
+        trace: Option<InputTrace>,
+    },
 
     /// Cancel an in-progress gesture, snapping the visualization back.
     CancelMove,
@@ -210,6 +313,30 @@ pub enum Command {
     /// On the wire this is encoded as the JSON string `"ToggleVisualizer"`.
     ToggleVisualizer,
 
+    /// The Hyprland plugin already switched the workspaces itself (its
+    /// `grid_mode = plugin`); adopt its grid state and update the
+    /// visualizer without touching the window manager.
+    ///
+    /// On the wire: `{"SyncGrid":{"cols":2,"rows":1,"col":1,"row":0}}`.
+    SyncGrid(GridSync),
+
+    /// The Hyprland plugin draws the grid overlay itself (its
+    /// `overlay = plugin`).  The daemon answers with the overlay settings
+    /// and the current cell, mirrors every later move to the plugin, and
+    /// sends nothing to its own visualizer from then on.
+    ///
+    /// Sent by the plugin on every (re)connect.  On the wire this is the
+    /// JSON string `"AttachOverlay"`.
+    AttachOverlay,
+
+    /// The Hyprland plugin routes swipes by finger count.  The daemon
+    /// answers with the finger counts it acts on, and the plugin leaves
+    /// every other swipe to Hyprland without forwarding it.
+    ///
+    /// Sent by the plugin on every (re)connect.  On the wire this is the
+    /// JSON string `"AttachGestures"`.
+    AttachGestures,
+
     //  Raw touchpad swipe events (forwarded by the Hyprland plugin) 
 
     /// A multi-finger swipe has started.
@@ -223,10 +350,91 @@ pub enum Command {
     ///
     /// `dx` / `dy` are raw pixel deltas from the touchpad, **not**
     /// normalised.  The daemon applies sensitivity scaling internally.
-    SwipeUpdate { fingers: u32, dx: f64, dy: f64 },
+    ///
+    /// `trace` holds the input event and send timestamps when the plugin
+    /// attaches them (see [`latency`](crate::latency)).
+    SwipeUpdate {
+        fingers: u32,
+        dx: f64,
+        dy: f64,
+        #[serde(default, skip_serializing_if = "Option::is_none")]
+        trace: Option<InputTrace>,
+    },
+
+    /// Release velocity of the current swipe, in raw pixels per second.
+    ///
+    /// Sent by the plugin right before [`SwipeEnd`](Command::SwipeEnd),
+    /// measured over the last few input events up to the moment the
+    /// fingers lifted — zero if they had come to rest.  Used by the
+    /// predictive commit (see
+    /// [`GestureConfig::fling_lookahead_ms`](crate::hyprland::gestures::GestureConfig::fling_lookahead_ms)).
+    ///
+    /// On the wire: `{"SwipeVelocity":{"vx":850.0,"vy":-12.5}}`.
+    SwipeVelocity { vx: f64, vy: f64 },
 
     /// Fingers lifted — end of a swipe gesture.
     SwipeEnd,
+
+    /// A command its client wants acknowledged (see
+    /// [`ack`](crate::ipc::ack)): handled like the inner command, then
+    /// answered with the outcome and the handling time.
+    ///
+    /// Built by the listener from the `{"seq":…,"cmd":…}` envelope or a
+    /// sequenced frame; it has no JSON form of its own.
+    #[serde(skip)]
+    Acked(Box<Command>, Ack),
+}
+
+impl Command {
+    /// The latency trace of a traced command.
+    pub fn trace(&self) -> Option<&InputTrace> {
+        match self {
+            Command::SwipeUpdate { trace, .. } | Command::PrepareMove { trace, .. } => trace.as_ref(),
+            Command::Acked(cmd, _) => cmd.trace(),
+            _ => None,
+        }
+    }
+
+    /// Stamp the daemon receive time on a traced command.
+    pub fn mark_received(&mut self, now_ns: u64) {
+        match self {
+            Command::SwipeUpdate { trace: Some(t), .. } | Command::PrepareMove { trace: Some(t), .. } => {
+                t.received_ns = now_ns;
+            }
+            Command::Acked(cmd, _) => cmd.mark_received(now_ns),
+            _ => {}
+        }
+    }
+
+    /// How the [`intake`](crate::intake) may treat the command while it
+    /// waits to be handled.
+    pub fn priority(&self) -> Priority {
+        match self {
+            Command::SwipeUpdate { .. } | Command::SwipeVelocity { .. } => Priority::Continuous,
+            Command::PrepareMove { .. } => Priority::Visual,
+            _ => Priority::Discrete,
+        }
+    }
+
+    /// Direction and cell count of a plain (unacknowledged) `Go` or `GoN`.
+    pub fn go_steps(&self) -> Option<(Direction, u32)> {
+        match *self {
+            Command::Go(dir) => Some((dir, 1)),
+            Command::GoN { dir, count } => Some((dir, count)),
+            _ => None,
+        }
+    }
+}
+
+/// Priority class of a [`Command`] (see [`intake`](crate::intake)).
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Priority {
+    /// Handled in order; never dropped.
+    Discrete,
+    /// Swipe input, merged into the like input waiting ahead of it.
+    Continuous,
+    /// Visualizer-only; the newest wins and it is dropped once stale.
+    Visual,
 }
 
 /// Static information about a monitor known to the window manager.
@@ -315,6 +523,33 @@ mod tests {
         assert_eq!(Direction::DownRight.to_string(), "down-right");
     }
 
+    #[test]
+    fn direction_spellings() {
+        for (s, d) in [
+            ("right", Direction::Right),
+            (" Left ", Direction::Left),
+            ("UpLeft", Direction::UpLeft),
+            ("up-right", Direction::UpRight),
+            ("down_left", Direction::DownLeft),
+            ("Down Right", Direction::DownRight),
+            ("\u{a0}up\u{a0}", Direction::Up),
+        ] {
+            assert_eq!(parse_direction(s), Some(d), "{:?}", s);
+        }
+        for s in ["", "sideways", "up--left", "rïght", "upupupupupupupupleft"] {
+            assert_eq!(parse_direction(s), None, "{:?}", s);
+        }
+    }
+
+    #[test]
+    fn direction_codes_round_trip() {
+        for (i, d) in Direction::ALL.into_iter().enumerate() {
+            assert_eq!(d.code() as usize, i);
+            assert_eq!(Direction::from_code(d.code()), Some(d));
+        }
+        assert_eq!(Direction::from_code(8), None);
+    }
+
     #[test]
     fn command_equality() {
         assert_eq!(
@@ -323,9 +558,67 @@ mod tests {
         );
         assert_ne!(Command::Go(Direction::Left), Command::Go(Direction::Right));
         assert_eq!(
-            Command::PrepareMove { dx: 0.5, dy: -0.3 },
-            Command::PrepareMove { dx: 0.5, dy: -0.3 }
+            Command::PrepareMove { dx: 0.5, dy: -0.3, trace: None },
+            Command::PrepareMove { dx: 0.5, dy: -0.3, trace: None }
+        );
+    }
+
+    #[test]
+    fn swipe_update_trace_is_optional_on_the_wire() {
+        let plain: Command = serde_json::from_str(r#"{"SwipeUpdate":{"fingers":3,"dx":1.0,"dy":2.0}}"#).unwrap();
+        assert_eq!(plain, Command::SwipeUpdate { fingers: 3, dx: 1.0, dy: 2.0, trace: None });
+        assert_eq!(
+            serde_json::to_string(&plain).unwrap(),
+            r#"{"SwipeUpdate":{"fingers":3,"dx":1.0,"dy":2.0}}"#
         );
+
+        let mut traced: Command = serde_json::from_str(
+            r#"{"SwipeUpdate":{"fingers":3,"dx":1.0,"dy":2.0,"trace":{"input_ms":5,"sent_ns":6000000}}}"#,
+        )
+        .unwrap();
+        traced.mark_received(7_000_000);
+        let expected = InputTrace { input_ms: 5, sent_ns: 6_000_000, received_ns: 7_000_000 };
+        assert_eq!(traced, Command::SwipeUpdate { fingers: 3, dx: 1.0, dy: 2.0, trace: Some(expected) });
+        assert_eq!(traced.trace(), Some(&expected));
+        assert_eq!(plain.trace(), None);
+    }
+
+    #[test]
+    fn sync_grid_wire_form() {
+        let json = r#"{"SyncGrid":{"cols":3,"rows":2,"col":2,"row":1}}"#;
+        let cmd: Command = serde_json::from_str(json).unwrap();
+        assert_eq!(cmd, Command::SyncGrid(GridSync { cols: 3, rows: 2, col: 2, row: 1 }));
+        assert_eq!(serde_json::to_string(&cmd).unwrap(), json);
+    }
+
+    #[test]
+    fn attach_overlay_wire_form() {
+        let cmd: Command = serde_json::from_str(r#""AttachOverlay""#).unwrap();
+        assert_eq!(cmd, Command::AttachOverlay);
+        assert_eq!(serde_json::to_string(&cmd).unwrap(), r#""AttachOverlay""#);
+    }
+
+    #[test]
+    fn go_n_wire_form() {
+        let json = r#"{"GoN":{"dir":"Right","count":3}}"#;
+        let cmd: Command = serde_json::from_str(json).unwrap();
+        assert_eq!(cmd, Command::GoN { dir: Direction::Right, count: 3 });
+        assert_eq!(serde_json::to_string(&cmd).unwrap(), json);
+    }
+
+    #[test]
+    fn attach_gestures_wire_form() {
+        let cmd: Command = serde_json::from_str(r#""AttachGestures""#).unwrap();
+        assert_eq!(cmd, Command::AttachGestures);
+        assert_eq!(serde_json::to_string(&cmd).unwrap(), r#""AttachGestures""#);
+    }
+
+    #[test]
+    fn swipe_velocity_wire_form() {
+        let json = r#"{"SwipeVelocity":{"vx":850.0,"vy":-12.5}}"#;
+        let cmd: Command = serde_json::from_str(json).unwrap();
+        assert_eq!(cmd, Command::SwipeVelocity { vx: 850.0, vy: -12.5 });
+        assert_eq!(serde_json::to_string(&cmd).unwrap(), json);
     }
 
     #[test]
@@ -15,12 +15,15 @@
 //!     "commit_while_dragging_threshold": 0.8,
 //!     "switch_fingers": 3,
 //!     "move_fingers": 4,
-//!     "natural_swiping": true
+//!     "natural_swiping": true,
+//!     "fling_lookahead_ms": 100,
+//!     "speculative_commit": false
 //!   }
 //! }
 //! ```
 
 use crate::hyprland::gestures::GestureConfig;
+use crate::prefetch::PrefetchConfig;
 use serde::{Deserialize, Serialize};
 use std::path::Path;
 
@@ -38,7 +41,8 @@ use std::path::Path;
 ///     "cursor_animation_ms": 80,
 ///     "linger_ms": 300,
 ///     "fade_out_ms": 200
-///   }
+///   },
+///   "prefetch": { "enabled": true, "max_cells": 16 }
 /// }
 /// ```
 #[derive(Debug, Clone, Default, Serialize, Deserialize)]
@@ -50,6 +54,10 @@ pub struct Config {
     /// Visualizer overlay timing and animation settings.
     #[serde(default)]
     pub visualizer: VisualizerConfig,
+
+    /// Keeping neighbouring cells' workspaces warm.
+    #[serde(default)]
+    pub prefetch: PrefetchConfig,
 }
 
 /// Visualizer overlay timing and animation settings.
@@ -158,6 +166,15 @@ mod tests {
         assert_eq!(cfg.visualizer.fade_out_ms, vd.fade_out_ms);
     }
 
+    #[test]
+    fn prefetch_is_opt_in() {
+        let cfg: Config = serde_json::from_str("{}").unwrap();
+        assert!(!cfg.prefetch.enabled);
+        let cfg: Config = serde_json::from_str(r#"{ "prefetch": { "enabled": true } }"#).unwrap();
+        assert!(cfg.prefetch.enabled);
+        assert_eq!(cfg.prefetch.max_cells, PrefetchConfig::default().max_cells);
+    }
+
     #[test]
     fn unknown_top_level_keys_ignored() {
         let json = r#"{ "gestures": {}, "future_section": { "key": 42 } }"#;
@@ -8,6 +8,12 @@
 //!
 //! Mapping a cell to concrete workspace ids for individual monitors is handled
 //! by higher-level orchestration code (see `switcher.rs`).
+//!
+//! Nothing is kept per cell, so a grid a script has grown to hundreds of
+//! columns costs no more than a 2×2 one: a move is the same few additions,
+//! the ids come from the cell alone and don't change as the grid grows, and
+//! the overlays draw only the cells around the cursor (see
+//! [`viewport`](crate::visualizer::viewport)).
 
 use crate::command::Direction;
 
@@ -87,6 +93,25 @@ impl Grid {
         (c, r)
     }
 
+    /// [`get_abs_from`](Grid::get_abs_from) taken `steps` times, without
+    /// walking the steps one by one.
+    pub fn get_abs_from_n(
+        direction: Direction,
+        col: usize,
+        row: usize,
+        steps: usize,
+    ) -> (usize, usize) {
+        // One step from (1, 1) never hits the edge, so it gives the sign of
+        // each axis.
+        let (dc, dr) = Grid::get_abs_from(direction, 1, 1);
+        let walk = |v: usize, d: usize| match d {
+            0 => v.saturating_sub(steps),
+            2 => v.saturating_add(steps),
+            _ => v,
+        };
+        (walk(col, dc), walk(row, dr))
+    }
+
     /// Grow the grid to contain `(col, row)` if needed.
     pub fn grow_to_contain(&mut self, col: usize, row: usize) {
         if col >= self.cols {
@@ -122,6 +147,18 @@ mod tests {
         assert_eq!(target, (0, 1));
     }
 
+    #[test]
+    fn get_abs_from_n_matches_repeated_steps() {
+        for dir in Direction::ALL {
+            let (mut col, mut row) = (2, 1);
+            for _ in 0..4 {
+                (col, row) = Grid::get_abs_from(dir, col, row);
+            }
+            assert_eq!(Grid::get_abs_from_n(dir, 2, 1, 4), (col, row), "{}", dir);
+        }
+        assert_eq!(Grid::get_abs_from_n(Direction::Right, 3, 0, 0), (3, 0));
+    }
+
     #[test]
     fn get_abs_from_left_at_origin_stays() {
         let target = Grid::get_abs_from(Direction::Left, 0, 0);
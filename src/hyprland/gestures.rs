@@ -1,9 +1,17 @@
 //! Translates Hyprland touchpad swipe events into hyprgrd [`Command`]s.
 //!
-//! # How three-finger gestures become `PrepareMove` / `CommitMove`
+//! # One gesture pipeline
 //!
-//! Hyprland emits three event types for touchpad swipes over its IPC event
-//! socket (`socket2`):
+//! Swipes reach the daemon one of two ways, and both end up in the same
+//! place: the raw [`SwipeBegin`](Command::SwipeBegin) /
+//! [`SwipeUpdate`](Command::SwipeUpdate) / [`SwipeEnd`](Command::SwipeEnd)
+//! vocabulary, which the [`GridSwitcher`](crate::switcher::GridSwitcher)
+//! accumulates, normalises and commits.  There is one gesture state
+//! machine, in the switcher, whichever way the swipe came.
+//!
+//! The Hyprland plugin sends those commands over the command socket.
+//! Without the plugin, [`HyprlandGestureSource`] reads them from
+//! Hyprland's IPC event socket (`socket2`), which emits
 //!
 //! | Event           | Payload               | Meaning                               |
 //! |-----------------|-----------------------|---------------------------------------|
@@ -11,27 +19,20 @@
 //! | `swipeupdate`   | `<fingers>,<dx>,<dy>` | Incremental finger movement (pixels)  |
 //! | `swipeend`      | `<fingers>`           | Fingers lifted                        |
 //!
-//! These events are sent in the `EVENT>>DATA\n` format on socket2 at
-//! `$XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/.socket2.sock`.
-//!
-//! [`HyprlandGestureSource`] connects to this socket directly (bypassing
-//! the `hyprland` crate's event listener, which does not expose swipe
-//! events) and:
+//! in the `EVENT>>DATA\n` format at
+//! `$XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/.socket2.sock`.  The
+//! source connects to it directly (bypassing the `hyprland` crate's event
+//! listener, which does not expose swipe events) and passes each swipe of
+//! the configured finger counts on unchanged.
 //!
-//! 1. **`swipebegin` with 3 fingers** → starts accumulating `(dx, dy)`.
-//! 2. **Each `swipeupdate`** → adds the delta to the accumulator, normalises
-//!    to `[-1.0, 1.0]` using [`GestureConfig::sensitivity`], and emits
-//!    [`Command::PrepareMove`].
-//! 3. **`swipeend`** →
-//!    - If the dominant axis exceeds [`GestureConfig::commit_threshold`],
-//!      emits [`Command::CommitMove`] in the corresponding direction.
-//!    - Otherwise emits [`Command::CancelMove`] (snap back).
-//!
-//! Four-finger swipes follow the same flow but emit
-//! [`Command::MoveWindowAndGo`] instead of `CommitMove`, carrying the
-//! active window along.
+//! While a plugin is connected ([`PluginPresence`]) the source leaves the
+//! swipes to it: it looks at the event name only and never parses the
+//! payload, so a swipe is handled once.  A swipe the source was following
+//! when the plugin attached gets a synthetic `SwipeEnd` on its next event,
+//! so the switcher never waits for a release nobody will send.
 
 use crate::command::{Command, Direction};
+use crate::ipc::listener::PluginPresence;
 use crate::traits::CommandSource;
 use log::{debug, error, info, warn};
 use serde::{Deserialize, Serialize};
@@ -57,6 +58,17 @@ use std::sync::mpsc;
 ///
 /// `natural_swiping` inverts the gesture direction (swipe right → grid
 /// moves left, like "natural" scroll).  Default: `true`.
+///
+/// `fling_lookahead_ms` makes the release decision predictive: the offset
+/// tested against `commit_threshold` is where the fingers would be after
+/// that many more milliseconds at their release velocity, so a quick flick
+/// commits without travelling the whole threshold (and a swipe already
+/// heading back cancels).  `0` = decide from displacement alone.
+///
+/// `speculative_commit`: once the gesture is past `commit_threshold` and
+/// its velocity keeps it there, switch the workspaces before the fingers
+/// lift (plain switches only).  If the release then decides otherwise, the
+/// switch is undone.  Default: `false`.
 #[derive(Debug, Clone, Serialize, Deserialize)]
 #[serde(default)]
 pub struct GestureConfig {
@@ -73,6 +85,12 @@ pub struct GestureConfig {
     pub move_fingers: u32,
     /// Invert gesture direction (natural swiping).  Default: `true`.
     pub natural_swiping: bool,
+    /// Milliseconds of release velocity added to the offset before the
+    /// commit decision.  Default: `100`.
+    pub fling_lookahead_ms: u32,
+    /// Switch workspaces before release once the commit is certain.
+    /// Default: `false`.
+    pub speculative_commit: bool,
 }
 
 impl Default for GestureConfig {
@@ -84,40 +102,43 @@ impl Default for GestureConfig {
             switch_fingers: 3,
             move_fingers: 4,
             natural_swiping: true,
+            fling_lookahead_ms: 100,
+            speculative_commit: false,
         }
     }
 }
 
-/// Accumulator for an in-flight swipe gesture.
-#[derive(Debug, Default)]
-struct SwipeState {
-    active: bool,
-    fingers: u32,
-    dx: f64,
-    dy: f64,
-}
-
 /// A [`CommandSource`] that listens to Hyprland swipe events via the raw
-/// IPC event socket and emits grid commands.
+/// IPC event socket and forwards them as raw swipe commands.
 ///
 /// This struct connects directly to Hyprland's event socket (`socket2`)
-/// and translates touchpad swipe gestures into the `PrepareMove` /
-/// `CommitMove` / `CancelMove` command vocabulary that the
-/// [`GridSwitcher`](crate::switcher::GridSwitcher) understands.
+/// and turns touchpad swipes into the `SwipeBegin` / `SwipeUpdate` /
+/// `SwipeEnd` commands the plugin sends, for the
+/// [`GridSwitcher`](crate::switcher::GridSwitcher) to act on.
 pub struct HyprlandGestureSource {
     config: GestureConfig,
+    plugin: PluginPresence,
 }
 
 impl HyprlandGestureSource {
     /// Create a new gesture source with the given configuration.
     pub fn new(config: GestureConfig) -> Self {
-        Self { config }
+        Self {
+            config,
+            plugin: PluginPresence::default(),
+        }
     }
 
     /// Create a gesture source with default settings.
     pub fn with_defaults() -> Self {
         Self::new(GestureConfig::default())
     }
+
+    /// Leave swipes to the plugin while `plugin` says one is connected.
+    pub fn defer_to(mut self, plugin: PluginPresence) -> Self {
+        self.plugin = plugin;
+        self
+    }
 }
 
 /// Determine the dominant direction from accumulated deltas.
@@ -177,11 +198,72 @@ pub(crate) fn normalised_swipe_offset(
     }
 }
 
+/// Raw displacement `(dx, dy)` projected `lookahead_ms` ahead at
+/// `velocity` (pixels per second).
+pub(crate) fn projected_displacement(dx: f64, dy: f64, velocity: (f64, f64), lookahead_ms: u32) -> (f64, f64) {
+    let ahead = f64::from(lookahead_ms) / 1000.0;
+    (dx + velocity.0 * ahead, dy + velocity.1 * ahead)
+}
+
+/// How much recent motion the velocity estimate looks at.  Shared with the
+/// plugin's `VELOCITY_WINDOW_MS` (plugin/velocity.hpp).
+pub(crate) const VELOCITY_WINDOW_MS: u32 = 50;
+
+/// Samples kept by [`VelocityWindow`]; enough for the window at 250 Hz.
+const VELOCITY_SAMPLES: usize = 16;
+
+/// Swipe velocity over the last [`VELOCITY_WINDOW_MS`] of input, from the
+/// gesture's running totals and their input timestamps.
+///
+/// Mirrors `VelocityTracker` in plugin/velocity.hpp, which measures the
+/// release velocity from every raw event; this one only sees the updates
+/// that reach the daemon and serves as the estimate while dragging (and
+/// at release for clients that don't send
+/// [`SwipeVelocity`](Command::SwipeVelocity)).
+#[derive(Debug, Clone, Copy, Default)]
+pub(crate) struct VelocityWindow {
+    /// `(time_ms, total dx, total dy)`, a ring ending at `head`.
+    samples: [(u32, f64, f64); VELOCITY_SAMPLES],
+    head: usize,
+    len: usize,
+}
+
+impl VelocityWindow {
+    /// Record the gesture's totals as of input time `time_ms`.
+    pub(crate) fn push(&mut self, time_ms: u32, dx: f64, dy: f64) {
+        self.samples[self.head] = (time_ms, dx, dy);
+        self.head = (self.head + 1) % VELOCITY_SAMPLES;
+        self.len = (self.len + 1).min(VELOCITY_SAMPLES);
+    }
+
+    /// `i`-th sample, oldest first.
+    fn at(&self, i: usize) -> (u32, f64, f64) {
+        self.samples[(self.head + VELOCITY_SAMPLES - self.len + i) % VELOCITY_SAMPLES]
+    }
+
+    /// Velocity in pixels per second between the oldest sample inside the
+    /// window and the latest one, or `None` without two distinct times.
+    pub(crate) fn velocity(&self) -> Option<(f64, f64)> {
+        let (last_ms, last_dx, last_dy) = self.at(self.len.checked_sub(1)?);
+        let (first_ms, first_dx, first_dy) = (0..self.len - 1)
+            .rev()
+            .map(|i| self.at(i))
+            .take_while(|s| last_ms.wrapping_sub(s.0) <= VELOCITY_WINDOW_MS)
+            .last()?;
+        let dt_ms = last_ms.wrapping_sub(first_ms);
+        if dt_ms == 0 {
+            return None;
+        }
+        let per_s = 1000.0 / f64::from(dt_ms);
+        Some(((last_dx - first_dx) * per_s, (last_dy - first_dy) * per_s))
+    }
+}
+
 /// Resolve the Hyprland event socket path.
 ///
 /// Hyprland stores its sockets at
 /// `$XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/.socket2.sock`.
-fn socket2_path() -> Result<PathBuf, HyprlandGestureError> {
+pub(crate) fn socket2_path() -> Result<PathBuf, HyprlandGestureError> {
     let runtime_dir = std::env::var("XDG_RUNTIME_DIR")
         .map_err(|_| HyprlandGestureError("XDG_RUNTIME_DIR not set".into()))?;
     let his = std::env::var("HYPRLAND_INSTANCE_SIGNATURE")
@@ -195,76 +277,63 @@ fn socket2_path() -> Result<PathBuf, HyprlandGestureError> {
 /// Parse a single event line from socket2.
 ///
 /// Lines have the form `EVENT>>DATA\n`.
-fn parse_event_line(line: &str) -> Option<(&str, &str)> {
+pub(crate) fn parse_event_line(line: &str) -> Option<(&str, &str)> {
     let sep = line.find(">>")?;
     Some((&line[..sep], &line[sep + 2..]))
 }
 
-/// Process a single event and potentially emit commands.
-fn handle_event(
-    event: &str,
-    data: &str,
-    state: &mut SwipeState,
-    config: &GestureConfig,
-    sink: &mpsc::Sender<Command>,
-) {
+/// Parse a `swipeupdate` payload, `<fingers>,<dx>,<dy>`, in place.
+fn parse_swipe_update(data: &str) -> Option<(u32, f64, f64)> {
+    let mut parts = data.trim().splitn(3, ',');
+    let fingers = parts.next()?.parse().ok()?;
+    let dx = parts.next()?.parse().ok()?;
+    let dy = parts.next()?.parse().ok()?;
+    Some((fingers, dx, dy))
+}
+
+/// Translate one socket2 event into a raw swipe command.  `following` is
+/// whether the current swipe has the configured finger counts; updates of
+/// other swipes are not even parsed.
+fn translate_event(event: &str, data: &str, following: &mut bool, config: &GestureConfig) -> Option<Command> {
     match event {
         "swipebegin" => {
-            if let Ok(fingers) = data.trim().parse::<u32>() {
-                if fingers == config.switch_fingers || fingers == config.move_fingers {
-                    debug!("swipe begin: {} fingers", fingers);
-                    state.active = true;
-                    state.fingers = fingers;
-                    state.dx = 0.0;
-                    state.dy = 0.0;
-                }
-            }
+            let fingers = data.trim().parse::<u32>().ok()?;
+            *following = fingers == config.switch_fingers || fingers == config.move_fingers;
+            following.then_some(Command::SwipeBegin { fingers })
         }
-        "swipeupdate" => {
-            if !state.active {
-                return;
-            }
-            // Format: "<fingers>,<dx>,<dy>"
-            let parts: Vec<&str> = data.trim().split(',').collect();
-            if parts.len() == 3 {
-                if let (Ok(dx), Ok(dy)) = (parts[1].parse::<f64>(), parts[2].parse::<f64>()) {
-                    state.dx += dx;
-                    state.dy += dy;
-                    let norm_dx = clamp_unit(state.dx / config.sensitivity);
-                    let norm_dy = clamp_unit(state.dy / config.sensitivity);
-                    debug!("swipe update: dx={:.2} dy={:.2}", norm_dx, norm_dy);
-                    let _ = sink.send(Command::PrepareMove {
-                        dx: norm_dx,
-                        dy: norm_dy,
-                    });
-                }
-            }
+        "swipeupdate" if *following => {
+            let (fingers, dx, dy) = parse_swipe_update(data)?;
+            Some(Command::SwipeUpdate {
+                fingers,
+                dx,
+                dy,
+                trace: None,
+            })
         }
-        "swipeend" => {
-            if !state.active {
-                return;
-            }
-            let norm_dx = clamp_unit(state.dx / config.sensitivity);
-            let norm_dy = clamp_unit(state.dy / config.sensitivity);
-
-            let cmd = match dominant_direction(norm_dx, norm_dy, config.commit_threshold) {
-                Some(dir) if state.fingers == config.move_fingers => {
-                    Command::MoveWindowAndGo(dir)
-                }
-                Some(dir) => Command::CommitMove(dir),
-                None => Command::CancelMove,
-            };
-            debug!("swipe end: {:?}", cmd);
-            let _ = sink.send(cmd);
-
-            state.active = false;
-            state.dx = 0.0;
-            state.dy = 0.0;
-        }
-        _ => {
-            // Ignore events we don't care about.
+        "swipeend" if *following => {
+            *following = false;
+            Some(Command::SwipeEnd)
         }
+        _ => None,
+    }
+}
+
+/// Route one socket2 swipe event: translate it while no plugin is
+/// connected, otherwise leave it to the plugin.  A swipe this source was
+/// following when the plugin attached is ended here, since the plugin
+/// never saw it begin and will not send its `SwipeEnd`.
+fn route_event(
+    event: &str,
+    data: &str,
+    following: &mut bool,
+    plugin_present: bool,
+    config: &GestureConfig,
+) -> Option<Command> {
+    if plugin_present {
+        // The plugin forwards this swipe itself.
+        return std::mem::take(following).then_some(Command::SwipeEnd);
     }
+    translate_event(event, data, following, config)
 }
 
 impl CommandSource for HyprlandGestureSource {
@@ -281,30 +350,40 @@ impl CommandSource for HyprlandGestureSource {
         let stream = UnixStream::connect(&path)
             .map_err(|e| HyprlandGestureError(format!("connect to {}: {}", path.display(), e)))?;
         info!("gesture source connected to {}", path.display());
-        let reader = BufReader::new(stream);
-        let mut state = SwipeState::default();
+        let mut reader = BufReader::new(stream);
+        let mut line = String::new();
+        let mut following = false;
         let mut first_swipe_logged = false;
 
-        for line in reader.lines() {
-            match line {
-                Ok(line) if line.is_empty() => continue,
-                Ok(line) => {
-                    if let Some((raw_event, data)) = parse_event_line(&line) {
-                        // Strip any namespace prefix (e.g. "touchpad:swipebegin" → "swipebegin")
-                        let event = raw_event
-                            .rsplit_once(':')
-                            .map(|(_, name)| name)
-                            .unwrap_or(raw_event);
-
-                        if !first_swipe_logged && event.starts_with("swipe") {
-                            info!(
-                                "first swipe event received: raw={:?} parsed={:?} data={:?}",
-                                raw_event, event, data
-                            );
-                            first_swipe_logged = true;
+        loop {
+            line.clear();
+            match reader.read_line(&mut line) {
+                Ok(0) => break,
+                Ok(_) => {
+                    let Some((raw_event, data)) = parse_event_line(line.trim_end_matches('\n')) else {
+                        continue;
+                    };
+                    // Strip any namespace prefix (e.g. "touchpad:swipebegin" → "swipebegin")
+                    let event = raw_event
+                        .rsplit_once(':')
+                        .map(|(_, name)| name)
+                        .unwrap_or(raw_event);
+                    if !event.starts_with("swipe") {
+                        continue;
+                    }
+                    let plugin_present = self.plugin.is_present();
+                    if !plugin_present && !first_swipe_logged {
+                        info!(
+                            "first swipe event received: raw={:?} parsed={:?} data={:?}",
+                            raw_event, event, data
+                        );
+                        first_swipe_logged = true;
+                    }
+                    if let Some(cmd) = route_event(event, data, &mut following, plugin_present, &self.config) {
+                        debug!("socket2 swipe: {:?}", cmd);
+                        if sink.send(cmd).is_err() {
+                            return Ok(());
                         }
-
-                        handle_event(event, data, &mut state, &self.config, &sink);
                     }
                 }
                 Err(e) => {
@@ -402,6 +481,52 @@ mod tests {
         assert_eq!(cfg.switch_fingers, 3);
         assert_eq!(cfg.move_fingers, 4);
         assert!(cfg.natural_swiping);
+        assert_eq!(cfg.fling_lookahead_ms, 100);
+        assert!(!cfg.speculative_commit);
+    }
+
+    #[test]
+    fn velocity_needs_two_distinct_times() {
+        let mut w = VelocityWindow::default();
+        assert_eq!(w.velocity(), None);
+        w.push(100, 5.0, 0.0);
+        assert_eq!(w.velocity(), None);
+        w.push(100, 9.0, 0.0);
+        assert_eq!(w.velocity(), None);
+        w.push(110, 15.0, -2.0);
+        assert_eq!(w.velocity(), Some((1000.0, -200.0)));
+    }
+
+    #[test]
+    fn velocity_only_looks_at_recent_motion() {
+        let mut w = VelocityWindow::default();
+        // Input times wrap around during the gesture.
+        let base = u32::MAX - 100;
+        // A slow start...
+        for t in 0..5u32 {
+            w.push(base + t * 20, f64::from(t), 0.0);
+        }
+        // ...then a flick: 40 px in the last 40 ms.
+        w.push(base.wrapping_add(100), 10.0, 0.0);
+        w.push(base.wrapping_add(120), 30.0, 0.0);
+        w.push(base.wrapping_add(140), 50.0, 0.0);
+        assert_eq!(w.velocity(), Some((1000.0, 0.0)));
+    }
+
+    #[test]
+    fn velocity_ring_wraps() {
+        let mut w = VelocityWindow::default();
+        for t in 0..100u32 {
+            w.push(t * 4, f64::from(t) * 2.0, 0.0);
+        }
+        // 2 px every 4 ms, across the 48 ms the ring still holds.
+        assert_eq!(w.velocity(), Some((500.0, 0.0)));
+    }
+
+    #[test]
+    fn projection_adds_lookahead_of_velocity() {
+        assert_eq!(projected_displacement(40.0, -10.0, (1000.0, 0.0), 100), (140.0, -10.0));
+        assert_eq!(projected_displacement(40.0, -10.0, (1000.0, 0.0), 0), (40.0, -10.0));
     }
 
     #[test]
@@ -421,142 +546,91 @@ mod tests {
         assert_eq!(parse_event_line("garbage"), None);
     }
 
-    #[test]
-    fn handle_event_swipe_begin_activates_state() {
-        let cfg = GestureConfig::default();
-        let (tx, _rx) = mpsc::channel();
-        let mut state = SwipeState::default();
-
-        handle_event("swipebegin", "3", &mut state, &cfg, &tx);
-        assert!(state.active);
-        assert_eq!(state.fingers, 3);
+    /// Feed `events` through [`route_event`] like the socket2 loop, with
+    /// no plugin connected.
+    fn translate_all(events: &[(&str, &str)]) -> Vec<Command> {
+        route_all(&events.iter().map(|&(event, data)| (event, data, false)).collect::<Vec<_>>())
     }
 
-    #[test]
-    fn handle_event_swipe_begin_ignores_wrong_finger_count() {
+    /// Like [`translate_all`], with whether a plugin is connected at each
+    /// event.
+    fn route_all(events: &[(&str, &str, bool)]) -> Vec<Command> {
         let cfg = GestureConfig::default();
-        let (tx, _rx) = mpsc::channel();
-        let mut state = SwipeState::default();
-
-        handle_event("swipebegin", "2", &mut state, &cfg, &tx);
-        assert!(!state.active);
+        let mut following = false;
+        events
+            .iter()
+            .filter_map(|(event, data, present)| route_event(event, data, &mut following, *present, &cfg))
+            .collect()
     }
 
     #[test]
-    fn handle_event_swipe_update_accumulates_and_emits() {
-        let cfg = GestureConfig::default();
-        let (tx, rx) = mpsc::channel();
-        let mut state = SwipeState {
-            active: true,
-            fingers: 3,
-            dx: 0.0,
-            dy: 0.0,
-        };
-
-        handle_event("swipeupdate", "3,50.0,10.0", &mut state, &cfg, &tx);
-        assert_eq!(state.dx, 50.0);
-        assert_eq!(state.dy, 10.0);
-
-        let cmd = rx.try_recv().unwrap();
+    fn socket2_leaves_swipes_to_a_connected_plugin() {
         assert_eq!(
-            cmd,
-            Command::PrepareMove {
-                dx: 50.0 / cfg.sensitivity,
-                dy: 10.0 / cfg.sensitivity,
-            }
+            route_all(&[("swipebegin", "3", true), ("swipeupdate", "3,25.0,0.0", true), ("swipeend", "3", true)]),
+            vec![]
         );
     }
 
     #[test]
-    fn handle_event_swipe_end_commits_right() {
-        let cfg = GestureConfig::default();
-        let (tx, rx) = mpsc::channel();
-        let mut state = SwipeState {
-            active: true,
-            fingers: 3,
-            dx: 250.0,
-            dy: 10.0,
-        };
-
-        handle_event("swipeend", "3", &mut state, &cfg, &tx);
-        let cmd = rx.try_recv().unwrap();
-        assert_eq!(cmd, Command::CommitMove(Direction::Right));
-        assert!(!state.active);
+    fn socket2_ends_its_swipe_when_the_plugin_attaches_mid_swipe() {
+        assert_eq!(
+            route_all(&[
+                ("swipebegin", "3", false),
+                ("swipeupdate", "3,25.0,0.0", false),
+                ("swipeupdate", "3,30.0,0.0", true),
+                ("swipeupdate", "3,35.0,0.0", true),
+                ("swipeend", "3", true),
+            ]),
+            vec![
+                Command::SwipeBegin { fingers: 3 },
+                Command::SwipeUpdate { fingers: 3, dx: 25.0, dy: 0.0, trace: None },
+                Command::SwipeEnd,
+            ]
+        );
+        // Once the plugin leaves again, the next swipe is the source's.
+        assert_eq!(
+            route_all(&[("swipebegin", "3", false), ("swipeend", "3", true), ("swipebegin", "4", false)]),
+            vec![Command::SwipeBegin { fingers: 3 }, Command::SwipeEnd, Command::SwipeBegin { fingers: 4 }]
+        );
     }
 
     #[test]
-    fn handle_event_swipe_end_cancels_small_gesture() {
-        let cfg = GestureConfig::default();
-        let (tx, rx) = mpsc::channel();
-        let mut state = SwipeState {
-            active: true,
-            fingers: 3,
-            dx: 10.0,
-            dy: 5.0,
-        };
-
-        handle_event("swipeend", "3", &mut state, &cfg, &tx);
-        let cmd = rx.try_recv().unwrap();
-        assert_eq!(cmd, Command::CancelMove);
+    fn socket2_swipes_become_raw_swipe_commands() {
+        assert_eq!(
+            translate_all(&[("swipebegin", "3"), ("swipeupdate", "3,25.0,-2.5"), ("swipeend", "3")]),
+            vec![
+                Command::SwipeBegin { fingers: 3 },
+                Command::SwipeUpdate { fingers: 3, dx: 25.0, dy: -2.5, trace: None },
+                Command::SwipeEnd,
+            ]
+        );
     }
 
     #[test]
-    fn handle_event_four_finger_swipe_moves_window() {
-        let cfg = GestureConfig::default();
-        let (tx, rx) = mpsc::channel();
-        let mut state = SwipeState {
-            active: true,
-            fingers: 4,
-            dx: -300.0,
-            dy: 10.0,
-        };
-
-        handle_event("swipeend", "4", &mut state, &cfg, &tx);
-        let cmd = rx.try_recv().unwrap();
-        assert_eq!(cmd, Command::MoveWindowAndGo(Direction::Left));
+    fn socket2_ignores_other_finger_counts() {
+        assert_eq!(
+            translate_all(&[("swipebegin", "2"), ("swipeupdate", "2,25.0,0.0"), ("swipeend", "2")]),
+            vec![]
+        );
+        // A four-finger swipe is the configured move gesture.
+        assert_eq!(translate_all(&[("swipebegin", "4")]), vec![Command::SwipeBegin { fingers: 4 }]);
     }
 
-    /// End-to-end simulation: begin → multiple updates → end.
     #[test]
-    fn full_gesture_simulation() {
-        let cfg = GestureConfig::default();
-        let (tx, rx) = mpsc::channel();
-        let mut state = SwipeState::default();
-
-        // Begin
-        handle_event("swipebegin", "3", &mut state, &cfg, &tx);
-        assert!(state.active);
-
-        // Simulate 10 incremental rightward updates (25px each)
-        for _ in 0..10 {
-            handle_event("swipeupdate", "3,25.0,2.0", &mut state, &cfg, &tx);
-        }
-
-        // End
-        handle_event("swipeend", "3", &mut state, &cfg, &tx);
-
-        let cmds: Vec<Command> = rx.try_iter().collect();
-        // 10 PrepareMove + 1 CommitMove
-        assert_eq!(cmds.len(), 11);
-
-        // All intermediate commands are PrepareMove
-        for cmd in &cmds[..10] {
-            assert!(matches!(cmd, Command::PrepareMove { .. }));
-        }
-
-        // Final command commits rightward
-        assert_eq!(cmds[10], Command::CommitMove(Direction::Right));
+    fn socket2_skips_malformed_updates() {
+        assert_eq!(parse_swipe_update(" 3,10.5,-2.3\n"), Some((3, 10.5, -2.3)));
+        assert_eq!(parse_swipe_update("3,10.5"), None);
+        assert_eq!(parse_swipe_update("3,10.5,-2.3,1"), None);
+        assert_eq!(parse_swipe_update("3,x,1"), None);
+        assert_eq!(
+            translate_all(&[("swipebegin", "3"), ("swipeupdate", "3,oops"), ("swipeend", "3")]),
+            vec![Command::SwipeBegin { fingers: 3 }, Command::SwipeEnd]
+        );
     }
 
     /// Unknown events are silently ignored.
     #[test]
     fn unknown_events_ignored() {
-        let cfg = GestureConfig::default();
-        let (tx, rx) = mpsc::channel();
-        let mut state = SwipeState::default();
-
-        handle_event("workspace", "2", &mut state, &cfg, &tx);
-        handle_event("activewindow", "kitty,~", &mut state, &cfg, &tx);
-        assert!(rx.try_recv().is_err());
+        assert_eq!(translate_all(&[("workspace", "2"), ("activewindow", "kitty,~"), ("swipeend", "3")]), vec![]);
     }
 }
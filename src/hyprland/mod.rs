@@ -8,6 +8,8 @@
 //! Nothing outside this module should reference Hyprland directly.
 
 pub mod gestures;
+pub mod pipeline;
+pub mod state;
 pub mod wm;
 
 
@@ -0,0 +1,103 @@
+//! Hyprland IPC requests kept in flight off the event loop.
+//!
+//! Hyprland's command socket answers one request per connection, so the
+//! only way to wait for a request is to wait for its whole round trip.
+//! Made on the event loop, every workspace switch, plugin sync and
+//! prefetch would hold up the commands behind it, swipe updates included.
+//!
+//! A [`Lane`] is a worker thread that carries out requests in the order
+//! they were given.  [`HyprlandWm`](super::wm::HyprlandWm) keeps two: one
+//! for workspace switches and window moves, whose order matters, and one
+//! for the fire-and-forget plugin syncs and prefetching.  The two are in
+//! flight side by side, each on its own connection, and the caller only
+//! waits when it needs an outcome ([`Pending::wait`]).
+
+use crate::traits::Pending;
+use log::warn;
+use std::sync::mpsc;
+
+type Job = Box<dyn FnOnce() + Send>;
+
+/// A worker thread running requests one after another.
+pub struct Lane {
+    /// `None` if the thread couldn't be started; requests then run on the
+    /// caller's thread.
+    jobs: Option<mpsc::Sender<Job>>,
+}
+
+impl Lane {
+    /// Start a lane on a thread called `name`.  The thread exits once the
+    /// lane is dropped and its queued requests are done.
+    pub fn spawn(name: &str) -> Self {
+        let (tx, rx) = mpsc::channel::<Job>();
+        let spawned = std::thread::Builder::new().name(name.into()).spawn(move || {
+            for job in rx {
+                job();
+            }
+        });
+        match spawned {
+            Ok(_) => Self { jobs: Some(tx) },
+            Err(e) => {
+                warn!("{} not started, requests will block: {}", name, e);
+                Self { jobs: None }
+            }
+        }
+    }
+
+    /// Run `job` after everything already given to the lane.
+    pub fn run(&self, job: impl FnOnce() + Send + 'static) {
+        let job: Job = Box::new(job);
+        match &self.jobs {
+            Some(tx) => {
+                // A worker that died (it never should) hands the job back.
+                if let Err(mpsc::SendError(job)) = tx.send(job) {
+                    job();
+                }
+            }
+            None => job(),
+        }
+    }
+
+    /// Run `job` as for [`run`](Self::run), and return its outcome to wait
+    /// for.
+    pub fn start<E: Into<String>>(&self, job: impl FnOnce() -> Result<(), E> + Send + 'static) -> Pending {
+        let (tx, pending) = Pending::channel();
+        self.run(move || {
+            let _ = tx.send(job().map_err(Into::into));
+        });
+        pending
+    }
+}
+
+//  Tests
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::{Arc, Mutex};
+
+    #[test]
+    fn lane_runs_requests_in_order() {
+        let lane = Lane::spawn("test-lane");
+        let log = Arc::new(Mutex::new(Vec::new()));
+        for i in 0..5 {
+            let log = log.clone();
+            lane.run(move || log.lock().unwrap().push(i));
+        }
+        let last = lane.start(|| Err("last"));
+        assert_eq!(last.wait(), Err("last".into()));
+        assert_eq!(*log.lock().unwrap(), vec![0, 1, 2, 3, 4]);
+    }
+
+    #[test]
+    fn lane_without_a_thread_runs_inline() {
+        let lane = Lane { jobs: None };
+        let ran = Arc::new(Mutex::new(false));
+        {
+            let ran = ran.clone();
+            lane.run(move || *ran.lock().unwrap() = true);
+        }
+        assert!(*ran.lock().unwrap());
+        assert_eq!(lane.start(|| Ok::<_, String>(())).wait(), Ok(()));
+    }
+}
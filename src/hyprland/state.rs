@@ -0,0 +1,305 @@
+//! Cached Hyprland monitor / focus state, kept current by socket2 events.
+//!
+//! [`HyprlandWm`](super::wm::HyprlandWm) asks for the monitor list, the
+//! focused monitor and the active window on every grid move.  Instead of a
+//! `j/monitors` / `j/activewindow` round trip each time, the answers are
+//! cached in a [`WmStateCache`] and dropped again when Hyprland's event
+//! socket (`socket2`) reports a change:
+//!
+//! | Event | Effect |
+//! |---|---|
+//! | `focusedmon>>MON,WS` (and `focusedmonv2`) | focused monitor := `MON` |
+//! | `monitoradded`, `monitorremoved` (and `v2`), `configreloaded` | everything invalidated |
+//! | `activewindow`, `activewindowv2`, `movewindow`, `movewindowv2`, `closewindow` | active window invalidated |
+//!
+//! The cache only serves answers while [`watch`] is connected to socket2;
+//! without the event stream nobody would invalidate it, so every lookup
+//! falls through to a fresh query.
+
+use super::gestures::{parse_event_line, socket2_path};
+use crate::command::{MonitorInfo, WindowInfo};
+use log::{debug, info, warn};
+use std::io::{BufRead, BufReader};
+use std::os::unix::net::UnixStream;
+use std::path::Path;
+use std::sync::{Arc, Mutex, MutexGuard};
+use std::time::Duration;
+
+/// How long [`watch`] waits before reconnecting to a lost socket2.
+const RECONNECT_DELAY: Duration = Duration::from_secs(1);
+
+/// A monitor as cached: its Hyprland id plus the public info.
+#[derive(Debug, Clone, PartialEq, Eq)]
+pub struct CachedMonitor {
+    pub id: i64,
+    pub info: MonitorInfo,
+}
+
+/// Monitor list, focused monitor and active window, each `None` until
+/// queried (or after an event invalidated it).
+#[derive(Debug, Default)]
+struct CachedState {
+    /// socket2 is connected, so cached answers are kept current.
+    live: bool,
+    /// Bumped by every event; a query result is only stored if no event
+    /// arrived while it was in flight.
+    generation: u64,
+    monitors: Option<Vec<CachedMonitor>>,
+    focused: Option<Option<String>>,
+    active_window: Option<Option<WindowInfo>>,
+}
+
+/// Thread-safe cache shared between the window manager and the socket2
+/// watcher thread.
+#[derive(Debug, Default)]
+pub struct WmStateCache {
+    state: Mutex<CachedState>,
+}
+
+impl WmStateCache {
+    pub fn new() -> Self {
+        Self::default()
+    }
+
+    fn lock(&self) -> MutexGuard<'_, CachedState> {
+        self.state.lock().unwrap_or_else(|e| e.into_inner())
+    }
+
+    /// Token to pass to the `store_*` methods: take it before issuing the
+    /// query whose result will be stored.
+    pub fn generation(&self) -> u64 {
+        self.lock().generation
+    }
+
+    /// Cached monitor list.
+    pub fn monitors(&self) -> Option<Vec<CachedMonitor>> {
+        self.lock().monitors.clone()
+    }
+
+    /// Cached focused monitor (`Some(None)`: known to have none).
+    pub fn focused_monitor(&self) -> Option<Option<String>> {
+        self.lock().focused.clone()
+    }
+
+    /// Cached active window (`Some(None)`: known to have none).
+    pub fn active_window(&self) -> Option<Option<WindowInfo>> {
+        self.lock().active_window.clone()
+    }
+
+    /// Remember a `j/monitors` result, taken at `generation`.
+    pub fn store_monitors(&self, generation: u64, monitors: Vec<CachedMonitor>, focused: Option<String>) {
+        let mut s = self.lock();
+        if s.live && s.generation == generation {
+            s.monitors = Some(monitors);
+            s.focused = Some(focused);
+        }
+    }
+
+    /// Remember a `j/activewindow` result, taken at `generation`.
+    pub fn store_active_window(&self, generation: u64, window: Option<WindowInfo>) {
+        let mut s = self.lock();
+        if s.live && s.generation == generation {
+            s.active_window = Some(window);
+        }
+    }
+
+    /// Forget the active window, e.g. after moving it ourselves.
+    pub fn invalidate_active_window(&self) {
+        let mut s = self.lock();
+        s.generation += 1;
+        s.active_window = None;
+    }
+
+    /// Start or stop serving cached answers; either way the cache starts
+    /// out empty.
+    pub fn set_live(&self, live: bool) {
+        let mut s = self.lock();
+        *s = CachedState {
+            live,
+            generation: s.generation + 1,
+            ..CachedState::default()
+        };
+    }
+
+    /// Apply one socket2 event.
+    pub fn apply_event(&self, event: &str, data: &str) {
+        let mut s = self.lock();
+        match event {
+            "focusedmon" | "focusedmonv2" => {
+                let monitor = data.split(',').next().unwrap_or_default();
+                s.focused = Some((!monitor.is_empty()).then(|| monitor.to_string()));
+            }
+            "monitoradded" | "monitoraddedv2" | "monitorremoved" | "monitorremovedv2"
+            | "configreloaded" => {
+                s.monitors = None;
+                s.focused = None;
+                s.active_window = None;
+            }
+            "activewindow" | "activewindowv2" | "movewindow" | "movewindowv2" | "closewindow" => {
+                s.active_window = None;
+            }
+            _ => return,
+        }
+        s.generation += 1;
+    }
+}
+
+/// Keep `cache` current from Hyprland's event socket, reconnecting when
+/// the socket goes away.  Blocks forever; run it on its own thread.
+pub fn watch(cache: Arc<WmStateCache>) {
+    loop {
+        match socket2_path() {
+            Ok(path) => {
+                if let Err(e) = watch_path(&cache, &path) {
+                    warn!("state cache: {}", e);
+                }
+            }
+            Err(e) => warn!("state cache disabled: {}", e),
+        }
+        std::thread::sleep(RECONNECT_DELAY);
+    }
+}
+
+/// Follow the event socket at `path` until it closes.  The cache is live
+/// exactly while connected.
+fn watch_path(cache: &WmStateCache, path: &Path) -> std::io::Result<()> {
+    let stream = UnixStream::connect(path)?;
+    info!("state cache following {}", path.display());
+    cache.set_live(true);
+    let result = (|| {
+        for line in BufReader::new(stream).lines() {
+            if let Some((event, data)) = parse_event_line(&line?) {
+                cache.apply_event(event, data);
+            }
+        }
+        Ok(())
+    })();
+    cache.set_live(false);
+    debug!("state cache: socket2 closed");
+    result
+}
+
+//  Tests
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::Write;
+    use std::os::unix::net::UnixListener;
+
+    fn monitor(id: i64, name: &str) -> CachedMonitor {
+        CachedMonitor {
+            id,
+            info: MonitorInfo {
+                name: name.into(),
+                width: 1920,
+                height: 1080,
+                x: 1920 * id as i32,
+                y: 0,
+            },
+        }
+    }
+
+    fn window(monitor: &str) -> WindowInfo {
+        WindowInfo {
+            address: "0xbeef".into(),
+            title: "t".into(),
+            monitor: monitor.into(),
+        }
+    }
+
+    fn live_cache() -> WmStateCache {
+        let c = WmStateCache::new();
+        c.set_live(true);
+        let g = c.generation();
+        c.store_monitors(g, vec![monitor(0, "DP-1"), monitor(1, "HDMI-A-1")], Some("DP-1".into()));
+        c.store_active_window(g, Some(window("DP-1")));
+        c
+    }
+
+    #[test]
+    fn nothing_is_cached_while_not_live() {
+        let c = WmStateCache::new();
+        c.store_monitors(c.generation(), vec![monitor(0, "DP-1")], None);
+        c.store_active_window(c.generation(), None);
+        assert_eq!(c.monitors(), None);
+        assert_eq!(c.active_window(), None);
+    }
+
+    #[test]
+    fn focus_events_update_in_place() {
+        let c = live_cache();
+        c.apply_event("focusedmon", "HDMI-A-1,3");
+        assert_eq!(c.focused_monitor(), Some(Some("HDMI-A-1".into())));
+        assert!(c.monitors().is_some(), "monitor list is still valid");
+    }
+
+    #[test]
+    fn window_events_invalidate_active_window_only() {
+        for event in ["activewindow", "activewindowv2", "movewindow", "closewindow"] {
+            let c = live_cache();
+            c.apply_event(event, "0xbeef");
+            assert_eq!(c.active_window(), None, "{}", event);
+            assert!(c.monitors().is_some(), "{}", event);
+        }
+    }
+
+    #[test]
+    fn monitor_events_invalidate_everything() {
+        let c = live_cache();
+        c.apply_event("monitoradded", "DP-2");
+        assert_eq!(c.monitors(), None);
+        assert_eq!(c.focused_monitor(), None);
+        assert_eq!(c.active_window(), None);
+    }
+
+    #[test]
+    fn unrelated_events_keep_cache() {
+        let c = live_cache();
+        let g = c.generation();
+        c.apply_event("workspace", "5");
+        assert_eq!(c.generation(), g);
+        assert!(c.active_window().is_some());
+    }
+
+    #[test]
+    fn result_racing_an_event_is_discarded() {
+        let c = live_cache();
+        c.apply_event("activewindowv2", "0xcafe");
+        let g = c.generation();
+        // An event lands while our query is in flight...
+        c.apply_event("movewindowv2", "0xcafe,2,2");
+        c.store_active_window(g, Some(window("DP-1")));
+        // ...so the (possibly stale) answer is not kept.
+        assert_eq!(c.active_window(), None);
+    }
+
+    #[test]
+    fn watcher_follows_socket_and_goes_stale_on_close() {
+        let path = std::env::temp_dir().join(format!("hyprgrd-test-{}-socket2.sock", std::process::id()));
+        let _ = std::fs::remove_file(&path);
+        let listener = UnixListener::bind(&path).unwrap();
+        let cache = Arc::new(WmStateCache::new());
+
+        let watcher = {
+            let cache = cache.clone();
+            let path = path.clone();
+            std::thread::spawn(move || watch_path(&cache, &path))
+        };
+        let (mut conn, _) = listener.accept().unwrap();
+        // Wait until the watcher is live, then seed the cache like a query would.
+        while cache.monitors().is_none() {
+            let g = cache.generation();
+            cache.store_monitors(g, vec![monitor(0, "DP-1")], Some("DP-1".into()));
+        }
+        writeln!(conn, "focusedmon>>HDMI-A-1,2").unwrap();
+        while cache.focused_monitor() != Some(Some("HDMI-A-1".into())) {
+            std::thread::yield_now();
+        }
+
+        drop(conn);
+        watcher.join().unwrap().unwrap();
+        assert_eq!(cache.monitors(), None, "cache dropped once the stream ends");
+        let _ = std::fs::remove_file(&path);
+    }
+}
@@ -4,42 +4,225 @@
 //! `$XDG_RUNTIME_DIR/hypr/$HYPRLAND_INSTANCE_SIGNATURE/.socket.sock`,
 //! avoiding any shell command invocation or third-party crate for socket
 //! discovery.
+//!
+//! A grid move switches every monitor at once.  With the hyprgrd plugin
+//! loaded that is a single `hyprgrd:applygrid` dispatch; otherwise all the
+//! `focusmonitor` / `workspace` dispatches go out as one `[[BATCH]]`
+//! request, so a move costs one socket round trip either way.
+//!
+//! Prefetched workspaces are created and kept by the plugin's
+//! `hyprgrd:warm` / `hyprgrd:cool` dispatchers, inside the compositor;
+//! without the plugin prefetching is skipped.
+//!
+//! Requests that change what is on screen go out on worker threads
+//! ([`pipeline`](super::pipeline)): switches and window moves in order on
+//! one, plugin syncs and prefetching on the other, so a grid move's switch,
+//! `hyprgrd:syncgrid` and prefetch are in flight at once and the event loop
+//! goes on with the next swipe update meanwhile.  Only lookups are made on
+//! the caller's thread.
+//!
+//! Monitor, focus and active-window lookups are answered from a
+//! [`WmStateCache`] once [`HyprlandWm::watch_events`] follows Hyprland's
+//! event socket; see [`state`](super::state).
 
-use crate::command::{MonitorInfo, WindowInfo};
-use crate::traits::WindowManager;
+use super::pipeline::Lane;
+use super::state::{self, CachedMonitor, WmStateCache};
+use crate::command::{GestureRoutes, GridSync, MonitorInfo, OverlaySync, WindowInfo};
+use crate::traits::{Pending, WindowManager};
+use log::{info, warn};
 use serde::Deserialize;
 use std::io::{Read, Write};
 use std::os::unix::net::UnixStream;
 use std::path::PathBuf;
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::Arc;
 
 /// Hyprland-backed window manager.
 ///
 /// All communication happens over Hyprland's IPC socket
 /// (`$XDG_RUNTIME_DIR/hypr/<instance>/.socket.sock`).  No child processes
 /// are spawned.
-pub struct HyprlandWm;
+pub struct HyprlandWm {
+    /// Cleared once Hyprland rejects `hyprgrd:applygrid` (plugin not
+    /// loaded), after which grid moves go straight to `[[BATCH]]`.
+    applygrid: Arc<AtomicBool>,
+    /// Cleared once Hyprland rejects `hyprgrd:warm`, after which
+    /// prefetching is skipped.
+    prefetch: Arc<AtomicBool>,
+    /// Monitor / focus state, valid while socket2 is being followed.
+    state: Arc<WmStateCache>,
+    /// Workspace switches and window moves, in order.
+    switches: Lane,
+    /// Plugin syncs and prefetching; their errors are only logged.
+    background: Lane,
+}
 
 /// Errors that can occur when talking to Hyprland.
 #[derive(Debug, thiserror::Error)]
 #[error("hyprland IPC error: {0}")]
 pub struct HyprlandWmError(String);
 
+/// The message, without the prefix, as lane requests report it.
+impl From<HyprlandWmError> for String {
+    fn from(e: HyprlandWmError) -> String {
+        e.0
+    }
+}
+
 impl Default for HyprlandWm {
     fn default() -> Self {
-        Self
+        Self::new()
     }
 }
 
 impl HyprlandWm {
     /// Create a new handle.
     ///
-    /// No connection is opened eagerly; each method call opens a short-lived
-    /// IPC request.
+    /// No connection is opened eagerly; each request opens a short-lived
+    /// one.  Starts the two request [`Lane`]s.
     pub fn new() -> Self {
-        Self
+        Self {
+            applygrid: Arc::new(AtomicBool::new(true)),
+            prefetch: Arc::new(AtomicBool::new(true)),
+            state: Arc::new(WmStateCache::new()),
+            switches: Lane::spawn("hyprgrd-switch"),
+            background: Lane::spawn("hyprgrd-sync"),
+        }
+    }
+
+    /// Follow Hyprland's event socket on a background thread, so monitor
+    /// and focus lookups are served from the cache instead of a query per
+    /// command.  Without it every lookup queries Hyprland.
+    pub fn watch_events(&self) {
+        let cache = self.state.clone();
+        if let Err(e) = std::thread::Builder::new()
+            .name("hyprgrd-socket2".into())
+            .spawn(move || state::watch(cache))
+        {
+            warn!("state cache disabled: {}", e);
+        }
+    }
+
+    /// Monitor list and focused monitor, from the cache or a fresh
+    /// `j/monitors` query.
+    fn monitor_state(&self) -> Result<(Vec<CachedMonitor>, Option<String>), HyprlandWmError> {
+        monitor_state(&self.state)
+    }
+
+    /// Run `job` on the background lane, logging a failure; for requests
+    /// nobody waits on.
+    fn in_background(&self, what: &'static str, job: impl FnOnce() -> Result<(), HyprlandWmError> + Send + 'static) {
+        self.background.run(move || {
+            if let Err(e) = job() {
+                warn!("{}: {}", what, e);
+            }
+        });
+    }
+
+    /// Start `dispatch` on the background lane.
+    fn start_background(&self, dispatch: String) -> Pending {
+        self.background.start(move || ipc_dispatch(&dispatch))
     }
 }
 
+/// [`HyprlandWm::monitor_state`], for the lanes' threads.
+fn monitor_state(state: &WmStateCache) -> Result<(Vec<CachedMonitor>, Option<String>), HyprlandWmError> {
+    if let (Some(monitors), Some(focused)) = (state.monitors(), state.focused_monitor()) {
+        return Ok((monitors, focused));
+    }
+    let generation = state.generation();
+    let json = ipc_json("monitors")?;
+    let parsed: Vec<MonitorJson> =
+        serde_json::from_str(&json).map_err(|e| HyprlandWmError(format!("parse: {}", e)))?;
+    let focused = parsed.iter().find(|m| m.focused).map(|m| m.name.clone());
+    let monitors: Vec<CachedMonitor> = parsed
+        .into_iter()
+        .map(|m| CachedMonitor {
+            id: m.id,
+            info: MonitorInfo {
+                name: m.name,
+                width: m.width,
+                height: m.height,
+                x: m.x,
+                y: m.y,
+            },
+        })
+        .collect();
+    state.store_monitors(generation, monitors.clone(), focused.clone());
+    Ok((monitors, focused))
+}
+
+/// The focused monitor: kept current by `focusedmon` events even without a
+/// monitor list, otherwise queried.
+fn focused_monitor(state: &WmStateCache) -> Result<Option<String>, HyprlandWmError> {
+    if let Some(focused) = state.focused_monitor() {
+        return Ok(focused);
+    }
+    Ok(monitor_state(state)?.1)
+}
+
+/// Switch every monitor as one request: `hyprgrd:applygrid` with the
+/// plugin, one `[[BATCH]]` without.  Runs on the switch lane.
+fn switch_all(switches: &[(&str, i32)], applygrid: &AtomicBool, state: &WmStateCache) -> Result<(), HyprlandWmError> {
+    if switches.is_empty() {
+        return Ok(());
+    }
+    if applygrid.load(Ordering::Relaxed) {
+        // The plugin orders the focused monitor last itself.
+        match ipc_dispatch(&format!("hyprgrd:applygrid {}", applygrid_args(switches))) {
+            Ok(()) => return Ok(()),
+            Err(e) if is_unknown_dispatcher(&e) => {
+                info!("hyprgrd plugin not loaded; batching workspace switches instead");
+                applygrid.store(false, Ordering::Relaxed);
+            }
+            Err(e) => return Err(e),
+        }
+    }
+
+    let active = focused_monitor(state)?;
+    let (focused, mut ordered): (Vec<_>, Vec<_>) = switches
+        .iter()
+        .copied()
+        .partition(|(monitor, _)| Some(*monitor) == active.as_deref());
+    ordered.extend(focused);
+    check_batch_reply(&ipc_request(&batch_request(&ordered))?, 2 * ordered.len())
+}
+
+/// Warm and cool workspaces as one `[[BATCH]]`.  Runs on the background
+/// lane.
+fn prefetch_all(warm: &[(&str, i32)], cool: &[i32], prefetch: &AtomicBool) -> Result<(), HyprlandWmError> {
+    let mut request = String::from("[[BATCH]]");
+    let mut commands = 0;
+    if !warm.is_empty() {
+        request.push_str(&format!("dispatch hyprgrd:warm {};", applygrid_args(warm)));
+        commands += 1;
+    }
+    if !cool.is_empty() {
+        request.push_str(&format!("dispatch hyprgrd:cool {};", cool_args(cool)));
+        commands += 1;
+    }
+    if commands == 0 {
+        return Ok(());
+    }
+    let response = ipc_request(&request)?;
+    if response.contains("Invalid dispatcher") {
+        info!("hyprgrd plugin not loaded; workspace prefetching needs it, skipping");
+        prefetch.store(false, Ordering::Relaxed);
+        return Ok(());
+    }
+    check_batch_reply(&response, commands)
+}
+
+/// `switches` with owned monitor names, to hand to a lane.
+fn owned_switches(switches: &[(&str, i32)]) -> Vec<(String, i32)> {
+    switches.iter().map(|&(monitor, ws)| (monitor.to_string(), ws)).collect()
+}
+
+/// Borrow an [`owned_switches`] list back.
+fn borrowed_switches(switches: &[(String, i32)]) -> Vec<(&str, i32)> {
+    switches.iter().map(|(monitor, ws)| (monitor.as_str(), *ws)).collect()
+}
+
 //  Direct Hyprland IPC helpers 
 
 /// Resolve the Hyprland command socket path.
@@ -91,6 +274,73 @@ fn ipc_dispatch(args: &str) -> Result<(), HyprlandWmError> {
     }
 }
 
+/// Arguments for `hyprgrd:applygrid`: `<monitor> <workspace>` pairs.
+fn applygrid_args(switches: &[(&str, i32)]) -> String {
+    let pairs: Vec<String> = switches
+        .iter()
+        .map(|(monitor, ws)| format!("{} {}", monitor, ws))
+        .collect();
+    pairs.join(" ")
+}
+
+/// Arguments for `hyprgrd:cool`: workspace ids.
+fn cool_args(ids: &[i32]) -> String {
+    let ids: Vec<String> = ids.iter().map(i32::to_string).collect();
+    ids.join(" ")
+}
+
+/// Arguments for `hyprgrd:syncoverlay`, in the order plugin/overlay.hpp's
+/// `parseSyncOverlay` reads them.
+fn syncoverlay_args(o: &OverlaySync) -> String {
+    format!(
+        "{} {} {} {} {} {} {} {} {}",
+        o.sensitivity,
+        o.commit_threshold,
+        u8::from(o.natural_swiping),
+        o.switch_fingers,
+        o.move_fingers,
+        o.fling_lookahead_ms,
+        o.cursor_animation_ms,
+        o.linger_ms,
+        o.fade_out_ms
+    )
+}
+
+/// Arguments for `hyprgrd:syncgestures`: the finger counts to forward.
+fn syncgestures_args(r: &GestureRoutes) -> String {
+    if r.switch_fingers == r.move_fingers {
+        r.switch_fingers.to_string()
+    } else {
+        format!("{} {}", r.switch_fingers, r.move_fingers)
+    }
+}
+
+/// One `[[BATCH]]` request that focuses and switches each monitor in
+/// order.
+fn batch_request(switches: &[(&str, i32)]) -> String {
+    let mut request = String::from("[[BATCH]]");
+    for (monitor, ws) in switches {
+        request.push_str(&format!("dispatch focusmonitor {};dispatch workspace {};", monitor, ws));
+    }
+    request
+}
+
+/// Check a `[[BATCH]]` reply: one `ok` per command, concatenated.
+fn check_batch_reply(response: &str, commands: usize) -> Result<(), HyprlandWmError> {
+    let compact: String = response.split_whitespace().collect();
+    if compact == "ok".repeat(commands) {
+        Ok(())
+    } else {
+        Err(HyprlandWmError(format!("batch dispatch error: {}", response)))
+    }
+}
+
+/// Whether a dispatch error means the dispatcher doesn't exist (as opposed
+/// to the dispatcher itself failing).
+fn is_unknown_dispatcher(err: &HyprlandWmError) -> bool {
+    err.0.contains("Invalid dispatcher")
+}
+
 //  Minimal serde structs for the JSON we care about 
 
 /// Subset of the JSON object returned by `j/monitors`.
@@ -113,78 +363,182 @@ struct ActiveWindowJson {
     monitor: i64,
 }
 
-/// Resolve a Hyprland monitor numeric id to its name by querying `j/monitors`.
-fn monitor_name_by_id(id: i64) -> Result<String, HyprlandWmError> {
-    let json = ipc_json("monitors")?;
-    let monitors: Vec<MonitorJson> =
-        serde_json::from_str(&json).map_err(|e| HyprlandWmError(format!("parse: {}", e)))?;
-    monitors
-        .iter()
-        .find(|m| m.id == id)
-        .map(|m| m.name.clone())
-        .ok_or_else(|| HyprlandWmError(format!("unknown monitor id: {}", id)))
-}
-
 //  WindowManager implementation 
 
 impl WindowManager for HyprlandWm {
     type Error = HyprlandWmError;
 
     fn monitors(&self) -> Result<Vec<MonitorInfo>, Self::Error> {
-        let json = ipc_json("monitors")?;
-        let monitors: Vec<MonitorJson> =
-            serde_json::from_str(&json).map_err(|e| HyprlandWmError(format!("parse: {}", e)))?;
-        Ok(monitors
-            .into_iter()
-            .map(|m| MonitorInfo {
-                name: m.name,
-                width: m.width,
-                height: m.height,
-                x: m.x,
-                y: m.y,
-            })
-            .collect())
+        let (monitors, _) = self.monitor_state()?;
+        Ok(monitors.into_iter().map(|m| m.info).collect())
     }
 
     fn switch_workspace(&self, monitor: &str, workspace_id: i32) -> Result<(), Self::Error> {
         // Hyprland dispatches are global — we focus the target monitor first,
-        // then switch.
-        ipc_dispatch(&format!("focusmonitor {}", monitor))?;
-        ipc_dispatch(&format!("workspace {}", workspace_id))?;
+        // then switch.  On the switch lane, behind any switch in flight.
+        let monitor = monitor.to_string();
+        self.switches
+            .start(move || {
+                ipc_dispatch(&format!("focusmonitor {}", monitor))?;
+                ipc_dispatch(&format!("workspace {}", workspace_id))
+            })
+            .wait()
+            .map_err(HyprlandWmError)
+    }
+
+    fn switch_workspaces(&self, switches: &[(&str, i32)]) -> Result<(), Self::Error> {
+        self.start_switch_workspaces(switches).wait().map_err(HyprlandWmError)
+    }
+
+    fn start_switch_workspaces(&self, switches: &[(&str, i32)]) -> Pending {
+        let switches = owned_switches(switches);
+        let applygrid = self.applygrid.clone();
+        let state = self.state.clone();
+        self.switches
+            .start(move || switch_all(&borrowed_switches(&switches), &applygrid, &state))
+    }
+
+    fn sync_grid(&self, grid: &GridSync) -> Pending {
+        self.start_background(format!("hyprgrd:syncgrid {} {} {} {}", grid.cols, grid.rows, grid.col, grid.row))
+    }
+
+    fn sync_overlay(&self, overlay: &OverlaySync) -> Pending {
+        self.start_background(format!("hyprgrd:syncoverlay {}", syncoverlay_args(overlay)))
+    }
+
+    fn sync_gestures(&self, routes: &GestureRoutes) -> Pending {
+        self.start_background(format!("hyprgrd:syncgestures {}", syncgestures_args(routes)))
+    }
+
+    fn toggle_overlay(&self) -> Pending {
+        self.start_background("hyprgrd:togglevis".into())
+    }
+
+    fn prefetch_workspaces(&self, warm: &[(&str, i32)], cool: &[i32]) -> Result<(), Self::Error> {
+        if !self.prefetch.load(Ordering::Relaxed) || (warm.is_empty() && cool.is_empty()) {
+            return Ok(());
+        }
+        let warm = owned_switches(warm);
+        let cool = cool.to_vec();
+        let prefetch = self.prefetch.clone();
+        self.in_background("failed to prefetch workspaces", move || {
+            prefetch_all(&borrowed_switches(&warm), &cool, &prefetch)
+        });
         Ok(())
     }
 
     fn move_window_to_workspace(&self, workspace_id: i32) -> Result<(), Self::Error> {
-        ipc_dispatch(&format!("movetoworkspace {}", workspace_id))
+        self.start_move_window_to_workspace(workspace_id).wait().map_err(HyprlandWmError)
+    }
+
+    fn start_move_window_to_workspace(&self, workspace_id: i32) -> Pending {
+        self.state.invalidate_active_window();
+        self.switches
+            .start(move || ipc_dispatch(&format!("movetoworkspace {}", workspace_id)))
     }
 
     fn move_window_to_monitor(&self, monitor: &str) -> Result<(), Self::Error> {
-        ipc_dispatch(&format!("movewindow mon:{}", monitor))
+        self.state.invalidate_active_window();
+        let dispatch = format!("movewindow mon:{}", monitor);
+        self.switches
+            .start(move || ipc_dispatch(&dispatch))
+            .wait()
+            .map_err(HyprlandWmError)
     }
 
     fn active_monitor(&self) -> Result<Option<String>, Self::Error> {
-        let json = ipc_json("monitors")?;
-        let monitors: Vec<MonitorJson> = serde_json::from_str(&json)
-            .map_err(|e| HyprlandWmError(format!("parse: {}", e)))?;
-        Ok(monitors
-            .into_iter()
-            .find(|m| m.focused)
-            .map(|m| m.name))
+        focused_monitor(&self.state)
     }
 
     fn active_window(&self) -> Result<Option<WindowInfo>, Self::Error> {
+        if let Some(window) = self.state.active_window() {
+            return Ok(window);
+        }
+        let generation = self.state.generation();
         let json = ipc_json("activewindow")?;
         // Hyprland returns an empty object `{}` when no window is focused.
-        if json.trim() == "{}" {
-            return Ok(None);
-        }
-        let w: ActiveWindowJson =
-            serde_json::from_str(&json).map_err(|e| HyprlandWmError(format!("parse: {}", e)))?;
-        let monitor_name = monitor_name_by_id(w.monitor)?;
-        Ok(Some(WindowInfo {
-            address: w.address,
-            title: w.title,
-            monitor: monitor_name,
-        }))
+        let window = if json.trim() == "{}" {
+            None
+        } else {
+            let w: ActiveWindowJson =
+                serde_json::from_str(&json).map_err(|e| HyprlandWmError(format!("parse: {}", e)))?;
+            let (monitors, _) = self.monitor_state()?;
+            let monitor = monitors
+                .into_iter()
+                .find(|m| m.id == w.monitor)
+                .map(|m| m.info.name)
+                .ok_or_else(|| HyprlandWmError(format!("unknown monitor id: {}", w.monitor)))?;
+            Some(WindowInfo {
+                address: w.address,
+                title: w.title,
+                monitor,
+            })
+        };
+        self.state.store_active_window(generation, window.clone());
+        Ok(window)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const SWITCHES: &[(&str, i32)] = &[("DP-1", 1), ("HDMI-A-1", 2)];
+
+    #[test]
+    fn applygrid_args_are_pairs() {
+        assert_eq!(applygrid_args(SWITCHES), "DP-1 1 HDMI-A-1 2");
+    }
+
+    #[test]
+    fn cool_args_are_ids() {
+        assert_eq!(cool_args(&[3, 17]), "3 17");
+    }
+
+    #[test]
+    fn syncoverlay_args_are_positional() {
+        let overlay = OverlaySync {
+            sensitivity: 200.0,
+            commit_threshold: 0.3,
+            natural_swiping: true,
+            switch_fingers: 3,
+            move_fingers: 4,
+            fling_lookahead_ms: 100,
+            cursor_animation_ms: 80,
+            linger_ms: 300,
+            fade_out_ms: 200,
+        };
+        assert_eq!(syncoverlay_args(&overlay), "200 0.3 1 3 4 100 80 300 200");
+    }
+
+    #[test]
+    fn syncgestures_args_list_finger_counts() {
+        assert_eq!(syncgestures_args(&GestureRoutes { switch_fingers: 3, move_fingers: 4 }), "3 4");
+        assert_eq!(syncgestures_args(&GestureRoutes { switch_fingers: 3, move_fingers: 3 }), "3");
+    }
+
+    #[test]
+    fn batch_request_focuses_then_switches() {
+        assert_eq!(
+            batch_request(SWITCHES),
+            "[[BATCH]]dispatch focusmonitor DP-1;dispatch workspace 1;\
+             dispatch focusmonitor HDMI-A-1;dispatch workspace 2;"
+        );
+    }
+
+    #[test]
+    fn batch_reply_needs_one_ok_per_command() {
+        assert!(check_batch_reply("ok\n\nok\n\nok\n\nok", 4).is_ok());
+        assert!(check_batch_reply("okokokok", 4).is_ok());
+        assert!(check_batch_reply("ok\n\nok", 4).is_err());
+        assert!(check_batch_reply("ok\n\nNo such monitor\n\nok\n\nok", 4).is_err());
+    }
+
+    #[test]
+    fn unknown_dispatcher_is_detected() {
+        assert!(is_unknown_dispatcher(&HyprlandWmError(
+            "dispatch error: Invalid dispatcher, requested \"hyprgrd:applygrid\" does not exist".into()
+        )));
+        assert!(!is_unknown_dispatcher(&HyprlandWmError("dispatch error: No such monitor".into())));
     }
 }
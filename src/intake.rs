@@ -0,0 +1,295 @@
+//! The event loops' end of the command channel.
+//!
+//! Every source — the plugin's dispatchers and swipes, socket2 gestures,
+//! scripted clients — sends into one `mpsc` channel, which is first in,
+//! first out.  When the switcher falls behind, a burst of motion would then
+//! hold up the discrete command queued after it, and a held key would keep
+//! switching long after it was let go.
+//!
+//! [`CommandIntake`] takes everything waiting in the channel at once and
+//! treats it by the command's [`Priority`]:
+//!
+//! * [`Discrete`](Priority::Discrete) commands are handled in order, none
+//!   dropped.  Moves in the same direction waiting one behind another are
+//!   folded into one [`GoN`](Command::GoN), so the switcher goes straight
+//!   to the final cell.
+//! * [`Continuous`](Priority::Continuous) swipe input is merged into the
+//!   one waiting right ahead of it: swipe updates sum their deltas and keep
+//!   the newest trace, and the newest release velocity wins.
+//! * [`Visual`](Priority::Visual) offsets ([`PrepareMove`](Command::PrepareMove))
+//!   only draw the visualizer.  The newest one waiting replaces the older,
+//!   and one still waiting when a discrete command arrives is dropped as
+//!   stale, so nothing draws an offset the command after it overrides.
+//!
+//! The class is a property of the command variant, which on binary
+//! connections is the frame's opcode, so it is known without looking at a
+//! payload.  Acknowledged commands are discrete and never merged, so each
+//! still gets its answer.
+//!
+//! [`recv_counted`](CommandIntake::recv_counted) also tells how many
+//! commands from the channel each one stands for, for callers that account
+//! per command sent (the `--mock-wm` daemon's acks).
+
+use crate::command::{Command, Priority};
+use std::collections::VecDeque;
+use std::sync::mpsc::{self, Receiver, TryRecvError};
+
+/// Commands taken from the channel, waiting to be handled.
+pub struct CommandIntake {
+    rx: Receiver<Command>,
+    waiting: VecDeque<Waiting>,
+    disconnected: bool,
+}
+
+/// A waiting command and how many commands from the channel it stands for.
+struct Waiting {
+    cmd: Command,
+    taken: u64,
+}
+
+impl CommandIntake {
+    pub fn new(rx: Receiver<Command>) -> Self {
+        Self {
+            rx,
+            waiting: VecDeque::new(),
+            disconnected: false,
+        }
+    }
+
+    /// The next command to handle, blocking until there is one.  `None`
+    /// once every sender is gone and nothing is left waiting.
+    pub fn recv(&mut self) -> Option<Command> {
+        self.recv_counted().map(|(cmd, _)| cmd)
+    }
+
+    /// The next command to handle, if one is waiting.  `Disconnected` only
+    /// once nothing is left waiting.
+    pub fn try_recv(&mut self) -> Result<Command, TryRecvError> {
+        self.try_recv_counted().map(|(cmd, _)| cmd)
+    }
+
+    /// [`recv`](Self::recv), with the number of commands from the channel
+    /// the one returned stands for: itself, those folded or merged into it,
+    /// and stale offsets it dropped.
+    pub fn recv_counted(&mut self) -> Option<(Command, u64)> {
+        match self.try_recv_counted() {
+            Ok(next) => Some(next),
+            Err(TryRecvError::Disconnected) => None,
+            Err(TryRecvError::Empty) => {
+                let cmd = self.rx.recv().ok()?;
+                self.push(cmd);
+                self.try_recv_counted().ok()
+            }
+        }
+    }
+
+    /// [`try_recv`](Self::try_recv), counted like [`recv_counted`](Self::recv_counted).
+    pub fn try_recv_counted(&mut self) -> Result<(Command, u64), TryRecvError> {
+        self.pull();
+        match self.waiting.pop_front() {
+            Some(w) => Ok((w.cmd, w.taken)),
+            None if self.disconnected => Err(TryRecvError::Disconnected),
+            None => Err(TryRecvError::Empty),
+        }
+    }
+
+    /// Take everything already in the channel.
+    fn pull(&mut self) {
+        loop {
+            match self.rx.try_recv() {
+                Ok(cmd) => self.push(cmd),
+                Err(mpsc::TryRecvError::Empty) => break,
+                Err(mpsc::TryRecvError::Disconnected) => {
+                    self.disconnected = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    fn push(&mut self, cmd: Command) {
+        let mut taken = 1;
+        match cmd.priority() {
+            Priority::Discrete => {
+                self.waiting.retain(|w| {
+                    let stale = w.cmd.priority() == Priority::Visual;
+                    if stale {
+                        taken += w.taken;
+                    }
+                    !stale
+                });
+                if let (Some(back), Some((dir, n))) = (self.waiting.back_mut(), cmd.go_steps()) {
+                    if let Some((d, count)) = back.cmd.go_steps().filter(|&(d, _)| d == dir) {
+                        back.cmd = Command::GoN { dir: d, count: count.saturating_add(n) };
+                        back.taken += taken;
+                        return;
+                    }
+                }
+            }
+            Priority::Continuous => {
+                if let Some(back) = self.waiting.back_mut() {
+                    if merge(&mut back.cmd, &cmd) {
+                        back.taken += 1;
+                        return;
+                    }
+                }
+            }
+            Priority::Visual => {
+                if let Some(back) = self.waiting.back_mut().filter(|w| w.cmd.priority() == Priority::Visual) {
+                    back.cmd = cmd;
+                    back.taken += 1;
+                    return;
+                }
+            }
+        }
+        self.waiting.push_back(Waiting { cmd, taken });
+    }
+}
+
+/// Merge continuous input `next` into `into`, the command waiting ahead of
+/// it.  False if they don't merge.
+fn merge(into: &mut Command, next: &Command) -> bool {
+    match (into, next) {
+        (
+            Command::SwipeUpdate { fingers, dx, dy, trace },
+            Command::SwipeUpdate { fingers: f, dx: ndx, dy: ndy, trace: ntrace },
+        ) if fingers == f => {
+            *dx += ndx;
+            *dy += ndy;
+            if ntrace.is_some() {
+                *trace = *ntrace;
+            }
+            true
+        }
+        (into @ Command::SwipeVelocity { .. }, Command::SwipeVelocity { .. }) => {
+            *into = next.clone();
+            true
+        }
+        _ => false,
+    }
+}
+
+//  Tests
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use crate::command::{Direction, SwitchToTarget};
+    use crate::ipc::ack::{Ack, AckSink};
+    use std::os::unix::net::UnixStream;
+
+    fn intake(cmds: Vec<Command>) -> CommandIntake {
+        let (tx, rx) = mpsc::channel();
+        for cmd in cmds {
+            tx.send(cmd).unwrap();
+        }
+        CommandIntake::new(rx)
+    }
+
+    fn drain(intake: &mut CommandIntake) -> Vec<Command> {
+        std::iter::from_fn(|| intake.recv()).collect()
+    }
+
+    fn prepare(dx: f64) -> Command {
+        Command::PrepareMove { dx, dy: 0.0, trace: None }
+    }
+
+    fn update(dx: f64) -> Command {
+        Command::SwipeUpdate { fingers: 3, dx, dy: 1.0, trace: None }
+    }
+
+    #[test]
+    fn go_bursts_fold_into_one_move() {
+        let mut intake = intake(vec![
+            Command::Go(Direction::Right),
+            Command::GoN { dir: Direction::Right, count: 2 },
+            Command::Go(Direction::Right),
+            Command::Go(Direction::Down),
+            Command::Go(Direction::Down),
+            Command::ToggleVisualizer,
+            Command::Go(Direction::Up),
+        ]);
+        assert_eq!(
+            drain(&mut intake),
+            vec![
+                Command::GoN { dir: Direction::Right, count: 4 },
+                Command::GoN { dir: Direction::Down, count: 2 },
+                Command::ToggleVisualizer,
+                Command::Go(Direction::Up),
+            ]
+        );
+    }
+
+    #[test]
+    fn acked_moves_are_never_folded() {
+        let (daemon, _client) = UnixStream::pair().unwrap();
+        let sink = AckSink::new(&daemon).unwrap();
+        let acked = |seq| Command::Acked(Box::new(Command::Go(Direction::Left)), Ack::new(seq, &sink));
+        let mut intake = intake(vec![acked(1), acked(2), Command::Go(Direction::Left)]);
+        assert_eq!(
+            drain(&mut intake),
+            vec![acked(1), acked(2), Command::Go(Direction::Left)]
+        );
+    }
+
+    #[test]
+    fn stale_offsets_give_way_to_discrete_commands() {
+        let switch = Command::SwitchTo(SwitchToTarget { x: 1, y: 0 });
+        let mut intake = intake(vec![prepare(0.1), prepare(0.2), prepare(0.3), switch.clone(), prepare(0.4), prepare(0.5)]);
+        assert_eq!(drain(&mut intake), vec![switch, prepare(0.5)]);
+    }
+
+    #[test]
+    fn swipe_input_merges_but_keeps_its_place() {
+        let mut intake = intake(vec![
+            Command::SwipeBegin { fingers: 3 },
+            update(1.0),
+            update(2.0),
+            Command::SwipeVelocity { vx: 1.0, vy: 0.0 },
+            Command::SwipeVelocity { vx: 2.0, vy: 0.0 },
+            update(4.0),
+            Command::SwipeEnd,
+        ]);
+        assert_eq!(
+            drain(&mut intake),
+            vec![
+                Command::SwipeBegin { fingers: 3 },
+                Command::SwipeUpdate { fingers: 3, dx: 3.0, dy: 2.0, trace: None },
+                Command::SwipeVelocity { vx: 2.0, vy: 0.0 },
+                update(4.0),
+                Command::SwipeEnd,
+            ]
+        );
+    }
+
+    #[test]
+    fn counts_cover_every_command_taken() {
+        let mut intake = intake(vec![
+            Command::Go(Direction::Right),
+            Command::Go(Direction::Right),
+            prepare(0.1),
+            prepare(0.2),
+            Command::Go(Direction::Right),
+            update(1.0),
+            update(2.0),
+            Command::SwipeEnd,
+        ]);
+        let counted: Vec<_> = std::iter::from_fn(|| intake.recv_counted()).collect();
+        assert_eq!(
+            counted,
+            vec![
+                (Command::GoN { dir: Direction::Right, count: 3 }, 5),
+                (Command::SwipeUpdate { fingers: 3, dx: 3.0, dy: 2.0, trace: None }, 2),
+                (Command::SwipeEnd, 1),
+            ]
+        );
+    }
+
+    #[test]
+    fn disconnect_is_reported_once_drained() {
+        let mut intake = intake(vec![Command::CancelMove]);
+        assert_eq!(intake.try_recv(), Ok(Command::CancelMove));
+        assert_eq!(intake.try_recv(), Err(TryRecvError::Disconnected));
+        assert_eq!(intake.recv(), None);
+    }
+}
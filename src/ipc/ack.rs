@@ -0,0 +1,128 @@
+//! Acknowledgements of sequenced commands.
+//!
+//! By default a client never hears whether its command worked.  One that
+//! wants to (the Hyprland plugin with `plugin:hyprgrd:acks = 1`) sends the
+//! handshake line [`HELLO_ACKS_V1`](super::protocol::HELLO_ACKS_V1) and
+//! then wraps the commands it cares about with a sequence id:
+//!
+//! ```text
+//! {"seq":7,"cmd":{"Go":"Right"}}           JSON line
+//! 0x15 len  seq:u32  <the command's frame>  binary frame
+//! ```
+//!
+//! Each one is answered on the same connection once the switcher has
+//! handled it, with the daemon's handling time in nanoseconds and, on
+//! failure, the error on the rest of the line:
+//!
+//! ```text
+//! ACK 7 ok 153200
+//! ACK 7 err 4100 no active monitor
+//! ```
+//!
+//! A sequenced command that doesn't decode is answered right away by the
+//! listener, with handling time 0.  Unsequenced commands (swipe updates)
+//! are never answered.
+
+use log::debug;
+use std::fmt;
+use std::io::{self, Write};
+use std::os::unix::net::UnixStream;
+use std::sync::Arc;
+
+/// Where a client's acknowledgements go: a handle on its socket that the
+/// main thread can write to.
+#[derive(Clone)]
+pub struct AckSink {
+    stream: Arc<UnixStream>,
+}
+
+impl AckSink {
+    /// A sink writing to `stream` (through its own descriptor).
+    pub fn new(stream: &UnixStream) -> io::Result<Self> {
+        Ok(Self {
+            stream: Arc::new(stream.try_clone()?),
+        })
+    }
+
+    /// Send one acknowledgement.  Best-effort: the socket is non-blocking
+    /// and a client that doesn't read its replies just loses them.
+    pub fn reply(&self, seq: u32, result: Result<(), &str>, handle_ns: u64) {
+        let line = format_ack(seq, result, handle_ns);
+        match (&*self.stream).write(line.as_bytes()) {
+            Ok(n) if n == line.len() => {}
+            Ok(_) => debug!("ack {} cut short", seq),
+            Err(e) => debug!("ack {} dropped: {}", seq, e),
+        }
+    }
+}
+
+/// The acknowledgement owed for one command.
+#[derive(Clone)]
+pub struct Ack {
+    pub seq: u32,
+    sink: AckSink,
+}
+
+impl Ack {
+    pub fn new(seq: u32, sink: &AckSink) -> Self {
+        Self { seq, sink: sink.clone() }
+    }
+
+    /// Answer with the outcome of handling the command, which took
+    /// `handle_ns`.
+    pub fn reply(&self, result: Result<(), &str>, handle_ns: u64) {
+        self.sink.reply(self.seq, result, handle_ns);
+    }
+}
+
+impl fmt::Debug for Ack {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(f, "Ack({})", self.seq)
+    }
+}
+
+/// Acks are equal if they answer the same id to the same client.
+impl PartialEq for Ack {
+    fn eq(&self, other: &Self) -> bool {
+        self.seq == other.seq && Arc::ptr_eq(&self.sink.stream, &other.sink.stream)
+    }
+}
+
+/// The reply line for `seq`, newline included.  Line breaks in the error
+/// are flattened so the message stays on its line.
+pub fn format_ack(seq: u32, result: Result<(), &str>, handle_ns: u64) -> String {
+    match result {
+        Ok(()) => format!("ACK {} ok {}\n", seq, handle_ns),
+        Err(msg) => {
+            let msg: String = msg.chars().map(|c| if c == '\n' || c == '\r' { ' ' } else { c }).collect();
+            format!("ACK {} err {} {}\n", seq, handle_ns, msg)
+        }
+    }
+}
+
+//  Tests
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::io::{BufRead, BufReader};
+
+    #[test]
+    fn reply_lines() {
+        assert_eq!(format_ack(7, Ok(()), 153_200), "ACK 7 ok 153200\n");
+        assert_eq!(format_ack(8, Err("no active\nmonitor"), 41), "ACK 8 err 41 no active monitor\n");
+    }
+
+    #[test]
+    fn acks_reach_the_client() {
+        let (daemon, client) = UnixStream::pair().unwrap();
+        let sink = AckSink::new(&daemon).unwrap();
+        let ack = Ack::new(3, &sink);
+        assert_eq!(ack, Ack::new(3, &sink));
+        assert_ne!(ack, Ack::new(3, &AckSink::new(&daemon).unwrap()));
+        ack.reply(Err("bad"), 0);
+        let mut line = String::new();
+        BufReader::new(client).read_line(&mut line).unwrap();
+        assert_eq!(line, "ACK 3 err 0 bad\n");
+    }
+}
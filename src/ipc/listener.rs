@@ -1,7 +1,9 @@
 //! Unix-socket [`CommandSource`] implementation.
 //!
-//! Binds a Unix stream socket and accepts one connection at a time.
-//! Each line received is parsed as a JSON-encoded [`Command`].
+//! Binds a Unix stream socket and multiplexes every accepted connection on
+//! one thread with `epoll`, so a long-lived client (the Hyprland plugin
+//! keeps one persistent connection open) never blocks other clients such
+//! as `socat`.  Each line received is parsed as a JSON-encoded [`Command`].
 //!
 //! # Wire format
 //!
@@ -15,23 +17,128 @@
 //! {"CommitMove":"Down"}
 //! {"MoveWindowAndGo":"Left"}
 //! ```
+//!
+//! A client may instead negotiate the compact binary framing described in
+//! [`protocol`](super::protocol) by sending its handshake line first; the
+//! Hyprland plugin does this.  JSON lines remain accepted either way.
+//!
+//! # Scheduling
+//!
+//! Each client has its own read buffer; messages are parsed in place from
+//! it.  A client is served at most [`MESSAGES_PER_TURN`] messages before
+//! the other ready clients get their turn, so a burst of swipe updates
+//! cannot hold back a keybind arriving on another connection.
+//!
+//! A binary client may attach a [swipe channel](super::swipe_channel); its
+//! doorbell is watched by the same epoll and counts as one more message of
+//! that client.
+//!
+//! # Acknowledgements
+//!
+//! Sequenced commands (`{"seq":…,"cmd":…}` lines and `0x15` frames, see
+//! [`ack`](super::ack)) are forwarded as [`Command::Acked`] carrying a
+//! handle on the client's socket, so whoever handles them can answer.
+//! Ones that don't decode are answered here.
+//!
+//! # Plugin presence
+//!
+//! A client that forwards swipes (its `AttachGestures` greeting, or a
+//! `SwipeBegin` from plugins that predate it) counts as a connected plugin
+//! until it disconnects; [`PluginPresence`] tells other sources so.
 
+use super::ack::{Ack, AckSink};
+use super::protocol;
+use super::swipe_channel::SwipeChannel;
 use crate::command::Command;
+use crate::latency::monotonic_ns;
 use crate::traits::CommandSource;
 use log::{debug, error, info};
-use std::io::{BufRead, BufReader};
-use std::os::unix::net::UnixListener;
+use serde::Deserialize;
+use std::collections::{HashMap, VecDeque};
+use std::io::{self, Write};
+use std::os::fd::{AsRawFd, FromRawFd, OwnedFd, RawFd};
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::ops::Range;
 use std::path::{Path, PathBuf};
-use std::sync::mpsc;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{mpsc, Arc};
+
+/// Messages one client may deliver before the next ready client is served.
+const MESSAGES_PER_TURN: usize = 16;
+
+/// Bytes read from a client socket at once.
+const READ_CHUNK: usize = 4096;
+
+/// Longest JSON line accepted; a client exceeding it is dropped.
+const MAX_LINE: usize = 64 * 1024;
+
+/// epoll token of the listening socket (client tokens are their fds).
+const LISTENER_TOKEN: u64 = u64::MAX;
+
+/// Set in the epoll token of a client's swipe-channel doorbell.
+const DOORBELL_TOKEN: u64 = 1 << 32;
+
+/// File descriptors kept per client until an attach frame claims them.
+const MAX_PENDING_FDS: usize = 2;
+
+/// How a sequenced JSON line starts.
+const SEQUENCED_JSON: &[u8] = b"{\"seq\"";
 
 /// A [`CommandSource`] that listens on a Unix stream socket for
 /// JSON-encoded commands.
 ///
 /// Each accepted connection can send multiple newline-delimited JSON
-/// commands.  When the connection closes, the listener waits for the
-/// next one.
+/// commands and may stay open indefinitely.  Connections are served
+/// concurrently.
 pub struct UnixSocketListener {
     path: PathBuf,
+    presence: PluginPresence,
+}
+
+/// Whether a Hyprland plugin is connected and forwarding swipes, shared
+/// between the listener and whoever else takes swipes from Hyprland.
+/// Cloning shares the same state.
+#[derive(Debug, Clone, Default)]
+pub struct PluginPresence(Arc<AtomicUsize>);
+
+impl PluginPresence {
+    /// True while at least one connected client forwards swipes.
+    pub fn is_present(&self) -> bool {
+        self.0.load(Ordering::Relaxed) > 0
+    }
+}
+
+/// One client's share of [`PluginPresence`]: counted from the first
+/// swipe command it forwards until it disconnects.
+struct PluginMark {
+    presence: PluginPresence,
+    counted: bool,
+}
+
+impl PluginMark {
+    fn new(presence: PluginPresence) -> Self {
+        Self {
+            presence,
+            counted: false,
+        }
+    }
+
+    /// Count the client once `cmd` shows it forwards swipes.
+    fn note(&mut self, cmd: &Command) {
+        if !self.counted && matches!(cmd, Command::AttachGestures | Command::SwipeBegin { .. }) {
+            debug!("client forwards swipes");
+            self.counted = true;
+            self.presence.0.fetch_add(1, Ordering::Relaxed);
+        }
+    }
+}
+
+impl Drop for PluginMark {
+    fn drop(&mut self) {
+        if self.counted {
+            self.presence.0.fetch_sub(1, Ordering::Relaxed);
+        }
+    }
 }
 
 /// Errors produced by the Unix socket listener.
@@ -51,6 +158,7 @@ impl UnixSocketListener {
     pub fn new(path: impl AsRef<Path>) -> Self {
         Self {
             path: path.as_ref().to_path_buf(),
+            presence: PluginPresence::default(),
         }
     }
 
@@ -58,56 +166,617 @@ impl UnixSocketListener {
     pub fn path(&self) -> &Path {
         &self.path
     }
+
+    /// A handle telling whether a plugin is connected.
+    pub fn plugin_presence(&self) -> PluginPresence {
+        self.presence.clone()
+    }
 }
 
 impl CommandSource for UnixSocketListener {
     type Error = UnixSocketError;
 
-    /// Bind the socket and start accepting connections.
+    /// Bind the socket and serve clients until the sink closes.
     ///
-    /// This method **blocks** indefinitely.  Run it on a dedicated thread.
+    /// This method **blocks**.  Run it on a dedicated thread.
     fn run(&mut self, sink: mpsc::Sender<Command>) -> Result<(), Self::Error> {
         // Remove stale socket if present.
         let _ = std::fs::remove_file(&self.path);
 
         let listener = UnixListener::bind(&self.path)?;
+        listener.set_nonblocking(true)?;
         info!("listening on {}", self.path.display());
 
-        for stream in listener.incoming() {
-            match stream {
-                Ok(stream) => {
-                    debug!("client connected");
-                    let reader = BufReader::new(stream);
-                    for line in reader.lines() {
-                        match line {
-                            Ok(ref text) if text.trim().is_empty() => continue,
-                            Ok(text) => match serde_json::from_str::<Command>(&text) {
-                                Ok(cmd) => {
-                                    debug!("received {:?}", cmd);
-                                    if sink.send(cmd).is_err() {
-                                        info!("sink closed, shutting down");
-                                        return Ok(());
-                                    }
-                                }
-                                Err(e) => {
-                                    error!("bad command: {} — {}", text, e);
-                                }
-                            },
-                            Err(e) => {
-                                error!("read error: {}", e);
-                                break;
+        let result = EventLoop::new(listener, sink, self.presence.clone()).and_then(|mut l| l.run());
+        let _ = std::fs::remove_file(&self.path);
+        Ok(result?)
+    }
+}
+
+//  epoll
+
+/// Minimal owned epoll instance.
+struct Epoll {
+    fd: RawFd,
+}
+
+impl Epoll {
+    fn new() -> io::Result<Self> {
+        // SAFETY: plain syscall; the returned fd is owned by `Self`.
+        let fd = unsafe { libc::epoll_create1(libc::EPOLL_CLOEXEC) };
+        if fd < 0 {
+            return Err(io::Error::last_os_error());
+        }
+        Ok(Self { fd })
+    }
+
+    /// Watch `fd` for input (level-triggered) under `token`.
+    fn add(&self, fd: RawFd, token: u64) -> io::Result<()> {
+        let mut ev = libc::epoll_event {
+            events: (libc::EPOLLIN | libc::EPOLLRDHUP) as u32,
+            u64: token,
+        };
+        // SAFETY: `ev` is a valid epoll_event for the duration of the call.
+        if unsafe { libc::epoll_ctl(self.fd, libc::EPOLL_CTL_ADD, fd, &mut ev) } < 0 {
+            return Err(io::Error::last_os_error());
+        }
+        Ok(())
+    }
+
+    fn remove(&self, fd: RawFd) {
+        // SAFETY: a null event is allowed for EPOLL_CTL_DEL.
+        unsafe { libc::epoll_ctl(self.fd, libc::EPOLL_CTL_DEL, fd, std::ptr::null_mut()) };
+    }
+
+    /// Wait for events; `timeout_ms` of -1 blocks.  Returns the number of
+    /// entries filled in `events`.
+    fn wait(&self, events: &mut [libc::epoll_event], timeout_ms: i32) -> io::Result<usize> {
+        loop {
+            // SAFETY: `events` is a valid writable buffer of `events.len()` entries.
+            let n = unsafe { libc::epoll_wait(self.fd, events.as_mut_ptr(), events.len() as i32, timeout_ms) };
+            if n >= 0 {
+                return Ok(n as usize);
+            }
+            let err = io::Error::last_os_error();
+            if err.kind() != io::ErrorKind::Interrupted {
+                return Err(err);
+            }
+        }
+    }
+}
+
+impl Drop for Epoll {
+    fn drop(&mut self) {
+        // SAFETY: `fd` is owned by `self` and closed exactly once.
+        unsafe { libc::close(self.fd) };
+    }
+}
+
+//  Clients
+
+/// How a client's bytes are framed.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Framing {
+    /// Newline-delimited JSON (handshake lines allowed).
+    Json,
+    /// Binary frames, with JSON lines still accepted.
+    Binary,
+}
+
+/// One message cut from a client's buffer, as a range of it.
+enum Message {
+    Line(Range<usize>),
+    Frame(u8, Range<usize>),
+}
+
+/// One connected client and the bytes it sent that are not parsed yet.
+struct Client {
+    stream: UnixStream,
+    framing: Framing,
+    buf: Vec<u8>,
+    /// Start of the unparsed bytes in `buf`.
+    pos: usize,
+    /// The peer closed its end; whatever is buffered is all there is.
+    eof: bool,
+    /// Descriptors received with the bytes in `buf` (`SCM_RIGHTS`).
+    fds: VecDeque<OwnedFd>,
+    swipe: Option<SwipeChannel>,
+    /// The swipe channel's doorbell rang since the last turn.
+    doorbell: bool,
+    /// Where acknowledgements go, once the client asked for them.
+    acks: Option<AckSink>,
+    plugin: PluginMark,
+}
+
+impl Client {
+    fn new(stream: UnixStream, presence: PluginPresence) -> Self {
+        Self {
+            stream,
+            framing: Framing::Json,
+            buf: Vec::with_capacity(READ_CHUNK),
+            pos: 0,
+            eof: false,
+            fds: VecDeque::new(),
+            swipe: None,
+            doorbell: false,
+            acks: None,
+            plugin: PluginMark::new(presence),
+        }
+    }
+
+    /// The client's ack sink, opened on first use.
+    fn ack_sink(&mut self) -> Option<AckSink> {
+        if self.acks.is_none() {
+            match AckSink::new(&self.stream) {
+                Ok(acks) => self.acks = Some(acks),
+                Err(e) => error!("cannot acknowledge commands: {}", e),
+            }
+        }
+        self.acks.clone()
+    }
+
+    /// Read what is available, up to one chunk.  A client that already
+    /// has a chunk of complete messages waiting is not read from until
+    /// those are served, so a flood backs up into its own socket.
+    fn fill(&mut self) -> io::Result<()> {
+        if self.buf.len() - self.pos > READ_CHUNK && self.has_message() {
+            return Ok(());
+        }
+        if self.pos == self.buf.len() {
+            self.buf.clear();
+            self.pos = 0;
+        } else if self.pos > 0 && self.buf.capacity() - self.buf.len() < READ_CHUNK {
+            self.buf.drain(..self.pos);
+            self.pos = 0;
+        }
+        let len = self.buf.len();
+        self.buf.resize(len + READ_CHUNK, 0);
+        let result = recv_with_fds(&self.stream, &mut self.buf[len..], &mut self.fds);
+        let n = *result.as_ref().unwrap_or(&0);
+        self.buf.truncate(len + n);
+        match result {
+            Ok(0) => self.eof = true,
+            Ok(_) => {}
+            Err(e) if e.kind() == io::ErrorKind::WouldBlock || e.kind() == io::ErrorKind::Interrupted => {}
+            Err(e) => return Err(e),
+        }
+        Ok(())
+    }
+
+    /// Cut the next complete message from the buffer, or `None` if more
+    /// bytes are needed.  At EOF a trailing line without `\n` still counts.
+    fn next_message(&mut self) -> io::Result<Option<Message>> {
+        let start = self.pos;
+        let rest = &self.buf[start..];
+        let Some(&first) = rest.first() else {
+            return Ok(None);
+        };
+        if self.framing == Framing::Json || protocol::starts_json(first) {
+            let len = match rest.iter().position(|&b| b == b'\n') {
+                Some(nl) => nl + 1,
+                None if self.eof => rest.len(),
+                None if rest.len() > MAX_LINE => {
+                    return Err(io::Error::new(io::ErrorKind::InvalidData, "line too long"));
+                }
+                None => return Ok(None),
+            };
+            self.pos += len;
+            return Ok(Some(Message::Line(start..start + len)));
+        }
+        if rest.len() < 2 || rest.len() < 2 + rest[1] as usize {
+            if self.eof {
+                debug!("truncated frame");
+                self.pos = self.buf.len();
+            }
+            return Ok(None);
+        }
+        let len = rest[1] as usize;
+        self.pos += 2 + len;
+        Ok(Some(Message::Frame(first, start + 2..start + 2 + len)))
+    }
+
+    /// Whether a complete message is already buffered.
+    fn has_message(&self) -> bool {
+        let rest = &self.buf[self.pos..];
+        match rest.first() {
+            None => false,
+            Some(&b) if self.framing == Framing::Json || protocol::starts_json(b) => {
+                self.eof || rest.contains(&b'\n')
+            }
+            Some(_) => self.eof || (rest.len() >= 2 && rest.len() >= 2 + rest[1] as usize),
+        }
+    }
+}
+
+/// What serving a client turn decided about the client.
+#[derive(Debug, PartialEq, Eq)]
+enum Turn {
+    /// Keep the client; `true` if it still has buffered messages.
+    Keep(bool),
+    /// Drop the client.
+    Close,
+    /// The sink closed; stop the listener.
+    Stop,
+}
+
+/// Serve up to [`MESSAGES_PER_TURN`] buffered messages of `client` (whose
+/// socket is `fd`), after its swipe channel if the doorbell rang.
+fn serve_turn(client: &mut Client, fd: RawFd, epoll: &Epoll, sink: &mpsc::Sender<Command>) -> Turn {
+    if std::mem::take(&mut client.doorbell) {
+        if let Some(update) = client.swipe.as_mut().and_then(SwipeChannel::drain) {
+            if !forward(update, sink) {
+                return Turn::Stop;
+            }
+        }
+    }
+    for _ in 0..MESSAGES_PER_TURN {
+        let framing = client.framing;
+        let message = match client.next_message() {
+            Ok(Some(m)) => m,
+            Ok(None) => return if client.eof { Turn::Close } else { Turn::Keep(false) },
+            Err(e) => {
+                error!("dropping client: {}", e);
+                return Turn::Close;
+            }
+        };
+        match message {
+            Message::Line(range) => {
+                let line = client.buf[range.clone()].trim_ascii();
+                if line.is_empty() {
+                    continue;
+                }
+                if line.starts_with(SEQUENCED_JSON) {
+                    let acks = client.ack_sink();
+                    if !dispatch_sequenced_json(client.buf[range].trim_ascii(), acks.as_ref(), sink) {
+                        return Turn::Stop;
+                    }
+                    continue;
+                }
+                let handshake = match (framing, std::str::from_utf8(line)) {
+                    (Framing::Json, Ok(text)) => protocol::handshake(text),
+                    _ => None,
+                };
+                if let Some((reply, upgrade)) = handshake {
+                    if let Err(e) = writeln!(&client.stream, "{}", reply) {
+                        error!("handshake reply failed: {}", e);
+                        return Turn::Close;
+                    }
+                    match upgrade {
+                        protocol::Upgrade::Binary => {
+                            debug!("client switched to binary framing");
+                            client.framing = Framing::Binary;
+                        }
+                        protocol::Upgrade::Acks => {
+                            debug!("client asked for acknowledgements");
+                            client.ack_sink();
+                        }
+                        protocol::Upgrade::None => {}
+                    }
+                } else if !dispatch_json(line, &mut client.plugin, sink) {
+                    return Turn::Stop;
+                }
+            }
+            Message::Frame(protocol::op::ATTACH_SWIPE_CHANNEL, _) => {
+                let reply = match attach_swipe_channel(client, fd, epoll) {
+                    Ok(()) => protocol::ACCEPT_SHM,
+                    Err(e) => {
+                        error!("swipe channel rejected: {}", e);
+                        protocol::REJECT_SHM
+                    }
+                };
+                if let Err(e) = writeln!(&client.stream, "{}", reply) {
+                    error!("swipe channel reply failed: {}", e);
+                    return Turn::Close;
+                }
+            }
+            Message::Frame(protocol::op::SEQUENCED, range) => match protocol::decode_sequenced(&client.buf[range]) {
+                Ok((seq, decoded)) => {
+                    let acks = client.ack_sink();
+                    match decoded {
+                        Ok(cmd) => {
+                            if !forward_with_channel(acked(cmd, seq, acks.as_ref()), client.swipe.as_mut(), sink) {
+                                return Turn::Stop;
+                            }
+                        }
+                        Err(e) => {
+                            error!("bad frame: {}", e);
+                            if let Some(acks) = acks {
+                                acks.reply(seq, Err(&format!("bad frame: {}", e)), 0);
                             }
                         }
                     }
-                    debug!("client disconnected");
                 }
+                Err(e) => error!("bad frame: {}", e),
+            },
+            Message::Frame(op, range) => match protocol::decode_frame(op, &client.buf[range]) {
+                Ok(cmd) => {
+                    client.plugin.note(&cmd);
+                    if !forward_with_channel(cmd, client.swipe.as_mut(), sink) {
+                        return Turn::Stop;
+                    }
+                }
+                // The length byte keeps framing intact; skip just this frame.
+                Err(e) => error!("bad frame: {}", e),
+            },
+        }
+    }
+    Turn::Keep(client.has_message())
+}
+
+/// Attach the swipe channel whose memfd and eventfd came with the attach
+/// frame, replacing any earlier one, and watch its doorbell.
+fn attach_swipe_channel(client: &mut Client, fd: RawFd, epoll: &Epoll) -> io::Result<()> {
+    let (Some(memfd), Some(doorbell)) = (client.fds.pop_front(), client.fds.pop_front()) else {
+        return Err(io::Error::new(io::ErrorKind::InvalidInput, "attach frame without fds"));
+    };
+    set_nonblocking(&doorbell)?;
+    let channel = SwipeChannel::attach(memfd, doorbell)?;
+    if let Some(old) = client.swipe.take() {
+        epoll.remove(old.doorbell_fd());
+    }
+    epoll.add(channel.doorbell_fd(), DOORBELL_TOKEN | fd as u64)?;
+    debug!("client attached a swipe channel");
+    client.swipe = Some(channel);
+    Ok(())
+}
+
+/// Forward `cmd`, bracketing it with the swipe channel's motion: SwipeBegin
+/// starts following the gesture, and SwipeEnd goes out only after the
+/// gesture's last motion.  Returns false once the sink closed.
+fn forward_with_channel(cmd: Command, channel: Option<&mut SwipeChannel>, sink: &mpsc::Sender<Command>) -> bool {
+    let Some(channel) = channel else {
+        return forward(cmd, sink);
+    };
+    match cmd {
+        Command::SwipeBegin { .. } => forward(cmd, sink) && channel.begin().map_or(true, |u| forward(u, sink)),
+        Command::SwipeEnd => channel.end().map_or(true, |u| forward(u, sink)) && forward(cmd, sink),
+        _ => forward(cmd, sink),
+    }
+}
+
+/// `read()` that also collects `SCM_RIGHTS` descriptors into `fds`,
+/// keeping at most [`MAX_PENDING_FDS`] (the newest).
+fn recv_with_fds(stream: &UnixStream, buf: &mut [u8], fds: &mut VecDeque<OwnedFd>) -> io::Result<usize> {
+    let mut iov = libc::iovec {
+        iov_base: buf.as_mut_ptr().cast(),
+        iov_len: buf.len(),
+    };
+    // Room for a few descriptors, aligned for cmsghdr.
+    let mut control = [0u64; 8];
+    // SAFETY: a zeroed msghdr is valid; the pointers below outlive the call.
+    let mut msg: libc::msghdr = unsafe { std::mem::zeroed() };
+    msg.msg_iov = &mut iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.as_mut_ptr().cast();
+    msg.msg_controllen = std::mem::size_of_val(&control) as _;
+    // SAFETY: `msg` describes valid writable buffers.
+    let n = unsafe { libc::recvmsg(stream.as_raw_fd(), &mut msg, libc::MSG_CMSG_CLOEXEC) };
+    if n < 0 {
+        return Err(io::Error::last_os_error());
+    }
+    // SAFETY: walks the control messages the kernel just wrote into `control`.
+    unsafe {
+        let mut cmsg = libc::CMSG_FIRSTHDR(&msg);
+        while !cmsg.is_null() {
+            if (*cmsg).cmsg_level == libc::SOL_SOCKET && (*cmsg).cmsg_type == libc::SCM_RIGHTS {
+                let data = libc::CMSG_DATA(cmsg) as *const RawFd;
+                let count = ((*cmsg).cmsg_len as usize - libc::CMSG_LEN(0) as usize) / std::mem::size_of::<RawFd>();
+                for i in 0..count {
+                    fds.push_back(OwnedFd::from_raw_fd(data.add(i).read_unaligned()));
+                    if fds.len() > MAX_PENDING_FDS {
+                        fds.pop_front();
+                    }
+                }
+            }
+            cmsg = libc::CMSG_NXTHDR(&msg, cmsg);
+        }
+    }
+    Ok(n as usize)
+}
+
+fn set_nonblocking(fd: &OwnedFd) -> io::Result<()> {
+    // SAFETY: fcntl on a descriptor we own.
+    unsafe {
+        let flags = libc::fcntl(fd.as_raw_fd(), libc::F_GETFL);
+        if flags < 0 || libc::fcntl(fd.as_raw_fd(), libc::F_SETFL, flags | libc::O_NONBLOCK) < 0 {
+            return Err(io::Error::last_os_error());
+        }
+    }
+    Ok(())
+}
+
+//  Event loop
+
+/// The listener's single-threaded client multiplexer.
+struct EventLoop {
+    epoll: Epoll,
+    listener: UnixListener,
+    clients: HashMap<RawFd, Client>,
+    /// Clients with complete messages still buffered after their turn.
+    backlog: VecDeque<RawFd>,
+    sink: mpsc::Sender<Command>,
+    presence: PluginPresence,
+}
+
+impl EventLoop {
+    fn new(listener: UnixListener, sink: mpsc::Sender<Command>, presence: PluginPresence) -> io::Result<Self> {
+        let epoll = Epoll::new()?;
+        epoll.add(listener.as_raw_fd(), LISTENER_TOKEN)?;
+        Ok(Self {
+            epoll,
+            listener,
+            clients: HashMap::new(),
+            backlog: VecDeque::new(),
+            sink,
+            presence,
+        })
+    }
+
+    /// Serve until the sink closes.
+    fn run(&mut self) -> io::Result<()> {
+        while self.round(-1)? {}
+        info!("sink closed, stopping listener");
+        Ok(())
+    }
+
+    /// One scheduling round: wait up to `timeout_ms` for input (not at all
+    /// while clients are backlogged), then give every ready client one
+    /// turn.  Returns false once the sink closed.
+    fn round(&mut self, timeout_ms: i32) -> io::Result<bool> {
+        let mut events = [libc::epoll_event { events: 0, u64: 0 }; 64];
+        // Buffered work must not wait for new input.
+        let timeout = if self.backlog.is_empty() { timeout_ms } else { 0 };
+        let n = self.epoll.wait(&mut events, timeout)?;
+
+        // Backlogged clients first (they have waited a turn already), then
+        // newly readable ones; each gets one turn per round.
+        let mut ready: Vec<RawFd> = self.backlog.drain(..).collect();
+        for ev in &events[..n] {
+            let token = ev.u64;
+            if token == LISTENER_TOKEN {
+                self.accept_all();
+                continue;
+            }
+            let fd = (token & 0xffff_ffff) as RawFd;
+            if token & DOORBELL_TOKEN != 0 {
+                if let Some(client) = self.clients.get_mut(&fd) {
+                    client.doorbell = true;
+                    if !ready.contains(&fd) {
+                        ready.push(fd);
+                    }
+                }
+                continue;
+            }
+            match self.clients.get_mut(&fd).map(Client::fill) {
+                Some(Ok(())) => {
+                    if !ready.contains(&fd) {
+                        ready.push(fd);
+                    }
+                }
+                Some(Err(e)) => {
+                    error!("read error: {}", e);
+                    self.close(fd);
+                }
+                None => {}
+            }
+        }
+
+        for fd in ready {
+            let Some(client) = self.clients.get_mut(&fd) else {
+                continue;
+            };
+            match serve_turn(client, fd, &self.epoll, &self.sink) {
+                Turn::Keep(true) => self.backlog.push_back(fd),
+                Turn::Keep(false) => {}
+                Turn::Close => self.close(fd),
+                Turn::Stop => return Ok(false),
+            }
+        }
+        Ok(true)
+    }
+
+    fn accept_all(&mut self) {
+        loop {
+            match self.listener.accept() {
+                Ok((stream, _)) => {
+                    if let Err(e) = self.register(stream) {
+                        error!("cannot register client: {}", e);
+                    }
+                }
+                Err(e) if e.kind() == io::ErrorKind::WouldBlock => return,
+                Err(e) if e.kind() == io::ErrorKind::Interrupted => {}
                 Err(e) => {
                     error!("accept error: {}", e);
+                    return;
                 }
             }
         }
+    }
+
+    fn register(&mut self, stream: UnixStream) -> io::Result<()> {
+        stream.set_nonblocking(true)?;
+        let fd = stream.as_raw_fd();
+        self.epoll.add(fd, fd as u64)?;
+        debug!("client connected");
+        self.clients.insert(fd, Client::new(stream, self.presence.clone()));
         Ok(())
     }
+
+    fn close(&mut self, fd: RawFd) {
+        if let Some(client) = self.clients.remove(&fd) {
+            // The plugin still holds the doorbell, so closing our copy
+            // would not drop it from the epoll set.
+            if let Some(channel) = &client.swipe {
+                self.epoll.remove(channel.doorbell_fd());
+            }
+            self.epoll.remove(fd);
+            self.backlog.retain(|&b| b != fd);
+            debug!("client disconnected");
+        }
+    }
+}
+
+/// Parse one JSON line and forward it.  Returns false once the sink closed.
+fn dispatch_json(line: &[u8], plugin: &mut PluginMark, sink: &mpsc::Sender<Command>) -> bool {
+    match serde_json::from_slice::<Command>(line) {
+        Ok(cmd) => {
+            plugin.note(&cmd);
+            forward(cmd, sink)
+        }
+        Err(e) => {
+            error!("bad command: {} — {}", String::from_utf8_lossy(line), e);
+            true
+        }
+    }
+}
+
+/// JSON envelope of a sequenced command.
+#[derive(Deserialize)]
+struct SequencedLine {
+    seq: u32,
+    cmd: serde_json::Value,
+}
+
+/// Forward a `{"seq":…,"cmd":…}` line as an acked command, or answer it
+/// right away if the command doesn't parse.  Returns false once the sink
+/// closed.
+fn dispatch_sequenced_json(line: &[u8], acks: Option<&AckSink>, sink: &mpsc::Sender<Command>) -> bool {
+    let envelope = match serde_json::from_slice::<SequencedLine>(line) {
+        Ok(envelope) => envelope,
+        Err(e) => {
+            error!("bad command: {} — {}", String::from_utf8_lossy(line), e);
+            return true;
+        }
+    };
+    match Command::deserialize(envelope.cmd) {
+        Ok(cmd) => forward(acked(cmd, envelope.seq, acks), sink),
+        Err(e) => {
+            error!("bad command: {} — {}", String::from_utf8_lossy(line), e);
+            if let Some(acks) = acks {
+                acks.reply(envelope.seq, Err(&format!("bad command: {}", e)), 0);
+            }
+            true
+        }
+    }
+}
+
+/// `cmd` with its acknowledgement.  Without a sink to answer on (the
+/// client's socket could not be duplicated) the command still runs, just
+/// unanswered: dropping it would lose a keypress the plugin has already
+/// reported as done.
+fn acked(cmd: Command, seq: u32, acks: Option<&AckSink>) -> Command {
+    match acks {
+        Some(acks) => Command::Acked(Box::new(cmd), Ack::new(seq, acks)),
+        None => cmd,
+    }
+}
+
+/// Forward a decoded command, stamping the receive time on traced ones.
+/// Returns false once the sink closed.
+fn forward(mut cmd: Command, sink: &mpsc::Sender<Command>) -> bool {
+    cmd.mark_received(monotonic_ns());
+    debug!("received {:?}", cmd);
+    sink.send(cmd).is_ok()
 }
 
 //  Tests 
@@ -116,7 +785,7 @@ impl CommandSource for UnixSocketListener {
 mod tests {
     use super::*;
     use crate::command::Direction;
-    use std::io::Write;
+    use std::io::{BufRead, BufReader, Write};
     use std::os::unix::net::UnixStream;
     use std::sync::atomic::{AtomicU32, Ordering};
 
@@ -172,6 +841,153 @@ mod tests {
         let _ = std::fs::remove_file(&path);
     }
 
+    #[test]
+    fn idle_persistent_client_does_not_block_others() {
+        let path = tmp_socket_path();
+        let path2 = path.clone();
+        let (tx, rx) = mpsc::channel();
+
+        let _handle = std::thread::spawn(move || {
+            let mut listener = UnixSocketListener::new(&path2);
+            let _ = listener.run(tx);
+        });
+
+        std::thread::sleep(std::time::Duration::from_millis(150));
+
+        // Like the plugin: connect, send, and keep the connection open.
+        let mut persistent = UnixStream::connect(&path).expect("connect persistent");
+        writeln!(persistent, r#"{{"Go":"Left"}}"#).unwrap();
+
+        // A second, short-lived client must still get through.
+        {
+            let mut stream = UnixStream::connect(&path).expect("connect second");
+            writeln!(stream, r#"{{"Go":"Right"}}"#).unwrap();
+            stream.shutdown(std::net::Shutdown::Write).unwrap();
+        }
+
+        std::thread::sleep(std::time::Duration::from_millis(150));
+        let mut cmds: Vec<Command> = rx.try_iter().collect();
+        cmds.sort_by_key(|c| format!("{:?}", c));
+        assert_eq!(cmds, vec![Command::Go(Direction::Left), Command::Go(Direction::Right)]);
+
+        drop(persistent);
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn binary_handshake_and_frames() {
+        let path = tmp_socket_path();
+        let path2 = path.clone();
+        let (tx, rx) = mpsc::channel();
+
+        let _handle = std::thread::spawn(move || {
+            let mut listener = UnixSocketListener::new(&path2);
+            let _ = listener.run(tx);
+        });
+
+        std::thread::sleep(std::time::Duration::from_millis(150));
+
+        {
+            let mut stream = UnixStream::connect(&path).expect("connect");
+            writeln!(stream, "{}", protocol::HELLO_BINARY_V1).unwrap();
+            let mut reply = String::new();
+            BufReader::new(stream.try_clone().unwrap()).read_line(&mut reply).unwrap();
+            assert_eq!(reply.trim(), protocol::ACCEPT_BINARY_V1);
+
+            let update = Command::SwipeUpdate { fingers: 3, dx: 1.5, dy: -0.25, trace: None };
+            stream.write_all(&protocol::encode_frame(&Command::Go(Direction::Up)).unwrap()).unwrap();
+            stream.write_all(&protocol::encode_frame(&update).unwrap()).unwrap();
+            // Unknown opcode is skipped without losing framing.
+            stream.write_all(&[0x7f, 2, 0xaa, 0xbb]).unwrap();
+            // JSON lines still work on a binary connection.
+            writeln!(stream, r#""CancelMove""#).unwrap();
+            stream.write_all(&protocol::encode_frame(&Command::SwipeEnd).unwrap()).unwrap();
+            stream.shutdown(std::net::Shutdown::Write).unwrap();
+        }
+
+        std::thread::sleep(std::time::Duration::from_millis(150));
+        let cmds: Vec<Command> = rx.try_iter().collect();
+        assert_eq!(
+            cmds,
+            vec![
+                Command::Go(Direction::Up),
+                Command::SwipeUpdate { fingers: 3, dx: 1.5, dy: -0.25, trace: None },
+                Command::CancelMove,
+                Command::SwipeEnd,
+            ]
+        );
+
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn unknown_handshake_stays_on_json() {
+        let path = tmp_socket_path();
+        let path2 = path.clone();
+        let (tx, rx) = mpsc::channel();
+
+        let _handle = std::thread::spawn(move || {
+            let mut listener = UnixSocketListener::new(&path2);
+            let _ = listener.run(tx);
+        });
+
+        std::thread::sleep(std::time::Duration::from_millis(150));
+
+        {
+            let mut stream = UnixStream::connect(&path).expect("connect");
+            writeln!(stream, "HELLO hyprgrd-binary/99").unwrap();
+            let mut reply = String::new();
+            BufReader::new(stream.try_clone().unwrap()).read_line(&mut reply).unwrap();
+            assert_eq!(reply.trim(), protocol::ACCEPT_JSON);
+            writeln!(stream, r#"{{"Go":"Right"}}"#).unwrap();
+            stream.shutdown(std::net::Shutdown::Write).unwrap();
+        }
+
+        std::thread::sleep(std::time::Duration::from_millis(150));
+        let cmds: Vec<Command> = rx.try_iter().collect();
+        assert_eq!(cmds, vec![Command::Go(Direction::Right)]);
+
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn traced_updates_are_stamped_on_receipt() {
+        let path = tmp_socket_path();
+        let path2 = path.clone();
+        let (tx, rx) = mpsc::channel();
+
+        let _handle = std::thread::spawn(move || {
+            let mut listener = UnixSocketListener::new(&path2);
+            let _ = listener.run(tx);
+        });
+
+        std::thread::sleep(std::time::Duration::from_millis(150));
+
+        let sent_ns = monotonic_ns();
+        {
+            let mut stream = UnixStream::connect(&path).expect("connect");
+            writeln!(
+                stream,
+                r#"{{"SwipeUpdate":{{"fingers":3,"dx":1.0,"dy":0.0,"trace":{{"input_ms":1,"sent_ns":{}}}}}}}"#,
+                sent_ns
+            )
+            .unwrap();
+            stream.shutdown(std::net::Shutdown::Write).unwrap();
+        }
+
+        std::thread::sleep(std::time::Duration::from_millis(150));
+        let cmds: Vec<Command> = rx.try_iter().collect();
+        match cmds.as_slice() {
+            [Command::SwipeUpdate { trace: Some(t), .. }] => {
+                assert_eq!(t.sent_ns, sent_ns);
+                assert!(t.received_ns >= sent_ns && t.received_ns <= monotonic_ns());
+            }
+            other => panic!("unexpected commands: {:?}", other),
+        }
+
+        let _ = std::fs::remove_file(&path);
+    }
+
     #[test]
     fn malformed_json_does_not_crash() {
         let path = tmp_socket_path();
@@ -200,5 +1016,221 @@ mod tests {
 
         let _ = std::fs::remove_file(&path);
     }
-}
 
+    /// An [`EventLoop`] on a fresh socket, driven by hand with `round`.
+    fn manual_loop() -> (EventLoop, PathBuf, mpsc::Receiver<Command>) {
+        let path = tmp_socket_path();
+        let listener = UnixListener::bind(&path).unwrap();
+        listener.set_nonblocking(true).unwrap();
+        let (tx, rx) = mpsc::channel();
+        (EventLoop::new(listener, tx, PluginPresence::default()).unwrap(), path, rx)
+    }
+
+    #[test]
+    fn flooding_client_does_not_starve_others() {
+        let (mut event_loop, path, rx) = manual_loop();
+        let mut flood = UnixStream::connect(&path).unwrap();
+        let mut keybind = UnixStream::connect(&path).unwrap();
+        for _ in 0..100 {
+            writeln!(flood, r#""CancelMove""#).unwrap();
+        }
+        writeln!(keybind, r#"{{"Go":"Right"}}"#).unwrap();
+
+        let mut cmds = Vec::new();
+        while cmds.len() < 101 {
+            assert!(event_loop.round(1000).unwrap());
+            cmds.extend(rx.try_iter());
+        }
+        let at = cmds.iter().position(|c| *c == Command::Go(Direction::Right)).unwrap();
+        assert!(at <= MESSAGES_PER_TURN, "keybind served after {} flood messages", at);
+
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn messages_split_across_reads() {
+        let (mut event_loop, path, rx) = manual_loop();
+        let mut stream = UnixStream::connect(&path).unwrap();
+        event_loop.round(1000).unwrap(); // accept
+
+        writeln!(stream, "{}", protocol::HELLO_BINARY_V1).unwrap();
+        event_loop.round(1000).unwrap();
+        let mut reply = String::new();
+        BufReader::new(stream.try_clone().unwrap()).read_line(&mut reply).unwrap();
+        assert_eq!(reply.trim(), protocol::ACCEPT_BINARY_V1);
+
+        let frame = protocol::encode_frame(&Command::Go(Direction::Down)).unwrap();
+        let json = br#"{"Go":"Left"}"#;
+        stream.write_all(&frame[..1]).unwrap();
+        event_loop.round(1000).unwrap();
+        stream.write_all(&frame[1..]).unwrap();
+        stream.write_all(&json[..5]).unwrap();
+        event_loop.round(1000).unwrap();
+        assert_eq!(rx.try_iter().collect::<Vec<_>>(), vec![Command::Go(Direction::Down)]);
+
+        stream.write_all(&json[5..]).unwrap();
+        // No trailing newline: the line completes when the client hangs up.
+        stream.shutdown(std::net::Shutdown::Write).unwrap();
+        event_loop.round(1000).unwrap(); // the rest of the line
+        event_loop.round(1000).unwrap(); // EOF
+        assert_eq!(rx.try_iter().collect::<Vec<_>>(), vec![Command::Go(Direction::Left)]);
+        assert!(event_loop.clients.is_empty(), "closed client is dropped");
+
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn clients_forwarding_swipes_count_as_plugins() {
+        let (mut event_loop, path, rx) = manual_loop();
+        let presence = event_loop.presence.clone();
+        let mut script = UnixStream::connect(&path).unwrap();
+        let mut plugin = UnixStream::connect(&path).unwrap();
+        writeln!(script, r#"{{"Go":"Right"}}"#).unwrap();
+        while rx.try_recv().is_err() {
+            event_loop.round(1000).unwrap();
+        }
+        assert!(!presence.is_present(), "keybind clients are not plugins");
+
+        writeln!(plugin, r#""AttachGestures""#).unwrap();
+        writeln!(plugin, r#"{{"SwipeBegin":{{"fingers":3}}}}"#).unwrap();
+        while rx.try_iter().count() == 0 {
+            event_loop.round(1000).unwrap();
+        }
+        assert!(presence.is_present());
+
+        drop(plugin);
+        while event_loop.clients.len() > 1 {
+            event_loop.round(1000).unwrap();
+        }
+        assert!(!presence.is_present(), "presence ends with the connection");
+
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn sequenced_commands_are_acknowledged() {
+        let (mut event_loop, path, rx) = manual_loop();
+        let mut stream = UnixStream::connect(&path).unwrap();
+        let mut replies = BufReader::new(stream.try_clone().unwrap());
+        event_loop.round(1000).unwrap(); // accept
+
+        writeln!(stream, "{}", protocol::HELLO_ACKS_V1).unwrap();
+        writeln!(stream, r#"{{"seq":5,"cmd":{{"Go":"Right"}}}}"#).unwrap();
+        writeln!(stream, r#"{{"seq":6,"cmd":{{"Go":"Nowhere"}}}}"#).unwrap();
+        event_loop.round(1000).unwrap();
+        let mut reply = String::new();
+        replies.read_line(&mut reply).unwrap();
+        assert_eq!(reply.trim(), protocol::ACCEPT_ACKS_V1);
+        // The bad command is answered by the listener itself.
+        reply.clear();
+        replies.read_line(&mut reply).unwrap();
+        assert!(reply.starts_with("ACK 6 err 0 bad command"), "{}", reply);
+
+        let cmds: Vec<_> = rx.try_iter().collect();
+        assert_eq!(cmds.len(), 1);
+        let Command::Acked(inner, ack) = &cmds[0] else {
+            panic!("expected an acked command, got {:?}", cmds[0]);
+        };
+        assert_eq!(**inner, Command::Go(Direction::Right));
+        assert_eq!(ack.seq, 5);
+        ack.reply(Ok(()), 1200);
+        reply.clear();
+        replies.read_line(&mut reply).unwrap();
+        assert_eq!(reply, "ACK 5 ok 1200\n");
+
+        // The same over binary framing.
+        writeln!(stream, "{}", protocol::HELLO_BINARY_V1).unwrap();
+        event_loop.round(1000).unwrap();
+        reply.clear();
+        replies.read_line(&mut reply).unwrap();
+        assert_eq!(reply.trim(), protocol::ACCEPT_BINARY_V1);
+        stream.write_all(&protocol::encode_sequenced(9, &Command::Go(Direction::Up)).unwrap()).unwrap();
+        event_loop.round(1000).unwrap();
+        let cmds: Vec<_> = rx.try_iter().collect();
+        assert!(matches!(&cmds[..], [Command::Acked(inner, ack)] if **inner == Command::Go(Direction::Up) && ack.seq == 9));
+
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn sequenced_commands_run_without_an_ack_sink() {
+        let (tx, rx) = mpsc::channel();
+        assert!(dispatch_sequenced_json(br#"{"seq":5,"cmd":{"Go":"Right"}}"#, None, &tx));
+        assert!(dispatch_sequenced_json(br#"{"seq":6,"cmd":{"Go":"Nowhere"}}"#, None, &tx));
+        assert_eq!(rx.try_iter().collect::<Vec<_>>(), vec![Command::Go(Direction::Right)]);
+    }
+
+    /// Send `bytes` with `fds` attached, like the plugin's attach frame.
+    fn send_with_fds(stream: &UnixStream, bytes: &[u8], fds: &[RawFd]) {
+        let mut iov = libc::iovec {
+            iov_base: bytes.as_ptr() as *mut _,
+            iov_len: bytes.len(),
+        };
+        let mut control = [0u64; 8];
+        // SAFETY: test-only sendmsg with buffers that outlive the call.
+        unsafe {
+            let mut msg: libc::msghdr = std::mem::zeroed();
+            msg.msg_iov = &mut iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control.as_mut_ptr().cast();
+            msg.msg_controllen = libc::CMSG_SPACE(std::mem::size_of_val(fds) as u32) as _;
+            let cmsg = libc::CMSG_FIRSTHDR(&msg);
+            (*cmsg).cmsg_level = libc::SOL_SOCKET;
+            (*cmsg).cmsg_type = libc::SCM_RIGHTS;
+            (*cmsg).cmsg_len = libc::CMSG_LEN(std::mem::size_of_val(fds) as u32) as _;
+            std::ptr::copy_nonoverlapping(fds.as_ptr(), libc::CMSG_DATA(cmsg) as *mut RawFd, fds.len());
+            assert_eq!(libc::sendmsg(stream.as_raw_fd(), &msg, 0), bytes.len() as isize);
+        }
+    }
+
+    #[test]
+    fn swipe_channel_updates_are_ordered_with_socket_frames() {
+        use crate::ipc::swipe_channel::tests::TestWriter;
+
+        let (mut event_loop, path, rx) = manual_loop();
+        let stream = UnixStream::connect(&path).unwrap();
+        let mut reader = BufReader::new(stream.try_clone().unwrap());
+        let mut reply = String::new();
+        event_loop.round(1000).unwrap(); // accept
+
+        writeln!(&stream, "{}", protocol::HELLO_BINARY_V1).unwrap();
+        event_loop.round(1000).unwrap();
+        reader.read_line(&mut reply).unwrap();
+
+        let mut writer = TestWriter::new();
+        let fds = [writer.memfd.as_raw_fd(), writer.doorbell.as_raw_fd()];
+        send_with_fds(&stream, &[protocol::op::ATTACH_SWIPE_CHANNEL, 0], &fds);
+        event_loop.round(1000).unwrap();
+        reply.clear();
+        reader.read_line(&mut reply).unwrap();
+        assert_eq!(reply.trim(), protocol::ACCEPT_SHM);
+
+        let update = |dx: f64| Command::SwipeUpdate { fingers: 3, dx, dy: 0.0, trace: None };
+        let frame = |cmd: &Command| protocol::encode_frame(cmd).unwrap();
+
+        writer.begin(3);
+        (&stream).write_all(&frame(&Command::SwipeBegin { fingers: 3 })).unwrap();
+        event_loop.round(1000).unwrap();
+        assert_eq!(rx.try_iter().collect::<Vec<_>>(), vec![Command::SwipeBegin { fingers: 3 }]);
+
+        // The doorbell wakes the loop; updates between wakeups merge.
+        assert!(writer.add(3, 1.0, 0.0, 0));
+        event_loop.round(1000).unwrap();
+        assert!(writer.add(3, 1.0, 0.0, 0));
+        assert!(!writer.add(3, 1.0, 0.0, 0));
+        event_loop.round(1000).unwrap();
+        assert_eq!(rx.try_iter().collect::<Vec<_>>(), vec![update(1.0), update(2.0)]);
+
+        // Motion published before SwipeEnd is delivered before it, rung or not.
+        assert!(writer.add(3, 0.5, 0.0, 0));
+        assert!(!writer.add(3, 0.25, 0.0, 0));
+        (&stream).write_all(&frame(&Command::SwipeEnd)).unwrap();
+        event_loop.round(1000).unwrap();
+        assert_eq!(rx.try_iter().collect::<Vec<_>>(), vec![update(0.75), Command::SwipeEnd]);
+
+        drop((stream, reader));
+        event_loop.round(1000).unwrap();
+        assert!(event_loop.clients.is_empty(), "client and doorbell deregistered");
+        let _ = std::fs::remove_file(&path);
+    }
+}
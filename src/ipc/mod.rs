@@ -1,9 +1,15 @@
 //! IPC listener that accepts commands over a Unix socket.
 //!
 //! External tools (scripts, key-bind helpers, etc.) can connect to the
-//! socket and send newline-delimited JSON commands.
+//! socket and send newline-delimited JSON commands, or negotiate the
+//! compact binary framing used by the Hyprland plugin, which can also hand
+//! over a shared-memory channel for swipe updates.  Clients that ask get
+//! every sequenced command acknowledged.
 
+pub mod ack;
 pub mod listener;
+pub mod protocol;
+pub mod swipe_channel;
 
 
 
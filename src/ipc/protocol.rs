@@ -0,0 +1,665 @@
+//! Compact binary wire protocol spoken by the Hyprland plugin.
+//!
+//! Mirrors `plugin/protocol.hpp`; keep the two in sync.
+//!
+//! Every connection starts in JSON mode (see [`listener`](super::listener)).
+//! A client that wants binary framing sends the handshake line
+//! [`HELLO_BINARY_V2`] and the daemon answers [`ACCEPT_BINARY_V2`] before
+//! switching that connection to binary frames, or [`ACCEPT_JSON`] for any
+//! other `HELLO`.  Version 2 adds the [pre-parsed](#pre-parsed-arguments)
+//! dispatcher frames; [`HELLO_BINARY_V1`] is still accepted, and a client
+//! told [`ACCEPT_JSON`] may retry with it.  Clients that never send a
+//! handshake (`socat`, scripts) simply keep using JSON.
+//!
+//! Before that, a client may send [`HELLO_ACKS_V1`] to have its
+//! [sequenced](super::ack) commands acknowledged; the daemon answers
+//! [`ACCEPT_ACKS_V1`] and the framing stays as it was.
+//!
+//! # Frames
+//!
+//! `[opcode: u8][len: u8][payload: len bytes]`, little-endian:
+//!
+//! | Opcode | Command | Payload |
+//! |---|---|---|
+//! | `0x01` | `Go` | direction (UTF-8) |
+//! | `0x02` | `MoveWindowAndGo` | direction (UTF-8) |
+//! | `0x03` | `SwitchTo` | `"col row"` (UTF-8) |
+//! | `0x04` | `MoveWindowToMonitor` | direction (UTF-8) |
+//! | `0x05` | `MoveWindowToMonitorIndex` | index (UTF-8) |
+//! | `0x06` | `ToggleVisualizer` | — |
+//! | `0x07` | `SyncGrid` | cols, rows, col, row (`u32` each) |
+//! | `0x08` | `AttachOverlay` | — |
+//! | `0x10` | `SwipeBegin` | fingers `u32` |
+//! | `0x11` | `SwipeUpdate` | fingers `u32`, dx `f64`, dy `f64`, time_ms `u32`, sent_ns `u64` |
+//! | `0x12` | `SwipeEnd` | — |
+//! | `0x13` | attach [swipe channel](super::swipe_channel) | — (memfd + eventfd as `SCM_RIGHTS`) |
+//! | `0x14` | `SwipeVelocity` | vx `f64`, vy `f64` |
+//! | `0x15` | [sequenced](super::ack) command | seq `u32`, then the command's frame |
+//! | `0x16` | `AttachGestures` | — |
+//! | `0x17` | `GoN` | direction code `u8`, count `u32` |
+//!
+//! `GoN` is key repeat the plugin folded into one move while the daemon
+//! was busy; it sends it only on version-2 connections.
+//!
+//! `time_ms` / `sent_ns` are the [latency trace](crate::latency::InputTrace)
+//! (both 0 when absent).  The older 24-byte `SwipeUpdate` without
+//! `sent_ns` is still accepted.
+//!
+//! # Pre-parsed arguments
+//!
+//! A dispatcher opcode with [`PARSED`](op::PARSED) set carries its
+//! argument already parsed, so the daemon does no string handling at all:
+//!
+//! | Opcode | Command | Payload |
+//! |---|---|---|
+//! | `0x81` | `Go` | direction code `u8` |
+//! | `0x82` | `MoveWindowAndGo` | direction code `u8` |
+//! | `0x83` | `SwitchTo` | col, row (`u32` each) |
+//! | `0x84` | `MoveWindowToMonitor` | direction code `u8` |
+//! | `0x85` | `MoveWindowToMonitorIndex` | index `u32` |
+//!
+//! Direction codes are the order of [`Direction::ALL`].  Only version-2
+//! connections send these; the plugin falls back to the string form for
+//! arguments it can't parse, so the daemon still reports the error.
+//!
+//! `0x13` is not a command: the listener takes the attached fds and
+//! answers [`ACCEPT_SHM`], or [`REJECT_SHM`] if they are unusable.
+//!
+//! String payloads go through the same parsers as their JSON form.  A
+//! binary connection also accepts JSON lines: no opcode is `{` or `"`.
+
+use crate::command::{Command, Direction, GridSync, MonitorIndex, SwitchToTarget};
+use crate::latency::InputTrace;
+use serde::de::value::{Error as ValueError, StrDeserializer};
+use serde::de::IntoDeserializer;
+use serde::Deserialize;
+
+/// Handshake line requesting binary framing, version 1.
+pub const HELLO_BINARY_V1: &str = "HELLO hyprgrd-binary/1";
+/// Reply accepting binary framing, version 1.
+pub const ACCEPT_BINARY_V1: &str = "OK hyprgrd-binary/1";
+/// Handshake line requesting binary framing with pre-parsed arguments.
+pub const HELLO_BINARY_V2: &str = "HELLO hyprgrd-binary/2";
+/// Reply accepting binary framing, version 2.
+pub const ACCEPT_BINARY_V2: &str = "OK hyprgrd-binary/2";
+/// Reply to any other `HELLO`: the connection stays on JSON.
+pub const ACCEPT_JSON: &str = "OK json";
+/// Reply accepting an attached swipe channel.
+pub const ACCEPT_SHM: &str = "OK shm";
+/// Reply rejecting an attached swipe channel; swipes stay on the socket.
+pub const REJECT_SHM: &str = "NO shm";
+/// Handshake line asking for acknowledgements of sequenced commands.
+pub const HELLO_ACKS_V1: &str = "HELLO hyprgrd-acks/1";
+/// Reply promising acknowledgements.
+pub const ACCEPT_ACKS_V1: &str = "OK hyprgrd-acks/1";
+
+/// What a handshake switches on for its connection.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Upgrade {
+    /// Nothing; the connection stays on JSON.
+    None,
+    /// Binary framing.
+    Binary,
+    /// Acknowledgements of sequenced commands.
+    Acks,
+}
+
+/// Frame opcodes.
+pub mod op {
+    pub const GO: u8 = 0x01;
+    pub const MOVE_WINDOW_AND_GO: u8 = 0x02;
+    pub const SWITCH_TO: u8 = 0x03;
+    pub const MOVE_WINDOW_TO_MONITOR: u8 = 0x04;
+    pub const MOVE_WINDOW_TO_MONITOR_INDEX: u8 = 0x05;
+    pub const TOGGLE_VISUALIZER: u8 = 0x06;
+    pub const SYNC_GRID: u8 = 0x07;
+    pub const ATTACH_OVERLAY: u8 = 0x08;
+    pub const SWIPE_BEGIN: u8 = 0x10;
+    pub const SWIPE_UPDATE: u8 = 0x11;
+    pub const SWIPE_END: u8 = 0x12;
+    pub const ATTACH_SWIPE_CHANNEL: u8 = 0x13;
+    pub const SWIPE_VELOCITY: u8 = 0x14;
+    pub const SEQUENCED: u8 = 0x15;
+    pub const ATTACH_GESTURES: u8 = 0x16;
+    pub const GO_N: u8 = 0x17;
+    /// Flag on a dispatcher opcode: the argument is pre-parsed.
+    pub const PARSED: u8 = 0x80;
+}
+
+/// Size of the fixed `SwipeUpdate` payload.
+pub const SWIPE_UPDATE_PAYLOAD: usize = 4 + 8 + 8 + 4 + 8;
+
+/// `SwipeUpdate` payload of plugins that predate `sent_ns`.
+const SWIPE_UPDATE_PAYLOAD_V1: usize = 4 + 8 + 8 + 4;
+
+/// Errors produced while decoding a binary frame.
+#[derive(Debug, thiserror::Error, PartialEq)]
+pub enum ProtocolError {
+    #[error("unknown opcode 0x{0:02x}")]
+    UnknownOpcode(u8),
+    #[error("opcode 0x{op:02x}: bad payload length {len}")]
+    BadLength { op: u8, len: usize },
+    #[error("opcode 0x{op:02x}: payload is not UTF-8")]
+    NotUtf8 { op: u8 },
+    #[error("opcode 0x{op:02x}: {msg}")]
+    BadArgument { op: u8, msg: String },
+}
+
+/// If `line` is a handshake, return the reply to send back and what it
+/// switches on.
+pub fn handshake(line: &str) -> Option<(&'static str, Upgrade)> {
+    let line = line.trim();
+    if line == HELLO_BINARY_V2 {
+        Some((ACCEPT_BINARY_V2, Upgrade::Binary))
+    } else if line == HELLO_BINARY_V1 {
+        Some((ACCEPT_BINARY_V1, Upgrade::Binary))
+    } else if line == HELLO_ACKS_V1 {
+        Some((ACCEPT_ACKS_V1, Upgrade::Acks))
+    } else if line.starts_with("HELLO ") {
+        Some((ACCEPT_JSON, Upgrade::None))
+    } else {
+        None
+    }
+}
+
+/// True if a frame starting with `byte` is really a JSON line.
+pub fn starts_json(byte: u8) -> bool {
+    matches!(byte, b'{' | b'"' | b' ' | b'\t' | b'\r' | b'\n')
+}
+
+/// Decode one frame's opcode and payload into a [`Command`].
+pub fn decode_frame(op: u8, payload: &[u8]) -> Result<Command, ProtocolError> {
+    let expect_len = |len: usize| {
+        if payload.len() == len {
+            Ok(())
+        } else {
+            Err(ProtocolError::BadLength { op, len: payload.len() })
+        }
+    };
+    match op {
+        op::GO => Ok(Command::Go(parse_arg::<Direction>(op, payload)?)),
+        op::MOVE_WINDOW_AND_GO => Ok(Command::MoveWindowAndGo(parse_arg::<Direction>(op, payload)?)),
+        op::SWITCH_TO => Ok(Command::SwitchTo(parse_arg::<SwitchToTarget>(op, payload)?)),
+        op::MOVE_WINDOW_TO_MONITOR => {
+            Ok(Command::MoveWindowToMonitor(parse_arg::<Direction>(op, payload)?))
+        }
+        op::MOVE_WINDOW_TO_MONITOR_INDEX => {
+            Ok(Command::MoveWindowToMonitorIndex(parse_arg::<MonitorIndex>(op, payload)?))
+        }
+        op::TOGGLE_VISUALIZER => expect_len(0).map(|_| Command::ToggleVisualizer),
+        op::SYNC_GRID => {
+            expect_len(16)?;
+            let field = |i: usize| read_u32(payload, 4 * i) as usize;
+            Ok(Command::SyncGrid(GridSync { cols: field(0), rows: field(1), col: field(2), row: field(3) }))
+        }
+        op::ATTACH_OVERLAY => expect_len(0).map(|_| Command::AttachOverlay),
+        op::ATTACH_GESTURES => expect_len(0).map(|_| Command::AttachGestures),
+        op::SWIPE_BEGIN => {
+            expect_len(4)?;
+            Ok(Command::SwipeBegin { fingers: read_u32(payload, 0) })
+        }
+        op::SWIPE_UPDATE => {
+            if payload.len() != SWIPE_UPDATE_PAYLOAD_V1 {
+                expect_len(SWIPE_UPDATE_PAYLOAD)?;
+            }
+            let input_ms = read_u32(payload, 20);
+            let sent_ns = if payload.len() == SWIPE_UPDATE_PAYLOAD { read_u64(payload, 24) } else { 0 };
+            Ok(Command::SwipeUpdate {
+                fingers: read_u32(payload, 0),
+                dx: read_f64(payload, 4),
+                dy: read_f64(payload, 12),
+                trace: (sent_ns != 0).then_some(InputTrace { input_ms, sent_ns, received_ns: 0 }),
+            })
+        }
+        op::SWIPE_VELOCITY => {
+            expect_len(16)?;
+            Ok(Command::SwipeVelocity { vx: read_f64(payload, 0), vy: read_f64(payload, 8) })
+        }
+        op::SWIPE_END => expect_len(0).map(|_| Command::SwipeEnd),
+        op::GO_N => {
+            expect_len(5)?;
+            let dir = Direction::from_code(payload[0]).ok_or_else(|| ProtocolError::BadArgument {
+                op,
+                msg: format!("unknown direction code {}", payload[0]),
+            })?;
+            Ok(Command::GoN { dir, count: read_u32(payload, 1) })
+        }
+        parsed if parsed & op::PARSED != 0 => decode_parsed(parsed, payload),
+        other => Err(ProtocolError::UnknownOpcode(other)),
+    }
+}
+
+/// Decode a [pre-parsed](op::PARSED) dispatcher frame.
+fn decode_parsed(op: u8, payload: &[u8]) -> Result<Command, ProtocolError> {
+    let expect_len = |n: usize| {
+        if payload.len() == n {
+            Ok(())
+        } else {
+            Err(ProtocolError::BadLength { op, len: payload.len() })
+        }
+    };
+    let direction = || {
+        expect_len(1)?;
+        Direction::from_code(payload[0])
+            .ok_or_else(|| ProtocolError::BadArgument { op, msg: format!("unknown direction code {}", payload[0]) })
+    };
+    match op & !op::PARSED {
+        op::GO => Ok(Command::Go(direction()?)),
+        op::MOVE_WINDOW_AND_GO => Ok(Command::MoveWindowAndGo(direction()?)),
+        op::MOVE_WINDOW_TO_MONITOR => Ok(Command::MoveWindowToMonitor(direction()?)),
+        op::SWITCH_TO => {
+            expect_len(8)?;
+            let (x, y) = (read_u32(payload, 0) as usize, read_u32(payload, 4) as usize);
+            Ok(Command::SwitchTo(SwitchToTarget { x, y }))
+        }
+        op::MOVE_WINDOW_TO_MONITOR_INDEX => {
+            expect_len(4)?;
+            Ok(Command::MoveWindowToMonitorIndex(MonitorIndex(read_u32(payload, 0) as usize)))
+        }
+        _ => Err(ProtocolError::UnknownOpcode(op)),
+    }
+}
+
+/// Split a [`SEQUENCED`](op::SEQUENCED) payload into its sequence id and
+/// the decoded inner command.  The outer error means not even the id
+/// could be read; an inner one should be acknowledged as a failure.
+pub fn decode_sequenced(payload: &[u8]) -> Result<(u32, Result<Command, ProtocolError>), ProtocolError> {
+    let bad_length = ProtocolError::BadLength { op: op::SEQUENCED, len: payload.len() };
+    if payload.len() < 6 || payload.len() != 6 + payload[5] as usize {
+        return Err(bad_length);
+    }
+    let seq = read_u32(payload, 0);
+    match payload[4] {
+        // Sequencing a sequenced frame would need two acks for one command.
+        op::SEQUENCED => Ok((seq, Err(ProtocolError::UnknownOpcode(op::SEQUENCED)))),
+        inner => Ok((seq, decode_frame(inner, &payload[6..]))),
+    }
+}
+
+/// Encode `cmd` as a [`SEQUENCED`](op::SEQUENCED) frame with id `seq`, or
+/// `None` if `cmd` has no frame of its own.
+pub fn encode_sequenced(seq: u32, cmd: &Command) -> Option<Vec<u8>> {
+    let inner = encode_frame(cmd)?;
+    let mut out = vec![op::SEQUENCED, (4 + inner.len()) as u8];
+    out.extend_from_slice(&seq.to_le_bytes());
+    out.extend_from_slice(&inner);
+    Some(out)
+}
+
+/// Encode a dispatcher command as a [pre-parsed](op::PARSED) frame, or
+/// `None` for commands without one.  Only for version-2 connections.
+pub fn encode_parsed_frame(cmd: &Command) -> Option<Vec<u8>> {
+    let direction = |op: u8, d: &Direction| vec![op | op::PARSED, 1, d.code()];
+    let frame = match cmd {
+        Command::Go(d) => direction(op::GO, d),
+        Command::MoveWindowAndGo(d) => direction(op::MOVE_WINDOW_AND_GO, d),
+        Command::MoveWindowToMonitor(d) => direction(op::MOVE_WINDOW_TO_MONITOR, d),
+        Command::SwitchTo(t) => {
+            let mut out = vec![op::SWITCH_TO | op::PARSED, 8];
+            out.extend_from_slice(&(t.x as u32).to_le_bytes());
+            out.extend_from_slice(&(t.y as u32).to_le_bytes());
+            out
+        }
+        Command::MoveWindowToMonitorIndex(i) => {
+            let mut out = vec![op::MOVE_WINDOW_TO_MONITOR_INDEX | op::PARSED, 4];
+            out.extend_from_slice(&(i.0 as u32).to_le_bytes());
+            out
+        }
+        _ => return None,
+    };
+    Some(frame)
+}
+
+/// Encode `cmd` as a frame, or `None` for commands the binary protocol
+/// doesn't carry (they can still be sent as a JSON line).
+///
+/// Used by the tests and by any Rust client that wants the compact form.
+pub fn encode_frame(cmd: &Command) -> Option<Vec<u8>> {
+    let arg_frame = |op: u8, arg: String| {
+        let mut out = vec![op, arg.len() as u8];
+        out.extend_from_slice(arg.as_bytes());
+        out
+    };
+    let frame = match cmd {
+        Command::Go(d) => arg_frame(op::GO, d.to_string()),
+        Command::MoveWindowAndGo(d) => arg_frame(op::MOVE_WINDOW_AND_GO, d.to_string()),
+        Command::SwitchTo(t) => arg_frame(op::SWITCH_TO, format!("{} {}", t.x, t.y)),
+        Command::MoveWindowToMonitor(d) => arg_frame(op::MOVE_WINDOW_TO_MONITOR, d.to_string()),
+        Command::MoveWindowToMonitorIndex(i) => {
+            arg_frame(op::MOVE_WINDOW_TO_MONITOR_INDEX, i.0.to_string())
+        }
+        Command::ToggleVisualizer => vec![op::TOGGLE_VISUALIZER, 0],
+        Command::SyncGrid(g) => {
+            let mut out = vec![op::SYNC_GRID, 16];
+            for v in [g.cols, g.rows, g.col, g.row] {
+                out.extend_from_slice(&(v as u32).to_le_bytes());
+            }
+            out
+        }
+        Command::AttachOverlay => vec![op::ATTACH_OVERLAY, 0],
+        Command::AttachGestures => vec![op::ATTACH_GESTURES, 0],
+        Command::SwipeBegin { fingers } => {
+            let mut out = vec![op::SWIPE_BEGIN, 4];
+            out.extend_from_slice(&fingers.to_le_bytes());
+            out
+        }
+        Command::SwipeUpdate { fingers, dx, dy, trace } => {
+            let trace = trace.unwrap_or_default();
+            let mut out = vec![op::SWIPE_UPDATE, SWIPE_UPDATE_PAYLOAD as u8];
+            out.extend_from_slice(&fingers.to_le_bytes());
+            out.extend_from_slice(&dx.to_le_bytes());
+            out.extend_from_slice(&dy.to_le_bytes());
+            out.extend_from_slice(&trace.input_ms.to_le_bytes());
+            out.extend_from_slice(&trace.sent_ns.to_le_bytes());
+            out
+        }
+        Command::SwipeVelocity { vx, vy } => {
+            let mut out = vec![op::SWIPE_VELOCITY, 16];
+            out.extend_from_slice(&vx.to_le_bytes());
+            out.extend_from_slice(&vy.to_le_bytes());
+            out
+        }
+        Command::SwipeEnd => vec![op::SWIPE_END, 0],
+        Command::GoN { dir, count } => {
+            let mut out = vec![op::GO_N, 5, dir.code()];
+            out.extend_from_slice(&count.to_le_bytes());
+            out
+        }
+        _ => return None,
+    };
+    Some(frame)
+}
+
+/// Parse a UTF-8 string payload with the type's regular deserializer, so
+/// the binary form accepts exactly what the JSON string form accepts.
+fn parse_arg<'de, T: Deserialize<'de>>(op: u8, payload: &'de [u8]) -> Result<T, ProtocolError> {
+    let s = std::str::from_utf8(payload).map_err(|_| ProtocolError::NotUtf8 { op })?;
+    let de: StrDeserializer<'_, ValueError> = s.into_deserializer();
+    T::deserialize(de).map_err(|e| ProtocolError::BadArgument { op, msg: e.to_string() })
+}
+
+fn read_u32(buf: &[u8], at: usize) -> u32 {
+    u32::from_le_bytes(buf[at..at + 4].try_into().unwrap())
+}
+
+fn read_u64(buf: &[u8], at: usize) -> u64 {
+    u64::from_le_bytes(buf[at..at + 8].try_into().unwrap())
+}
+
+fn read_f64(buf: &[u8], at: usize) -> f64 {
+    f64::from_le_bytes(buf[at..at + 8].try_into().unwrap())
+}
+
+//  Tests
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn round_trip(cmd: Command) {
+        let frame = encode_frame(&cmd).expect("encodable");
+        assert_eq!(frame[1] as usize, frame.len() - 2, "length byte");
+        assert_eq!(decode_frame(frame[0], &frame[2..]), Ok(cmd));
+    }
+
+    #[test]
+    fn dispatcher_frames_round_trip() {
+        round_trip(Command::Go(Direction::UpLeft));
+        round_trip(Command::GoN { dir: Direction::DownRight, count: 40 });
+        round_trip(Command::MoveWindowAndGo(Direction::Down));
+        round_trip(Command::SwitchTo(SwitchToTarget { x: 3, y: 1 }));
+        round_trip(Command::MoveWindowToMonitor(Direction::Right));
+        round_trip(Command::MoveWindowToMonitorIndex(MonitorIndex(2)));
+        round_trip(Command::ToggleVisualizer);
+        round_trip(Command::AttachOverlay);
+        round_trip(Command::AttachGestures);
+        round_trip(Command::SyncGrid(GridSync { cols: 4, rows: 2, col: 3, row: 1 }));
+    }
+
+    #[test]
+    fn parsed_frames_round_trip() {
+        for cmd in [
+            Command::Go(Direction::DownRight),
+            Command::MoveWindowAndGo(Direction::Left),
+            Command::SwitchTo(SwitchToTarget { x: 3, y: 70_000 }),
+            Command::MoveWindowToMonitor(Direction::Up),
+            Command::MoveWindowToMonitorIndex(MonitorIndex(2)),
+        ] {
+            let frame = encode_parsed_frame(&cmd).expect("has a parsed form");
+            assert_ne!(frame[0] & op::PARSED, 0);
+            assert_eq!(frame[1] as usize, frame.len() - 2, "length byte");
+            assert_eq!(decode_frame(frame[0], &frame[2..]), Ok(cmd));
+        }
+        assert_eq!(encode_parsed_frame(&Command::ToggleVisualizer), None);
+        // Bytes as produced by the plugin's putParsedCommandFrame.
+        assert_eq!(decode_frame(0x81, &[1]), Ok(Command::Go(Direction::Right)));
+        assert_eq!(
+            decode_frame(0x83, &[2, 0, 0, 0, 1, 0, 0, 0]),
+            Ok(Command::SwitchTo(SwitchToTarget { x: 2, y: 1 }))
+        );
+    }
+
+    #[test]
+    fn bad_parsed_frames_are_rejected() {
+        let go = op::GO | op::PARSED;
+        assert!(matches!(decode_frame(go, &[8]), Err(ProtocolError::BadArgument { op: 0x81, .. })));
+        assert_eq!(decode_frame(go, &[1, 2]), Err(ProtocolError::BadLength { op: go, len: 2 }));
+        assert_eq!(
+            decode_frame(op::SWITCH_TO | op::PARSED, &[1, 0, 0, 0]),
+            Err(ProtocolError::BadLength { op: 0x83, len: 4 })
+        );
+        // Only dispatcher commands with an argument have a parsed form.
+        let toggle = op::TOGGLE_VISUALIZER | op::PARSED;
+        assert_eq!(decode_frame(toggle, &[]), Err(ProtocolError::UnknownOpcode(toggle)));
+        assert_eq!(decode_frame(0xff, &[]), Err(ProtocolError::UnknownOpcode(0xff)));
+        assert!(matches!(decode_frame(op::GO_N, &[9, 1, 0, 0, 0]), Err(ProtocolError::BadArgument { op: 0x17, .. })));
+        assert_eq!(decode_frame(op::GO_N, &[1]), Err(ProtocolError::BadLength { op: 0x17, len: 1 }));
+    }
+
+    #[test]
+    fn swipe_frames_round_trip() {
+        round_trip(Command::SwipeBegin { fingers: 4 });
+        round_trip(Command::SwipeUpdate { fingers: 3, dx: 12.25, dy: -0.125, trace: None });
+        round_trip(Command::SwipeUpdate {
+            fingers: 3,
+            dx: 1.0,
+            dy: 0.0,
+            trace: Some(InputTrace { input_ms: 42, sent_ns: 43_000_000, received_ns: 0 }),
+        });
+        round_trip(Command::SwipeVelocity { vx: 850.0, vy: -12.5 });
+        round_trip(Command::SwipeEnd);
+    }
+
+    #[test]
+    fn arg_payload_uses_json_parsers() {
+        // Same leniency as {"Go":"Right"} / {"SwitchTo":"1 2"}.
+        assert_eq!(decode_frame(op::GO, b"Right"), Ok(Command::Go(Direction::Right)));
+        assert_eq!(
+            decode_frame(op::SWITCH_TO, b" 1 2 "),
+            Ok(Command::SwitchTo(SwitchToTarget { x: 1, y: 2 }))
+        );
+        assert!(matches!(
+            decode_frame(op::GO, b"sideways"),
+            Err(ProtocolError::BadArgument { op: op::GO, .. })
+        ));
+    }
+
+    #[test]
+    fn swipe_update_payload_matches_plugin_layout() {
+        // Bytes as produced by the plugin's buildMessageFrame.
+        let mut payload = Vec::new();
+        payload.extend_from_slice(&3u32.to_le_bytes());
+        payload.extend_from_slice(&1.5f64.to_le_bytes());
+        payload.extend_from_slice(&(-2.0f64).to_le_bytes());
+        payload.extend_from_slice(&12345u32.to_le_bytes());
+        // Without sent_ns (older plugins): no trace.
+        assert_eq!(
+            decode_frame(op::SWIPE_UPDATE, &payload),
+            Ok(Command::SwipeUpdate { fingers: 3, dx: 1.5, dy: -2.0, trace: None })
+        );
+        payload.extend_from_slice(&99_000_000u64.to_le_bytes());
+        assert_eq!(
+            decode_frame(op::SWIPE_UPDATE, &payload),
+            Ok(Command::SwipeUpdate {
+                fingers: 3,
+                dx: 1.5,
+                dy: -2.0,
+                trace: Some(InputTrace { input_ms: 12345, sent_ns: 99_000_000, received_ns: 0 }),
+            })
+        );
+        payload.pop();
+        assert_eq!(
+            decode_frame(op::SWIPE_UPDATE, &payload),
+            Err(ProtocolError::BadLength { op: op::SWIPE_UPDATE, len: 31 })
+        );
+    }
+
+    #[test]
+    fn bad_frames_are_rejected() {
+        assert_eq!(decode_frame(0x7f, &[]), Err(ProtocolError::UnknownOpcode(0x7f)));
+        assert_eq!(
+            decode_frame(op::SWIPE_BEGIN, &[3]),
+            Err(ProtocolError::BadLength { op: op::SWIPE_BEGIN, len: 1 })
+        );
+        assert_eq!(
+            decode_frame(op::GO, &[0xff]),
+            Err(ProtocolError::NotUtf8 { op: op::GO })
+        );
+    }
+
+    #[test]
+    fn sequenced_frames_carry_id_and_inner_result() {
+        let frame = encode_sequenced(7, &Command::Go(Direction::Left)).unwrap();
+        assert_eq!(frame[..6], [op::SEQUENCED, 4 + 2 + 4, 7, 0, 0, 0]);
+        assert_eq!(decode_sequenced(&frame[2..]), Ok((7, Ok(Command::Go(Direction::Left)))));
+
+        // A bad inner command still yields the id to acknowledge.
+        let bad = [9, 0, 0, 0, op::GO, 2, b'x', b'x'];
+        let (seq, inner) = decode_sequenced(&bad).unwrap();
+        assert_eq!(seq, 9);
+        assert!(matches!(inner, Err(ProtocolError::BadArgument { op: op::GO, .. })));
+        assert!(decode_sequenced(&[9, 0, 0, 0, op::GO, 1, b'x', b'x']).is_err());
+        assert!(decode_sequenced(&bad[..4]).is_err());
+        let nested = [1, 0, 0, 0, op::SEQUENCED, 0];
+        assert_eq!(decode_sequenced(&nested), Ok((1, Err(ProtocolError::UnknownOpcode(op::SEQUENCED)))));
+    }
+
+    /// Read a file of the plugin's source tree.
+    fn plugin_source(name: &str) -> String {
+        let path = std::path::Path::new(env!("CARGO_MANIFEST_DIR")).join("plugin").join(name);
+        std::fs::read_to_string(&path).unwrap_or_else(|e| panic!("{}: {}", path.display(), e))
+    }
+
+    /// `name = 0x..` opcodes of the `Op` namespace in plugin/protocol.hpp.
+    fn plugin_opcodes() -> Vec<(String, u8)> {
+        plugin_source("protocol.hpp")
+            .lines()
+            .filter_map(|line| {
+                let rest = line.trim().strip_prefix("inline constexpr uint8_t ")?;
+                let (name, value) = rest.split_once('=')?;
+                let hex = value.trim().strip_prefix("0x")?.split(';').next()?;
+                Some((name.trim().to_string(), u8::from_str_radix(hex, 16).ok()?))
+            })
+            .collect()
+    }
+
+    #[test]
+    fn plugin_opcodes_match_daemon() {
+        let daemon = [
+            ("Go", op::GO),
+            ("GoN", op::GO_N),
+            ("MoveWindowAndGo", op::MOVE_WINDOW_AND_GO),
+            ("SwitchTo", op::SWITCH_TO),
+            ("MoveWindowToMonitor", op::MOVE_WINDOW_TO_MONITOR),
+            ("MoveWindowToMonitorIndex", op::MOVE_WINDOW_TO_MONITOR_INDEX),
+            ("ToggleVisualizer", op::TOGGLE_VISUALIZER),
+            ("SyncGrid", op::SYNC_GRID),
+            ("AttachOverlay", op::ATTACH_OVERLAY),
+            ("AttachGestures", op::ATTACH_GESTURES),
+            ("SwipeBegin", op::SWIPE_BEGIN),
+            ("SwipeUpdate", op::SWIPE_UPDATE),
+            ("SwipeEnd", op::SWIPE_END),
+            ("AttachSwipeChannel", op::ATTACH_SWIPE_CHANNEL),
+            ("SwipeVelocity", op::SWIPE_VELOCITY),
+            ("Sequenced", op::SEQUENCED),
+            ("Parsed", op::PARSED),
+        ];
+        let plugin = plugin_opcodes();
+        assert_eq!(plugin.len(), daemon.len(), "plugin opcodes: {:?}", plugin);
+        for (name, value) in daemon {
+            assert!(plugin.contains(&(name.to_string(), value)), "Op::{} = 0x{:02x} missing from protocol.hpp", name, value);
+        }
+    }
+
+    /// Every row of `DISPATCHER_COMMANDS` in plugin/commands.hpp must reach
+    /// the daemon as the same command in both wire formats.
+    #[test]
+    fn plugin_command_table_matches_daemon() {
+        let opcodes = plugin_opcodes();
+        let source = plugin_source("commands.hpp");
+        let rows: Vec<Vec<&str>> = source
+            .lines()
+            .filter_map(|line| line.trim().strip_prefix("CommandSpec{")?.strip_suffix("},"))
+            .map(|row| row.split(',').map(|field| field.trim().trim_matches('"')).collect())
+            .collect();
+        assert!(!rows.is_empty(), "no CommandSpec rows found in commands.hpp");
+
+        for row in rows {
+            let [dispatcher, variant, opcode, _kind, arg] = row[..] else {
+                panic!("malformed CommandSpec row: {:?}", row);
+            };
+            let opcode = opcode.strip_prefix("Op::").expect("opcode is an Op:: constant");
+            let (_, opcode) = opcodes.iter().find(|(name, _)| name == opcode).expect("opcode in protocol.hpp");
+            let sample = match arg {
+                "ArgKind::None" => None,
+                "ArgKind::Direction" => Some("right"),
+                "ArgKind::Cell" => Some("1 2"),
+                "ArgKind::Index" => Some("2"),
+                other => panic!("unknown argument kind {}", other),
+            };
+            let json = match sample {
+                Some(sample) => format!(r#"{{"{}":"{}"}}"#, variant, sample),
+                None => format!(r#""{}""#, variant),
+            };
+            let from_json: Command =
+                serde_json::from_str(&json).unwrap_or_else(|e| panic!("hyprgrd:{}: {} — {}", dispatcher, json, e));
+            let from_frame = decode_frame(*opcode, sample.unwrap_or("").as_bytes())
+                .unwrap_or_else(|e| panic!("hyprgrd:{}: {}", dispatcher, e));
+            assert_eq!(from_json, from_frame, "hyprgrd:{}", dispatcher);
+        }
+    }
+
+    #[test]
+    fn handshake_replies() {
+        assert_eq!(handshake(HELLO_BINARY_V2), Some((ACCEPT_BINARY_V2, Upgrade::Binary)));
+        assert_eq!(handshake(HELLO_BINARY_V1), Some((ACCEPT_BINARY_V1, Upgrade::Binary)));
+        assert_eq!(handshake(HELLO_ACKS_V1), Some((ACCEPT_ACKS_V1, Upgrade::Acks)));
+        assert_eq!(handshake("HELLO hyprgrd-binary/9"), Some((ACCEPT_JSON, Upgrade::None)));
+        assert_eq!(handshake(r#"{"Go":"Right"}"#), None);
+    }
+
+    #[test]
+    fn no_opcode_looks_like_json() {
+        for b in [
+            op::GO,
+            op::GO_N,
+            op::MOVE_WINDOW_AND_GO,
+            op::SWITCH_TO,
+            op::MOVE_WINDOW_TO_MONITOR,
+            op::MOVE_WINDOW_TO_MONITOR_INDEX,
+            op::TOGGLE_VISUALIZER,
+            op::SYNC_GRID,
+            op::ATTACH_OVERLAY,
+            op::ATTACH_GESTURES,
+            op::SWIPE_BEGIN,
+            op::SWIPE_UPDATE,
+            op::SWIPE_END,
+            op::ATTACH_SWIPE_CHANNEL,
+            op::SWIPE_VELOCITY,
+            op::SEQUENCED,
+        ] {
+            assert!(!starts_json(b), "opcode 0x{:02x}", b);
+            assert!(!starts_json(b | op::PARSED), "opcode 0x{:02x}", b | op::PARSED);
+        }
+    }
+}
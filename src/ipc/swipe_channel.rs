@@ -0,0 +1,413 @@
+//! Daemon side of the plugin's shared-memory swipe channel.
+//!
+//! Mirrors `plugin/swipe_channel.hpp`; keep the two in sync.
+//!
+//! The plugin publishes each gesture's running dx/dy totals into a seqlock
+//! [`SwipeSlot`] at the start of a memfd and rings an eventfd doorbell
+//! when the daemon has consumed the previous value.  Both fds arrive on an
+//! [`ATTACH_SWIPE_CHANNEL`](super::protocol::op::ATTACH_SWIPE_CHANNEL)
+//! frame; the [`listener`](super::listener) watches the doorbell and turns
+//! every wakeup into at most one [`Command::SwipeUpdate`] carrying the
+//! motion since the previous read — so a daemon that falls behind reads
+//! the latest totals once instead of draining a backlog of updates.
+//!
+//! SwipeBegin / SwipeEnd still come over the socket.  The channel only
+//! follows a gesture between its SwipeBegin ([`SwipeChannel::begin`]) and
+//! its SwipeEnd ([`SwipeChannel::end`]), and drains the slot at both, so
+//! no motion is lost to the race between doorbell and socket.
+
+use crate::command::Command;
+use crate::latency::InputTrace;
+use std::io;
+use std::os::fd::{AsRawFd, OwnedFd, RawFd};
+use std::ptr::NonNull;
+use std::sync::atomic::{fence, AtomicU32, AtomicU64, Ordering};
+
+/// `"HGSW"`, written last by the plugin once the slot is initialised.
+pub const MAGIC: u32 = 0x5753_4748;
+/// Slot layout version.
+pub const VERSION: u32 = 1;
+/// Size of the plugin's memfd.
+pub const SIZE: usize = 4096;
+
+/// The shared slot (`SwipeSlot` in the plugin).
+///
+/// Every field is written by the plugin except `reader_seq`, which only
+/// the daemon writes.  `seq` is odd while the plugin is writing; `dx` /
+/// `dy` hold the f64 bits of the gesture's totals since SwipeBegin.
+#[repr(C)]
+pub struct SwipeSlot {
+    magic: AtomicU32,
+    version: AtomicU32,
+    seq: AtomicU32,
+    reader_seq: AtomicU32,
+    gesture: AtomicU32,
+    fingers: AtomicU32,
+    dx: AtomicU64,
+    dy: AtomicU64,
+    sent_ns: AtomicU64,
+    input_ms: AtomicU32,
+    _reserved: [u32; 3],
+}
+
+const _: () = assert!(std::mem::size_of::<SwipeSlot>() == 64);
+
+/// A consistent copy of the slot.
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct SwipeSample {
+    pub seq: u32,
+    pub gesture: u32,
+    pub fingers: u32,
+    pub dx: f64,
+    pub dy: f64,
+    pub sent_ns: u64,
+    pub input_ms: u32,
+}
+
+impl SwipeSlot {
+    /// Seqlock read: retry until a copy is taken between two equal, even
+    /// reads of `seq`.
+    pub fn read(&self) -> SwipeSample {
+        loop {
+            let before = self.seq.load(Ordering::Acquire);
+            if before & 1 != 0 {
+                std::hint::spin_loop();
+                continue;
+            }
+            let sample = SwipeSample {
+                seq: before,
+                gesture: self.gesture.load(Ordering::Relaxed),
+                fingers: self.fingers.load(Ordering::Relaxed),
+                dx: f64::from_bits(self.dx.load(Ordering::Relaxed)),
+                dy: f64::from_bits(self.dy.load(Ordering::Relaxed)),
+                sent_ns: self.sent_ns.load(Ordering::Relaxed),
+                input_ms: self.input_ms.load(Ordering::Relaxed),
+            };
+            fence(Ordering::Acquire);
+            if self.seq.load(Ordering::Relaxed) == before {
+                return sample;
+            }
+        }
+    }
+
+    /// Read the latest sample and record it as consumed.
+    ///
+    /// The plugin only rings when `reader_seq` has caught up with what it
+    /// published before, so after recording, `seq` is checked once more
+    /// (both sides use `SeqCst`): either the plugin saw us caught up and
+    /// rang, or we see its newer value here.
+    fn consume(&self) -> SwipeSample {
+        loop {
+            let sample = self.read();
+            self.reader_seq.store(sample.seq, Ordering::SeqCst);
+            if self.seq.load(Ordering::SeqCst) == sample.seq {
+                return sample;
+            }
+        }
+    }
+}
+
+/// Shared mapping of the plugin's memfd.
+struct Mapping(NonNull<SwipeSlot>);
+
+// SAFETY: the mapping is only accessed through atomics.
+unsafe impl Send for Mapping {}
+
+impl Drop for Mapping {
+    fn drop(&mut self) {
+        // SAFETY: mapped with this size in `SwipeChannel::attach`.
+        unsafe { libc::munmap(self.0.as_ptr().cast(), SIZE) };
+    }
+}
+
+/// The gesture being followed and the totals already forwarded.
+#[derive(Debug, Clone, Copy)]
+struct Following {
+    gesture: u32,
+    dx: f64,
+    dy: f64,
+}
+
+/// One client's attached swipe channel.
+pub struct SwipeChannel {
+    map: Mapping,
+    doorbell: OwnedFd,
+    following: Option<Following>,
+}
+
+impl SwipeChannel {
+    /// Map the plugin's memfd and take its doorbell.  Fails if the memfd
+    /// is too small or doesn't hold an initialised slot of our version.
+    pub fn attach(memfd: OwnedFd, doorbell: OwnedFd) -> io::Result<Self> {
+        // SAFETY: fstat fills a valid, writable struct.
+        let mut st: libc::stat = unsafe { std::mem::zeroed() };
+        if unsafe { libc::fstat(memfd.as_raw_fd(), &mut st) } < 0 {
+            return Err(io::Error::last_os_error());
+        }
+        if (st.st_size as usize) < SIZE {
+            return Err(io::Error::new(io::ErrorKind::InvalidData, "swipe channel memfd too small"));
+        }
+        // SAFETY: fresh shared mapping of a file we hold; released by `Mapping`.
+        let ptr = unsafe {
+            libc::mmap(
+                std::ptr::null_mut(),
+                SIZE,
+                libc::PROT_READ | libc::PROT_WRITE,
+                libc::MAP_SHARED,
+                memfd.as_raw_fd(),
+                0,
+            )
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(io::Error::last_os_error());
+        }
+        let map = Mapping(NonNull::new(ptr.cast()).expect("mmap returned null"));
+        let channel = Self {
+            map,
+            doorbell,
+            following: None,
+        };
+        let slot = channel.slot();
+        if slot.magic.load(Ordering::Acquire) != MAGIC || slot.version.load(Ordering::Relaxed) != VERSION {
+            return Err(io::Error::new(io::ErrorKind::InvalidData, "not a hyprgrd swipe channel"));
+        }
+        // Catch up, so the plugin rings for its next update.
+        slot.consume();
+        Ok(channel)
+    }
+
+    fn slot(&self) -> &SwipeSlot {
+        // SAFETY: the mapping lives as long as `self` and is at least
+        // `SIZE` bytes, page-aligned.
+        unsafe { self.map.0.as_ref() }
+    }
+
+    /// The eventfd to watch for input.
+    pub fn doorbell_fd(&self) -> RawFd {
+        self.doorbell.as_raw_fd()
+    }
+
+    /// SwipeBegin arrived: follow the gesture the slot now shows and
+    /// forward whatever motion it already has.
+    pub fn begin(&mut self) -> Option<Command> {
+        let gesture = self.slot().read().gesture;
+        self.following = Some(Following { gesture, dx: 0.0, dy: 0.0 });
+        self.drain()
+    }
+
+    /// SwipeEnd arrived: forward the final motion and stop following.
+    pub fn end(&mut self) -> Option<Command> {
+        let last = self.drain();
+        self.following = None;
+        last
+    }
+
+    /// Clear the doorbell and turn the motion since the last read into a
+    /// [`Command::SwipeUpdate`], if the followed gesture moved.
+    pub fn drain(&mut self) -> Option<Command> {
+        let mut counter = 0u64;
+        // SAFETY: reads 8 bytes into `counter`; the eventfd is non-blocking.
+        unsafe { libc::read(self.doorbell.as_raw_fd(), (&mut counter as *mut u64).cast(), 8) };
+
+        let sample = self.slot().consume();
+        let following = self.following.as_mut()?;
+        if sample.gesture != following.gesture {
+            // A newer gesture; its SwipeBegin is still on the way.
+            return None;
+        }
+        let (dx, dy) = (sample.dx - following.dx, sample.dy - following.dy);
+        if dx == 0.0 && dy == 0.0 {
+            return None;
+        }
+        following.dx = sample.dx;
+        following.dy = sample.dy;
+        let trace = (sample.input_ms != 0).then_some(InputTrace {
+            input_ms: sample.input_ms,
+            sent_ns: sample.sent_ns,
+            received_ns: 0,
+        });
+        Some(Command::SwipeUpdate {
+            fingers: sample.fingers,
+            dx,
+            dy,
+            trace,
+        })
+    }
+}
+
+//  Tests
+
+#[cfg(test)]
+pub(crate) mod tests {
+    use super::*;
+    use std::os::fd::FromRawFd;
+
+    /// The plugin's end, for tests: a mapped memfd plus eventfd.
+    pub(crate) struct TestWriter {
+        slot: NonNull<SwipeSlot>,
+        pub memfd: OwnedFd,
+        pub doorbell: OwnedFd,
+        gesture: u32,
+        dx: f64,
+        dy: f64,
+    }
+
+    impl TestWriter {
+        pub(crate) fn new() -> Self {
+            // SAFETY: plain syscalls; results checked below.
+            unsafe {
+                let memfd = libc::memfd_create(c"hyprgrd-test-swipe".as_ptr(), libc::MFD_CLOEXEC);
+                assert!(memfd >= 0);
+                assert_eq!(libc::ftruncate(memfd, SIZE as libc::off_t), 0);
+                let ptr = libc::mmap(
+                    std::ptr::null_mut(),
+                    SIZE,
+                    libc::PROT_READ | libc::PROT_WRITE,
+                    libc::MAP_SHARED,
+                    memfd,
+                    0,
+                );
+                assert_ne!(ptr, libc::MAP_FAILED);
+                let doorbell = libc::eventfd(0, libc::EFD_NONBLOCK | libc::EFD_CLOEXEC);
+                assert!(doorbell >= 0);
+                let writer = Self {
+                    slot: NonNull::new(ptr.cast()).unwrap(),
+                    memfd: OwnedFd::from_raw_fd(memfd),
+                    doorbell: OwnedFd::from_raw_fd(doorbell),
+                    gesture: 0,
+                    dx: 0.0,
+                    dy: 0.0,
+                };
+                writer.slot().version.store(VERSION, Ordering::Relaxed);
+                writer.slot().magic.store(MAGIC, Ordering::Release);
+                writer
+            }
+        }
+
+        fn slot(&self) -> &SwipeSlot {
+            // SAFETY: mapped for the writer's lifetime.
+            unsafe { self.slot.as_ref() }
+        }
+
+        /// A channel reading this writer's slot.
+        pub(crate) fn reader(&self) -> SwipeChannel {
+            SwipeChannel::attach(self.memfd.try_clone().unwrap(), self.doorbell.try_clone().unwrap()).unwrap()
+        }
+
+        pub(crate) fn begin(&mut self, fingers: u32) {
+            self.gesture += 1;
+            self.dx = 0.0;
+            self.dy = 0.0;
+            self.publish(fingers, 0, false);
+        }
+
+        /// Returns whether the doorbell was rung.
+        pub(crate) fn add(&mut self, fingers: u32, dx: f64, dy: f64, input_ms: u32) -> bool {
+            self.dx += dx;
+            self.dy += dy;
+            self.publish(fingers, input_ms, true)
+        }
+
+        fn publish(&self, fingers: u32, input_ms: u32, ring: bool) -> bool {
+            let s = self.slot();
+            let seq = s.seq.load(Ordering::Relaxed);
+            s.seq.store(seq + 1, Ordering::Relaxed);
+            fence(Ordering::Release);
+            s.gesture.store(self.gesture, Ordering::Relaxed);
+            s.fingers.store(fingers, Ordering::Relaxed);
+            s.dx.store(self.dx.to_bits(), Ordering::Relaxed);
+            s.dy.store(self.dy.to_bits(), Ordering::Relaxed);
+            s.sent_ns.store(if input_ms != 0 { 42 } else { 0 }, Ordering::Relaxed);
+            s.input_ms.store(input_ms, Ordering::Relaxed);
+            s.seq.store(seq + 2, Ordering::SeqCst);
+            if ring && s.reader_seq.load(Ordering::SeqCst) == seq {
+                let one = 1u64;
+                // SAFETY: writes 8 bytes from `one`.
+                unsafe { libc::write(self.doorbell.as_raw_fd(), (&one as *const u64).cast(), 8) };
+                return true;
+            }
+            false
+        }
+    }
+
+    impl Drop for TestWriter {
+        fn drop(&mut self) {
+            // SAFETY: mapped with this size in `new`.
+            unsafe { libc::munmap(self.slot.as_ptr().cast(), SIZE) };
+        }
+    }
+
+    fn update(dx: f64, dy: f64) -> Command {
+        Command::SwipeUpdate { fingers: 3, dx, dy, trace: None }
+    }
+
+    #[test]
+    fn slot_layout_matches_plugin() {
+        assert_eq!(std::mem::offset_of!(SwipeSlot, seq), 8);
+        assert_eq!(std::mem::offset_of!(SwipeSlot, reader_seq), 12);
+        assert_eq!(std::mem::offset_of!(SwipeSlot, dx), 24);
+        assert_eq!(std::mem::offset_of!(SwipeSlot, input_ms), 48);
+    }
+
+    #[test]
+    fn forwards_motion_since_last_read_of_followed_gesture_only() {
+        let mut writer = TestWriter::new();
+        let mut channel = writer.reader();
+
+        // Not following yet: motion without SwipeBegin is ignored.
+        writer.add(3, 5.0, 0.0, 0);
+        assert_eq!(channel.drain(), None);
+
+        writer.begin(3);
+        writer.add(3, 1.0, 0.0, 0);
+        assert_eq!(channel.begin(), Some(update(1.0, 0.0)));
+
+        // Several updates between reads arrive as one.
+        writer.add(3, 1.0, 0.5, 0);
+        writer.add(3, 0.5, 0.5, 0);
+        assert_eq!(channel.drain(), Some(update(1.5, 1.0)));
+        assert_eq!(channel.drain(), None, "nothing new");
+
+        writer.add(3, -0.5, 0.0, 0);
+        assert_eq!(channel.end(), Some(update(-0.5, 0.0)));
+        writer.add(3, 1.0, 0.0, 0);
+        assert_eq!(channel.drain(), None, "gesture ended");
+    }
+
+    #[test]
+    fn newer_gesture_waits_for_its_swipe_begin() {
+        let mut writer = TestWriter::new();
+        let mut channel = writer.reader();
+        writer.begin(3);
+        assert_eq!(channel.begin(), None);
+        // The plugin already started gesture 2, whose SwipeBegin is queued.
+        writer.begin(4);
+        writer.add(4, 2.0, 0.0, 0);
+        assert_eq!(channel.drain(), None);
+    }
+
+    #[test]
+    fn doorbell_rings_once_until_consumed() {
+        let mut writer = TestWriter::new();
+        let mut channel = writer.reader();
+        writer.begin(3);
+        channel.begin();
+        assert!(writer.add(3, 1.0, 0.0, 7));
+        assert!(!writer.add(3, 1.0, 0.0, 8), "daemon hasn't read yet");
+        match channel.drain() {
+            Some(Command::SwipeUpdate { dx, trace: Some(t), .. }) => {
+                assert_eq!(dx, 2.0);
+                assert_eq!((t.input_ms, t.sent_ns), (8, 42));
+            }
+            other => panic!("unexpected {:?}", other),
+        }
+        assert!(writer.add(3, 1.0, 0.0, 9), "caught up again");
+    }
+
+    #[test]
+    fn rejects_foreign_memfd() {
+        let writer = TestWriter::new();
+        writer.slot().magic.store(0, Ordering::Relaxed);
+        assert!(SwipeChannel::attach(writer.memfd.try_clone().unwrap(), writer.doorbell.try_clone().unwrap()).is_err());
+    }
+}
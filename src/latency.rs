@@ -0,0 +1,249 @@
+//! End-to-end latency tracing for touchpad swipes.
+//!
+//! The Hyprland plugin stamps every swipe update with the libinput event
+//! time (`input_ms`) and the time it wrote the update to the socket
+//! (`sent_ns`).  The daemon adds the time it decoded the update
+//! (`received_ns`), carries the resulting [`InputTrace`] through
+//! [`Command::SwipeUpdate`](crate::command::Command::SwipeUpdate) /
+//! [`Command::PrepareMove`](crate::command::Command::PrepareMove) into the
+//! [`VisualizerEvent`](crate::traits::VisualizerEvent), and the visualizer
+//! records when the frame showing it was presented.
+//!
+//! All timestamps are `CLOCK_MONOTONIC`, which libinput, the plugin and
+//! [`monotonic_ns`] share, so they can be compared across processes.
+//! [`LatencyTracker`] turns the stage durations into p50/p99 summaries:
+//!
+//! * **input → plugin**: event time until the plugin sent the update
+//!   (Hyprland's input handling, the swipe hook, coalescing, send queue).
+//! * **plugin → daemon**: socket transfer and decoding.
+//! * **daemon → frame**: switcher, visualizer channel and rendering.
+
+use serde::{Deserialize, Serialize};
+use std::fmt;
+
+/// Current `CLOCK_MONOTONIC` time in nanoseconds.
+pub fn monotonic_ns() -> u64 {
+    let mut ts = libc::timespec { tv_sec: 0, tv_nsec: 0 };
+    // SAFETY: `ts` is a valid, writable timespec; CLOCK_MONOTONIC always exists.
+    unsafe { libc::clock_gettime(libc::CLOCK_MONOTONIC, &mut ts) };
+    ts.tv_sec as u64 * 1_000_000_000 + ts.tv_nsec as u64
+}
+
+/// Timestamps attached to one swipe update on its way to the screen.
+///
+/// On the wire (JSON) this is `{"input_ms":…,"sent_ns":…}`; `received_ns`
+/// is filled in by the daemon.
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq, Serialize, Deserialize)]
+pub struct InputTrace {
+    /// libinput event time in milliseconds (wraps after ~49 days).
+    pub input_ms: u32,
+    /// When the plugin sent the update.
+    pub sent_ns: u64,
+    /// When the daemon decoded the update; 0 until then.
+    #[serde(default, skip_serializing_if = "is_zero")]
+    pub received_ns: u64,
+}
+
+fn is_zero(v: &u64) -> bool {
+    *v == 0
+}
+
+impl InputTrace {
+    /// Input event → plugin send, in nanoseconds.
+    ///
+    /// The input time only has millisecond resolution and wraps, so the
+    /// difference is taken on the truncated millisecond clock.
+    pub fn input_to_plugin_ns(&self) -> u64 {
+        let sent_ms = (self.sent_ns / 1_000_000) as u32;
+        let whole_ms = sent_ms.wrapping_sub(self.input_ms) as u64;
+        whole_ms * 1_000_000 + self.sent_ns % 1_000_000
+    }
+
+    /// Plugin send → daemon receive, or `None` before the daemon stamped it.
+    pub fn plugin_to_daemon_ns(&self) -> Option<u64> {
+        (self.received_ns != 0).then(|| self.received_ns.saturating_sub(self.sent_ns))
+    }
+
+    /// Daemon receive → `frame_ns` (when the frame was presented).
+    pub fn daemon_to_frame_ns(&self, frame_ns: u64) -> Option<u64> {
+        (self.received_ns != 0).then(|| frame_ns.saturating_sub(self.received_ns))
+    }
+}
+
+/// One leg of the input-to-frame path.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Stage {
+    InputToPlugin,
+    PluginToDaemon,
+    DaemonToFrame,
+}
+
+impl Stage {
+    const ALL: [Stage; 3] = [Stage::InputToPlugin, Stage::PluginToDaemon, Stage::DaemonToFrame];
+
+    fn label(self) -> &'static str {
+        match self {
+            Stage::InputToPlugin => "input→plugin",
+            Stage::PluginToDaemon => "plugin→daemon",
+            Stage::DaemonToFrame => "daemon→frame",
+        }
+    }
+}
+
+/// Percentiles of one stage over the last reporting window.
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct StageSummary {
+    pub stage: Stage,
+    pub count: usize,
+    pub p50_ns: u64,
+    pub p99_ns: u64,
+    pub max_ns: u64,
+}
+
+impl fmt::Display for StageSummary {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        write!(
+            f,
+            "{} n={} p50={:.2}ms p99={:.2}ms max={:.2}ms",
+            self.stage.label(),
+            self.count,
+            self.p50_ns as f64 / 1e6,
+            self.p99_ns as f64 / 1e6,
+            self.max_ns as f64 / 1e6
+        )
+    }
+}
+
+/// Collects stage durations of presented updates and summarises them once
+/// every `window` traces.
+#[derive(Debug)]
+pub struct LatencyTracker {
+    window: usize,
+    samples: [Vec<u64>; 3],
+}
+
+impl LatencyTracker {
+    /// A tracker that reports every `window` recorded traces.
+    pub fn new(window: usize) -> Self {
+        Self {
+            window: window.max(1),
+            samples: Default::default(),
+        }
+    }
+
+    /// Record every stage of `trace`, whose frame was presented at `frame_ns`.
+    pub fn record(&mut self, trace: &InputTrace, frame_ns: u64) {
+        self.push(Stage::InputToPlugin, trace.input_to_plugin_ns());
+        if let Some(ns) = trace.plugin_to_daemon_ns() {
+            self.push(Stage::PluginToDaemon, ns);
+        }
+        if let Some(ns) = trace.daemon_to_frame_ns(frame_ns) {
+            self.push(Stage::DaemonToFrame, ns);
+        }
+    }
+
+    fn push(&mut self, stage: Stage, ns: u64) {
+        self.samples[stage as usize].push(ns);
+    }
+
+    /// Once a full window of traces has been recorded, return one summary
+    /// per stage and start a new window.
+    pub fn take_report(&mut self) -> Option<Vec<StageSummary>> {
+        if self.samples[Stage::InputToPlugin as usize].len() < self.window {
+            return None;
+        }
+        let report = Stage::ALL
+            .iter()
+            .filter_map(|&stage| summarise(stage, &mut self.samples[stage as usize]))
+            .collect();
+        for s in &mut self.samples {
+            s.clear();
+        }
+        Some(report)
+    }
+}
+
+fn summarise(stage: Stage, samples: &mut [u64]) -> Option<StageSummary> {
+    if samples.is_empty() {
+        return None;
+    }
+    samples.sort_unstable();
+    let at = |q: f64| samples[((samples.len() - 1) as f64 * q).round() as usize];
+    Some(StageSummary {
+        stage,
+        count: samples.len(),
+        p50_ns: at(0.5),
+        p99_ns: at(0.99),
+        max_ns: samples[samples.len() - 1],
+    })
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn monotonic_clock_advances() {
+        let a = monotonic_ns();
+        let b = monotonic_ns();
+        assert!(a > 0 && b >= a);
+    }
+
+    #[test]
+    fn stage_durations() {
+        let t = InputTrace {
+            input_ms: 1_000,
+            sent_ns: 1_002_500_000,
+            received_ns: 1_003_000_000,
+        };
+        assert_eq!(t.input_to_plugin_ns(), 2_500_000);
+        assert_eq!(t.plugin_to_daemon_ns(), Some(500_000));
+        assert_eq!(t.daemon_to_frame_ns(1_010_000_000), Some(7_000_000));
+    }
+
+    #[test]
+    fn input_time_wraps() {
+        // sent at 2^32 + 3 ms, input at 2^32 - 2 ms (just before the wrap).
+        let t = InputTrace {
+            input_ms: u32::MAX - 1,
+            sent_ns: ((1u64 << 32) + 3) * 1_000_000,
+            received_ns: 0,
+        };
+        assert_eq!(t.input_to_plugin_ns(), 5_000_000);
+        assert_eq!(t.plugin_to_daemon_ns(), None);
+    }
+
+    #[test]
+    fn json_wire_form() {
+        let t: InputTrace = serde_json::from_str(r#"{"input_ms":7,"sent_ns":9}"#).unwrap();
+        assert_eq!(t, InputTrace { input_ms: 7, sent_ns: 9, received_ns: 0 });
+        assert_eq!(serde_json::to_string(&t).unwrap(), r#"{"input_ms":7,"sent_ns":9}"#);
+    }
+
+    #[test]
+    fn tracker_reports_per_window() {
+        let mut tracker = LatencyTracker::new(100);
+        for i in 0..99u64 {
+            let t = InputTrace {
+                input_ms: 0,
+                sent_ns: (i + 1) * 1_000_000,
+                received_ns: (i + 1) * 1_000_000 + 1_000,
+            };
+            tracker.record(&t, t.received_ns + 2_000);
+        }
+        assert!(tracker.take_report().is_none());
+        tracker.record(&InputTrace { input_ms: 0, sent_ns: 100_000_000, received_ns: 0 }, 0);
+
+        let report = tracker.take_report().expect("full window");
+        assert_eq!(report.len(), 3);
+        assert_eq!(report[0].stage, Stage::InputToPlugin);
+        assert_eq!(report[0].count, 100);
+        assert_eq!(report[0].p50_ns, 51_000_000);
+        assert_eq!(report[0].p99_ns, 99_000_000);
+        assert_eq!(report[0].max_ns, 100_000_000);
+        assert_eq!(report[1].count, 99);
+        assert_eq!(report[1].p99_ns, 1_000);
+        assert_eq!(report[2].p50_ns, 2_000);
+        assert!(tracker.take_report().is_none(), "window restarts");
+    }
+}
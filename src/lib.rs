@@ -23,7 +23,11 @@ pub mod command;
 pub mod config;
 pub mod grid;
 pub mod hyprland;
+pub mod intake;
 pub mod ipc;
+pub mod latency;
+pub mod prefetch;
+pub mod snapshot;
 pub mod switcher;
 pub mod traits;
 pub mod visualizer;
@@ -6,15 +6,34 @@
 //! When the `visualizer-gtk` feature is enabled the main thread runs the
 //! GLib main loop (GTK4 requires it) and polls the command channel from
 //! there.  Without the feature, a simple blocking loop is used instead.
+//!
+//! `--mock-wm` runs the daemon headless against [`MockWm`] for load tests
+//! (see plugin/loadgen.cpp): no compositor, no visualizer, and one line
+//! per handled command on stdout,
+//!
+//! ```text
+//! ack <sent_ns> <received_ns> <done_ns> <taken>
+//! ```
+//!
+//! with the command's latency trace (zeros for untraced commands), the
+//! `CLOCK_MONOTONIC` time it was handled and how many commands from the
+//! channel it stood for (see [`hyprgrd::intake::CommandIntake`]).  Commands
+//! are read through the same intake as the real event loops.
+//! `--mock-wm-delay-us=N` makes
+//! every window-manager call take N µs, standing in for Hyprland's IPC.
 
 use hyprgrd::command::Command;
 use hyprgrd::config::Config;
+use hyprgrd::hyprland::gestures::{GestureConfig, HyprlandGestureSource};
 use hyprgrd::hyprland::wm::HyprlandWm;
 use hyprgrd::ipc::listener::UnixSocketListener;
+use hyprgrd::snapshot::SnapshotFile;
 use hyprgrd::switcher::GridSwitcher;
 use hyprgrd::traits::{CommandSource, WindowManager};
 use log::{error, info};
+use std::io::Write;
 use std::sync::mpsc;
+use std::time::Duration;
 
 /// Default socket path for the command listener.
 fn default_socket_path() -> String {
@@ -22,6 +41,16 @@ fn default_socket_path() -> String {
     format!("{}/hyprgrd.sock", runtime)
 }
 
+/// Snapshot file of the grid state, one per Hyprland instance (see
+/// [`snapshot`](hyprgrd::snapshot)).
+fn default_snapshot_path() -> String {
+    let runtime = std::env::var("XDG_RUNTIME_DIR").unwrap_or_else(|_| "/tmp".into());
+    match std::env::var("HYPRLAND_INSTANCE_SIGNATURE") {
+        Ok(instance) => format!("{}/hyprgrd-{}.state", runtime, instance),
+        Err(_) => format!("{}/hyprgrd.state", runtime),
+    }
+}
+
 /// Resolve the config directory (`$XDG_CONFIG_HOME/hyprgrd`).
 fn config_dir() -> std::path::PathBuf {
     let base = std::env::var("XDG_CONFIG_HOME").unwrap_or_else(|_| {
@@ -104,14 +133,90 @@ mod noop_wm {
 #[cfg(feature = "visualizer-gtk")]
 use noop_wm::NoopWm;
 
+//  Mock window manager (--mock-wm) 
+
+mod mock_wm {
+    use hyprgrd::command::{MonitorInfo, WindowInfo};
+    use hyprgrd::traits::WindowManager;
+    use std::time::Duration;
+
+    /// Two side-by-side monitors and no windows; every call takes `delay`.
+    pub struct MockWm {
+        pub delay: Duration,
+    }
+
+    #[derive(Debug, thiserror::Error)]
+    #[error("mock")]
+    pub struct MockWmError;
+
+    impl MockWm {
+        fn call(&self) -> Result<(), MockWmError> {
+            if !self.delay.is_zero() {
+                std::thread::sleep(self.delay);
+            }
+            Ok(())
+        }
+    }
+
+    impl WindowManager for MockWm {
+        type Error = MockWmError;
+
+        fn monitors(&self) -> Result<Vec<MonitorInfo>, MockWmError> {
+            Ok(vec![
+                MonitorInfo {
+                    name: "MOCK-1".into(),
+                    width: 2560,
+                    height: 1440,
+                    x: 0,
+                    y: 0,
+                },
+                MonitorInfo {
+                    name: "MOCK-2".into(),
+                    width: 1920,
+                    height: 1080,
+                    x: 2560,
+                    y: 0,
+                },
+            ])
+        }
+
+        fn switch_workspace(&self, _: &str, _: i32) -> Result<(), MockWmError> {
+            self.call()
+        }
+
+        fn move_window_to_workspace(&self, _: i32) -> Result<(), MockWmError> {
+            self.call()
+        }
+
+        fn move_window_to_monitor(&self, _: &str) -> Result<(), MockWmError> {
+            self.call()
+        }
+
+        fn active_monitor(&self) -> Result<Option<String>, MockWmError> {
+            self.call()?;
+            Ok(Some("MOCK-1".into()))
+        }
+
+        fn active_window(&self) -> Result<Option<WindowInfo>, MockWmError> {
+            self.call()?;
+            Ok(None)
+        }
+    }
+}
+
+use mock_wm::MockWm;
+
 //  Main 
 
 fn main() {
     env_logger::init();
 
     let debug_visualizer = std::env::args().any(|a| a == "--debug-visualizer-only");
+    let mock_wm = std::env::args().any(|a| a == "--mock-wm");
 
-    if debug_visualizer {
+    if mock_wm {
+        run_mock_wm();
+    } else if debug_visualizer {
         run_debug_visualizer();
     } else {
         run_daemon();
@@ -123,6 +228,7 @@ fn run_daemon() {
     let config = load_config();
 
     let wm = HyprlandWm::new();
+    wm.watch_events();
     let monitors = match wm.monitors() {
         Ok(m) => {
             info!("found {} monitor(s)", m.len());
@@ -136,11 +242,23 @@ fn run_daemon() {
 
     let mut switcher = GridSwitcher::new(wm, monitors);
     switcher.set_gesture_config(config.gestures.clone());
+    switcher.set_visualizer_config(config.visualizer.clone());
+    switcher.set_prefetch_config(&config.prefetch);
+    // Carry on where a previous daemon of this Hyprland session left off.
+    match SnapshotFile::open(default_snapshot_path()) {
+        Ok(snapshot) => {
+            if let Some(saved) = snapshot.load() {
+                switcher.restore(&saved);
+            }
+            switcher.set_snapshot(snapshot);
+        }
+        Err(e) => error!("cannot open the state snapshot: {}", e),
+    }
 
     let (cmd_tx, cmd_rx) = mpsc::channel::<Command>();
     #[cfg(feature = "visualizer-gtk")]
     let cmd_tx_for_visualizer = cmd_tx.clone();
-    spawn_command_sources(cmd_tx);
+    spawn_command_sources(cmd_tx, Some(config.gestures.clone()));
 
     #[cfg(feature = "visualizer-gtk")]
     start_event_loop(switcher, cmd_rx, cmd_tx_for_visualizer, config);
@@ -165,15 +283,70 @@ fn run_debug_visualizer() {
         let monitors = vec!["DEBUG-1".into()];
         let mut switcher = GridSwitcher::new(NoopWm, monitors);
         switcher.set_gesture_config(config.gestures.clone());
+        switcher.set_visualizer_config(config.visualizer.clone());
 
         let (cmd_tx, cmd_rx) = mpsc::channel::<Command>();
         let cmd_tx_for_visualizer = cmd_tx.clone();
-        spawn_command_sources(cmd_tx);
+        spawn_command_sources(cmd_tx, None);
 
         start_event_loop(switcher, cmd_rx, cmd_tx_for_visualizer, config);
     }
 }
 
+/// Mock-WM mode: headless, acknowledging every command on stdout.
+fn run_mock_wm() {
+    let config = load_config();
+    let delay_us = std::env::args()
+        .find_map(|a| a.strip_prefix("--mock-wm-delay-us=").and_then(|v| v.parse().ok()))
+        .unwrap_or(0);
+
+    info!("running against a mock window manager ({} µs per call)", delay_us);
+
+    let wm = MockWm {
+        delay: Duration::from_micros(delay_us),
+    };
+    let monitors = wm.monitors().unwrap_or_default().into_iter().map(|m| m.name).collect();
+    let mut switcher = GridSwitcher::new(wm, monitors);
+    switcher.set_gesture_config(config.gestures.clone());
+    switcher.set_visualizer_config(config.visualizer.clone());
+
+    let (cmd_tx, cmd_rx) = mpsc::channel::<Command>();
+    spawn_command_sources(cmd_tx, None);
+
+    // Read like the real event loops, so what is measured is the path
+    // production takes.  Each ack also says how many commands sent it
+    // stands for, folded, merged or dropped as stale included.
+    let mut intake = hyprgrd::intake::CommandIntake::new(cmd_rx);
+
+    // Buffered, and flushed whenever the channel runs dry, so acks cost
+    // little under load but none is held back while idle.
+    let mut out = std::io::BufWriter::new(std::io::stdout().lock());
+    loop {
+        let (cmd, taken) = match intake.try_recv_counted() {
+            Ok(next) => next,
+            Err(mpsc::TryRecvError::Empty) => {
+                if out.flush().is_err() {
+                    break;
+                }
+                match intake.recv_counted() {
+                    Some(next) => next,
+                    None => break,
+                }
+            }
+            Err(mpsc::TryRecvError::Disconnected) => break,
+        };
+        let (sent_ns, received_ns) = cmd.trace().map_or((0, 0), |t| (t.sent_ns, t.received_ns));
+        if let Err(e) = switcher.handle(cmd) {
+            error!("command error: {}", e);
+        }
+        let done_ns = hyprgrd::latency::monotonic_ns();
+        if writeln!(out, "ack {} {} {} {}", sent_ns, received_ns, done_ns, taken).is_err() {
+            break;
+        }
+    }
+    info!("mock daemon exiting");
+}
+
 //  Event loops 
 
 #[cfg(feature = "visualizer-gtk")]
@@ -214,7 +387,9 @@ fn start_event_loop<W: WindowManager>(
     _config: Config,
 ) {
     info!("hyprgrd running");
-    for cmd in cmd_rx {
+    // What piled up while a command was handled is merged by priority.
+    let mut intake = hyprgrd::intake::CommandIntake::new(cmd_rx);
+    while let Some(cmd) = intake.recv() {
         if let Err(e) = switcher.handle(cmd) {
             error!("command error: {}", e);
         }
@@ -224,21 +399,34 @@ fn start_event_loop<W: WindowManager>(
 
 //  Helpers 
 
-fn spawn_command_sources(tx: mpsc::Sender<Command>) {
+/// Start the command sources.  With `gestures`, swipes are also read from
+/// Hyprland's event socket whenever no plugin is connected to forward them.
+fn spawn_command_sources(tx: mpsc::Sender<Command>, gestures: Option<GestureConfig>) {
+    let listener = UnixSocketListener::new(default_socket_path());
+    let presence = listener.plugin_presence();
     {
         let tx = tx.clone();
-        let path = default_socket_path();
+        let mut source = listener;
         std::thread::spawn(move || {
-            let mut source = UnixSocketListener::new(&path);
             if let Err(e) = source.run(tx) {
                 error!("socket listener error: {}", e);
             }
         });
     }
 
-    // Swipe gestures arrive over the same Unix socket, sent by the
-    // hyprgrd Hyprland plugin (SwipeBegin / SwipeUpdate / SwipeEnd).
-    // No separate gesture thread is needed.
+    // Swipe gestures normally arrive over the same Unix socket, sent by
+    // the hyprgrd Hyprland plugin (SwipeBegin / SwipeUpdate / SwipeEnd).
+    // The socket2 source covers Hyprland without the plugin and stands
+    // aside while one is connected.
+    if let Some(config) = gestures {
+        let tx = tx.clone();
+        std::thread::spawn(move || {
+            let mut source = HyprlandGestureSource::new(config).defer_to(presence);
+            if let Err(e) = source.run(tx) {
+                error!("gesture source error: {}", e);
+            }
+        });
+    }
 
     drop(tx);
 }
@@ -0,0 +1,173 @@
+//! Keeping the workspaces of neighbouring grid cells warm.
+//!
+//! Hyprland creates a workspace the first time it is shown, so the first
+//! visit to a cell pays for creating one workspace per monitor while the
+//! switch is on screen.  With prefetching enabled the switcher asks the
+//! window manager to create the workspaces of every cell one step away
+//! (all eight [`Direction`]s via [`Grid::get_abs_from`]) right after a
+//! move, and to keep them, and the ones already visited, alive.
+//!
+//! [`WarmCells`] is a least-recently-visited set capped at
+//! [`PrefetchConfig::max_cells`]; cells that fall out of it are released
+//! again so Hyprland can drop them once they're empty.
+//!
+//! Mirrors `WarmCells` in plugin/grid.hpp (used with `grid_mode = plugin`);
+//! keep the two in sync.
+
+use crate::command::Direction;
+use crate::grid::Grid;
+use serde::{Deserialize, Serialize};
+
+/// Prefetch settings (the `"prefetch"` config section).
+#[derive(Debug, Clone, Serialize, Deserialize)]
+#[serde(default)]
+pub struct PrefetchConfig {
+    /// Create and keep neighbouring cells' workspaces (default off).
+    pub enabled: bool,
+    /// Most cells kept warm at once, the current one included.
+    pub max_cells: usize,
+}
+
+impl Default for PrefetchConfig {
+    fn default() -> Self {
+        Self {
+            enabled: false,
+            max_cells: 16,
+        }
+    }
+}
+
+/// Neighbours in the order they are warmed when the cap can't fit all of
+/// them: the cardinal directions first.
+const NEIGHBOUR_ORDER: [Direction; 8] = [
+    Direction::Right,
+    Direction::Left,
+    Direction::Down,
+    Direction::Up,
+    Direction::DownRight,
+    Direction::DownLeft,
+    Direction::UpRight,
+    Direction::UpLeft,
+];
+
+/// Cells that changed state after a [`WarmCells::visit`].
+#[derive(Debug, Default, Clone, PartialEq, Eq)]
+pub struct WarmChange {
+    /// Newly warm cells, to create and keep.
+    pub warm: Vec<(usize, usize)>,
+    /// Evicted cells, to release.
+    pub cool: Vec<(usize, usize)>,
+}
+
+impl WarmChange {
+    pub fn is_empty(&self) -> bool {
+        self.warm.is_empty() && self.cool.is_empty()
+    }
+}
+
+/// Least-recently-visited set of warm cells.
+#[derive(Debug, Clone)]
+pub struct WarmCells {
+    /// Most recently visited last.
+    cells: Vec<(usize, usize)>,
+    max_cells: usize,
+}
+
+impl WarmCells {
+    /// An empty set holding at most `max_cells` cells (at least one).
+    pub fn new(max_cells: usize) -> Self {
+        Self {
+            cells: Vec::new(),
+            max_cells: max_cells.max(1),
+        }
+    }
+
+    /// The warm cells, least recently visited first.
+    pub fn cells(&self) -> &[(usize, usize)] {
+        &self.cells
+    }
+
+    /// Record a move to `(col, row)`: it and as many of its neighbours as
+    /// the cap allows become the most recent cells, evicting the least
+    /// recently visited ones.
+    pub fn visit(&mut self, col: usize, row: usize) -> WarmChange {
+        let mut wanted = vec![(col, row)];
+        for dir in NEIGHBOUR_ORDER {
+            let cell = Grid::get_abs_from(dir, col, row);
+            if wanted.len() < self.max_cells && !wanted.contains(&cell) {
+                wanted.push(cell);
+            }
+        }
+
+        let mut change = WarmChange::default();
+        // Neighbours before the current cell, so it ends up most recent.
+        for &cell in wanted.iter().rev() {
+            match self.cells.iter().position(|&c| c == cell) {
+                Some(i) => {
+                    self.cells.remove(i);
+                }
+                None => change.warm.push(cell),
+            }
+            self.cells.push(cell);
+        }
+        change.warm.reverse();
+        let excess = self.cells.len().saturating_sub(self.max_cells);
+        change.cool = self.cells.drain(..excess).collect();
+        change
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn first_visit_warms_cell_and_neighbours() {
+        let mut w = WarmCells::new(16);
+        let change = w.visit(1, 1);
+        assert_eq!(
+            change.warm,
+            vec![(1, 1), (2, 1), (0, 1), (1, 2), (1, 0), (2, 2), (0, 2), (2, 0), (0, 0)]
+        );
+        assert!(change.cool.is_empty());
+        assert_eq!(w.cells().last(), Some(&(1, 1)));
+    }
+
+    #[test]
+    fn edges_collapse_duplicate_neighbours() {
+        let mut w = WarmCells::new(16);
+        // Left and up stay in place at the origin.
+        assert_eq!(w.visit(0, 0).warm, vec![(0, 0), (1, 0), (0, 1), (1, 1)]);
+    }
+
+    #[test]
+    fn revisits_only_warm_what_is_new() {
+        let mut w = WarmCells::new(16);
+        w.visit(0, 0);
+        let change = w.visit(1, 0);
+        assert_eq!(change.warm, vec![(2, 0), (2, 1)]);
+        assert!(change.cool.is_empty());
+        assert!(w.visit(0, 0).is_empty());
+    }
+
+    #[test]
+    fn cap_evicts_least_recently_visited() {
+        let mut w = WarmCells::new(4);
+        w.visit(0, 0);
+        let change = w.visit(3, 0);
+        // The cap keeps the cell and its first three neighbours.
+        assert_eq!(change.warm, vec![(3, 0), (4, 0), (2, 0), (3, 1)]);
+        assert_eq!(change.cool.len(), 4);
+        assert_eq!(w.cells().len(), 4);
+        assert_eq!(w.cells().last(), Some(&(3, 0)));
+    }
+
+    #[test]
+    fn cap_of_one_keeps_only_the_current_cell() {
+        let mut w = WarmCells::new(0);
+        assert_eq!(w.visit(2, 2).warm, vec![(2, 2)]);
+        let change = w.visit(3, 2);
+        assert_eq!(change.warm, vec![(3, 2)]);
+        assert_eq!(change.cool, vec![(2, 2)]);
+    }
+}
@@ -0,0 +1,260 @@
+//! Grid state snapshot, for restarting the daemon without losing its place.
+//!
+//! A restarted daemon would start over at cell `(0, 0)` of a 1×1 grid while
+//! Hyprland still shows the workspaces of wherever the old one left off.
+//! The [`GridSwitcher`](crate::switcher::GridSwitcher) therefore keeps its
+//! grid size, the per-monitor [`MonitorGridPosition`]s and whether the
+//! visualizer is pinned in a small file mapped into memory
+//! ([`SnapshotFile`]), rewritten in place after every command that changes
+//! them, and the daemon reads it back at startup.  Writing is a compare and
+//! a copy into the mapping; the kernel writes the page back on its own.
+//!
+//! The file lives in `$XDG_RUNTIME_DIR`, named after the Hyprland instance,
+//! so it is gone after a reboot and a new Hyprland session starts afresh.
+//!
+//! # Layout
+//!
+//! [`SIZE`] bytes, little-endian:
+//!
+//! | Offset | Size | Field                                              |
+//! |--------|------|----------------------------------------------------|
+//! | 0      | 8    | [`MAGIC`]                                          |
+//! | 8      | 4    | [`VERSION`]                                        |
+//! | 12     | 4    | FNV-1a checksum of bytes 16..                      |
+//! | 16     | 4    | cols                                               |
+//! | 20     | 4    | rows                                               |
+//! | 24     | 1    | visualizer pinned (0 / 1)                          |
+//! | 25     | 1    | monitor count, at most [`MAX_MONITORS`]            |
+//! | 32     | 64×n | monitors: col u32, row u32, name length u8, name   |
+//!
+//! A snapshot with the wrong magic, version or checksum (a torn write, or
+//! one from another version) is ignored.
+
+use crate::switcher::MonitorGridPosition;
+use std::fs::OpenOptions;
+use std::io;
+use std::os::fd::AsRawFd;
+use std::os::unix::fs::OpenOptionsExt;
+use std::path::Path;
+use std::ptr::NonNull;
+
+/// `"HGRDSNAP"`.
+pub const MAGIC: [u8; 8] = *b"HGRDSNAP";
+/// Layout version.
+pub const VERSION: u32 = 1;
+/// Monitors a snapshot keeps; positions of any beyond are not saved.
+pub const MAX_MONITORS: usize = 16;
+/// Longest monitor name kept; longer names are not saved.
+pub const MAX_NAME: usize = 55;
+
+const HEADER: usize = 32;
+const ENTRY: usize = 64;
+/// Size of the snapshot file.
+pub const SIZE: usize = HEADER + ENTRY * MAX_MONITORS;
+
+/// The state a snapshot holds.
+#[derive(Debug, Clone, Default)]
+pub struct GridSnapshot {
+    pub cols: usize,
+    pub rows: usize,
+    pub positions: Vec<MonitorGridPosition>,
+    pub visualizer_pinned: bool,
+}
+
+/// A snapshot file mapped into memory.
+pub struct SnapshotFile {
+    map: NonNull<u8>,
+}
+
+// SAFETY: the mapping is owned by `SnapshotFile` and only accessed through it.
+unsafe impl Send for SnapshotFile {}
+
+impl SnapshotFile {
+    /// Open (creating it if needed) and map the snapshot file at `path`.
+    pub fn open(path: impl AsRef<Path>) -> io::Result<Self> {
+        let file = OpenOptions::new()
+            .read(true)
+            .write(true)
+            .create(true)
+            .truncate(false)
+            .mode(0o600)
+            .open(path)?;
+        file.set_len(SIZE as u64)?;
+        // SAFETY: fresh shared mapping of a file of at least `SIZE` bytes;
+        // released in `Drop`.  The mapping outlives the descriptor.
+        let ptr = unsafe {
+            libc::mmap(
+                std::ptr::null_mut(),
+                SIZE,
+                libc::PROT_READ | libc::PROT_WRITE,
+                libc::MAP_SHARED,
+                file.as_raw_fd(),
+                0,
+            )
+        };
+        if ptr == libc::MAP_FAILED {
+            return Err(io::Error::last_os_error());
+        }
+        Ok(Self {
+            map: NonNull::new(ptr.cast()).expect("mmap returned null"),
+        })
+    }
+
+    fn bytes(&self) -> &[u8] {
+        // SAFETY: `map` points to `SIZE` mapped bytes for the life of `self`.
+        unsafe { std::slice::from_raw_parts(self.map.as_ptr(), SIZE) }
+    }
+
+    fn bytes_mut(&mut self) -> &mut [u8] {
+        // SAFETY: as in `bytes`, and `&mut self` makes this the only view.
+        unsafe { std::slice::from_raw_parts_mut(self.map.as_ptr(), SIZE) }
+    }
+
+    /// The saved state, or `None` if the file holds no valid snapshot.
+    pub fn load(&self) -> Option<GridSnapshot> {
+        decode(self.bytes())
+    }
+
+    /// Save the state, touching the mapping only if it changed.
+    pub fn store(&mut self, cols: usize, rows: usize, positions: &[MonitorGridPosition], visualizer_pinned: bool) {
+        let mut buf = [0u8; SIZE];
+        encode(&mut buf, cols, rows, positions, visualizer_pinned);
+        let map = self.bytes_mut();
+        if map[..] != buf[..] {
+            map.copy_from_slice(&buf);
+        }
+    }
+}
+
+impl Drop for SnapshotFile {
+    fn drop(&mut self) {
+        // SAFETY: mapped with this size in `SnapshotFile::open`.
+        unsafe { libc::munmap(self.map.as_ptr().cast(), SIZE) };
+    }
+}
+
+/// FNV-1a over `bytes`.
+fn checksum(bytes: &[u8]) -> u32 {
+    bytes
+        .iter()
+        .fold(2_166_136_261u32, |h, &b| (h ^ u32::from(b)).wrapping_mul(16_777_619))
+}
+
+/// Saturate `v` to the u32 the layout stores.
+fn clamp_u32(v: usize) -> u32 {
+    u32::try_from(v).unwrap_or(u32::MAX)
+}
+
+fn encode(buf: &mut [u8; SIZE], cols: usize, rows: usize, positions: &[MonitorGridPosition], pinned: bool) {
+    buf[16..20].copy_from_slice(&clamp_u32(cols).to_le_bytes());
+    buf[20..24].copy_from_slice(&clamp_u32(rows).to_le_bytes());
+    buf[24] = u8::from(pinned);
+    let mut count = 0;
+    for pos in positions.iter().filter(|p| p.name.len() <= MAX_NAME).take(MAX_MONITORS) {
+        let entry = &mut buf[HEADER + ENTRY * count..HEADER + ENTRY * (count + 1)];
+        entry[0..4].copy_from_slice(&clamp_u32(pos.col).to_le_bytes());
+        entry[4..8].copy_from_slice(&clamp_u32(pos.row).to_le_bytes());
+        entry[8] = pos.name.len() as u8;
+        entry[9..9 + pos.name.len()].copy_from_slice(pos.name.as_bytes());
+        count += 1;
+    }
+    buf[25] = count as u8;
+    let sum = checksum(&buf[16..]);
+    buf[0..8].copy_from_slice(&MAGIC);
+    buf[8..12].copy_from_slice(&VERSION.to_le_bytes());
+    buf[12..16].copy_from_slice(&sum.to_le_bytes());
+}
+
+fn decode(bytes: &[u8]) -> Option<GridSnapshot> {
+    let u32_at = |at: usize| u32::from_le_bytes(bytes[at..at + 4].try_into().unwrap()) as usize;
+    if bytes[0..8] != MAGIC || u32_at(8) != VERSION as usize || u32_at(12) != checksum(&bytes[16..]) as usize {
+        return None;
+    }
+    let count = usize::from(bytes[25]);
+    if count > MAX_MONITORS {
+        return None;
+    }
+    let positions = (0..count)
+        .map(|i| {
+            let entry = &bytes[HEADER + ENTRY * i..HEADER + ENTRY * (i + 1)];
+            let len = usize::from(entry[8]);
+            let name = std::str::from_utf8(entry.get(9..9 + len)?).ok()?;
+            Some(MonitorGridPosition {
+                name: name.to_string(),
+                col: u32_at(HEADER + ENTRY * i),
+                row: u32_at(HEADER + ENTRY * i + 4),
+            })
+        })
+        .collect::<Option<Vec<_>>>()?;
+    Some(GridSnapshot {
+        cols: u32_at(16),
+        rows: u32_at(20),
+        positions,
+        visualizer_pinned: bytes[24] != 0,
+    })
+}
+
+//  Tests
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn position(name: &str, col: usize, row: usize) -> MonitorGridPosition {
+        MonitorGridPosition {
+            name: name.into(),
+            col,
+            row,
+        }
+    }
+
+    fn tmp_path(name: &str) -> std::path::PathBuf {
+        std::env::temp_dir().join(format!("hyprgrd-snapshot-{}-{}", std::process::id(), name))
+    }
+
+    #[test]
+    fn snapshot_survives_reopening() {
+        let path = tmp_path("reopen");
+        let _ = std::fs::remove_file(&path);
+        {
+            let file = SnapshotFile::open(&path).unwrap();
+            assert!(file.load().is_none(), "a new file holds no snapshot");
+        }
+        {
+            let mut file = SnapshotFile::open(&path).unwrap();
+            file.store(3, 2, &[position("DP-1", 2, 1), position("HDMI-A-1", 2, 1)], true);
+        }
+        let snapshot = SnapshotFile::open(&path).unwrap().load().unwrap();
+        assert_eq!((snapshot.cols, snapshot.rows), (3, 2));
+        assert!(snapshot.visualizer_pinned);
+        let names: Vec<_> = snapshot.positions.iter().map(|p| (p.name.as_str(), p.col, p.row)).collect();
+        assert_eq!(names, vec![("DP-1", 2, 1), ("HDMI-A-1", 2, 1)]);
+        assert_eq!(std::fs::metadata(&path).unwrap().len(), SIZE as u64);
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn corrupt_snapshots_are_ignored() {
+        let mut buf = [0u8; SIZE];
+        encode(&mut buf, 2, 2, &[position("DP-1", 1, 1)], false);
+        assert!(decode(&buf).is_some());
+        let mut torn = buf;
+        torn[HEADER] ^= 1;
+        assert!(decode(&torn).is_none(), "checksum mismatch");
+        let mut other = buf;
+        other[8] = 2;
+        assert!(decode(&other).is_none(), "other version");
+    }
+
+    #[test]
+    fn oversized_names_and_monitors_are_left_out() {
+        let long = "X".repeat(MAX_NAME + 1);
+        let mut positions = vec![position(&long, 1, 0)];
+        positions.extend((0..MAX_MONITORS + 2).map(|i| position(&format!("M-{}", i), 1, 0)));
+        let mut buf = [0u8; SIZE];
+        encode(&mut buf, 2, 1, &positions, false);
+        let snapshot = decode(&buf).unwrap();
+        assert_eq!(snapshot.positions.len(), MAX_MONITORS);
+        assert_eq!(snapshot.positions[0].name, "M-0");
+    }
+}
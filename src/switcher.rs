@@ -4,10 +4,19 @@
 //! [`GridSwitcher`] owns the [`Grid`] and reacts to [`Command`]s by updating
 //! the grid state and issuing calls to the [`WindowManager`] trait.
 
-use crate::command::{find_monitor_in_direction, Command, Direction, MonitorIndex, SwitchToTarget};
+use crate::command::{
+    find_monitor_in_direction, Command, Direction, GestureRoutes, GridSync, MonitorIndex,
+    OverlaySync, SwitchToTarget,
+};
+use crate::config::VisualizerConfig;
 use crate::grid::Grid;
-use crate::hyprland::gestures::{dominant_direction, normalised_swipe_offset, GestureConfig};
-use crate::traits::{VisualizerEvent, VisualizerShowPayload, VisualizerState, WindowManager};
+use crate::hyprland::gestures::{
+    dominant_direction, normalised_swipe_offset, projected_displacement, GestureConfig, VelocityWindow,
+};
+use crate::latency::{monotonic_ns, InputTrace};
+use crate::prefetch::{PrefetchConfig, WarmCells};
+use crate::snapshot::{GridSnapshot, SnapshotFile};
+use crate::traits::{Pending, VisualizerEvent, VisualizerShowPayload, VisualizerState, WindowManager};
 use log::{debug, info, warn};
 use std::sync::mpsc;
 
@@ -25,6 +34,38 @@ struct ActiveSwipe {
     fingers: u32,
     dx: f64,
     dy: f64,
+    /// Recent totals, for the velocity while dragging.
+    velocity: VelocityWindow,
+    /// Release velocity reported by the plugin
+    /// ([`Command::SwipeVelocity`]).
+    release_velocity: Option<(f64, f64)>,
+    /// Direction whose workspaces were already switched to before release
+    /// ([`GestureConfig::speculative_commit`]); the grid position has not
+    /// moved yet.
+    speculated: Option<Direction>,
+}
+
+impl ActiveSwipe {
+    /// Offset the release decision is made on: the displacement projected
+    /// ahead at `velocity`, normalised.
+    fn predicted_offset(&self, velocity: Option<(f64, f64)>, cfg: &GestureConfig) -> (f64, f64) {
+        let (dx, dy) = projected_displacement(
+            self.dx,
+            self.dy,
+            velocity.unwrap_or_default(),
+            cfg.fling_lookahead_ms,
+        );
+        normalised_swipe_offset(dx, dy, cfg.sensitivity, cfg.natural_swiping)
+    }
+}
+
+/// Swipe motion only moves the visualizer, so it is handled while a
+/// switch is still in flight.
+fn is_swipe_motion(cmd: &Command) -> bool {
+    matches!(
+        cmd,
+        Command::SwipeUpdate { .. } | Command::SwipeVelocity { .. } | Command::PrepareMove { .. }
+    )
 }
 
 /// Per-monitor position in the shared grid.
@@ -54,6 +95,24 @@ pub struct GridSwitcher<W: WindowManager> {
     vis_tx: Option<mpsc::Sender<VisualizerEvent>>,
     gesture_config: GestureConfig,
     active_swipe: Option<ActiveSwipe>,
+    /// Set once the plugin reports owning the grid ([`Command::SyncGrid`]);
+    /// from then on moves made here are mirrored back to it.
+    plugin_grid: bool,
+    /// Set once the plugin draws the overlay ([`Command::AttachOverlay`]):
+    /// moves are mirrored to it and `vis_tx` is left alone.
+    plugin_overlay: bool,
+    /// Timings handed to the plugin's overlay.
+    visualizer_config: VisualizerConfig,
+    /// Warm cells around the position ([`PrefetchConfig::enabled`]).
+    prefetch: Option<WarmCells>,
+    /// The visualizer is shown until toggled off
+    /// ([`Command::ToggleVisualizer`]).
+    visualizer_pinned: bool,
+    /// Where the state is saved after every command ([`snapshot`](crate::snapshot)).
+    snapshot: Option<SnapshotFile>,
+    /// Window manager requests started but not waited for yet, oldest
+    /// first (see [`settle`](Self::settle)).
+    in_flight: Vec<Pending>,
 }
 
 impl<W: WindowManager> GridSwitcher<W> {
@@ -78,6 +137,13 @@ impl<W: WindowManager> GridSwitcher<W> {
             vis_tx: None,
             gesture_config: GestureConfig::default(),
             active_swipe: None,
+            plugin_grid: false,
+            plugin_overlay: false,
+            visualizer_config: VisualizerConfig::default(),
+            prefetch: None,
+            visualizer_pinned: false,
+            snapshot: None,
+            in_flight: Vec::new(),
         }
     }
 
@@ -90,6 +156,19 @@ impl<W: WindowManager> GridSwitcher<W> {
         self.gesture_config = config;
     }
 
+    /// Set the visualizer timings.  The daemon's own visualizer takes them
+    /// from the config directly; these are passed on to a plugin that draws
+    /// the overlay ([`Command::AttachOverlay`]).
+    pub fn set_visualizer_config(&mut self, config: VisualizerConfig) {
+        self.visualizer_config = config;
+    }
+
+    /// Enable or disable keeping neighbouring cells' workspaces warm (see
+    /// [`prefetch`](crate::prefetch)).  Starts from an empty warm set.
+    pub fn set_prefetch_config(&mut self, config: &PrefetchConfig) {
+        self.prefetch = config.enabled.then(|| WarmCells::new(config.max_cells));
+    }
+
     /// Attach a visualizer event channel.
     ///
     /// The switcher will send:
@@ -107,6 +186,38 @@ impl<W: WindowManager> GridSwitcher<W> {
     /// interpreting these events and maintaining its own visibility state.
     pub fn set_visualizer(&mut self, tx: mpsc::Sender<VisualizerEvent>) {
         self.vis_tx = Some(tx);
+        if self.visualizer_pinned {
+            // Pinned before a restart: show it again.
+            self.visualizer_pinned = false;
+            self.toggle_manual_visualizer();
+        }
+    }
+
+    /// Carry on from a saved [`GridSnapshot`]: grid size, the position of
+    /// every monitor it knows (monitors it doesn't take its first
+    /// position, since all of them share the cell) and the visualizer pin.
+    /// Call right after [`new`](Self::new); the workspaces on screen are
+    /// assumed to be the snapshot's, so nothing is switched.
+    pub fn restore(&mut self, snapshot: &GridSnapshot) {
+        let Some(shared) = snapshot.positions.first() else {
+            return;
+        };
+        self.grid
+            .grow_to_contain(snapshot.cols.saturating_sub(1), snapshot.rows.saturating_sub(1));
+        for pos in &mut self.monitor_positions {
+            let saved = snapshot.positions.iter().find(|p| p.name == pos.name).unwrap_or(shared);
+            pos.col = saved.col;
+            pos.row = saved.row;
+            self.grid.grow_to_contain(pos.col, pos.row);
+        }
+        self.visualizer_pinned = snapshot.visualizer_pinned;
+        info!("restored grid position {:?}", self.position());
+    }
+
+    /// Save the state to `snapshot` after every command from now on.
+    pub fn set_snapshot(&mut self, snapshot: SnapshotFile) {
+        self.snapshot = Some(snapshot);
+        self.store_snapshot();
     }
 
     /// Return a shared reference to the underlying grid.
@@ -146,7 +257,41 @@ impl<W: WindowManager> GridSwitcher<W> {
     /// Returns `Ok(())` on success.  If the window manager fails, the grid
     /// state has **already** been updated (the switcher is optimistic); a
     /// retry or recovery strategy is left to the caller.
+    ///
+    /// Workspace switches and window moves may still be in flight when this
+    /// returns ([`WindowManager::start_switch_workspaces`]).  Swipe motion
+    /// is handled meanwhile; any other command first waits for them, and a
+    /// failure among them is logged then.  An [acknowledged](Command::Acked)
+    /// command waits for its own before it is answered.
     pub fn handle(&mut self, cmd: Command) -> Result<(), SwitcherError> {
+        let result = self.handle_command(cmd);
+        self.store_snapshot();
+        result
+    }
+
+    /// Wait for the window manager requests still in flight, and return
+    /// the first failure among them.
+    pub fn settle(&mut self) -> Result<(), SwitcherError> {
+        let mut result = Ok(());
+        for pending in self.in_flight.drain(..) {
+            if let (Err(e), Ok(())) = (pending.wait(), &result) {
+                result = Err(SwitcherError::WindowManager(e));
+            }
+        }
+        result
+    }
+
+    fn handle_command(&mut self, cmd: Command) -> Result<(), SwitcherError> {
+        if !is_swipe_motion(&cmd) {
+            if let Err(e) = self.settle() {
+                warn!("earlier command: {}", e);
+                // Only a switch ahead of release can be in flight while a
+                // swipe is: do the switch again once the fingers lift.
+                if let Some(swipe) = &mut self.active_swipe {
+                    swipe.speculated = None;
+                }
+            }
+        }
         match cmd {
             Command::SwitchTo(SwitchToTarget { x, y }) => {
                 info!("switch to ({}, {})", x, y);
@@ -171,6 +316,11 @@ impl<W: WindowManager> GridSwitcher<W> {
                 self.go(dir)?;
             }
 
+            Command::GoN { dir, count } => {
+                info!("go {} ×{}", dir, count);
+                self.go_n(dir, count as usize)?;
+            }
+
             Command::MoveWindowAndGo(dir) => {
                 info!("move window and go {}", dir);
                 let (col, row) = self.position();
@@ -259,15 +409,15 @@ impl<W: WindowManager> GridSwitcher<W> {
                     .map_err(|e| SwitcherError::WindowManager(e.to_string()))?;
             }
 
-            Command::PrepareMove { dx, dy } => {
+            Command::PrepareMove { dx, dy, trace } => {
                 debug!("prepare move dx={:.2} dy={:.2}", dx, dy);
-                self.show_visualizer(dx, dy);
+                self.show_visualizer_traced(dx, dy, trace);
             }
 
             Command::CancelMove => {
                 debug!("cancel move — switch to current workspace");
                 let (col, row) = self.position();
-                return self.handle(Command::SwitchTo(SwitchToTarget { x: col, y: row }));
+                return self.handle_command(Command::SwitchTo(SwitchToTarget { x: col, y: row }));
             }
 
             Command::CommitMove(dir) => {
@@ -278,7 +428,54 @@ impl<W: WindowManager> GridSwitcher<W> {
 
             Command::ToggleVisualizer => {
                 debug!("toggle visualizer");
-                self.toggle_manual_visualizer();
+                if self.plugin_overlay {
+                    let pending = self.wm.toggle_overlay();
+                    self.in_flight.push(pending);
+                } else {
+                    // The plugin keeps its own overlay's pin.
+                    self.visualizer_pinned = !self.visualizer_pinned;
+                    self.toggle_manual_visualizer();
+                }
+            }
+
+            Command::Acked(cmd, ack) => {
+                let start = monotonic_ns();
+                let result = self.handle_command(*cmd).and_then(|()| self.settle());
+                let error = result.as_ref().err().map(|e| e.to_string());
+                ack.reply(error.as_deref().map_or(Ok(()), Err), monotonic_ns() - start);
+                return result;
+            }
+
+            Command::AttachOverlay => {
+                info!("plugin draws the overlay");
+                self.plugin_overlay = true;
+                let overlay = self.overlay_sync();
+                let pending = self.wm.sync_overlay(&overlay);
+                self.in_flight.push(pending);
+                self.sync_plugin_grid();
+            }
+
+            Command::AttachGestures => {
+                let g = &self.gesture_config;
+                let routes = GestureRoutes { switch_fingers: g.switch_fingers, move_fingers: g.move_fingers };
+                info!("plugin routes swipes: {} / {} fingers", routes.switch_fingers, routes.move_fingers);
+                let pending = self.wm.sync_gestures(&routes);
+                self.in_flight.push(pending);
+            }
+
+            Command::SyncGrid(sync) => {
+                info!("plugin moved to ({}, {})", sync.col, sync.row);
+                self.plugin_grid = true;
+                self.grid.grow_to_contain(
+                    sync.col.max(sync.cols.saturating_sub(1)),
+                    sync.row.max(sync.rows.saturating_sub(1)),
+                );
+                for pos in &mut self.monitor_positions {
+                    pos.col = sync.col;
+                    pos.row = sync.row;
+                }
+                self.show_visualizer(0.0, 0.0);
+                self.hide_visualizer();
             }
 
             //  Raw swipe events (from the Hyprland plugin) 
@@ -289,16 +486,18 @@ impl<W: WindowManager> GridSwitcher<W> {
                     debug!("swipe begin: {} fingers", fingers);
                     self.active_swipe = Some(ActiveSwipe {
                         fingers,
-                        dx: 0.0,
-                        dy: 0.0,
+                        ..ActiveSwipe::default()
                     });
                 }
             }
 
-            Command::SwipeUpdate { fingers: _, dx, dy } => {
+            Command::SwipeUpdate { fingers: _, dx, dy, trace } => {
                 let state = if let Some(ref mut swipe) = self.active_swipe {
                     swipe.dx += dx;
                     swipe.dy += dy;
+                    if let Some(t) = &trace {
+                        swipe.velocity.push(t.input_ms, swipe.dx, swipe.dy);
+                    }
                     let cfg = &self.gesture_config;
                     let (norm_dx, norm_dy) = normalised_swipe_offset(
                         swipe.dx,
@@ -311,41 +510,79 @@ impl<W: WindowManager> GridSwitcher<W> {
                         dominant_direction(norm_dx, norm_dy, t)
                             .map(|dir| (dir, fingers == cfg.move_fingers))
                     });
-                    Some((norm_dx, norm_dy, commit_while))
+                    // Certain enough to switch ahead of release: past the
+                    // threshold, and still past it at the current velocity.
+                    let speculate = (cfg.speculative_commit
+                        && fingers != cfg.move_fingers
+                        && swipe.speculated.is_none())
+                    .then(|| dominant_direction(norm_dx, norm_dy, cfg.commit_threshold))
+                    .flatten()
+                    .filter(|&dir| {
+                        let (px, py) = swipe.predicted_offset(swipe.velocity.velocity(), cfg);
+                        dominant_direction(px, py, cfg.commit_threshold) == Some(dir)
+                    });
+                    Some((norm_dx, norm_dy, commit_while, speculate))
                 } else {
                     None
                 };
-                if let Some((norm_dx, norm_dy, commit_while)) = state {
+                if let Some((norm_dx, norm_dy, commit_while, speculate)) = state {
                     debug!("swipe update: dx={:.2} dy={:.2}", norm_dx, norm_dy);
-                    self.show_visualizer(norm_dx, norm_dy);
+                    self.show_visualizer_traced(norm_dx, norm_dy, trace);
                     if let Some((dir, move_window)) = commit_while {
                         if let Err(e) = self.execute_swipe_commit(dir, move_window) {
                             warn!("swipe commit while dragging: {}", e);
                         }
                         self.active_swipe = None;
+                    } else if let Some(dir) = speculate {
+                        debug!("swipe commit {} is certain — switching ahead of release", dir);
+                        let (col, row) = self.position();
+                        let (col, row) = Grid::get_abs_from(dir, col, row);
+                        self.start_workspaces_at(col, row);
+                        if let Some(swipe) = &mut self.active_swipe {
+                            swipe.speculated = Some(dir);
+                        }
                     }
                 }
             }
 
+            Command::SwipeVelocity { vx, vy } => {
+                if let Some(swipe) = &mut self.active_swipe {
+                    debug!("swipe release velocity: vx={:.0} vy={:.0} px/s", vx, vy);
+                    swipe.release_velocity = Some((vx, vy));
+                }
+            }
+
             Command::SwipeEnd => {
                 if let Some(swipe) = self.active_swipe.take() {
                     let cfg = &self.gesture_config;
-                    let (norm_dx, norm_dy) = normalised_swipe_offset(
-                        swipe.dx,
-                        swipe.dy,
-                        cfg.sensitivity,
-                        cfg.natural_swiping,
-                    );
+                    // Prefer the plugin's release velocity: it saw every
+                    // event and knows when the fingers came to rest.
+                    let velocity = swipe.release_velocity.or_else(|| swipe.velocity.velocity());
+                    let (norm_dx, norm_dy) = swipe.predicted_offset(velocity, cfg);
+                    let move_window = swipe.fingers == cfg.move_fingers;
 
                     match dominant_direction(norm_dx, norm_dy, cfg.commit_threshold) {
+                        Some(dir) if swipe.speculated == Some(dir) => {
+                            info!("swipe commit: go {} (switched ahead of release)", dir);
+                            self.advance(dir);
+                            self.sync_plugin_grid();
+                        }
                         Some(dir) => {
-                            let move_window = swipe.fingers == cfg.move_fingers;
                             self.execute_swipe_commit(dir, move_window)?;
                         }
                         None => {
                             debug!("swipe cancel (below threshold) — switch to current workspace");
+                            if swipe.speculated.is_some() {
+                                // SwitchTo skips the cell we are already in.
+                                self.apply_current_workspace()?;
+                            }
                             let (col, row) = self.position();
-                            self.handle(Command::SwitchTo(SwitchToTarget { x: col, y: row }))?;
+                            self.handle_command(Command::SwitchTo(SwitchToTarget { x: col, y: row }))?;
+                            if self.plugin_overlay && swipe.speculated.is_none() {
+                                // The plugin's overlay predicted the release
+                                // on its own; confirm the cell it stays on.
+                                self.sync_plugin_grid();
+                            }
                         }
                     }
                 }
@@ -359,15 +596,24 @@ impl<W: WindowManager> GridSwitcher<W> {
     /// Show the visualizer with the current grid state (plus gesture offsets)
     /// as an **automatically** shown overlay.
     fn show_visualizer(&mut self, offset_x: f64, offset_y: f64) {
-        if let Some(tx) = &self.vis_tx {
-            let payload = self.visualizer_show_payload(offset_x, offset_y);
+        self.show_visualizer_traced(offset_x, offset_y, None);
+    }
+
+    /// [`show_visualizer`](Self::show_visualizer) for a gesture update,
+    /// passing its latency trace on to the visualizer.
+    fn show_visualizer_traced(&mut self, offset_x: f64, offset_y: f64, trace: Option<InputTrace>) {
+        if let Some(tx) = self.vis_tx.as_ref().filter(|_| !self.plugin_overlay) {
+            let payload = VisualizerShowPayload {
+                trace,
+                ..self.visualizer_show_payload(offset_x, offset_y)
+            };
             let _ = tx.send(VisualizerEvent::ShowAuto(payload));
         }
     }
 
     /// Toggle the visualizer in **manual** mode for the current grid state.
     fn toggle_manual_visualizer(&mut self) {
-        if let Some(tx) = &self.vis_tx {
+        if let Some(tx) = self.vis_tx.as_ref().filter(|_| !self.plugin_overlay) {
             let payload = self.visualizer_show_payload(0.0, 0.0);
             let _ = tx.send(VisualizerEvent::ToggleManual(payload));
         }
@@ -389,6 +635,7 @@ impl<W: WindowManager> GridSwitcher<W> {
             state,
             active_monitor_name,
             monitors,
+            trace: None,
         }
     }
 
@@ -418,25 +665,64 @@ impl<W: WindowManager> GridSwitcher<W> {
     /// attached. The visualizer uses its own internal state to decide whether
     /// to hide instantly (manual) or via linger + fade (automatic).
     fn hide_visualizer(&mut self) {
-        if let Some(tx) = &self.vis_tx {
+        if let Some(tx) = self.vis_tx.as_ref().filter(|_| !self.plugin_overlay) {
+            // Hiding ends a manually shown overlay too.
+            self.visualizer_pinned = false;
             let _ = tx.send(VisualizerEvent::Hide);
         }
     }
 
     /// Tell the window manager to switch every monitor to the workspace ids
-    /// derived from the current grid cell.
-    fn apply_current_workspace(&self) -> Result<(), SwitcherError> {
+    /// derived from the current grid cell, as one
+    /// [`switch_workspaces`](WindowManager::switch_workspaces) call.
+    ///
+    /// The switch is left in flight while the plugin sync and prefetch go
+    /// out beside it.
+    fn apply_current_workspace(&mut self) -> Result<(), SwitcherError> {
         let (col, row) = self.position();
+        self.start_workspaces_at(col, row);
+        self.sync_plugin_grid();
+        self.prefetch_around(col, row);
+        Ok(())
+    }
 
-        let active_monitor = self
-            .wm
-            .active_monitor()
-            .map_err(|e| SwitcherError::WindowManager(e.to_string()))?;
-
-        let active = active_monitor
-            .ok_or_else(|| SwitcherError::WindowManager("no active monitor".to_string()))?;
+    /// After a move to `(col, row)`: warm the cell and its neighbours and
+    /// release whatever fell out of the warm set.  Best-effort, after the
+    /// switch has been applied.
+    fn prefetch_around(&mut self, col: usize, row: usize) {
+        let Some(warm_cells) = self.prefetch.as_mut() else {
+            return;
+        };
+        let change = warm_cells.visit(col, row);
+        if change.is_empty() {
+            return;
+        }
+        let count = self.monitor_positions.len();
+        let warm: Vec<(&str, i32)> = change
+            .warm
+            .iter()
+            .flat_map(|&(c, r)| {
+                self.monitor_positions
+                    .iter()
+                    .enumerate()
+                    .map(move |(idx, p)| (p.name.as_str(), Self::compute_workspace_id(c, r, idx, count)))
+            })
+            .collect();
+        let cool: Vec<i32> = change
+            .cool
+            .iter()
+            .flat_map(|&(c, r)| (0..count).map(move |idx| Self::compute_workspace_id(c, r, idx, count)))
+            .collect();
+        if let Err(e) = self.wm.prefetch_workspaces(&warm, &cool) {
+            warn!("failed to prefetch workspaces: {}", e);
+        }
+    }
 
-        let mut entries: Vec<(&str, i32)> = self
+    /// Start switching every monitor to its workspace for cell
+    /// `(col, row)`, which need not be the current one (a speculative swipe
+    /// commit).
+    fn start_workspaces_at(&mut self, col: usize, row: usize) {
+        let entries: Vec<(&str, i32)> = self
             .monitor_positions
             .iter()
             .enumerate()
@@ -448,19 +734,48 @@ impl<W: WindowManager> GridSwitcher<W> {
             })
             .collect();
 
-        if let Some(pos) = entries.iter().position(|(mon, _)| *mon == active.as_str()) {
-            let entry = entries.remove(pos);
-            entries.push(entry);
-        }
-
         for (monitor, ws_id) in &entries {
             debug!("  {} -> workspace {}", monitor, ws_id);
-            self.wm
-                .switch_workspace(monitor, *ws_id)
-                .map_err(|e| SwitcherError::WindowManager(e.to_string()))?;
         }
+        let pending = self.wm.start_switch_workspaces(&entries);
+        self.in_flight.push(pending);
+    }
 
-        Ok(())
+    /// Save the state if a snapshot file is attached.
+    fn store_snapshot(&mut self) {
+        if let Some(snapshot) = &mut self.snapshot {
+            let (cols, rows) = self.grid.dimensions();
+            let pinned = self.visualizer_pinned && !self.plugin_overlay;
+            snapshot.store(cols, rows, &self.monitor_positions, pinned);
+        }
+    }
+
+    /// Mirror the current cell to the plugin once it owns the grid or
+    /// draws the overlay.  The sync is left in flight like a switch.
+    fn sync_plugin_grid(&mut self) {
+        if self.plugin_grid || self.plugin_overlay {
+            let (cols, rows) = self.grid.dimensions();
+            let (col, row) = self.position();
+            let pending = self.wm.sync_grid(&GridSync { cols, rows, col, row });
+            self.in_flight.push(pending);
+        }
+    }
+
+    /// Settings for a plugin-side overlay.
+    fn overlay_sync(&self) -> OverlaySync {
+        let g = &self.gesture_config;
+        let v = &self.visualizer_config;
+        OverlaySync {
+            sensitivity: g.sensitivity,
+            commit_threshold: g.commit_threshold,
+            natural_swiping: g.natural_swiping,
+            switch_fingers: g.switch_fingers,
+            move_fingers: g.move_fingers,
+            fling_lookahead_ms: g.fling_lookahead_ms,
+            cursor_animation_ms: v.cursor_animation_ms,
+            linger_ms: v.linger_ms,
+            fade_out_ms: v.fade_out_ms,
+        }
     }
 
     /// Execute a swipe commit in the given direction (plain go or move window and go).
@@ -502,10 +817,10 @@ impl<W: WindowManager> GridSwitcher<W> {
                 self.monitor_positions.len(),
             );
 
-            self.wm
-                .move_window_to_workspace(ws_id)
-                .map_err(|e| SwitcherError::WindowManager(e.to_string()))?;
-
+            // The switch follows the move on the window manager's side; the
+            // two are in flight together.
+            let pending = self.wm.start_move_window_to_workspace(ws_id);
+            self.in_flight.push(pending);
             self.go(dir)?;
         } else {
             info!("swipe commit: go {}", dir);
@@ -516,8 +831,30 @@ impl<W: WindowManager> GridSwitcher<W> {
 
     /// Core logic for a discrete workspace move in a direction.
     fn go(&mut self, dir: Direction) -> Result<(), SwitcherError> {
+        self.go_n(dir, 1)
+    }
+
+    /// Move `steps` cells in `dir` as one move: the window manager is told
+    /// only about the final cell, and the visualizer flashes once.
+    fn go_n(&mut self, dir: Direction, steps: usize) -> Result<(), SwitcherError> {
+        if steps == 0 {
+            return Ok(());
+        }
+        self.advance_n(dir, steps);
+        self.apply_current_workspace()?;
+        Ok(())
+    }
+
+    /// Move the grid position one step in `dir` (growing the grid) and
+    /// flash the visualizer, without touching the window manager.
+    fn advance(&mut self, dir: Direction) {
+        self.advance_n(dir, 1);
+    }
+
+    /// [`advance`](Self::advance) by `steps` cells.
+    fn advance_n(&mut self, dir: Direction, steps: usize) {
         let (col, row) = self.position();
-        let (col, row) = Grid::get_abs_from(dir, col, row);
+        let (col, row) = Grid::get_abs_from_n(dir, col, row, steps);
         self.grid.grow_to_contain(col, row);
         for pos in &mut self.monitor_positions {
             pos.col = col;
@@ -525,8 +862,6 @@ impl<W: WindowManager> GridSwitcher<W> {
         }
         self.show_visualizer(0.0, 0.0);
         self.hide_visualizer();
-        self.apply_current_workspace()?;
-        Ok(())
     }
 
     /// Deterministically compute a workspace id for the given grid coordinate
@@ -581,10 +916,22 @@ mod tests {
         switches: RefCell<Vec<(String, i32)>>,
         moves: RefCell<Vec<i32>>,
         monitor_moves: RefCell<Vec<String>>,
+        grid_syncs: RefCell<Vec<GridSync>>,
+        overlay_syncs: RefCell<Vec<OverlaySync>>,
+        gesture_syncs: RefCell<Vec<GestureRoutes>>,
+        overlay_toggles: RefCell<u32>,
+        prefetches: RefCell<Vec<(Vec<(String, i32)>, Vec<i32>)>>,
         /// Tracks which monitor is currently "focused" in the mock, i.e. where
         /// the mouse cursor would be. We model Hyprland's behaviour where
         /// `switch_workspace` focuses the target monitor.
         focused_monitor: RefCell<Option<String>>,
+        /// With `Some`, started switches are recorded but left in flight,
+        /// their outcome sent by the test through the kept senders.
+        in_flight: RefCell<Option<Vec<mpsc::Sender<Result<(), String>>>>>,
+        /// What started switches fail with, if anything.
+        switch_error: RefCell<Option<String>>,
+        /// What overlay toggles fail with, if anything.
+        overlay_error: RefCell<Option<String>>,
     }
 
     #[derive(Debug, thiserror::Error)]
@@ -621,6 +968,21 @@ mod tests {
             Ok(())
         }
 
+        fn start_switch_workspaces(&self, switches: &[(&str, i32)]) -> Pending {
+            let mut result = self.switch_workspaces(switches).map_err(|e| e.to_string());
+            if let Some(e) = self.switch_error.borrow().clone() {
+                result = Err(e);
+            }
+            match self.in_flight.borrow_mut().as_mut() {
+                Some(senders) => {
+                    let (tx, pending) = Pending::channel();
+                    senders.push(tx);
+                    pending
+                }
+                None => Pending::done(result),
+            }
+        }
+
         fn move_window_to_workspace(&self, ws: i32) -> Result<(), RecorderErr> {
             self.moves.borrow_mut().push(ws);
             Ok(())
@@ -631,6 +993,32 @@ mod tests {
             Ok(())
         }
 
+        fn sync_grid(&self, grid: &GridSync) -> Pending {
+            self.grid_syncs.borrow_mut().push(*grid);
+            Pending::done(Ok(()))
+        }
+
+        fn sync_overlay(&self, overlay: &OverlaySync) -> Pending {
+            self.overlay_syncs.borrow_mut().push(*overlay);
+            Pending::done(Ok(()))
+        }
+
+        fn sync_gestures(&self, routes: &GestureRoutes) -> Pending {
+            self.gesture_syncs.borrow_mut().push(*routes);
+            Pending::done(Ok(()))
+        }
+
+        fn toggle_overlay(&self) -> Pending {
+            *self.overlay_toggles.borrow_mut() += 1;
+            Pending::done(self.overlay_error.borrow().clone().map_or(Ok(()), Err))
+        }
+
+        fn prefetch_workspaces(&self, warm: &[(&str, i32)], cool: &[i32]) -> Result<(), RecorderErr> {
+            let warm = warm.iter().map(|&(m, ws)| (m.to_string(), ws)).collect();
+            self.prefetches.borrow_mut().push((warm, cool.to_vec()));
+            Ok(())
+        }
+
         fn active_monitor(&self) -> Result<Option<String>, RecorderErr> {
             Ok(self
                 .focused_monitor
@@ -743,6 +1131,22 @@ mod tests {
         assert_ne!(ids[0], ids[1]);
     }
 
+    #[test]
+    fn acked_command_is_handled_then_answered() {
+        use crate::ipc::ack::{Ack, AckSink};
+        use std::io::{BufRead, BufReader};
+
+        let (daemon, client) = std::os::unix::net::UnixStream::pair().unwrap();
+        let sink = AckSink::new(&daemon).unwrap();
+        let mut s = make_switcher();
+        s.handle(Command::Acked(Box::new(Command::Go(Direction::Right)), Ack::new(4, &sink)))
+            .unwrap();
+        assert_eq!(s.position(), (1, 0));
+        let mut line = String::new();
+        BufReader::new(client).read_line(&mut line).unwrap();
+        assert!(line.starts_with("ACK 4 ok "), "{}", line);
+    }
+
     #[test]
     fn go_keeps_focused_monitor_on_original_display() {
         let mut s = make_switcher();
@@ -819,6 +1223,31 @@ mod tests {
         );
     }
 
+    #[test]
+    fn go_n_moves_straight_to_the_final_cell() {
+        let mut s = make_switcher();
+        let (tx, rx) = mpsc::channel();
+        s.set_visualizer(tx);
+        s.handle(Command::GoN { dir: Direction::Right, count: 3 }).unwrap();
+        assert_eq!(s.position(), (3, 0));
+        assert_eq!(s.grid.dimensions(), (4, 1));
+        // One switch per monitor, to the final cell, and one flash.
+        let mut direct = make_switcher();
+        for _ in 0..3 {
+            direct.handle(Command::Go(Direction::Right)).unwrap();
+        }
+        assert_eq!(*s.wm.switches.borrow(), direct.wm.switches.borrow()[4..]);
+        let events: Vec<_> = rx.try_iter().collect();
+        assert!(
+            matches!(events.as_slice(), [VisualizerEvent::ShowAuto(_), VisualizerEvent::Hide]),
+            "GoN should flash once, got: {events:#?}"
+        );
+
+        s.handle(Command::GoN { dir: Direction::Left, count: 0 }).unwrap();
+        assert_eq!(s.position(), (3, 0));
+        assert_eq!(s.wm.switches.borrow().len(), 2);
+    }
+
     #[test]
     fn move_window_and_go_emits_show_and_hide_events() {
         let events = collect_vis_events(Command::MoveWindowAndGo(Direction::Right));
@@ -865,6 +1294,33 @@ mod tests {
         assert_eq!(s.grid().dimensions(), (3, 2));
     }
 
+    #[test]
+    fn restarted_switcher_carries_on_from_snapshot() {
+        let path = std::env::temp_dir().join(format!("hyprgrd-switcher-snapshot-{}", std::process::id()));
+        let _ = std::fs::remove_file(&path);
+        let mut s = make_switcher();
+        let (tx, _rx) = mpsc::channel();
+        s.set_visualizer(tx);
+        s.set_snapshot(SnapshotFile::open(&path).unwrap());
+        s.handle(Command::SwitchTo(SwitchToTarget { x: 2, y: 1 })).unwrap();
+        s.handle(Command::ToggleVisualizer).unwrap();
+        drop(s);
+
+        // A monitor the snapshot doesn't know joins the shared cell.
+        let mut restarted = GridSwitcher::new(RecorderWm::default(), vec!["DP-1".into(), "DP-2".into()]);
+        restarted.restore(&SnapshotFile::open(&path).unwrap().load().unwrap());
+        assert_eq!(restarted.position(), (2, 1));
+        assert_eq!(restarted.grid().dimensions(), (3, 2));
+        assert!(restarted.monitor_positions.iter().all(|p| (p.col, p.row) == (2, 1)));
+        assert!(restarted.wm.switches.borrow().is_empty(), "the workspaces on screen are kept");
+
+        // The pinned visualizer comes back with the visualizer.
+        let (tx, rx) = mpsc::channel();
+        restarted.set_visualizer(tx);
+        assert!(matches!(rx.try_iter().collect::<Vec<_>>().as_slice(), [VisualizerEvent::ToggleManual(_)]));
+        let _ = std::fs::remove_file(&path);
+    }
+
     #[test]
     fn move_window_and_go_records_move() {
         let mut s = make_switcher();
@@ -896,7 +1352,7 @@ mod tests {
     #[test]
     fn prepare_move_does_not_change_grid() {
         let mut s = make_switcher();
-        s.handle(Command::PrepareMove { dx: 0.5, dy: 0.0 })
+        s.handle(Command::PrepareMove { dx: 0.5, dy: 0.0, trace: None })
             .unwrap();
         assert_eq!(s.position(), (0, 0), "grid should not move");
     }
@@ -991,5 +1447,295 @@ mod tests {
         s.handle(Command::MoveWindowToMonitorIndex(MonitorIndex(1))).unwrap();
         assert_eq!(s.position(), (0, 0), "grid should not move");
     }
-}
 
+    #[test]
+    fn sync_grid_adopts_plugin_state_without_switching() {
+        let mut s = make_switcher();
+        s.handle(Command::SyncGrid(GridSync { cols: 3, rows: 2, col: 2, row: 1 })).unwrap();
+        assert_eq!(s.position(), (2, 1));
+        assert_eq!(s.grid().dimensions(), (3, 2));
+        assert!(s.wm.switches.borrow().is_empty(), "plugin already switched");
+        assert!(s.wm.grid_syncs.borrow().is_empty(), "nothing to echo back");
+    }
+
+    #[test]
+    fn own_moves_are_mirrored_once_plugin_owns_grid() {
+        let mut s = make_switcher();
+        s.handle(Command::Go(Direction::Right)).unwrap();
+        assert!(s.wm.grid_syncs.borrow().is_empty(), "daemon mode: no plugin grid");
+
+        s.handle(Command::SyncGrid(GridSync { cols: 2, rows: 1, col: 1, row: 0 })).unwrap();
+        s.handle(Command::Go(Direction::Down)).unwrap();
+        assert_eq!(
+            *s.wm.grid_syncs.borrow(),
+            vec![GridSync { cols: 2, rows: 2, col: 1, row: 1 }]
+        );
+    }
+
+    #[test]
+    fn attach_overlay_pushes_settings_and_cell() {
+        let mut s = make_switcher();
+        s.set_visualizer_config(VisualizerConfig { linger_ms: 500, ..VisualizerConfig::default() });
+        s.handle(Command::Go(Direction::Right)).unwrap();
+        s.handle(Command::AttachOverlay).unwrap();
+
+        let syncs = s.wm.overlay_syncs.borrow();
+        assert_eq!(syncs.len(), 1);
+        assert_eq!(syncs[0].sensitivity, 200.0);
+        assert_eq!(syncs[0].switch_fingers, 3);
+        assert_eq!(syncs[0].linger_ms, 500);
+        assert_eq!(
+            *s.wm.grid_syncs.borrow(),
+            vec![GridSync { cols: 2, rows: 1, col: 1, row: 0 }]
+        );
+    }
+
+    #[test]
+    fn attach_gestures_pushes_finger_counts() {
+        let mut s = make_switcher();
+        s.set_gesture_config(GestureConfig { move_fingers: 5, ..GestureConfig::default() });
+        s.handle(Command::AttachGestures).unwrap();
+        assert_eq!(
+            *s.wm.gesture_syncs.borrow(),
+            vec![GestureRoutes { switch_fingers: 3, move_fingers: 5 }]
+        );
+    }
+
+    #[test]
+    fn plugin_overlay_replaces_own_visualizer() {
+        let mut s = make_switcher();
+        let (tx, rx) = mpsc::channel();
+        s.set_visualizer(tx);
+        s.handle(Command::AttachOverlay).unwrap();
+
+        s.handle(Command::SwipeBegin { fingers: 3 }).unwrap();
+        s.handle(swipe_update(-100.0, 10)).unwrap();
+        s.handle(Command::SwipeEnd).unwrap();
+        s.handle(Command::ToggleVisualizer).unwrap();
+
+        assert_eq!(rx.try_iter().count(), 0, "the plugin draws the overlay");
+        assert_eq!(*s.wm.overlay_toggles.borrow(), 1);
+        assert_eq!(
+            s.wm.grid_syncs.borrow().last(),
+            Some(&GridSync { cols: 2, rows: 1, col: 1, row: 0 }),
+            "the commit is mirrored to the plugin"
+        );
+    }
+
+    #[test]
+    fn cancelled_swipe_confirms_cell_to_plugin_overlay() {
+        let mut s = make_switcher();
+        s.handle(Command::AttachOverlay).unwrap();
+        s.wm.grid_syncs.borrow_mut().clear();
+
+        s.handle(Command::SwipeBegin { fingers: 3 }).unwrap();
+        s.handle(swipe_update(-10.0, 10)).unwrap();
+        s.handle(Command::SwipeEnd).unwrap();
+
+        assert_eq!(
+            *s.wm.grid_syncs.borrow(),
+            vec![GridSync { cols: 1, rows: 1, col: 0, row: 0 }]
+        );
+    }
+
+    //  Swipe tests 
+
+    /// A traced 3-finger update of `dx` pixels at input time `ms`.
+    fn swipe_update(dx: f64, ms: u32) -> Command {
+        Command::SwipeUpdate {
+            fingers: 3,
+            dx,
+            dy: 0.0,
+            trace: Some(InputTrace { input_ms: ms, sent_ns: 1, received_ns: 0 }),
+        }
+    }
+
+    /// Workspace ids switched to so far, sorted.
+    fn switched_ids(s: &GridSwitcher<RecorderWm>) -> Vec<i32> {
+        let mut ids: Vec<i32> = s.wm.switches.borrow().iter().map(|(_, id)| *id).collect();
+        ids.sort();
+        ids
+    }
+
+    #[test]
+    fn flick_commits_before_covering_threshold() {
+        let mut s = make_switcher();
+        s.handle(Command::SwipeBegin { fingers: 3 }).unwrap();
+        // 40 px (0.2 of a cell) in 30 ms: short of the 0.3 threshold, but
+        // 100 ms ahead at 1000 px/s it is at 0.7.  Natural swiping: a
+        // leftward swipe moves right.
+        for ms in [0, 10, 20, 30] {
+            s.handle(swipe_update(-10.0, ms)).unwrap();
+        }
+        s.handle(Command::SwipeEnd).unwrap();
+        assert_eq!(s.position(), (1, 0));
+    }
+
+    #[test]
+    fn flick_that_came_to_rest_cancels() {
+        let mut s = make_switcher();
+        s.handle(Command::SwipeBegin { fingers: 3 }).unwrap();
+        for ms in [0, 10, 20, 30] {
+            s.handle(swipe_update(-10.0, ms)).unwrap();
+        }
+        // The plugin saw the fingers stop before they lifted.
+        s.handle(Command::SwipeVelocity { vx: 0.0, vy: 0.0 }).unwrap();
+        s.handle(Command::SwipeEnd).unwrap();
+        assert_eq!(s.position(), (0, 0));
+    }
+
+    #[test]
+    fn speculative_commit_switches_before_release() {
+        let mut s = make_switcher();
+        s.set_gesture_config(GestureConfig { speculative_commit: true, ..GestureConfig::default() });
+        s.handle(Command::SwipeBegin { fingers: 3 }).unwrap();
+        s.handle(swipe_update(-20.0, 0)).unwrap();
+        s.handle(swipe_update(-20.0, 20)).unwrap();
+        assert!(s.wm.switches.borrow().is_empty(), "not past the threshold yet");
+        s.handle(swipe_update(-20.0, 40)).unwrap();
+        assert_eq!(switched_ids(&s), vec![3, 4], "cell (1, 0) shown before release");
+        assert_eq!(s.position(), (0, 0), "grid only moves on release");
+
+        s.handle(swipe_update(-20.0, 60)).unwrap();
+        s.handle(Command::SwipeEnd).unwrap();
+        assert_eq!(s.position(), (1, 0));
+        assert_eq!(switched_ids(&s), vec![3, 4], "release confirms without switching again");
+    }
+
+    #[test]
+    fn speculative_commit_is_undone_when_release_cancels() {
+        let mut s = make_switcher();
+        s.set_gesture_config(GestureConfig { speculative_commit: true, ..GestureConfig::default() });
+        s.handle(Command::SwipeBegin { fingers: 3 }).unwrap();
+        for ms in [0, 20, 40] {
+            s.handle(swipe_update(-20.0, ms)).unwrap();
+        }
+        assert_eq!(switched_ids(&s), vec![3, 4]);
+        // The fingers drift back and rest before lifting.
+        s.handle(swipe_update(40.0, 200)).unwrap();
+        s.handle(Command::SwipeVelocity { vx: 0.0, vy: 0.0 }).unwrap();
+        s.handle(Command::SwipeEnd).unwrap();
+        assert_eq!(s.position(), (0, 0));
+        assert_eq!(switched_ids(&s), vec![1, 2, 3, 4], "switched back to cell (0, 0)");
+    }
+
+    #[test]
+    fn swipes_go_on_while_a_switch_is_in_flight() {
+        let mut s = make_switcher();
+        *s.wm.in_flight.borrow_mut() = Some(Vec::new());
+        let (tx, rx) = mpsc::channel();
+        s.set_visualizer(tx);
+        s.set_gesture_config(GestureConfig { speculative_commit: true, ..GestureConfig::default() });
+        s.handle(Command::SwipeBegin { fingers: 3 }).unwrap();
+        for ms in [0, 20, 40] {
+            s.handle(swipe_update(-20.0, ms)).unwrap();
+        }
+        assert_eq!(switched_ids(&s), vec![3, 4], "switch ahead of release started");
+        // The switch hasn't finished, yet the overlay keeps following.
+        rx.try_iter().for_each(drop);
+        s.handle(swipe_update(-20.0, 60)).unwrap();
+        assert!(matches!(rx.try_iter().last(), Some(VisualizerEvent::ShowAuto(_))));
+
+        // It fails; the release waits for it and switches again.
+        let senders = s.wm.in_flight.borrow_mut().take().unwrap();
+        senders[0].send(Err("busy".into())).unwrap();
+        s.handle(Command::SwipeEnd).unwrap();
+        assert_eq!(s.position(), (1, 0));
+        assert_eq!(switched_ids(&s), vec![3, 3, 4, 4], "cell (1, 0) switched to twice");
+        assert!(s.settle().is_ok());
+    }
+
+    #[test]
+    fn acked_command_waits_for_its_switch() {
+        use crate::ipc::ack::{Ack, AckSink};
+        use std::io::{BufRead, BufReader};
+
+        let (daemon, client) = std::os::unix::net::UnixStream::pair().unwrap();
+        let sink = AckSink::new(&daemon).unwrap();
+        let mut s = make_switcher();
+        // A failed switch of an earlier command is only logged...
+        s.in_flight.push(Pending::done(Err("earlier".into())));
+        // ...while one of the command's own is its answer.
+        *s.wm.switch_error.borrow_mut() = Some("no such monitor".into());
+        let result = s.handle(Command::Acked(Box::new(Command::Go(Direction::Right)), Ack::new(9, &sink)));
+        assert!(result.is_err());
+        let mut line = String::new();
+        BufReader::new(client).read_line(&mut line).unwrap();
+        assert!(line.starts_with("ACK 9 err ") && line.ends_with("no such monitor\n"), "{}", line);
+        assert!(s.in_flight.is_empty());
+    }
+
+    #[test]
+    fn acked_plugin_toggle_answers_its_outcome() {
+        use crate::ipc::ack::{Ack, AckSink};
+        use std::io::{BufRead, BufReader};
+
+        let (daemon, client) = std::os::unix::net::UnixStream::pair().unwrap();
+        let sink = AckSink::new(&daemon).unwrap();
+        let mut s = make_switcher();
+        s.handle(Command::AttachOverlay).unwrap();
+        *s.wm.overlay_error.borrow_mut() = Some("no overlay".into());
+        let result = s.handle(Command::Acked(Box::new(Command::ToggleVisualizer), Ack::new(4, &sink)));
+        assert!(result.is_err());
+        let mut line = String::new();
+        BufReader::new(client).read_line(&mut line).unwrap();
+        assert!(line.starts_with("ACK 4 err ") && line.ends_with("no overlay\n"), "{}", line);
+        assert_eq!(*s.wm.overlay_toggles.borrow(), 1);
+    }
+
+    fn prefetching_switcher(max_cells: usize) -> GridSwitcher<RecorderWm> {
+        let mut s = make_switcher();
+        s.set_prefetch_config(&PrefetchConfig {
+            enabled: true,
+            max_cells,
+        });
+        s
+    }
+
+    #[test]
+    fn prefetch_is_off_by_default() {
+        let mut s = make_switcher();
+        s.handle(Command::Go(Direction::Right)).unwrap();
+        assert!(s.wm.prefetches.borrow().is_empty());
+    }
+
+    #[test]
+    fn move_warms_cell_and_neighbours_on_every_monitor() {
+        let mut s = prefetching_switcher(16);
+        s.handle(Command::Go(Direction::Right)).unwrap();
+        let prefetches = s.wm.prefetches.borrow();
+        assert_eq!(prefetches.len(), 1);
+        let (warm, cool) = &prefetches[0];
+        // (1, 0) and its five distinct neighbours, one workspace per monitor.
+        assert_eq!(warm.len(), 6 * 2);
+        assert_eq!(warm[0], ("DP-1".to_string(), 3));
+        assert_eq!(warm[1], ("HDMI-A-1".to_string(), 4));
+        assert!(cool.is_empty());
+    }
+
+    #[test]
+    fn prefetch_releases_cells_beyond_the_cap() {
+        let mut s = prefetching_switcher(1);
+        s.handle(Command::Go(Direction::Right)).unwrap();
+        s.handle(Command::Go(Direction::Right)).unwrap();
+        let prefetches = s.wm.prefetches.borrow();
+        let (warm, cool) = &prefetches[1];
+        assert_eq!(warm.len(), 2);
+        // (1, 0) on both monitors.
+        assert_eq!(cool, &vec![3, 4]);
+    }
+
+    /// Pinned ids: the plugin's grid engine (plugin/grid.hpp) computes the
+    /// same mapping and its tests use the same table.
+    #[test]
+    fn workspace_ids_are_stable() {
+        type S = GridSwitcher<RecorderWm>;
+        assert_eq!(S::compute_workspace_id(0, 0, 0, 2), 1);
+        assert_eq!(S::compute_workspace_id(0, 0, 1, 2), 2);
+        assert_eq!(S::compute_workspace_id(1, 0, 0, 2), 3);
+        assert_eq!(S::compute_workspace_id(0, 1, 0, 2), 5);
+        assert_eq!(S::compute_workspace_id(2, 1, 1, 2), 16);
+        assert_eq!(S::compute_workspace_id(1, 1, 2, 3), 15);
+        assert_eq!(S::compute_workspace_id(100_000, 100_000, 0, 4), i32::MAX);
+    }
+}
@@ -5,7 +5,8 @@
 //! …) implements one of these traits.  The [`GridSwitcher`](crate::switcher::GridSwitcher)
 //! only depends on these abstractions.
 
-use crate::command::{Command, MonitorInfo, WindowInfo};
+use crate::command::{Command, GestureRoutes, GridSync, MonitorInfo, OverlaySync, WindowInfo};
+use crate::latency::InputTrace;
 use std::sync::mpsc;
 
 /// Payload for visualizer events that show the overlay (ShowAuto, ToggleManual).
@@ -18,6 +19,9 @@ pub struct VisualizerShowPayload {
     pub active_monitor_name: Option<String>,
     /// Monitor list from the window manager (to resolve GDK monitor by position).
     pub monitors: Vec<MonitorInfo>,
+    /// Latency trace of the gesture input behind this update, if any; the
+    /// visualizer records it once the frame showing it is presented.
+    pub trace: Option<InputTrace>,
 }
 
 /// Abstraction over a window manager that can switch workspaces and move
@@ -38,6 +42,89 @@ pub trait WindowManager {
     /// and is an opaque integer meaningful to the window manager.
     fn switch_workspace(&self, monitor: &str, workspace_id: i32) -> Result<(), Self::Error>;
 
+    /// Switch every `(monitor, workspace_id)` pair as one grid move, leaving
+    /// the focused monitor focused.
+    ///
+    /// The default implementation queries [`active_monitor`](Self::active_monitor)
+    /// and calls [`switch_workspace`](Self::switch_workspace) for each pair,
+    /// the focused monitor last (switching a workspace focuses its monitor).
+    /// Backends that can apply all switches in one request should override it.
+    fn switch_workspaces(&self, switches: &[(&str, i32)]) -> Result<(), Self::Error> {
+        let active = self.active_monitor()?;
+        let (focused, others): (Vec<_>, Vec<_>) = switches
+            .iter()
+            .copied()
+            .partition(|(monitor, _)| Some(*monitor) == active.as_deref());
+        for (monitor, workspace_id) in others.into_iter().chain(focused) {
+            self.switch_workspace(monitor, workspace_id)?;
+        }
+        Ok(())
+    }
+
+    /// Start [`switch_workspaces`](Self::switch_workspaces) and return
+    /// without waiting for it to finish, so the caller can go on with other
+    /// work (and other requests) meanwhile; the outcome comes from
+    /// [`Pending::wait`].
+    ///
+    /// Backends must carry out what they start, and later switches and
+    /// window moves, in the order they were started.  The default switches
+    /// right away and returns the finished result.
+    fn start_switch_workspaces(&self, switches: &[(&str, i32)]) -> Pending {
+        Pending::done(self.switch_workspaces(switches).map_err(|e| e.to_string()))
+    }
+
+    /// [`move_window_to_workspace`](Self::move_window_to_workspace) without
+    /// waiting for it, ordered as for
+    /// [`start_switch_workspaces`](Self::start_switch_workspaces).
+    fn start_move_window_to_workspace(&self, workspace_id: i32) -> Pending {
+        Pending::done(self.move_window_to_workspace(workspace_id).map_err(|e| e.to_string()))
+    }
+
+    /// Tell a window-manager-side grid engine where the switcher moved on
+    /// its own (e.g. a swipe commit), so both agree on the current cell.
+    ///
+    /// Like the syncs below it may return before the request has run; the
+    /// outcome comes from [`Pending::wait`].  Only called once the
+    /// compositor has reported owning the grid via [`Command::SyncGrid`];
+    /// the default does nothing.
+    fn sync_grid(&self, _grid: &GridSync) -> Pending {
+        Pending::done(Ok(()))
+    }
+
+    /// Hand a compositor-side overlay renderer the settings it needs to
+    /// follow swipes itself.
+    ///
+    /// Only called once the compositor has asked for them via
+    /// [`Command::AttachOverlay`]; the default does nothing.
+    fn sync_overlay(&self, _overlay: &OverlaySync) -> Pending {
+        Pending::done(Ok(()))
+    }
+
+    /// Tell a compositor-side swipe hook which finger counts to forward.
+    ///
+    /// Only called once the compositor has asked via
+    /// [`Command::AttachGestures`]; the default does nothing.
+    fn sync_gestures(&self, _routes: &GestureRoutes) -> Pending {
+        Pending::done(Ok(()))
+    }
+
+    /// Toggle the compositor-side overlay's manual mode (what
+    /// [`Command::ToggleVisualizer`] does to the daemon's own visualizer).
+    ///
+    /// Only called after [`Command::AttachOverlay`]; the default does
+    /// nothing.
+    fn toggle_overlay(&self) -> Pending {
+        Pending::done(Ok(()))
+    }
+
+    /// Create the workspaces in `warm` (`(monitor, workspace_id)` pairs)
+    /// without showing them, and keep them alive even while empty; let the
+    /// ones in `cool` go again.  Used to keep the cells around the current
+    /// one warm ([`prefetch`](crate::prefetch)); the default does nothing.
+    fn prefetch_workspaces(&self, _warm: &[(&str, i32)], _cool: &[i32]) -> Result<(), Self::Error> {
+        Ok(())
+    }
+
     /// Move the currently focused window to `workspace_id` **and** switch
     /// the active monitor to that workspace so the user follows the window.
     fn move_window_to_workspace(&self, workspace_id: i32) -> Result<(), Self::Error>;
@@ -61,6 +148,41 @@ pub trait WindowManager {
     fn active_window(&self) -> Result<Option<WindowInfo>, Self::Error>;
 }
 
+/// The outcome of a window manager request that may still be in flight
+/// (see [`WindowManager::start_switch_workspaces`]).
+///
+/// Dropping it doesn't cancel the request; only its outcome is lost.
+#[derive(Debug)]
+pub struct Pending(PendingState);
+
+#[derive(Debug)]
+enum PendingState {
+    Done(Result<(), String>),
+    InFlight(mpsc::Receiver<Result<(), String>>),
+}
+
+impl Pending {
+    /// A request that has already finished with `result`.
+    pub fn done(result: Result<(), String>) -> Self {
+        Self(PendingState::Done(result))
+    }
+
+    /// A request whose outcome will be sent on the returned sender.  If the
+    /// sender is dropped without sending, the request counts as failed.
+    pub fn channel() -> (mpsc::Sender<Result<(), String>>, Self) {
+        let (tx, rx) = mpsc::channel();
+        (tx, Self(PendingState::InFlight(rx)))
+    }
+
+    /// Block until the request has finished, and return its outcome.
+    pub fn wait(self) -> Result<(), String> {
+        match self.0 {
+            PendingState::Done(result) => result,
+            PendingState::InFlight(rx) => rx.recv().unwrap_or_else(|_| Err("request abandoned".into())),
+        }
+    }
+}
+
 //  Visualizer 
 
 /// A snapshot of the grid state that a [`Visualizer`] needs in order to
@@ -231,6 +353,25 @@ mod tests {
         }
     }
 
+    #[test]
+    fn pending_reports_the_outcome() {
+        assert_eq!(Pending::done(Ok(())).wait(), Ok(()));
+        let (tx, pending) = Pending::channel();
+        std::thread::spawn(move || tx.send(Err("refused".into())).unwrap());
+        assert_eq!(pending.wait(), Err("refused".into()));
+        let (tx, pending) = Pending::channel();
+        drop(tx);
+        assert!(pending.wait().is_err(), "an abandoned request failed");
+    }
+
+    #[test]
+    fn default_start_switch_runs_right_away() {
+        let wm = MockWm::default();
+        let pending = wm.start_switch_workspaces(&[("MOCK-1", 7)]);
+        assert_eq!(*wm.switch_log.borrow(), vec![("MOCK-1".to_string(), 7)]);
+        assert_eq!(pending.wait(), Ok(()));
+    }
+
     #[test]
     fn mock_wm_records_switches() {
         let wm = MockWm::default();
@@ -9,7 +9,8 @@
 //!         ├ .grid              (GtkGrid, main child)
 //!         │   ├ .grid-cell     (dim base colour)
 //!         │   └ …
-//!         └ .grid-cursor       (overlay child, animated position)
+//!         └ GtkFixed           (overlay child, cursor layer)
+//!             └ .grid-cursor   (animated position)
 //! ```
 //!
 //! # CSS selectors
@@ -27,15 +28,30 @@
 //!
 //! The `.grid-cursor` appearance is fully CSS-configurable.  Movement is
 //! code-driven; timing is controlled by [`VisualizerConfig`].
+//!
+//! # Redraws
+//!
+//! GTK keeps the render node of every widget that was not invalidated, so
+//! the cells are drawn once and then reused until the grid size or the
+//! theme changes.  Updates only touch the cells whose `active` / `target`
+//! classes actually change, a resize keeps the cells that are still in
+//! range, and the cursor moves by translating it inside its own layer, so
+//! a frame repaints the cursor and at most the few re-classed cells.
+//! Cursor slides and the fade-out are stepped from the window's frame
+//! clock, only while one of them is running.
 
 use crate::command::{Command, MonitorInfo};
 use crate::config::VisualizerConfig;
+use crate::intake::CommandIntake;
+use crate::latency::{monotonic_ns, InputTrace, LatencyTracker};
 use crate::traits::{VisualizerEvent, VisualizerState};
+use crate::visualizer::viewport::Viewport;
 use gtk4::prelude::*;
 use gtk4::{gdk, glib};
 use gtk4_layer_shell::LayerShell;
 use log::{debug, error, info, warn};
 use std::cell::{Cell, RefCell};
+use std::collections::VecDeque;
 use std::path::PathBuf;
 use std::rc::Rc;
 use std::sync::mpsc;
@@ -137,6 +153,7 @@ fn cell_px(index: usize) -> f64 {
 //  Overlay visibility state machine 
 
 /// Tracks the show → linger → fade-out → hidden lifecycle.
+#[derive(Clone, Copy)]
 enum Visibility {
     /// Overlay is hidden (`window.set_visible(false)`).
     Hidden,
@@ -162,17 +179,55 @@ struct CursorAnim {
     from_y: f64,
     to_x: f64,
     to_y: f64,
-    start: Instant,
+    /// Frame time (µs) of the first frame that showed the slide; set by the
+    /// first [`OverlayGrid::tick`].
+    start_us: Option<i64>,
+}
+
+/// Which cells carry the `active` / `target` / `tobecreated` classes.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct CellMarks {
+    active: (usize, usize),
+    target: Option<(usize, usize)>,
+    tobecreated: bool,
+}
+
+impl CellMarks {
+    fn of(state: &VisualizerState) -> Self {
+        let is_gesture = state.offset_x != 0.0 || state.offset_y != 0.0;
+        let effective_target = state
+            .target_cell
+            .unwrap_or((state.col, state.row));
+        Self {
+            active: (state.col, state.row),
+            target: is_gesture.then_some(effective_target),
+            tobecreated: is_gesture
+                && (effective_target.0 >= state.cols || effective_target.1 >= state.rows),
+        }
+    }
+
+    /// `(active, target, tobecreated)` for the cell at `pos`.
+    fn classes_at(&self, pos: (usize, usize)) -> (bool, bool, bool) {
+        let is_target = self.target == Some(pos);
+        (self.active == pos, is_target, is_target && self.tobecreated)
+    }
 }
 
 //  Persistent overlay grid 
 
 struct OverlayGrid {
     grid_widget: gtk4::Grid,
+    cursor_layer: gtk4::Fixed,
     cursor: gtk4::Box,
+    /// The cells in view, row-major, `cols` wide.
     cells: Vec<gtk4::Box>,
     cols: usize,
     rows: usize,
+    /// Grid position of the first cell in view; shared with the cells'
+    /// click handlers.
+    origin: Rc<Cell<(usize, usize)>>,
+    /// Classes currently set on the cells.
+    marks: Option<CellMarks>,
 
     cur_x: f64,
     cur_y: f64,
@@ -196,14 +251,17 @@ impl OverlayGrid {
         grid_widget.set_column_spacing(0);
         overlay.set_child(Some(&grid_widget));
 
+        // The cursor sits in its own layer and is moved by a transform, so
+        // a slide neither re-measures the grid nor invalidates its cells.
+        let cursor_layer = gtk4::Fixed::new();
+        cursor_layer.set_can_target(false);
         let cursor = gtk4::Box::new(gtk4::Orientation::Vertical, 0);
         cursor.add_css_class("grid-cursor");
         cursor.set_size_request(CELL_SIZE, CELL_SIZE);
-        cursor.set_halign(gtk4::Align::Start);
-        cursor.set_valign(gtk4::Align::Start);
         cursor.set_can_target(false);
-        overlay.add_overlay(&cursor);
-        overlay.set_measure_overlay(&cursor, false);
+        cursor_layer.put(&cursor, 0.0, 0.0);
+        overlay.add_overlay(&cursor_layer);
+        overlay.set_measure_overlay(&cursor_layer, false);
 
         overlay.set_margin_start(OVERLAY_PADDING);
         overlay.set_margin_end(OVERLAY_PADDING);
@@ -213,10 +271,13 @@ impl OverlayGrid {
 
         Self {
             grid_widget,
+            cursor_layer,
             cursor,
             cells: Vec::new(),
             cols: 0,
             rows: 0,
+            origin: Rc::new(Cell::new((0, 0))),
+            marks: None,
             cur_x: 0.0,
             cur_y: 0.0,
             anim: None,
@@ -242,14 +303,24 @@ impl OverlayGrid {
             state.rows
         };
 
-        let dims_changed = display_cols != self.cols || display_rows != self.rows;
-        if dims_changed {
-            self.rebuild_cells(display_cols, display_rows, state.cols, state.rows);
+        // Only the cells around the cursor get widgets, however far the
+        // grid reaches.
+        let reach = if is_gesture {
+            effective_target
+        } else {
+            (state.col, state.row)
+        };
+        let view = Viewport::around(display_cols, display_rows, (state.col, state.row), reach);
+        if (view.col, view.row) != self.origin.get() {
+            self.scroll_to((view.col, view.row));
         }
-        self.apply_classes(state);
+        if view.cols != self.cols || view.rows != self.rows {
+            self.resize_cells(view.cols, view.rows);
+        }
+        self.apply_marks(CellMarks::of(state));
 
-        let base_x = cell_px(state.col);
-        let base_y = cell_px(state.row);
+        let base_x = cell_px(state.col - view.col);
+        let base_y = cell_px(state.row - view.row);
         let (display_ox, display_oy) = interpolated_offset(state.offset_x, state.offset_y);
         let mut target_x = base_x + display_ox * CELL_PITCH as f64;
         let mut target_y = base_y + display_oy * CELL_PITCH as f64;
@@ -270,24 +341,33 @@ impl OverlayGrid {
         }
     }
 
-    fn tick(&mut self) {
-        if let Some(ref anim) = self.anim {
-            let dur = self.cursor_anim_dur.as_secs_f64();
-            let t = if dur > 0.0 {
-                (anim.start.elapsed().as_secs_f64() / dur).min(1.0)
-            } else {
-                1.0
-            };
-            let e = ease_out_cubic(t);
+    /// Whether a cursor slide still needs frames.
+    fn is_animating(&self) -> bool {
+        self.anim.is_some()
+    }
 
-            self.cur_x = anim.from_x + (anim.to_x - anim.from_x) * e;
-            self.cur_y = anim.from_y + (anim.to_y - anim.from_y) * e;
-            self.apply_cursor_pos();
+    /// Step the cursor slide to the frame at `frame_us` (frame clock time,
+    /// µs).  Returns whether the slide needs further frames.
+    fn tick(&mut self, frame_us: i64) -> bool {
+        let dur = self.cursor_anim_dur.as_secs_f64();
+        let Some(ref mut anim) = self.anim else {
+            return false;
+        };
+        let start_us = *anim.start_us.get_or_insert(frame_us);
+        let t = if dur > 0.0 {
+            ((frame_us - start_us) as f64 / 1e6 / dur).clamp(0.0, 1.0)
+        } else {
+            1.0
+        };
+        let e = ease_out_cubic(t);
 
-            if t >= 1.0 {
-                self.anim = None;
-            }
+        self.cur_x = anim.from_x + (anim.to_x - anim.from_x) * e;
+        self.cur_y = anim.from_y + (anim.to_y - anim.from_y) * e;
+        if t >= 1.0 {
+            self.anim = None;
         }
+        self.apply_cursor_pos();
+        self.anim.is_some()
     }
 
     //  internals 
@@ -305,7 +385,7 @@ impl OverlayGrid {
             from_y: self.cur_y,
             to_x: x,
             to_y: y,
-            start: Instant::now(),
+            start_us: None,
         });
     }
 
@@ -317,79 +397,227 @@ impl OverlayGrid {
     }
 
     fn apply_cursor_pos(&self) {
-        self.cursor.set_margin_start(self.cur_x.round() as i32);
-        self.cursor.set_margin_top(self.cur_y.round() as i32);
+        self.cursor_layer
+            .move_(&self.cursor, self.cur_x.round(), self.cur_y.round());
     }
 
-    fn rebuild_cells(
-        &mut self,
-        display_cols: usize,
-        display_rows: usize,
-        _base_cols: usize,
-        _base_rows: usize,
-    ) {
-        for cell in self.cells.drain(..) {
-            self.grid_widget.remove(&cell);
+    /// Move the view's first cell to `origin`.  The cells stay and show
+    /// other grid positions; the cursor keeps its place on the grid, so a
+    /// slide carries on from where it was.
+    fn scroll_to(&mut self, origin: (usize, usize)) {
+        self.clear_marks();
+        let old = self.origin.replace(origin);
+        let dx = (old.0 as f64 - origin.0 as f64) * CELL_PITCH as f64;
+        let dy = (old.1 as f64 - origin.1 as f64) * CELL_PITCH as f64;
+        self.cur_x += dx;
+        self.cur_y += dy;
+        if let Some(anim) = &mut self.anim {
+            anim.from_x += dx;
+            anim.from_y += dy;
+            anim.to_x += dx;
+            anim.to_y += dy;
         }
-        self.cols = display_cols;
-        self.rows = display_rows;
-        self.cells.reserve(display_cols * display_rows);
-
-        for row in 0..display_rows {
-            for col in 0..display_cols {
-                let cell = gtk4::Box::new(gtk4::Orientation::Vertical, 0);
-                cell.add_css_class("grid-cell");
-                cell.set_size_request(CELL_SIZE, CELL_SIZE);
-                self.grid_widget
-                    .attach(&cell, col as i32, row as i32, 1, 1);
-
-                if let Some(ref on_click) = self.on_cell_click {
-                    let gesture = gtk4::GestureClick::new();
-                    gesture.set_button(1); // left mouse button
-                    let cb: Rc<dyn Fn(usize, usize)> = Rc::clone(on_click);
-                    gesture.connect_released(move |_, _, _, _| {
-                        cb(col, row);
-                    });
-                    cell.add_controller(gesture);
-                }
+        // A slide from a cell that just scrolled out starts at the edge.
+        self.cur_x = self.cur_x.max(CELL_MARGIN as f64);
+        self.cur_y = self.cur_y.max(CELL_MARGIN as f64);
+        if let Some(anim) = &mut self.anim {
+            anim.from_x = anim.from_x.max(CELL_MARGIN as f64);
+            anim.from_y = anim.from_y.max(CELL_MARGIN as f64);
+        }
+        self.apply_cursor_pos();
+    }
 
+    /// Resize to `cols` × `rows`, keeping the cells that stay in range
+    /// (and with them their cached rendering).
+    fn resize_cells(&mut self, cols: usize, rows: usize) {
+        let (old_cols, old_rows) = (self.cols, self.rows);
+        let mut old: Vec<Option<gtk4::Box>> = self.cells.drain(..).map(Some).collect();
+        for (i, slot) in old.iter_mut().enumerate() {
+            if i % old_cols >= cols || i / old_cols >= rows {
+                if let Some(cell) = slot.take() {
+                    self.grid_widget.remove(&cell);
+                }
+            }
+        }
+        self.cols = cols;
+        self.rows = rows;
+        self.cells.reserve(cols * rows);
+
+        for row in 0..rows {
+            for col in 0..cols {
+                let kept = if col < old_cols && row < old_rows {
+                    old[row * old_cols + col].take()
+                } else {
+                    None
+                };
+                let cell = kept.unwrap_or_else(|| self.new_cell(col, row));
                 self.cells.push(cell);
             }
         }
     }
 
-    fn apply_classes(&self, state: &VisualizerState) {
-        let is_gesture = state.offset_x != 0.0 || state.offset_y != 0.0;
-        let effective_target = state
-            .target_cell
-            .unwrap_or((state.col, state.row));
+    fn new_cell(&self, col: usize, row: usize) -> gtk4::Box {
+        let cell = gtk4::Box::new(gtk4::Orientation::Vertical, 0);
+        cell.add_css_class("grid-cell");
+        cell.set_size_request(CELL_SIZE, CELL_SIZE);
+        self.grid_widget
+            .attach(&cell, col as i32, row as i32, 1, 1);
+
+        if let Some(ref on_click) = self.on_cell_click {
+            let gesture = gtk4::GestureClick::new();
+            gesture.set_button(1); // left mouse button
+            let cb: Rc<dyn Fn(usize, usize)> = Rc::clone(on_click);
+            let origin = Rc::clone(&self.origin);
+            gesture.connect_released(move |_, _, _, _| {
+                let (col0, row0) = origin.get();
+                cb(col0 + col, row0 + row);
+            });
+            cell.add_controller(gesture);
+        }
+        cell
+    }
 
-        let is_tobecreated_cell = is_gesture
-            && (effective_target.0 >= state.cols || effective_target.1 >= state.rows);
+    /// Take the classes off the marked cells.
+    fn clear_marks(&mut self) {
+        let Some(old) = self.marks.take() else {
+            return;
+        };
+        for pos in [Some(old.active), old.target].into_iter().flatten() {
+            if let Some(cell) = self.cell_at(pos) {
+                set_class(cell, "active", false);
+                set_class(cell, "target", false);
+                set_class(cell, "tobecreated", false);
+            }
+        }
+    }
 
-        for row in 0..self.rows {
-            for col in 0..self.cols {
-                let cell = &self.cells[row * self.cols + col];
-                let is_active = col == state.col && row == state.row;
-                let is_target = is_gesture && col == effective_target.0 && row == effective_target.1;
-                let is_tobecreated =
-                    is_tobecreated_cell && col == effective_target.0 && row == effective_target.1;
+    /// The widget showing grid cell `(col, row)`, if it is in view.
+    fn cell_at(&self, (col, row): (usize, usize)) -> Option<&gtk4::Box> {
+        let (col0, row0) = self.origin.get();
+        let view = Viewport { col: col0, row: row0, cols: self.cols, rows: self.rows };
+        view.local((col, row)).map(|(c, r)| &self.cells[r * self.cols + c])
+    }
 
-                if is_active {
-                    cell.add_css_class("active");
-                } else {
-                    cell.remove_css_class("active");
-                }
-                if is_target {
-                    cell.add_css_class("target");
-                } else {
-                    cell.remove_css_class("target");
-                }
-                if is_tobecreated {
-                    cell.add_css_class("tobecreated");
-                } else {
-                    cell.remove_css_class("tobecreated");
-                }
+    /// Move the classes from the previously marked cells to `marks`,
+    /// touching only the cells that were or become marked.
+    fn apply_marks(&mut self, marks: CellMarks) {
+        let old = self.marks.replace(marks);
+        let mut touched = [Some(marks.active), marks.target, None, None];
+        if let Some(old) = old {
+            touched[2] = Some(old.active);
+            touched[3] = old.target;
+        }
+        for (i, pos) in touched.iter().enumerate() {
+            let Some(pos) = *pos else {
+                continue;
+            };
+            if touched[..i].contains(&Some(pos)) {
+                continue;
+            }
+            let Some(cell) = self.cell_at(pos) else {
+                continue;
+            };
+            let (is_active, is_target, is_tobecreated) = marks.classes_at(pos);
+            set_class(cell, "active", is_active);
+            set_class(cell, "target", is_target);
+            set_class(cell, "tobecreated", is_tobecreated);
+        }
+    }
+}
+
+fn set_class(widget: &impl IsA<gtk4::Widget>, class: &str, on: bool) {
+    if widget.has_css_class(class) == on {
+        return;
+    }
+    if on {
+        widget.add_css_class(class);
+    } else {
+        widget.remove_css_class(class);
+    }
+}
+
+//  Gesture latency probe 
+
+/// Traced updates summarised per latency report.
+const LATENCY_REPORT_WINDOW: usize = 240;
+/// Painted frames kept waiting for presentation feedback before falling
+/// back to their paint time.
+const MAX_AWAITING_PRESENTATION: usize = 8;
+
+/// A painted frame whose presentation time is not known yet.
+struct PaintedFrame {
+    counter: i64,
+    painted_ns: u64,
+    traces: Vec<InputTrace>,
+}
+
+/// Matches gesture latency traces (see [`crate::latency`]) to the frame
+/// that first showed them and logs p50/p99 per stage under the
+/// `hyprgrd::latency` target.
+struct LatencyProbe {
+    /// Traces received since the last paint.
+    pending: Vec<InputTrace>,
+    painted: VecDeque<PaintedFrame>,
+    tracker: LatencyTracker,
+    clock: Option<glib::WeakRef<gdk::FrameClock>>,
+}
+
+impl LatencyProbe {
+    fn new() -> Rc<RefCell<Self>> {
+        Rc::new(RefCell::new(Self {
+            pending: Vec::new(),
+            painted: VecDeque::new(),
+            tracker: LatencyTracker::new(LATENCY_REPORT_WINDOW),
+            clock: None,
+        }))
+    }
+
+    /// Follow the window's current frame clock; the surface (and with it
+    /// the clock) can be recreated when the overlay moves monitors.
+    fn attach(probe: &Rc<RefCell<Self>>, window: &gtk4::Window) {
+        let Some(clock) = window.frame_clock() else {
+            return;
+        };
+        let current = probe.borrow().clock.as_ref().and_then(|w| w.upgrade());
+        if current.as_ref() == Some(&clock) {
+            return;
+        }
+        let weak = Rc::downgrade(probe);
+        clock.connect_after_paint(move |clock| {
+            if let Some(probe) = weak.upgrade() {
+                probe.borrow_mut().after_paint(clock);
+            }
+        });
+        probe.borrow_mut().clock = Some(clock.downgrade());
+    }
+
+    fn after_paint(&mut self, clock: &gdk::FrameClock) {
+        if !self.pending.is_empty() {
+            self.painted.push_back(PaintedFrame {
+                counter: clock.frame_counter(),
+                painted_ns: monotonic_ns(),
+                traces: std::mem::take(&mut self.pending),
+            });
+        }
+        // Presentation feedback for a frame arrives a frame or two later.
+        while let Some(frame) = self.painted.front() {
+            let presented_ns = match clock.timings(frame.counter) {
+                Some(t) if t.is_complete() => match t.presentation_time() {
+                    0 => frame.painted_ns,
+                    // GDK frame times are CLOCK_MONOTONIC microseconds.
+                    us => us as u64 * 1_000,
+                },
+                Some(_) if self.painted.len() <= MAX_AWAITING_PRESENTATION => break,
+                _ => frame.painted_ns,
+            };
+            let frame = self.painted.pop_front().expect("front exists");
+            for trace in &frame.traces {
+                self.tracker.record(trace, presented_ns);
+            }
+        }
+        if let Some(report) = self.tracker.take_report() {
+            for stage in report {
+                info!(target: "hyprgrd::latency", "{}", stage);
             }
         }
     }
@@ -478,10 +706,14 @@ pub fn run_main_loop(
     };
 
     //  Persistent overlay grid
-    let mut overlay_grid = OverlayGrid::new(&container, &vis_config, Some(on_cell_click));
+    let overlay_grid = Rc::new(RefCell::new(OverlayGrid::new(
+        &container,
+        &vis_config,
+        Some(on_cell_click),
+    )));
 
     //  Initial render + present (maps the Wayland surface)
-    overlay_grid.update(&initial_state);
+    overlay_grid.borrow_mut().update(&initial_state);
     window.present();
     window.set_visible(false);
     info!(
@@ -501,27 +733,75 @@ pub fn run_main_loop(
     );
 
     //  Visibility state machine
-    let mut visibility = Visibility::Hidden;
+    let visibility = Rc::new(Cell::new(Visibility::Hidden));
 
-    //  Main event loop (~60 fps)
+    let latency_probe = LatencyProbe::new();
+
+    //  Frame-clock animation (cursor slide + fade-out)
+    let frame_step: Rc<dyn Fn(i64) -> bool> = {
+        let overlay_grid = Rc::clone(&overlay_grid);
+        let visibility = Rc::clone(&visibility);
+        let shown_kind = Rc::clone(&shown_kind);
+        let window = window.clone();
+        let container = container.clone();
+        Rc::new(move |frame_us| {
+            let sliding = overlay_grid.borrow_mut().tick(frame_us);
+            let Visibility::Fading(since) = visibility.get() else {
+                return sliding;
+            };
+            let t = (since.elapsed().as_secs_f64() / fade_dur.as_secs_f64()).min(1.0);
+            container.set_opacity(1.0 - t);
+            if t < 1.0 {
+                return true;
+            }
+            window.set_visible(false);
+            container.set_opacity(1.0); // reset for next show
+            visibility.set(Visibility::Hidden);
+            shown_kind.set(ShownKind::Hidden);
+            false
+        })
+    };
+    let ticking = Rc::new(Cell::new(false));
+    let start_ticking = {
+        let container = container.clone();
+        move || {
+            if ticking.replace(true) {
+                return;
+            }
+            let ticking = Rc::clone(&ticking);
+            let frame_step = Rc::clone(&frame_step);
+            container.add_tick_callback(move |_, clock| {
+                if frame_step(clock.frame_time()) {
+                    glib::ControlFlow::Continue
+                } else {
+                    ticking.set(false);
+                    glib::ControlFlow::Break
+                }
+            });
+        }
+    };
+
+    //  Main event loop: drains the channels every 16 ms; animation runs on
+    //  the frame clock above.
     let dispatch_cell = Rc::new(RefCell::new(dispatch));
     let shown_kind_for_loop = Rc::clone(&shown_kind);
     let dispatch_for_loop = Rc::clone(&dispatch_cell);
+    let mut intake = CommandIntake::new(cmd_rx);
     glib::timeout_add_local(Duration::from_millis(16), move || {
         // 1. Drain commands and forward to the switcher via the dispatch callback.
+        //    What piled up since the last tick is merged by priority.
         let mut disconnected = false;
         loop {
-            match cmd_rx.try_recv() {
-                Ok(cmd) => {
-                    debug!("command: {:?}", cmd);
-                    dispatch_for_loop.borrow_mut()(cmd);
-                }
+            let cmd = match intake.try_recv() {
+                Ok(cmd) => cmd,
                 Err(mpsc::TryRecvError::Empty) => break,
                 Err(mpsc::TryRecvError::Disconnected) => {
                     disconnected = true;
                     break;
                 }
-            }
+            };
+            debug!("command: {:?}", cmd);
+            dispatch_for_loop.borrow_mut()(cmd);
         }
 
         // 2. Drain visualizer events.
@@ -535,7 +815,7 @@ pub fn run_main_loop(
                         state.offset_x, state.offset_y
                     );
 
-                    overlay_grid.update(state);
+                    overlay_grid.borrow_mut().update(state);
                     container.set_opacity(1.0);
                     container.remove_css_class("mode-manual");
                     container.add_css_class("mode-auto");
@@ -555,8 +835,15 @@ pub fn run_main_loop(
 
                     window.set_visible(true);
                     window.present();
-                    visibility = Visibility::Visible;
+                    visibility.set(Visibility::Visible);
                     shown_kind_for_loop.set(ShownKind::AutomaticallyShown);
+
+                    if let Some(trace) = payload.trace {
+                        LatencyProbe::attach(&latency_probe, &window);
+                        latency_probe.borrow_mut().pending.push(trace);
+                        // Make sure a frame follows even if nothing moved.
+                        window.queue_draw();
+                    }
                 }
                 VisualizerEvent::ToggleManual(payload) => {
                     let state = &payload.state;
@@ -568,7 +855,7 @@ pub fn run_main_loop(
                             container.remove_css_class("mode-auto");
                             container.remove_css_class("mode-manual");
                             window.set_cursor_from_name(None::<&str>);
-                            visibility = Visibility::Hidden;
+                            visibility.set(Visibility::Hidden);
                             shown_kind_for_loop.set(ShownKind::Hidden);
                         }
                         ShownKind::Hidden | ShownKind::AutomaticallyShown => {
@@ -576,7 +863,7 @@ pub fn run_main_loop(
                                 "TOGGLE_MANUAL → show {}x{} pos=({},{})",
                                 state.cols, state.rows, state.col, state.row
                             );
-                            overlay_grid.update(state);
+                            overlay_grid.borrow_mut().update(state);
                             container.set_opacity(1.0);
                             container.remove_css_class("mode-auto");
                             container.add_css_class("mode-manual");
@@ -596,7 +883,7 @@ pub fn run_main_loop(
 
                             window.set_visible(true);
                             window.present();
-                            visibility = Visibility::Visible;
+                            visibility.set(Visibility::Visible);
                             shown_kind_for_loop.set(ShownKind::ManuallyShown);
                         }
                     }
@@ -615,7 +902,7 @@ pub fn run_main_loop(
                             container.remove_css_class("mode-auto");
                             container.remove_css_class("mode-manual");
                             window.set_cursor_from_name(None::<&str>);
-                            visibility = Visibility::Hidden;
+                            visibility.set(Visibility::Hidden);
                             shown_kind_for_loop.set(ShownKind::Hidden);
                         }
                         ShownKind::AutomaticallyShown => {
@@ -625,7 +912,7 @@ pub fn run_main_loop(
                                 linger_dur.as_millis(),
                                 fade_dur.as_millis()
                             );
-                            visibility = Visibility::Lingering(Instant::now());
+                            visibility.set(Visibility::Lingering(Instant::now()));
                             // We'll mark Hidden once the fade finishes.
                         }
                     }
@@ -633,36 +920,28 @@ pub fn run_main_loop(
             }
         }
 
-        // 3. Advance cursor animation.
-        overlay_grid.tick();
-
-        // 4. Advance visibility state machine.
-        match visibility {
-            Visibility::Hidden | Visibility::Visible => {}
-            Visibility::Lingering(since) => {
-                if since.elapsed() >= linger_dur {
-                    if fade_dur.is_zero() {
-                        // Instant hide, no fade.
-                        window.set_visible(false);
-                        container.set_opacity(1.0);
-                        visibility = Visibility::Hidden;
-                    } else {
-                        visibility = Visibility::Fading(Instant::now());
-                    }
-                }
-            }
-            Visibility::Fading(since) => {
-                let t = (since.elapsed().as_secs_f64() / fade_dur.as_secs_f64()).min(1.0);
-                container.set_opacity(1.0 - t);
-                if t >= 1.0 {
+        // 3. End the linger; the fade itself runs on the frame clock.
+        if let Visibility::Lingering(since) = visibility.get() {
+            if since.elapsed() >= linger_dur {
+                if fade_dur.is_zero() {
+                    // Instant hide, no fade.
                     window.set_visible(false);
-                    container.set_opacity(1.0); // reset for next show
-                    visibility = Visibility::Hidden;
+                    container.set_opacity(1.0);
+                    visibility.set(Visibility::Hidden);
                     shown_kind_for_loop.set(ShownKind::Hidden);
+                } else {
+                    visibility.set(Visibility::Fading(Instant::now()));
                 }
             }
         }
 
+        // 4. Start frame ticks for a new slide or fade.
+        if overlay_grid.borrow().is_animating()
+            || matches!(visibility.get(), Visibility::Fading(_))
+        {
+            start_ticking();
+        }
+
         if disconnected {
             info!("all sources closed — exiting");
             return glib::ControlFlow::Break;
@@ -3,7 +3,8 @@
 //! When the `visualizer-gtk` feature is enabled, the
 //! [`gtk::run_main_loop`] function takes over the main thread and
 //! drives both command processing and overlay rendering through the
-//! GLib main loop.
+//! GLib main loop.  [`viewport`] decides which cells it draws.
 
 #[cfg(feature = "visualizer-gtk")]
 pub mod gtk;
+pub mod viewport;
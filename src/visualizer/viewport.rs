@@ -0,0 +1,83 @@
+//! The part of the grid the overlay shows.
+//!
+//! Scripts can switch to cells hundreds of columns away, and the grid grows
+//! to contain them.  Drawing every cell would make the overlay as large as
+//! the grid and its cost grow with it, so the overlay shows at most
+//! [`VIEWPORT_CELLS`] cells along each axis, around the cursor.  The
+//! plugin's overlay (`overlayViewportAxis` in plugin/overlay.hpp) does the
+//! same; keep the two in sync.
+
+/// Most cells the overlay shows along each axis.
+pub const VIEWPORT_CELLS: usize = 9;
+
+/// The cells in view: the first column and row, and how many of each.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct Viewport {
+    pub col: usize,
+    pub row: usize,
+    pub cols: usize,
+    pub rows: usize,
+}
+
+impl Viewport {
+    /// The view of a `cols × rows` grid for the cursor at `shown`, keeping
+    /// `reach` (a gesture's target, at most one cell away) in view too.
+    pub fn around(cols: usize, rows: usize, shown: (usize, usize), reach: (usize, usize)) -> Self {
+        let (col, cols) = viewport_axis(cols, shown.0, reach.0);
+        let (row, rows) = viewport_axis(rows, shown.1, reach.1);
+        Self { col, row, cols, rows }
+    }
+
+    /// `(col, row)` relative to the view, or `None` if it is out of view.
+    pub fn local(&self, (col, row): (usize, usize)) -> Option<(usize, usize)> {
+        let (c, r) = (col.checked_sub(self.col)?, row.checked_sub(self.row)?);
+        (c < self.cols && r < self.rows).then_some((c, r))
+    }
+}
+
+/// First shown cell and number of shown cells along one axis of an
+/// `n`-cell grid: `shown` as near the middle as the edges allow, with
+/// `reach` still in view.
+fn viewport_axis(n: usize, shown: usize, reach: usize) -> (usize, usize) {
+    let len = n.min(VIEWPORT_CELLS);
+    let mut start = shown.saturating_sub(VIEWPORT_CELLS / 2).min(n - len);
+    if reach >= start + len {
+        start = reach + 1 - len;
+    } else if reach < start {
+        start = reach;
+    }
+    (start, len)
+}
+
+//  Tests
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn small_grids_are_shown_whole() {
+        let view = Viewport::around(3, 2, (2, 1), (2, 1));
+        assert_eq!(view, Viewport { col: 0, row: 0, cols: 3, rows: 2 });
+        assert_eq!(view.local((2, 1)), Some((2, 1)));
+    }
+
+    #[test]
+    fn viewport_axis_follows_the_cursor() {
+        // Same cases as `overlay_viewport_axis_follows_the_cursor` in
+        // plugin/test_plugin.cpp.
+        assert_eq!(viewport_axis(500, 0, 0), (0, 9));
+        assert_eq!(viewport_axis(500, 200, 200), (196, 9));
+        assert_eq!(viewport_axis(500, 499, 499), (491, 9));
+        assert_eq!(viewport_axis(501, 499, 500), (492, 9));
+    }
+
+    #[test]
+    fn cells_out_of_view_have_no_local_position() {
+        let view = Viewport::around(400, 300, (250, 1), (251, 1));
+        assert_eq!((view.col, view.row, view.cols, view.rows), (246, 0, 9, 9));
+        assert_eq!(view.local((251, 1)), Some((5, 1)));
+        assert_eq!(view.local((245, 1)), None);
+        assert_eq!(view.local((255, 0)), None);
+    }
+}